@@ -594,8 +594,14 @@ std::vector<uint8_t> Tilemap2D::CompressLZ77() const
 uint32_t Tilemap2D::UncompressLZ77(const std::vector<uint8_t>& data)
 {
 	std::size_t elen = 0;
+	std::size_t dlen = 0;
 	std::vector<uint8_t> result(65536);
-	auto dlen = LZ77::Decode(data.data(), data.size(), result.data(), elen);
+	// Maps have always been accepted without an end marker
+	const auto decoded = LZ77::Decode(data.data(), data.size(), result.data(), result.size(), elen, dlen);
+	if (decoded != LZ77::DecodeResult::OK && decoded != LZ77::DecodeResult::MISSING_END_MARKER)
+	{
+		throw std::runtime_error("Bad LZ77 compressed map!");
+	}
 	result.resize(dlen);
 	if (result.size() < 4) throw std::runtime_error("Bad LZ77 compressed map!");
 	m_left = result[0];
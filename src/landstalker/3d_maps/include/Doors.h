@@ -9,6 +9,8 @@
 #include <landstalker/misc/include/Literals.h>
 #include <landstalker/3d_maps/include/Tilemap3DCmp.h>
 
+class Tilemap3DOverlay;
+
 struct Door
 {
 	enum class Size : uint8_t
@@ -47,6 +49,7 @@ struct Door
 	std::pair<int, int> GetTileOffset(std::shared_ptr<const Tilemap3D> tilemap = nullptr, const Tilemap3D::Layer& layer = Tilemap3D::Layer::BG) const;
 	std::pair<int, int> GetTileOffset(const Tilemap3D& tilemap, const Tilemap3D::Layer& layer = Tilemap3D::Layer::BG) const;
 	void DrawDoor(Tilemap3D& map, Tilemap3D::Layer layer) const;
+	void DrawDoor(Tilemap3DOverlay& overlay) const;
 
 	bool operator==(const Door& rhs) const;
 	bool operator!=(const Door& rhs) const;
@@ -1,14 +1,45 @@
 #ifndef _MAP_TO_TMX_H_
 #define _MAP_TO_TMX_H_
 
+#include <memory>
 #include <string>
+#include <vector>
 #include <landstalker/main/include/DataTypes.h>
 
 class MapToTmx
 {
 public:
+	enum class Encoding
+	{
+		CSV,
+		BASE64_ZLIB
+	};
+
+	struct ExportRequest
+	{
+		std::string filename;
+		std::shared_ptr<const Tilemap3D> map;
+		std::string blockset_filename;
+	};
+
+	struct ImportRequest
+	{
+		std::string filename;
+		std::shared_ptr<Tilemap3D> map;
+	};
+
 	static bool ImportFromTmx(const std::string& fname, Tilemap3D& map);
-	static bool ExportToTmx(const std::string& fname, const Tilemap3D& map, const std::string& blockset_filename);
+	static bool ExportToTmx(const std::string& fname, const Tilemap3D& map, const std::string& blockset_filename, Encoding encoding = Encoding::CSV);
+
+	// The same conversions on a TMX document held in memory. Layers may be CSV or base64
+	// encoded, and base64 layers may be uncompressed or zlib / gzip compressed.
+	static bool ParseTmx(const std::string& tmx, Tilemap3D& map);
+	static std::string MakeTmx(const Tilemap3D& map, const std::string& name, const std::string& blockset_filename, Encoding encoding = Encoding::CSV);
+
+	// Converts every request on the task pool. Each request must name a different file, and
+	// each import a different map. Returns the files that could not be converted.
+	static std::vector<std::string> ImportAll(const std::vector<ImportRequest>& requests);
+	static std::vector<std::string> ExportAll(const std::vector<ExportRequest>& requests, Encoding encoding = Encoding::CSV);
 };
 
-#endif // _MAP_TO_TMX_H_
\ No newline at end of file
+#endif // _MAP_TO_TMX_H_
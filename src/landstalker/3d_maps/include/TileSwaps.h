@@ -7,6 +7,8 @@
 #include <memory>
 #include <landstalker/3d_maps/include/Tilemap3DCmp.h>
 
+class Tilemap3DOverlay;
+
 struct TileSwap
 {
 	enum class Mode : uint8_t
@@ -43,6 +45,7 @@ struct TileSwap
 	std::pair<int, int> GetTileOffset(TileSwap::Region region = TileSwap::Region::UNDEFINED, std::shared_ptr<const Tilemap3D> tilemap = nullptr, const Tilemap3D::Layer& layer = Tilemap3D::Layer::BG) const;
 	std::pair<int, int> GetRelTileOffset(const Tilemap3D::Layer& layer = Tilemap3D::Layer::BG) const;
 	void DrawSwap(Tilemap3D& map, Tilemap3D::Layer layer) const;
+	void DrawSwap(Tilemap3DOverlay& overlay) const;
 	void DrawHeightmapSwap(Tilemap3D& map) const;
 	bool IsHeightmapPointInSwap(int x, int y) const;
 
@@ -1,10 +1,13 @@
 #ifndef TILEMAP3DCMP_H
 #define TILEMAP3DCMP_H
 
+#include <atomic>
 #include <cstdint>
 #include <cstdlib>
 #include <vector>
 
+class BitWriter;
+
 struct Point2D
 {
     int x;
@@ -82,6 +85,11 @@ public:
         ICE_NW = 45,
         HEALTH_RECOVER = 46
     };
+    enum class Level
+    {
+        FAST,    // Offset dictionary holds the most frequent back offsets, as the original data was compressed
+        MAXIMUM  // Offset dictionary is refined by trial encoding, slower to encode
+    };
 
     Tilemap3D()
     : foreground(),
@@ -91,17 +99,24 @@ public:
     {
     }
 
-    Tilemap3D(const uint8_t* src)
+    Tilemap3D(const uint8_t* src, size_t size)
         : tile_width(8), tile_height(8)
     {
-        Decode(src);
+        Decode(src, size);
     }
 
     bool operator==(const Tilemap3D& rhs) const;
     bool operator!=(const Tilemap3D& rhs) const;
 
-    uint16_t Decode(const uint8_t* src);
+    uint16_t Decode(const uint8_t* src, size_t size);
     uint16_t Encode(uint8_t* dst, size_t size);
+    uint16_t Encode(uint8_t* dst, size_t size, Level level);
+    // Plain copy of the map state, with no compression. Used to cache decoded maps.
+    std::vector<uint8_t> EncodeUncompressed() const;
+    bool DecodeUncompressed(const uint8_t* src, size_t size);
+
+    static void SetDefaultLevel(Level level);
+    static Level GetDefaultLevel();
 
     uint8_t GetLeft() const;
     uint8_t GetTop() const;
@@ -161,6 +176,11 @@ public:
     uint16_t GetHeightmapCell(const HMPoint2D& iso) const;
     bool SetHeightmapCell(const HMPoint2D& iso, uint16_t value);
 private:
+    void EncodeTiles(const std::vector<uint16_t>& tiles, const std::vector<uint16_t>& offsets, BitWriter& cmap, bool trace) const;
+
+    // Set from the UI thread while encoders may be running on the task pool
+    static std::atomic<int> s_default_level;
+
     std::vector<uint16_t> foreground;
     std::vector<uint16_t> background;
     std::vector<uint16_t> heightmap;
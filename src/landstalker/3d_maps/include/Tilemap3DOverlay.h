@@ -0,0 +1,41 @@
+#ifndef _TILEMAP_3D_OVERLAY_H_
+#define _TILEMAP_3D_OVERLAY_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <landstalker/3d_maps/include/Tilemap3DCmp.h>
+#include <landstalker/3d_maps/include/TileSwaps.h>
+#include <landstalker/3d_maps/include/Doors.h>
+
+// One layer of a map as it is displayed with tile swaps and doors applied. Cells that have been
+// replaced are held in a small overlay; all other lookups go to the map, which is never copied or
+// modified and must outlive the overlay.
+class Tilemap3DOverlay
+{
+public:
+    Tilemap3DOverlay(const Tilemap3D& map, Tilemap3D::Layer layer);
+    Tilemap3DOverlay(const Tilemap3D& map, Tilemap3D::Layer layer, const std::vector<TileSwap>& swaps, const std::vector<Door>& doors);
+
+    const Tilemap3D& GetMap() const { return m_map; }
+    Tilemap3D::Layer GetLayer() const { return m_layer; }
+    uint8_t GetLeft() const { return m_map.GetLeft(); }
+    uint8_t GetTop() const { return m_map.GetTop(); }
+    uint8_t GetWidth() const { return m_map.GetWidth(); }
+    uint8_t GetHeight() const { return m_map.GetHeight(); }
+
+    // Same as the Tilemap3D equivalents, for this overlay's layer only
+    uint16_t GetBlock(const IsoPoint2D& iso) const;
+    uint16_t GetBlock(const IsoPoint2D& iso, Tilemap3D::Layer layer) const;
+    bool SetBlock(const BlockLoc& loc, Tilemap3D::Layer layer);
+
+    // The cells that differ from the map, as (cell index, block) sorted by index
+    const std::vector<std::pair<uint16_t, uint16_t>>& GetOverlaidCells() const { return m_cells; }
+private:
+    const Tilemap3D& m_map;
+    Tilemap3D::Layer m_layer;
+    std::vector<std::pair<uint16_t, uint16_t>> m_cells;
+};
+
+#endif // _TILEMAP_3D_OVERLAY_H_
@@ -2,6 +2,7 @@
 #include <algorithm>
 #include <iterator>
 #include <landstalker/3d_maps/include/TileSwaps.h>
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
 
 Doors::Doors(const std::vector<uint8_t>& offsets, const std::vector<uint8_t>& bytes)
 {
@@ -194,28 +195,53 @@ std::pair<int, int> Door::GetTileOffset(const Tilemap3D& tilemap, const Tilemap3
 	return offset;
 }
 
-void Door::DrawDoor(Tilemap3D& tilemap, Tilemap3D::Layer layer) const
+namespace
+{
+void DrawSwapOnto(const TileSwap& swap, Tilemap3D& tilemap, Tilemap3D::Layer layer)
+{
+	swap.DrawSwap(tilemap, layer);
+}
+
+void DrawSwapOnto(const TileSwap& swap, Tilemap3DOverlay& overlay, Tilemap3D::Layer /*layer*/)
+{
+	swap.DrawSwap(overlay);
+}
+
+// The door is drawn as a wall swap, onto either a map or an overlay of one
+template <class Map>
+void DrawDoorOnto(const Door& door, const Tilemap3D& base, Map& tilemap, Tilemap3D::Layer layer)
 {
 	if (layer == Tilemap3D::Layer::BG)
 	{
 		return;
 	}
-	Tilemap3D::FloorType type = static_cast<Tilemap3D::FloorType>(tilemap.GetCellType({ x, y }));
-	int z = tilemap.GetHeight({ x, y });
+	Tilemap3D::FloorType type = static_cast<Tilemap3D::FloorType>(base.GetCellType({ door.x, door.y }));
+	int z = base.GetHeight({ door.x, door.y });
 
 	TileSwap ts;
 	ts.map.src_x = 255;
 	ts.map.src_y = 255;
-	ts.map.dst_x = static_cast<uint8_t>(12 + x - z - Door::SIZES.at(size).second + (type == Tilemap3D::FloorType::DOOR_NW ? 1 : 0));
-	ts.map.dst_y = static_cast<uint8_t>(12 + y - z - Door::SIZES.at(size).second + (type == Tilemap3D::FloorType::DOOR_NW ? 1 : 0));
-	ts.map.width = SIZES.at(size).first;
-	ts.map.height = SIZES.at(size).second;
+	ts.map.dst_x = static_cast<uint8_t>(12 + door.x - z - Door::SIZES.at(door.size).second + (type == Tilemap3D::FloorType::DOOR_NW ? 1 : 0));
+	ts.map.dst_y = static_cast<uint8_t>(12 + door.y - z - Door::SIZES.at(door.size).second + (type == Tilemap3D::FloorType::DOOR_NW ? 1 : 0));
+	ts.map.width = Door::SIZES.at(door.size).first;
+	ts.map.height = Door::SIZES.at(door.size).second;
 	if (type != Tilemap3D::FloorType::DOOR_NE && type != Tilemap3D::FloorType::DOOR_NW)
 	{
 		return;
 	}
 	ts.mode = (type == Tilemap3D::FloorType::DOOR_NE) ? TileSwap::Mode::WALL_NE : TileSwap::Mode::WALL_NW;
-	ts.DrawSwap(tilemap, layer);
+	DrawSwapOnto(ts, tilemap, layer);
+}
+}
+
+void Door::DrawDoor(Tilemap3D& tilemap, Tilemap3D::Layer layer) const
+{
+	DrawDoorOnto(*this, tilemap, tilemap, layer);
+}
+
+void Door::DrawDoor(Tilemap3DOverlay& overlay) const
+{
+	DrawDoorOnto(*this, overlay.GetMap(), overlay, overlay.GetLayer());
 }
 
 bool Door::operator==(const Door& rhs) const
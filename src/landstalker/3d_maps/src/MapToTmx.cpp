@@ -1,157 +1,530 @@
 #include <landstalker/3d_maps/include/MapToTmx.h>
-#include <sstream>
-#include <iomanip>
-#include <wx/filename.h>
-#include <wx/xml/xml.h>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <zlib.h>
+#include <landstalker/misc/include/TaskPool.h>
 
-std::string GetData(const Tilemap3D& map, Tilemap3D::Layer layer)
+namespace
 {
-	std::ostringstream ss;
-	int i = 0;
-	for (int y = 0; y < map.GetHeight(); ++y)
+	const char BASE64_CHARS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	void AppendUInt(std::string& out, uint32_t value, int min_digits = 1)
+	{
+		char digits[10];
+		int count = 0;
+		do
+		{
+			digits[count++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		for (int i = count; i < min_digits; ++i)
+		{
+			out += '0';
+		}
+		while (count > 0)
+		{
+			out += digits[--count];
+		}
+	}
+
+	void AppendEscaped(std::string& out, const std::string& text)
 	{
-		for (int x = 0; x < map.GetWidth(); ++x, ++i)
+		for (char c : text)
 		{
-			ss << std::setw(4) << std::setfill('0') << (map.GetBlock({ x, y }, layer) + 1);
-			if (i < map.GetWidth() * map.GetHeight() - 1)
+			switch (c)
 			{
-				ss << ",";
+			case '&': out += "&amp;"; break;
+			case '<': out += "&lt;"; break;
+			case '>': out += "&gt;"; break;
+			case '"': out += "&quot;"; break;
+			default: out += c; break;
 			}
 		}
-		ss << std::endl;
 	}
-	return ss.str();
-}
 
-std::vector<uint16_t> ReadData(int width, int height, const wxString& csv)
-{
-	std::istringstream ss(csv.ToStdString());
-	std::vector<uint16_t> retval(width * height);
-	int x = 0, y = 0;
-    std::string row, cell;
-	while(std::getline(ss, row) && y < height)
+	void AppendAttribute(std::string& out, const char* name, const std::string& value)
 	{
-		std::istringstream rss(row);
-		while(std::getline(rss, cell, ',') && x < width)
+		out += ' ';
+		out += name;
+		out += "=\"";
+		AppendEscaped(out, value);
+		out += '"';
+	}
+
+	// The file name without its directory or extension
+	std::string GetStem(const std::string& filename)
+	{
+		const std::size_t dir = filename.find_last_of("/\\");
+		std::string name = (dir == std::string::npos) ? filename : filename.substr(dir + 1);
+		const std::size_t ext = name.find_last_of('.');
+		return (ext == std::string::npos || ext == 0) ? name : name.substr(0, ext);
+	}
+
+	void AppendCsv(std::string& out, const Tilemap3D& map, Tilemap3D::Layer layer)
+	{
+		out += '\n';
+		for (int y = 0; y < map.GetHeight(); ++y)
 		{
-			retval[x + y * width] = (std::stoi(cell) - 1) & 0x03FF;
-			x++;
+			for (int x = 0; x < map.GetWidth(); ++x)
+			{
+				AppendUInt(out, map.GetBlock({ x, y }, layer) + 1, 4);
+				if (x < map.GetWidth() - 1 || y < map.GetHeight() - 1)
+				{
+					out += ',';
+				}
+			}
+			out += '\n';
 		}
-		x = 0;
-		y++;
 	}
-	return retval;
-}
 
-bool MapToTmx::ImportFromTmx(const std::string& fname, Tilemap3D& map)
-{
-	wxXmlDocument tmx(fname);
-	int width = std::stoi(tmx.GetRoot()->GetAttribute("width").ToStdString()) - 1;
-	int height = std::stoi(tmx.GetRoot()->GetAttribute("height").ToStdString());
-	std::vector<uint16_t> fg, bg;
-	auto child = tmx.GetRoot()->GetChildren();
-	while (child)
+	void AppendBase64(std::string& out, const std::vector<uint8_t>& bytes)
+	{
+		std::size_t i = 0;
+		for (; i + 3 <= bytes.size(); i += 3)
+		{
+			const uint32_t v = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+			out += BASE64_CHARS[(v >> 18) & 0x3F];
+			out += BASE64_CHARS[(v >> 12) & 0x3F];
+			out += BASE64_CHARS[(v >> 6) & 0x3F];
+			out += BASE64_CHARS[v & 0x3F];
+		}
+		if (i < bytes.size())
+		{
+			const bool two = i + 1 < bytes.size();
+			const uint32_t v = (bytes[i] << 16) | (two ? bytes[i + 1] << 8 : 0);
+			out += BASE64_CHARS[(v >> 18) & 0x3F];
+			out += BASE64_CHARS[(v >> 12) & 0x3F];
+			out += two ? BASE64_CHARS[(v >> 6) & 0x3F] : '=';
+			out += '=';
+		}
+	}
+
+	// Tiled stores each cell as a little-endian 32-bit global tile ID
+	bool AppendBase64Zlib(std::string& out, const Tilemap3D& map, Tilemap3D::Layer layer)
+	{
+		std::vector<uint8_t> gids;
+		gids.reserve(map.GetWidth() * map.GetHeight() * 4);
+		for (int y = 0; y < map.GetHeight(); ++y)
+		{
+			for (int x = 0; x < map.GetWidth(); ++x)
+			{
+				const uint32_t gid = map.GetBlock({ x, y }, layer) + 1;
+				gids.insert(gids.end(), { static_cast<uint8_t>(gid), static_cast<uint8_t>(gid >> 8),
+					static_cast<uint8_t>(gid >> 16), static_cast<uint8_t>(gid >> 24) });
+			}
+		}
+		uLongf size = compressBound(static_cast<uLong>(gids.size()));
+		std::vector<uint8_t> compressed(size);
+		if (compress2(compressed.data(), &size, gids.data(), static_cast<uLong>(gids.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+		{
+			return false;
+		}
+		compressed.resize(size);
+		out += "\n   ";
+		AppendBase64(out, compressed);
+		out += "\n  ";
+		return true;
+	}
+
+	bool AppendLayer(std::string& out, const Tilemap3D& map, Tilemap3D::Layer layer, MapToTmx::Encoding encoding)
+	{
+		const bool bg = layer == Tilemap3D::Layer::BG;
+		out += " <layer";
+		AppendAttribute(out, "id", bg ? "1" : "2");
+		AppendAttribute(out, "name", bg ? "Background" : "Foreground");
+		AppendAttribute(out, "width", std::to_string(map.GetWidth()));
+		AppendAttribute(out, "height", std::to_string(map.GetHeight()));
+		AppendAttribute(out, "offsetx", bg ? "16" : "0");
+		AppendAttribute(out, "offsety", "0");
+		out += ">\n  <data";
+		if (encoding == MapToTmx::Encoding::BASE64_ZLIB)
+		{
+			AppendAttribute(out, "encoding", "base64");
+			AppendAttribute(out, "compression", "zlib");
+			out += '>';
+			if (!AppendBase64Zlib(out, map, layer))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			AppendAttribute(out, "encoding", "csv");
+			out += '>';
+			AppendCsv(out, map, layer);
+		}
+		out += "</data>\n </layer>\n";
+		return true;
+	}
+
+	bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	// Finds the next <name ...> tag at or after pos, and returns the offsets of its '<' and '>'
+	bool FindTag(const std::string& xml, std::size_t pos, const char* name, std::size_t& begin, std::size_t& end)
 	{
-		if (child->GetName() == "layer")
+		const std::size_t len = std::strlen(name);
+		while ((pos = xml.find('<', pos)) != std::string::npos)
 		{
-			auto grandchild = child->GetChildren();
-			if (grandchild && grandchild->GetName() == "data" && grandchild->GetChildren())
+			if (xml.compare(pos + 1, len, name) == 0 && pos + 1 + len < xml.size())
 			{
-				if(child->GetAttribute("id") == "1")
+				const char next = xml[pos + 1 + len];
+				if (IsSpace(next) || next == '>' || next == '/')
+				{
+					begin = pos;
+					end = xml.find('>', pos);
+					return end != std::string::npos;
+				}
+			}
+			++pos;
+		}
+		return false;
+	}
+
+	// Attribute values that are needed here never contain entities, so they are not unescaped
+	std::string GetAttribute(const std::string& xml, std::size_t begin, std::size_t end, const char* name)
+	{
+		const std::size_t len = std::strlen(name);
+		for (std::size_t pos = begin; pos + len + 2 < end; ++pos)
+		{
+			if (IsSpace(xml[pos]) && xml.compare(pos + 1, len, name) == 0)
+			{
+				std::size_t p = pos + 1 + len;
+				while (p < end && IsSpace(xml[p]))
+				{
+					++p;
+				}
+				if (p >= end || xml[p] != '=')
+				{
+					continue;
+				}
+				++p;
+				while (p < end && IsSpace(xml[p]))
 				{
-					bg = ReadData(width, height, grandchild->GetChildren()->GetContent().ToStdString());
+					++p;
 				}
-				else if (child->GetAttribute("id") == "2")
+				if (p >= end || (xml[p] != '"' && xml[p] != '\''))
 				{
-					fg = ReadData(width, height, grandchild->GetChildren()->GetContent().ToStdString());
+					continue;
 				}
+				const std::size_t close = xml.find(xml[p], p + 1);
+				if (close == std::string::npos || close > end)
+				{
+					return "";
+				}
+				return xml.substr(p + 1, close - p - 1);
+			}
+		}
+		return "";
+	}
+
+	bool ParseInt(const std::string& text, int& value)
+	{
+		if (text.empty() || text.size() > 9)
+		{
+			return false;
+		}
+		value = 0;
+		for (char c : text)
+		{
+			if (c < '0' || c > '9')
+			{
+				return false;
+			}
+			value = value * 10 + (c - '0');
+		}
+		return true;
+	}
+
+	// Cells are read in order, so any line breaks between them are ignored
+	bool ReadCsv(const char* p, const char* end, std::vector<uint16_t>& cells)
+	{
+		std::size_t count = 0;
+		while (p < end)
+		{
+			while (p < end && (IsSpace(*p) || *p == ','))
+			{
+				++p;
+			}
+			if (p == end)
+			{
+				break;
+			}
+			if (*p < '0' || *p > '9' || count == cells.size())
+			{
+				return false;
+			}
+			uint32_t gid = 0;
+			while (p < end && *p >= '0' && *p <= '9')
+			{
+				gid = gid * 10 + static_cast<uint32_t>(*p++ - '0');
 			}
+			cells[count++] = (gid - 1) & 0x03FF;
 		}
-		child = child->GetNext();
+		return count == cells.size();
 	}
 
-	if (width > 0 && width < 64 &&
-	    height > 0 && height < 64 &&
-		fg.size() == static_cast<std::size_t>(width * height) &&
-		bg.size() == static_cast<std::size_t>(width * height))
+	bool DecodeBase64(const char* p, const char* end, std::vector<uint8_t>& out)
 	{
-		map.Resize(width, height);
-		int i = 0;
-		for (int y = 0; y < height; ++y)
+		static const auto lookup = []()
+		{
+			std::array<int8_t, 256> table;
+			table.fill(-1);
+			for (int i = 0; i < 64; ++i)
+			{
+				table[static_cast<uint8_t>(BASE64_CHARS[i])] = static_cast<int8_t>(i);
+			}
+			return table;
+		}();
+		uint32_t bits = 0;
+		int count = 0;
+		for (; p < end; ++p)
 		{
-			for (int x = 0; x < width; ++x, ++i)
+			if (IsSpace(*p))
+			{
+				continue;
+			}
+			if (*p == '=')
+			{
+				break;
+			}
+			const int8_t v = lookup[static_cast<uint8_t>(*p)];
+			if (v < 0)
+			{
+				return false;
+			}
+			bits = (bits << 6) | static_cast<uint32_t>(v);
+			count += 6;
+			if (count >= 8)
 			{
-				map.SetBlock({ fg[i], {x, y} }, Tilemap3D::Layer::FG);
-				map.SetBlock({ bg[i], {x, y} }, Tilemap3D::Layer::BG);
+				count -= 8;
+				out.push_back(static_cast<uint8_t>(bits >> count));
 			}
 		}
 		return true;
 	}
 
-	return false;
+	bool ReadBase64(const char* p, const char* end, const std::string& compression, std::vector<uint16_t>& cells)
+	{
+		std::vector<uint8_t> bytes;
+		bytes.reserve((end - p) * 3 / 4);
+		if (!DecodeBase64(p, end, bytes))
+		{
+			return false;
+		}
+		std::vector<uint8_t> gids(cells.size() * 4);
+		if (compression == "zlib" || compression == "gzip")
+		{
+			z_stream zs;
+			std::memset(&zs, 0, sizeof(zs));
+			// Detects the zlib or gzip header by itself
+			if (inflateInit2(&zs, 15 + 32) != Z_OK)
+			{
+				return false;
+			}
+			zs.next_in = bytes.data();
+			zs.avail_in = static_cast<uInt>(bytes.size());
+			zs.next_out = gids.data();
+			zs.avail_out = static_cast<uInt>(gids.size());
+			const int result = inflate(&zs, Z_FINISH);
+			inflateEnd(&zs);
+			if (result != Z_STREAM_END || zs.avail_out != 0)
+			{
+				return false;
+			}
+		}
+		else if (compression.empty() && bytes.size() == gids.size())
+		{
+			gids.swap(bytes);
+		}
+		else
+		{
+			return false;
+		}
+		for (std::size_t i = 0; i < cells.size(); ++i)
+		{
+			const uint32_t gid = gids[i * 4] | (gids[i * 4 + 1] << 8) | (gids[i * 4 + 2] << 16) | (static_cast<uint32_t>(gids[i * 4 + 3]) << 24);
+			cells[i] = (gid - 1) & 0x03FF;
+		}
+		return true;
+	}
+
+	bool ReadFile(const std::string& fname, std::string& contents)
+	{
+		std::ifstream file(fname, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+		contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	bool WriteFile(const std::string& fname, const std::string& contents)
+	{
+		std::ofstream file(fname, std::ios::binary | std::ios::trunc);
+		file.write(contents.data(), contents.size());
+		return file.good();
+	}
+}
+
+bool MapToTmx::ImportFromTmx(const std::string& fname, Tilemap3D& map)
+{
+	std::string tmx;
+	return ReadFile(fname, tmx) && ParseTmx(tmx, map);
+}
+
+bool MapToTmx::ExportToTmx(const std::string& fname, const Tilemap3D& map, const std::string& blockset_filename, Encoding encoding)
+{
+	const std::string tmx = MakeTmx(map, GetStem(fname), blockset_filename, encoding);
+	return !tmx.empty() && WriteFile(fname, tmx);
+}
+
+bool MapToTmx::ParseTmx(const std::string& tmx, Tilemap3D& map)
+{
+	std::size_t begin, end;
+	if (!FindTag(tmx, 0, "map", begin, end))
+	{
+		return false;
+	}
+	int width, height;
+	if (!ParseInt(GetAttribute(tmx, begin, end, "width"), width) || !ParseInt(GetAttribute(tmx, begin, end, "height"), height))
+	{
+		return false;
+	}
+	// The map is one cell wider than the layers, to leave room for the offset background
+	width -= 1;
+	if (width <= 0 || width >= 64 || height <= 0 || height >= 64)
+	{
+		return false;
+	}
+
+	std::vector<uint16_t> fg, bg;
+	std::size_t pos = end;
+	while (FindTag(tmx, pos, "layer", begin, end))
+	{
+		const std::string id = GetAttribute(tmx, begin, end, "id");
+		const std::size_t layer_end = tmx.find("</layer>", end);
+		std::size_t data_begin, data_end;
+		pos = end;
+		if (layer_end == std::string::npos || !FindTag(tmx, end, "data", data_begin, data_end) || data_end > layer_end || tmx[data_end - 1] == '/')
+		{
+			continue;
+		}
+		const std::size_t content_end = tmx.find("</data>", data_end);
+		if (content_end == std::string::npos || content_end > layer_end || (id != "1" && id != "2"))
+		{
+			continue;
+		}
+		std::vector<uint16_t>& cells = (id == "1") ? bg : fg;
+		cells.assign(width * height, 0);
+		const std::string encoding = GetAttribute(tmx, data_begin, data_end, "encoding");
+		const char* content = tmx.data() + data_end + 1;
+		const char* content_last = tmx.data() + content_end;
+		bool valid = false;
+		if (encoding == "csv")
+		{
+			valid = ReadCsv(content, content_last, cells);
+		}
+		else if (encoding == "base64")
+		{
+			valid = ReadBase64(content, content_last, GetAttribute(tmx, data_begin, data_end, "compression"), cells);
+		}
+		if (!valid)
+		{
+			return false;
+		}
+		pos = layer_end;
+	}
+
+	if (fg.size() != static_cast<std::size_t>(width * height) || bg.size() != static_cast<std::size_t>(width * height))
+	{
+		return false;
+	}
+	map.Resize(width, height);
+	for (int i = 0; i < width * height; ++i)
+	{
+		map.SetBlock(fg[i], i, Tilemap3D::Layer::FG);
+		map.SetBlock(bg[i], i, Tilemap3D::Layer::BG);
+	}
+	return true;
+}
+
+std::string MapToTmx::MakeTmx(const Tilemap3D& map, const std::string& name, const std::string& blockset_filename, Encoding encoding)
+{
+	std::string out;
+	// Each CSV cell takes five characters
+	out.reserve(1024 + map.GetWidth() * map.GetHeight() * 10 + map.GetHeight() * 2);
+	out += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<map";
+	AppendAttribute(out, "version", "1.10");
+	AppendAttribute(out, "tiledversion", "1.10.1");
+	AppendAttribute(out, "class", name);
+	AppendAttribute(out, "orientation", "isometric");
+	AppendAttribute(out, "renderorder", "left-down");
+	AppendAttribute(out, "width", std::to_string(map.GetWidth() + 1));
+	AppendAttribute(out, "height", std::to_string(map.GetHeight()));
+	AppendAttribute(out, "tilewidth", "32");
+	AppendAttribute(out, "tileheight", "16");
+	AppendAttribute(out, "infinite", "0");
+	AppendAttribute(out, "backgroundcolor", "#181818");
+	AppendAttribute(out, "nextlayerid", "3");
+	AppendAttribute(out, "nextobjectid", "1");
+	out += ">\n <tileset";
+	AppendAttribute(out, "firstgid", "1");
+	AppendAttribute(out, "name", GetStem(blockset_filename));
+	AppendAttribute(out, "tilewidth", "16");
+	AppendAttribute(out, "tileheight", "16");
+	AppendAttribute(out, "tilecount", "1024");
+	AppendAttribute(out, "columns", "16");
+	out += ">\n  <image";
+	AppendAttribute(out, "source", blockset_filename);
+	AppendAttribute(out, "width", "256");
+	AppendAttribute(out, "height", "1024");
+	out += "/>\n </tileset>\n";
+	if (!AppendLayer(out, map, Tilemap3D::Layer::BG, encoding) || !AppendLayer(out, map, Tilemap3D::Layer::FG, encoding))
+	{
+		return "";
+	}
+	out += "</map>\n";
+	return out;
+}
+
+std::vector<std::string> MapToTmx::ImportAll(const std::vector<ImportRequest>& requests)
+{
+	std::vector<char> imported(requests.size(), 0);
+	TaskPool::ParallelFor(requests.size(), [&](std::size_t i)
+		{
+			imported[i] = ImportFromTmx(requests[i].filename, *requests[i].map) ? 1 : 0;
+		});
+	std::vector<std::string> failed;
+	for (std::size_t i = 0; i < requests.size(); ++i)
+	{
+		if (!imported[i])
+		{
+			failed.push_back(requests[i].filename);
+		}
+	}
+	return failed;
 }
 
-bool MapToTmx::ExportToTmx(const std::string& fname, const Tilemap3D& map, const std::string& blockset_filename)
+std::vector<std::string> MapToTmx::ExportAll(const std::vector<ExportRequest>& requests, Encoding encoding)
 {
-	wxXmlDocument tmx;
-	wxFileName fn(fname);
-	wxFileName bsfn(blockset_filename);
-	tmx.SetRoot(new wxXmlNode(wxXML_ELEMENT_NODE, "map"));
-	tmx.GetRoot()->AddAttribute("version", "1.10");
-	tmx.GetRoot()->AddAttribute("tiledversion", "1.10.1");
-	tmx.GetRoot()->AddAttribute("class", fn.GetName());
-	tmx.GetRoot()->AddAttribute("orientation", "isometric");
-	tmx.GetRoot()->AddAttribute("renderorder", "left-down");
-	tmx.GetRoot()->AddAttribute("width", std::to_string(map.GetWidth() + 1));
-	tmx.GetRoot()->AddAttribute("height", std::to_string(map.GetHeight()));
-	tmx.GetRoot()->AddAttribute("tilewidth", "32");
-	tmx.GetRoot()->AddAttribute("tileheight", "16");
-	tmx.GetRoot()->AddAttribute("infinite", "0");
-	tmx.GetRoot()->AddAttribute("backgroundcolor", "#181818");
-	tmx.GetRoot()->AddAttribute("nextlayerid", "3");
-	tmx.GetRoot()->AddAttribute("nextobjectid", "1");
-
-	auto tileset = new wxXmlNode(wxXML_ELEMENT_NODE, "tileset");
-	tileset->AddAttribute("firstgid", "1");
-	tileset->AddAttribute("name", bsfn.GetName());
-	tileset->AddAttribute("tilewidth", "16");
-	tileset->AddAttribute("tileheight", "16");
-	tileset->AddAttribute("tilecount", "1024");
-	tileset->AddAttribute("columns", "16");
-
-	auto image = new wxXmlNode(wxXML_ELEMENT_NODE, "image");
-	image->AddAttribute("source", blockset_filename);
-	image->AddAttribute("width", "256");
-	image->AddAttribute("height", "1024");
-	tileset->AddChild(image);
-	tmx.GetRoot()->AddChild(tileset);
-
-	auto bg_layer = new wxXmlNode(wxXML_ELEMENT_NODE, "layer");
-	bg_layer->AddAttribute("id", "1");
-	bg_layer->AddAttribute("name", "Background");
-	bg_layer->AddAttribute("width", std::to_string(map.GetWidth()));
-	bg_layer->AddAttribute("height", std::to_string(map.GetHeight()));
-	bg_layer->AddAttribute("offsetx", "16");
-	bg_layer->AddAttribute("offsety", "0");
-	auto bg_data = new wxXmlNode(wxXML_ELEMENT_NODE, "data");
-	bg_data->AddAttribute("encoding", "csv");
-	bg_data->AddChild(new wxXmlNode(wxXML_TEXT_NODE, "", GetData(map, Tilemap3D::Layer::BG)));
-	bg_layer->AddChild(bg_data);
-
-	auto fg_layer = new wxXmlNode(wxXML_ELEMENT_NODE, "layer");
-	fg_layer->AddAttribute("id", "2");
-	fg_layer->AddAttribute("name", "Foreground");
-	fg_layer->AddAttribute("width", std::to_string(map.GetWidth()));
-	fg_layer->AddAttribute("height", std::to_string(map.GetHeight()));
-	fg_layer->AddAttribute("offsetx", "0");
-	fg_layer->AddAttribute("offsety", "0");
-	auto fg_data = new wxXmlNode(wxXML_ELEMENT_NODE, "data");
-	fg_data->AddAttribute("encoding", "csv");
-	fg_data->AddChild(new wxXmlNode(wxXML_TEXT_NODE, "", GetData(map, Tilemap3D::Layer::FG)));
-	fg_layer->AddChild(fg_data);
-
-	tmx.GetRoot()->AddChild(bg_layer);
-	tmx.GetRoot()->AddChild(fg_layer);
-
-	return tmx.Save(fname);
+	std::vector<char> exported(requests.size(), 0);
+	TaskPool::ParallelFor(requests.size(), [&](std::size_t i)
+		{
+			exported[i] = ExportToTmx(requests[i].filename, *requests[i].map, requests[i].blockset_filename, encoding) ? 1 : 0;
+		});
+	std::vector<std::string> failed;
+	for (std::size_t i = 0; i < requests.size(); ++i)
+	{
+		if (!exported[i])
+		{
+			failed.push_back(requests[i].filename);
+		}
+	}
+	return failed;
 }
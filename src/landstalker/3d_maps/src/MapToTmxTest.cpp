@@ -0,0 +1,48 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <chrono>
+#include <cstdio>
+
+#include <landstalker/3d_maps/include/MapToTmx.h>
+
+void SelfTest::TmxRoundTrip()
+{
+    // TMX files only hold the block layers, so each map is parsed back over a cleared copy
+    const std::vector<std::pair<std::string, MapToTmx::Encoding>> encodings = {
+        {"csv", MapToTmx::Encoding::CSV}, {"zlib", MapToTmx::Encoding::BASE64_ZLIB} };
+    std::vector<double> make_ms(encodings.size());
+    std::vector<double> parse_ms(encodings.size());
+    std::vector<std::size_t> bytes(encodings.size());
+    const auto maps = GenerateMaps();
+    for (const auto& m : maps)
+    {
+        for (std::size_t i = 0; i < encodings.size(); ++i)
+        {
+            const std::string name = m.first + " (" + encodings[i].first + ")";
+            auto start = std::chrono::steady_clock::now();
+            const std::string tmx = MapToTmx::MakeTmx(m.second, m.first, "blockset.png", encodings[i].second);
+            make_ms[i] += ElapsedMs(start);
+            bytes[i] += tmx.size();
+            Tilemap3D parsed(m.second);
+            parsed.ClearTilemap();
+            start = std::chrono::steady_clock::now();
+            Check(MapToTmx::ParseTmx(tmx, parsed) && parsed == m.second, name + " did not survive the round trip");
+            parse_ms[i] += ElapsedMs(start);
+
+            // Documents saved on Windows must parse the same, and cut off ones must be rejected
+            std::string crlf;
+            for (char c : tmx)
+            {
+                crlf += c == '\n' ? "\r\n" : std::string(1, c);
+            }
+            parsed.ClearTilemap();
+            Check(MapToTmx::ParseTmx(crlf, parsed) && parsed == m.second, name + " did not parse with CRLF line endings");
+            Check(!MapToTmx::ParseTmx(tmx.substr(0, tmx.size() / 2), parsed), name + ": a truncated document was accepted");
+        }
+    }
+    for (std::size_t i = 0; i < encodings.size(); ++i)
+    {
+        std::printf("  %-4s %zu maps: make %.2f ms, parse %.2f ms, %zu bytes\n", encodings[i].first.c_str(), maps.size(),
+            make_ms[i], parse_ms[i], bytes[i]);
+    }
+}
@@ -1,4 +1,5 @@
 #include <landstalker/3d_maps/include/TileSwaps.h>
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
 #include <cassert>
 #include <memory>
 #include <algorithm>
@@ -270,7 +271,11 @@ std::pair<int, int> TileSwap::GetRelTileOffset(const Tilemap3D::Layer& layer) co
 	}
 }
 
-void TileSwap::DrawSwap(Tilemap3D& tilemap, Tilemap3D::Layer layer) const
+namespace
+{
+// Shared by maps and overlays, which provide the same block accessors
+template <class Map>
+void DrawSwapOnto(const TileSwap::CopyOp& map, TileSwap::Mode mode, Map& tilemap, Tilemap3D::Layer layer)
 {
 	for (int y = 0; y < tilemap.GetHeight(); ++y)
 	{
@@ -321,6 +326,17 @@ void TileSwap::DrawSwap(Tilemap3D& tilemap, Tilemap3D::Layer layer) const
 		}
 	}
 }
+}
+
+void TileSwap::DrawSwap(Tilemap3D& tilemap, Tilemap3D::Layer layer) const
+{
+	DrawSwapOnto(map, mode, tilemap, layer);
+}
+
+void TileSwap::DrawSwap(Tilemap3DOverlay& overlay) const
+{
+	DrawSwapOnto(map, mode, overlay, overlay.GetLayer());
+}
 
 void TileSwap::DrawHeightmapSwap(Tilemap3D& tilemap) const
 {
@@ -7,25 +7,26 @@
 #include <functional>
 #include <cstdint>
 #include <algorithm>
-#include <iostream>
 
-#include <landstalker/misc/include/BitBarrel.h>
-#include <landstalker/misc/include/BitBarrelWriter.h>
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/misc/include/BitWriter.h>
+#include <landstalker/misc/include/CodecTrace.h>
 #include <landstalker/misc/include/Literals.h>
 
-static uint16_t getCodedNumber(BitBarrel& bb)
+static uint16_t getCodedNumber(BitReader& bb)
 {
-    uint16_t exp = 0, num = 0;
-    
-    while(!bb.getNextBit())
+    uint16_t num = 0;
+    const unsigned exp = bb.CountLeadingZeros();
+    if (exp >= 16)
     {
-        exp++;
+        throw std::runtime_error("Bad coded number in compressed map");
     }
+    bb.Consume(exp + 1);
     
     if(exp)
     {
-        num = 1 << exp;
-        num += static_cast<uint16_t>(bb.readBits(exp));
+        num = static_cast<uint16_t>(1 << exp);
+        num += static_cast<uint16_t>(bb.ReadBits(exp));
     }
     
     return num;
@@ -60,17 +61,17 @@ bool Tilemap3D::operator!=(const Tilemap3D& rhs) const
     return !(*this == rhs);
 }
 
-uint16_t Tilemap3D::Decode(const uint8_t* src)
+uint16_t Tilemap3D::Decode(const uint8_t* src, size_t size)
 {
-    BitBarrel bb(src);
+    BitReader bb(src, size);
     foreground.clear();
     background.clear();
     heightmap.clear();
 
-    left   = static_cast<uint8_t>(bb.readBits(8));
-    top    = static_cast<uint8_t>(bb.readBits(8));
-    width  = static_cast<uint8_t>(bb.readBits(8) + 1);
-    height = static_cast<uint8_t>((bb.readBits(8) + 1) / 2);
+    left   = static_cast<uint8_t>(bb.ReadBits(8));
+    top    = static_cast<uint8_t>(bb.ReadBits(8));
+    width  = static_cast<uint8_t>(bb.ReadBits(8) + 1);
+    height = static_cast<uint8_t>((bb.ReadBits(8) + 1) / 2);
     
     uint16_t tileDictionary[2] = {0, 0};
     uint16_t offsetDictionary[14] = {0xFFFF,
@@ -83,12 +84,12 @@ uint16_t Tilemap3D::Decode(const uint8_t* src)
     const uint16_t t = GetSize() * 2;
     std::vector<uint16_t> buffer(t,0);
     
-    tileDictionary[1] = static_cast<uint16_t>(bb.readBits(10));
-    tileDictionary[0] = static_cast<uint16_t>(bb.readBits(10));
+    tileDictionary[1] = static_cast<uint16_t>(bb.ReadBits(10));
+    tileDictionary[0] = static_cast<uint16_t>(bb.ReadBits(10));
     
     for(size_t i = 6; i < 14; ++i)
     {
-        offsetDictionary[i] = static_cast<uint16_t>(bb.readBits(12));
+        offsetDictionary[i] = static_cast<uint16_t>(bb.ReadBits(12));
     }
     
     int16_t dst_addr = -1;
@@ -105,26 +106,26 @@ uint16_t Tilemap3D::Decode(const uint8_t* src)
             break;
         }
         
-        uint8_t command = static_cast<uint8_t>(bb.readBits(3));
+        uint8_t command = static_cast<uint8_t>(bb.ReadBits(3));
         if(command > 5)
         {
-            command = static_cast<uint8_t>(6 + (((command & 1) << 2) | bb.readBits(2)));
+            command = static_cast<uint8_t>(6 + (((command & 1) << 2) | bb.ReadBits(2)));
         }
         buffer[dst_addr] = offsetDictionary[command];
         
-        if(bb.getNextBit())
+        if(bb.ReadBit())
         {
             uint16_t row_addr = dst_addr;
-            bool width_offset = bb.getNextBit();
+            bool width_offset = bb.ReadBit();
             do
             {
                 do
                 {
                     row_addr += GetWidth() + (width_offset ? 1 : 0);
                     buffer[row_addr] = offsetDictionary[command];
-                } while(bb.getNextBit());
+                } while(bb.ReadBit());
                 width_offset = !width_offset;
-            } while(bb.getNextBit());
+            } while(bb.ReadBit());
         }
     }
     
@@ -146,21 +147,21 @@ uint16_t Tilemap3D::Decode(const uint8_t* src)
         {
             do
             {
-                operand = static_cast<uint8_t>(bb.readBits(2));
+                operand = static_cast<uint8_t>(bb.ReadBits(2));
                 uint16_t value = 0;
                 switch(operand)
                 {
                     case 0:
                         if(tiles[0])
                         {
-                            value = static_cast<uint16_t>(bb.readBits(ilog2(tiles[0])));
+                            value = static_cast<uint16_t>(bb.ReadBits(ilog2(tiles[0])));
                         }
                         buffer[dst_addr++] = value;
                         break;
                     case 1:
                         if(tiles[1] != tileDictionary[1])
                         {
-                            value = static_cast<uint16_t>(bb.readBits(ilog2(tiles[1] - tileDictionary[1])));
+                            value = static_cast<uint16_t>(bb.ReadBits(ilog2(tiles[1] - tileDictionary[1])));
                         }
                         value += tileDictionary[1];
                         buffer[dst_addr++] = value;
@@ -183,9 +184,9 @@ uint16_t Tilemap3D::Decode(const uint8_t* src)
     std::copy(buffer.begin() + t/2, buffer.end(), background.begin());
     std::copy(buffer.begin(), buffer.begin() + t / 2, foreground.begin());
     
-    bb.advanceNextByte();
-    hmwidth = static_cast<uint8_t>(bb.readBits(8));
-    hmheight = static_cast<uint8_t>(bb.readBits(8));
+    bb.AlignToByte();
+    hmwidth = static_cast<uint8_t>(bb.ReadBits(8));
+    hmheight = static_cast<uint8_t>(bb.ReadBits(8));
     
     uint16_t hm_pattern = 0;
     uint16_t hm_rle_count = 0;
@@ -200,21 +201,25 @@ uint16_t Tilemap3D::Decode(const uint8_t* src)
             {
                 uint8_t read_count = 0;
                 hm_rle_count = 0;
-                hm_pattern = static_cast<uint16_t>(bb.readBits(16));
+                hm_pattern = static_cast<uint16_t>(bb.ReadBits(16));
                 do
                 {
-                    read_count = static_cast<uint8_t>(bb.readBits(8));
+                    read_count = static_cast<uint8_t>(bb.ReadBits(8));
                     hm_rle_count += read_count;
                 } while(read_count == 0xFF);
             }
             heightmap[dst_addr++] = hm_pattern;
         }
     }
-    bb.advanceNextByte();
-    return static_cast<uint16_t>(bb.getBytePosition());
+    bb.AlignToByte();
+    if (bb.IsOverrun())
+    {
+        throw std::runtime_error("Unexpected end of compressed map data");
+    }
+    return static_cast<uint16_t>(bb.GetBytePosition());
 }
 
-void makeCodedNumber(uint16_t value, BitBarrelWriter& bb)
+void makeCodedNumber(uint16_t value, BitWriter& bb)
 {
     uint16_t exp = ilog2(value) - 1;
     uint16_t i = exp;
@@ -232,69 +237,114 @@ void makeCodedNumber(uint16_t value, BitBarrelWriter& bb)
     }
 }
 
-int findMatchFrequency(const std::vector<uint16_t>& input, size_t offset, std::unordered_map<int, int>& fc)
+namespace
 {
-    size_t lookback_size = std::min<size_t>(offset, 4095);
-    size_t lookahead_size = input.size() - offset;
-    int best = 0;
-    for (size_t b = 1; b <= lookback_size; ++b)
+    // Indexes every position of the tile stream by the pair of tiles that starts
+    // there, so that back offsets that could give a match of two or more tiles can
+    // be enumerated without scanning the whole 4095-tile window.
+    class TilePairIndex
     {
-        int match_run = 0;
-        for (size_t m = 0; m < lookahead_size; ++m)
+    public:
+        static constexpr std::size_t WINDOW_SIZE = 4095;
+
+        explicit TilePairIndex(const std::vector<uint16_t>& input)
+            : m_input(input),
+              m_head(HASH_SIZE, NO_POS),
+              m_prev(input.size(), NO_POS),
+              m_inserted(0)
+        {
+        }
+
+        // Calls fn(back_offset) for each back offset within the window whose
+        // first two tiles match those at offset, nearest first. All positions
+        // before offset are indexed on demand.
+        template <class Fn>
+        void ForEachCandidate(std::size_t offset, Fn fn)
         {
-            if (input[offset - b + m] != input[offset + m])
+            if (offset + 1 >= m_input.size())
+            {
+                return;
+            }
+            for (; m_inserted < offset; ++m_inserted)
+            {
+                const uint32_t h = Hash(m_inserted);
+                m_prev[m_inserted] = m_head[h];
+                m_head[h] = static_cast<uint32_t>(m_inserted);
+            }
+            const std::size_t limit = offset > WINDOW_SIZE ? offset - WINDOW_SIZE : 0;
+            for (uint32_t pos = m_head[Hash(offset)]; pos != NO_POS && pos >= limit; pos = m_prev[pos])
             {
-                break;
+                if (m_input[pos] == m_input[offset] && m_input[pos + 1] == m_input[offset + 1])
+                {
+                    fn(offset - pos);
+                }
             }
-            match_run++;
         }
-        if (match_run > best)
+
+    private:
+        static constexpr unsigned HASH_BITS = 12;
+        static constexpr std::size_t HASH_SIZE = 1 << HASH_BITS;
+        static constexpr uint32_t NO_POS = 0xFFFFFFFF;
+
+        uint32_t Hash(std::size_t pos) const
         {
-            best = match_run;
+            const uint32_t key = (static_cast<uint32_t>(m_input[pos]) << 16) | m_input[pos + 1];
+            return (key * 2654435761U) >> (32 - HASH_BITS);
         }
-    }
-    if (best < 2) return 0;
-    for (size_t b = 1; b <= lookback_size; ++b)
+
+        const std::vector<uint16_t>& m_input;
+        std::vector<uint32_t> m_head;
+        std::vector<uint32_t> m_prev;
+        std::size_t m_inserted;
+    };
+}
+
+static int matchLength(const std::vector<uint16_t>& input, size_t offset, size_t back_offset, size_t start = 0)
+{
+    size_t m = start;
+    while (offset + m < input.size() && input[offset - back_offset + m] == input[offset + m])
     {
-        int match_run = 0;
-        for (size_t m = 0; m < lookahead_size; ++m)
+        m++;
+    }
+    return static_cast<int>(m);
+}
+
+// Finds the longest match of at least two tiles at offset, and increments the
+// frequency count of every back offset that achieves it.
+static int findMatchFrequency(const std::vector<uint16_t>& input, size_t offset, TilePairIndex& index,
+                              std::vector<std::pair<size_t, int>>& matches, std::unordered_map<int, int>& fc)
+{
+    int best = 0;
+    matches.clear();
+    index.ForEachCandidate(offset, [&](size_t b)
         {
-            if (input[offset - b + m] != input[offset + m])
-            {
-                break;
-            }
-            match_run++;
-        }
-        if (match_run == best)
+            int match_run = matchLength(input, offset, b, 2);
+            matches.emplace_back(b, match_run);
+            best = std::max(best, match_run);
+        });
+    for (const auto& match : matches)
+    {
+        if (match.second == best)
         {
-            fc[b] ++;
+            fc[static_cast<int>(match.first)]++;
         }
     }
     return best;
 }
 
-std::pair<int, int> findMatch(const std::vector<uint16_t>& input, size_t offset, const std::vector<uint16_t>& back_offsets)
+static std::pair<int, int> findMatch(const std::vector<uint16_t>& input, size_t offset, const std::vector<uint16_t>& back_offsets)
 {
     size_t lookback_size = std::min<size_t>(offset, 4095);
-    size_t lookahead_size = input.size() - offset;
     std::pair<int, int> ret = { 0,0 };
     for (size_t i = 0; i < back_offsets.size(); ++i)
     {
         size_t b = back_offsets[i];
         if ((b == 0) || (b > lookback_size)) continue;
-        int match_run = 0;
-        for (size_t m = 0; m < lookahead_size; ++m)
-        {
-            if (input[offset - b + m] != input[offset + m])
-            {
-                break;
-            }
-            match_run++;
-        }
+        int match_run = matchLength(input, offset, b);
         if (match_run > ret.second)
         {
             ret.second = match_run;
-            ret.first = i;
+            ret.first = static_cast<int>(i);
         }
     }
     if (ret.second == 0)
@@ -306,34 +356,94 @@ std::pair<int, int> findMatch(const std::vector<uint16_t>& input, size_t offset,
     return ret;
 }
 
-uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
+typedef std::function<bool(const std::pair<int, int>&, const std::pair<int, int>&)> Comparator;
+
+// Orders by descending frequency, then by ascending value
+static bool comparator(const std::pair<int, int>& p1, const std::pair<int, int>& p2)
 {
-    BitBarrelWriter cmap;
-    std::vector<uint16_t> offsets = { 0, 1, 2, static_cast<uint16_t>(GetWidth()), static_cast<uint16_t>(GetWidth() * 2), static_cast<uint16_t>(GetWidth() + 1)};
-    struct LZ77Entry
+    if (p1.second != p2.second)
     {
-        LZ77Entry(int run_length_in, int back_offset_idx_in, int index_in)
-            : run_length(run_length_in), back_offset_idx(back_offset_idx_in), index(index_in)
-        {}
-        int run_length;
-        int back_offset_idx;
-        int index;
-        std::vector<std::pair<bool, int>> vertical_info;
-    };
-    struct TileEntry
+        return p1.second > p2.second;
+    }
+    else
     {
-        TileEntry(uint8_t code_in, uint16_t data_in, uint8_t data_length_in)
-            : code(code_in), data(data_in), data_length(data_length_in)
-        {}
-        uint8_t code;
-        uint16_t data;
-        uint8_t data_length;
-    };
-    std::vector<LZ77Entry> lz77;
-    uint16_t tile_dict[2] = { 0 };
-    uint16_t tile_increment[2] = { 0 };
-    std::vector<TileEntry> tile_entries;
-    std::vector<std::pair<int, uint16_t>> hm_buffer;
+        return p1.first < p2.first;
+    }
+}
+
+// Limits on the dictionary search done at Level::MAXIMUM
+static const std::size_t MAX_OFFSET_CANDIDATES = 24;
+static const int MAX_OFFSET_SEARCH_PASSES = 3;
+
+std::atomic<int> Tilemap3D::s_default_level{ static_cast<int>(Tilemap3D::Level::FAST) };
+
+void Tilemap3D::SetDefaultLevel(Level level)
+{
+    s_default_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+Tilemap3D::Level Tilemap3D::GetDefaultLevel()
+{
+    return static_cast<Level>(s_default_level.load(std::memory_order_relaxed));
+}
+
+std::vector<uint8_t> Tilemap3D::EncodeUncompressed() const
+{
+    std::vector<uint8_t> ret = { left, top, width, height, hmwidth, hmheight, tile_width, tile_height };
+    ret.reserve(ret.size() + (foreground.size() + background.size() + heightmap.size()) * 2);
+    for (const auto* layer : { &foreground, &background, &heightmap })
+    {
+        for (uint16_t v : *layer)
+        {
+            ret.push_back(v >> 8);
+            ret.push_back(v & 0xFF);
+        }
+    }
+    return ret;
+}
+
+bool Tilemap3D::DecodeUncompressed(const uint8_t* src, size_t size)
+{
+    if (size < 8)
+    {
+        return false;
+    }
+    const std::size_t map_size = src[2] * src[3];
+    const std::size_t hm_size = src[4] * src[5];
+    if (size != 8 + (map_size * 2 + hm_size) * 2)
+    {
+        return false;
+    }
+    left = src[0];
+    top = src[1];
+    width = src[2];
+    height = src[3];
+    hmwidth = src[4];
+    hmheight = src[5];
+    tile_width = src[6];
+    tile_height = src[7];
+    const uint8_t* p = src + 8;
+    for (auto* layer : { &foreground, &background, &heightmap })
+    {
+        layer->resize(layer == &heightmap ? hm_size : map_size);
+        for (auto& v : *layer)
+        {
+            v = (p[0] << 8) | p[1];
+            p += 2;
+        }
+    }
+    return true;
+}
+
+uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
+{
+    return Encode(dst, size, GetDefaultLevel());
+}
+
+uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size, Level level)
+{
+    BitWriter cmap;
+    std::vector<uint16_t> offsets = { 0, 1, 2, static_cast<uint16_t>(GetWidth()), static_cast<uint16_t>(GetWidth() * 2), static_cast<uint16_t>(GetWidth() + 1)};
 
     // COMPRESS MAP
     // Combine foreground and background
@@ -343,11 +453,12 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
     // First stage of map compression involves LZ77 with a fixed-size dictionary
     // STEP 1: Run map through LZ77 compressor. Make a list of LZ77 offset frequencies.
     std::unordered_map<int, int> offset_freq_count;
-    std::vector<bool> compressed(tiles.size(), false);
+    TilePairIndex pair_index(tiles);
+    std::vector<std::pair<size_t, int>> matches;
     size_t idx = 1;
     do
     {
-        int run = findMatchFrequency(tiles, idx, offset_freq_count);
+        int run = findMatchFrequency(tiles, idx, pair_index, matches, offset_freq_count);
         if (run == 0)
         {
             idx++;
@@ -360,41 +471,109 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
 
     // STEP 2: Identify top 8 back offsets and add to back offset dictionary
 
-    typedef std::function<bool(const std::pair<int, int>&, const std::pair<int, int>&)> Comparator;
-    Comparator comparator = [](const std::pair<int, int>& p1, const std::pair<int, int>& p2)
+    std::multiset<std::pair<int, int>, Comparator> frequency_counts(offset_freq_count.begin(), offset_freq_count.end(), comparator);
+    for (auto it = frequency_counts.cbegin(); it != frequency_counts.cend(); ++it)
     {
-        if (p1.second != p2.second)
+        if (std::find(offsets.begin(), offsets.end(), it->first) == offsets.end())
         {
-            return p1.second > p2.second;
+            offsets.push_back(static_cast<uint16_t>(it->first));
         }
-        else
+    }
+    // Offsets that did not make it into the dictionary are kept as candidates for the search below
+    std::vector<uint16_t> candidates;
+    if (offsets.size() > 14)
+    {
+        candidates.assign(offsets.begin() + 14, offsets.begin() + std::min<size_t>(offsets.size(), 14 + MAX_OFFSET_CANDIDATES));
+    }
+    offsets.resize(14);
+
+    // STEP 2a: When compressing for size, replace dictionary entries one at a time with other observed
+    //          offsets, keeping any change that reduces the total encoded size.
+    if (level == Level::MAXIMUM)
+    {
+        std::vector<uint16_t> pool(offsets.begin() + 6, offsets.end());
+        pool.insert(pool.end(), candidates.begin(), candidates.end());
+        BitWriter best;
+        EncodeTiles(tiles, offsets, best, false);
+        bool improved = true;
+        for (int pass = 0; improved && pass < MAX_OFFSET_SEARCH_PASSES; ++pass)
         {
-            return p1.first < p2.first;
+            improved = false;
+            for (size_t slot = 6; slot < offsets.size(); ++slot)
+            {
+                for (uint16_t candidate : pool)
+                {
+                    if (std::find(offsets.begin(), offsets.end(), candidate) != offsets.end())
+                    {
+                        continue;
+                    }
+                    std::vector<uint16_t> trial(offsets);
+                    trial[slot] = candidate;
+                    BitWriter trial_map;
+                    EncodeTiles(tiles, trial, trial_map, false);
+                    if (trial_map.GetBitCount() < best.GetBitCount())
+                    {
+                        offsets.swap(trial);
+                        best = std::move(trial_map);
+                        improved = true;
+                    }
+                }
+            }
         }
-    };
+    }
 
-    std::multiset<std::pair<int, int>, Comparator> frequency_counts(offset_freq_count.begin(), offset_freq_count.end(), comparator);
-    for (auto it = frequency_counts.cbegin(); it != frequency_counts.cend(); ++it)
+    if (CodecTrace::IsEnabled(CodecTrace::Codec::TILEMAP3D))
     {
-#ifndef NDEBUG
-        std::cout << "Offset " << std::hex << it->first << ": " << std::dec << it->second << std::endl;
-#endif
-        if (std::find(offsets.begin(), offsets.end(), it->first) == offsets.end())
+        for (size_t i = 0; i < offsets.size(); ++i)
         {
-            offsets.push_back(static_cast<uint16_t>(it->first));
+            CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::OFFSET_DICT, i, offsets[i], offset_freq_count[offsets[i]]);
         }
     }
-    offsets.resize(14);
-#ifndef NDEBUG
-    for (size_t i = 0; i < offsets.size(); ++i)
+    EncodeTiles(tiles, offsets, cmap, true);
+
+    if (cmap.GetByteCount() <= size)
     {
-        std::cout << "Offset " << std::hex << offsets[i] << ": " << std::dec << offset_freq_count[offsets[i]] << std::endl;
+        const auto bytes = cmap.GetBytes();
+        std::copy(bytes.begin(), bytes.end(), dst);
     }
-#endif
-    // STEP 3: Compress map using LZ77 and the back offset dictionary created during step 2
+    else
+    {
+        throw std::runtime_error("Output buffer not large enough to hold result.");
+    }
+    return static_cast<uint16_t>(cmap.GetByteCount());
+}
 
+void Tilemap3D::EncodeTiles(const std::vector<uint16_t>& tiles, const std::vector<uint16_t>& offsets, BitWriter& cmap, bool trace) const
+{
+    struct LZ77Entry
+    {
+        LZ77Entry(int run_length_in, int back_offset_idx_in, int index_in)
+            : run_length(run_length_in), back_offset_idx(back_offset_idx_in), index(index_in)
+        {}
+        int run_length;
+        int back_offset_idx;
+        int index;
+        std::vector<std::pair<bool, int>> vertical_info;
+    };
+    struct TileEntry
+    {
+        TileEntry(uint8_t code_in, uint16_t data_in, uint8_t data_length_in)
+            : code(code_in), data(data_in), data_length(data_length_in)
+        {}
+        uint8_t code;
+        uint16_t data;
+        uint8_t data_length;
+    };
+    std::vector<LZ77Entry> lz77;
+    uint16_t tile_dict[2] = { 0 };
+    uint16_t tile_increment[2] = { 0 };
+    std::vector<TileEntry> tile_entries;
+    std::vector<std::pair<int, uint16_t>> hm_buffer;
+    std::vector<bool> compressed(tiles.size(), false);
+
+    // STEP 3: Compress map using LZ77 and the back offset dictionary created during step 2
     lz77.emplace_back(1, 0, 0);
-    idx = 1;
+    size_t idx = 1;
     do
     {
         auto result = findMatch(tiles, idx, offsets);
@@ -408,19 +587,20 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
         }
         if (lz77.back().back_offset_idx == 0)
         {
-#ifndef NDEBUG
-            std::cout << " LOAD TILE @ " << idx << std::endl;
-#endif
+            if (trace)
+            {
+                CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::LOAD_TILE, idx);
+            }
             compressed[idx] = false;
             idx++;
         }
         else
         {
-#ifndef NDEBUG
-            std::cout << " LZ77 @ " << idx << " : copy " << lz77.back().run_length
-                      << " bytes from offset " << lz77.back().back_offset_idx << "("
-                      << (idx - offsets[lz77.back().back_offset_idx]) << ")" << std::endl;
-#endif
+            if (trace)
+            {
+                CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::RUN, idx,
+                                   offsets[lz77.back().back_offset_idx], static_cast<uint32_t>(lz77.back().run_length));
+            }
             std::fill(compressed.begin() + idx, compressed.begin() + idx + lz77.back().run_length, true);
             idx += lz77.back().run_length;
         }
@@ -439,11 +619,12 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
             while (next < tiles.size())
             {
                 next += GetWidth() + (right ? 1 : 0);
-                auto nit = std::find_if(it, lz77.end(), [&](const LZ77Entry& comp)
+                // Entries are ordered by index, so the only candidate can be found by bisection
+                auto nit = std::lower_bound(it, lz77.end(), static_cast<int>(next), [](const LZ77Entry& comp, int index)
                     {
-                        return (comp.index == static_cast<int>(next)) && (comp.back_offset_idx == it->back_offset_idx);
+                        return comp.index < index;
                     });
-                if (nit != lz77.end())
+                if ((nit != lz77.end()) && (nit->index == static_cast<int>(next)) && (nit->back_offset_idx == it->back_offset_idx))
                 {
                     count++;
                     nit->back_offset_idx = -1;
@@ -530,10 +711,11 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
         incrementing_tile_counts.begin(), incrementing_tile_counts.end(), comparator);
 
     tile_dict[0] = incrementing_tile_freqs.begin()->first;
-#ifndef NDEBUG
-    std::cout << "TILE DICT 1: " << std::hex << tile_dict[1] << std::endl;
-    std::cout << "TILE DICT 0: " << std::hex << tile_dict[0] << std::endl;
-#endif
+    if (trace)
+    {
+        CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::TILE_DICT, 0, 1, tile_dict[1]);
+        CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::TILE_DICT, 0, 0, tile_dict[0]);
+    }
 
     // STEP 7: Start to compress tile data. Identify if tile is (1) equal to any in tile dictionary + increment,
     //         (2) between tileDict[0] and tileDict[0] + tileDictIncr[0], or (3) none of the above.
@@ -545,31 +727,35 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
             if (tiles[i] == tile_dict[0] + tile_increment[0])
             {
                 tile_increment[0]++;
-#ifndef NDEBUG
-                std::cout << "INCREMENT TILE 1 [" << std::hex << tiles[i] << " @ " << std::dec << i << std::endl;
-#endif
+                if (trace)
+                {
+                    CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::INCREMENT_TILE, i, 0, tiles[i]);
+                }
                 tile_entries.emplace_back(3_u8, 0_u16, 0_u8);
             }
             else if (tiles[i] == tile_dict[1] + tile_increment[1])
             {
                 tile_increment[1]++;
-#ifndef NDEBUG
-                std::cout << "INCREMENT TILE 2 [" << std::hex << tiles[i] << " @ " << std::dec << i << std::endl;
-#endif
+                if (trace)
+                {
+                    CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::INCREMENT_TILE, i, 1, tiles[i]);
+                }
                 tile_entries.emplace_back(2_u8, 0_u16, 0_u8);
             }
             else if ((tiles[i] >= tile_dict[0]) && (tiles[i] < (tile_dict[0] + tile_increment[0])))
             {
-#ifndef NDEBUG
-                std::cout << "PLACE REL TILE [" << std::hex << tiles[i] << " @ " << std::dec << i << std::endl;
-#endif
+                if (trace)
+                {
+                    CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::PLACE_REL_TILE, i, tiles[i]);
+                }
                 tile_entries.emplace_back(1_u8, static_cast<uint16_t>(tiles[i] - tile_dict[0]), static_cast<uint8_t>(ilog2(tile_increment[0])));
             }
             else
             {
-#ifndef NDEBUG
-                std::cout << "PLACE TILE " << std::hex << tiles[i] << " @ " << std::dec << i << std::endl;
-#endif
+                if (trace)
+                {
+                    CodecTrace::Record(CodecTrace::Codec::TILEMAP3D, CodecTrace::Op::PLACE_TILE, i, tiles[i]);
+                }
                 tile_entries.emplace_back(0_u8, tiles[i], static_cast<uint8_t>(ilog2(tile_dict[1])));
             }
         }
@@ -592,10 +778,10 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
     // STEP 9: Compression complete! Begin output:
 
     // Top, Left, Width, Height
-    cmap.Write<uint8_t>(GetLeft());
-    cmap.Write<uint8_t>(GetTop());
-    cmap.Write<uint8_t>(GetWidth() - 1);
-    cmap.Write<uint8_t>(GetHeight() * 2 - 1);
+    cmap.WriteBits(GetLeft(), 8);
+    cmap.WriteBits(GetTop(), 8);
+    cmap.WriteBits(GetWidth() - 1, 8);
+    cmap.WriteBits(GetHeight() * 2 - 1, 8);
     // Tile Dictionary
     cmap.WriteBits(tile_dict[0], 10);
     cmap.WriteBits(tile_dict[1], 10);
@@ -676,31 +862,22 @@ uint16_t Tilemap3D::Encode(uint8_t* dst, size_t size)
         }
     }
     // Advance to next byte
-    cmap.AdvanceNextByte();
+    cmap.AlignToByte();
     // Heightmap dims
-    cmap.Write<uint8_t>(GetHeightmapWidth());
-    cmap.Write<uint8_t>(GetHeightmapHeight());
+    cmap.WriteBits(GetHeightmapWidth(), 8);
+    cmap.WriteBits(GetHeightmapHeight(), 8);
     // Heightmap data: pattern + run length. If run length >= 0xFF, output 0xFF then run length - 0xFF
     for (const auto& entry : hm_buffer)
     {
-        cmap.Write<uint16_t>(entry.second);
+        cmap.WriteBits(entry.second, 16);
         int len = entry.first;
         while (len >= 0xFF)
         {
-            cmap.Write<uint8_t>(0xFF);
+            cmap.WriteBits(0xFF, 8);
             len -= 0xFF;
         }
-        cmap.Write<uint8_t>(static_cast<uint8_t>(len));
-    }
-    if (cmap.GetByteCount() <= size)
-    {
-        std::copy(cmap.Begin(), cmap.End(), dst);
+        cmap.WriteBits(static_cast<uint8_t>(len), 8);
     }
-    else
-    {
-        throw std::runtime_error("Output buffer not large enough to hold result.");
-    }
-    return static_cast<uint16_t>(cmap.GetByteCount());
 }
 
 uint8_t Tilemap3D::GetLeft() const
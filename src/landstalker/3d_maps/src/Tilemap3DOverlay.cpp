@@ -0,0 +1,61 @@
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
+
+#include <algorithm>
+
+Tilemap3DOverlay::Tilemap3DOverlay(const Tilemap3D& map, Tilemap3D::Layer layer)
+    : m_map(map),
+      m_layer(layer)
+{
+}
+
+Tilemap3DOverlay::Tilemap3DOverlay(const Tilemap3D& map, Tilemap3D::Layer layer, const std::vector<TileSwap>& swaps, const std::vector<Door>& doors)
+    : Tilemap3DOverlay(map, layer)
+{
+    for (const auto& swap : swaps)
+    {
+        swap.DrawSwap(*this);
+    }
+    for (const auto& door : doors)
+    {
+        door.DrawDoor(*this);
+    }
+}
+
+uint16_t Tilemap3DOverlay::GetBlock(const IsoPoint2D& iso) const
+{
+    if (!m_cells.empty())
+    {
+        const uint16_t index = static_cast<uint16_t>(iso.x + iso.y * m_map.GetWidth());
+        auto it = std::lower_bound(m_cells.cbegin(), m_cells.cend(), std::make_pair(index, uint16_t(0)));
+        if (it != m_cells.cend() && it->first == index)
+        {
+            return it->second;
+        }
+    }
+    return m_map.GetBlock(iso, m_layer);
+}
+
+uint16_t Tilemap3DOverlay::GetBlock(const IsoPoint2D& iso, Tilemap3D::Layer layer) const
+{
+    return (layer == m_layer) ? GetBlock(iso) : m_map.GetBlock(iso, layer);
+}
+
+bool Tilemap3DOverlay::SetBlock(const BlockLoc& loc, Tilemap3D::Layer layer)
+{
+    if (layer != m_layer || !m_map.IsBlockValid(loc.position))
+    {
+        return false;
+    }
+    const uint16_t index = static_cast<uint16_t>(loc.position.x + loc.position.y * m_map.GetWidth());
+    const uint16_t value = loc.value & 0x3FF;
+    auto it = std::lower_bound(m_cells.begin(), m_cells.end(), std::make_pair(index, uint16_t(0)));
+    if (it != m_cells.end() && it->first == index)
+    {
+        it->second = value;
+    }
+    else
+    {
+        m_cells.insert(it, { index, value });
+    }
+    return true;
+}
@@ -0,0 +1,217 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
+#include <landstalker/3d_maps/include/TileSwaps.h>
+#include <landstalker/3d_maps/include/Doors.h>
+#include <landstalker/main/include/ImageBuffer.h>
+
+namespace
+{
+    // The eight back offsets added to a map's offset dictionary, as the encoder chose them before its
+    // match search was indexed: those that most often give the longest match of two or more tiles,
+    // found by trying every offset in the window
+    std::vector<uint16_t> ReferenceOffsetDictionary(const Tilemap3D& map)
+    {
+        std::vector<uint16_t> tiles;
+        for (auto layer : { Tilemap3D::Layer::FG, Tilemap3D::Layer::BG })
+        {
+            for (int i = 0; i < map.GetSize(); ++i)
+            {
+                tiles.push_back(map.GetBlock({ i % map.GetWidth(), i / map.GetWidth() }, layer));
+            }
+        }
+        std::map<int, int> frequencies;
+        std::vector<std::size_t> lengths;
+        for (std::size_t i = 1; i < tiles.size();)
+        {
+            const std::size_t window = std::min<std::size_t>(i, 4095);
+            std::size_t best = 0;
+            lengths.assign(window + 1, 0);
+            for (std::size_t b = 1; b <= window; ++b)
+            {
+                while (i + lengths[b] < tiles.size() && tiles[i - b + lengths[b]] == tiles[i + lengths[b]])
+                {
+                    ++lengths[b];
+                }
+                best = std::max(best, lengths[b]);
+            }
+            if (best < 2)
+            {
+                ++i;
+                continue;
+            }
+            for (std::size_t b = 1; b <= window; ++b)
+            {
+                frequencies[static_cast<int>(b)] += lengths[b] == best ? 1 : 0;
+            }
+            i += best;
+        }
+        std::vector<std::pair<int, int>> ranked;
+        std::copy_if(frequencies.begin(), frequencies.end(), std::back_inserter(ranked), [](const auto& f) { return f.second > 0; });
+        std::stable_sort(ranked.begin(), ranked.end(), [](const auto& lhs, const auto& rhs) { return lhs.second > rhs.second; });
+        std::vector<uint16_t> offsets = { 0, 1, 2, map.GetWidth(), static_cast<uint16_t>(map.GetWidth() * 2), static_cast<uint16_t>(map.GetWidth() + 1) };
+        for (const auto& f : ranked)
+        {
+            if (std::find(offsets.begin(), offsets.end(), f.first) == offsets.end())
+            {
+                offsets.push_back(static_cast<uint16_t>(f.first));
+            }
+        }
+        offsets.resize(14);
+        return std::vector<uint16_t>(offsets.begin() + 6, offsets.end());
+    }
+
+    // The offset dictionary stored in an encoded map, which follows the map's position and size and the
+    // two tile dictionary entries
+    std::vector<uint16_t> ReadOffsetDictionary(const std::vector<uint8_t>& encoded)
+    {
+        BitReader reader(encoded.data(), encoded.size());
+        reader.Consume(32);
+        reader.Consume(20);
+        std::vector<uint16_t> offsets(8);
+        for (auto& offset : offsets)
+        {
+            offset = static_cast<uint16_t>(reader.ReadBits(12));
+        }
+        return offsets;
+    }
+}
+
+void SelfTest::Tilemap3DMaps()
+{
+    auto maps = GenerateMaps();
+    std::size_t unchanged = 0;
+    if (m_gd != nullptr)
+    {
+        for (const auto& m : m_gd->GetRoomData()->GetMaps())
+        {
+            std::shared_ptr<const Tilemap3DEntry> entry = m.second;
+            const auto bytes = entry->GetOrigBytes();
+            Tilemap3D map(bytes->data(), bytes->size());
+            std::vector<uint8_t> encoded(65536);
+            encoded.resize(map.Encode(encoded.data(), encoded.size(), Tilemap3D::Level::FAST));
+            unchanged += encoded == *bytes ? 1 : 0;
+            maps.push_back({ m.first, std::move(map) });
+        }
+        std::printf("  %zu of %zu room maps re-encode to their original bytes\n", unchanged, m_gd->GetRoomData()->GetMaps().size());
+    }
+    std::size_t fast_bytes = 0;
+    std::size_t maximum_bytes = 0;
+    for (auto& m : maps)
+    {
+        std::vector<uint8_t> fast(65536);
+        fast.resize(m.second.Encode(fast.data(), fast.size(), Tilemap3D::Level::FAST));
+        std::vector<uint8_t> maximum(65536);
+        maximum.resize(m.second.Encode(maximum.data(), maximum.size(), Tilemap3D::Level::MAXIMUM));
+        fast_bytes += fast.size();
+        maximum_bytes += maximum.size();
+        Check(maximum.size() <= fast.size(), m.first + ": maximum compression is larger than fast compression");
+        Check(ReadOffsetDictionary(fast) == ReferenceOffsetDictionary(m.second), m.first + ": offset dictionary differs from the reference");
+        for (const auto* encoded : { &fast, &maximum })
+        {
+            Tilemap3D decoded;
+            Check(decoded.Decode(encoded->data(), encoded->size()) == encoded->size() && decoded == m.second,
+                m.first + " did not survive the round trip at " + (encoded == &fast ? "fast" : "maximum") + " compression");
+        }
+    }
+    std::printf("  %zu bytes fast, %zu bytes maximum\n", fast_bytes, maximum_bytes);
+}
+
+void SelfTest::PreviewOverlays()
+{
+    // Swaps and doors seen through an overlay must match the same swaps and doors drawn onto a copy
+    // of the map, and toggling them must redraw to the same image
+    const auto room = GenerateRoom();
+    const Tilemap3D::Layer layers[] = { Tilemap3D::Layer::BG, Tilemap3D::Layer::FG };
+    std::mt19937 rng(31);
+    double overlay_ms = 0.0;
+    double copy_ms = 0.0;
+    std::size_t toggles = 0;
+    for (const auto& m : GenerateMaps())
+    {
+        const auto map = std::make_shared<const Tilemap3D>(m.second);
+        auto random_op = [&]()
+        {
+            return TileSwap::CopyOp{ static_cast<uint8_t>(rng() % 64), static_cast<uint8_t>(rng() % 64), static_cast<uint8_t>(rng() % 64),
+                static_cast<uint8_t>(rng() % 64), static_cast<uint8_t>(1 + rng() % 8), static_cast<uint8_t>(1 + rng() % 8) };
+        };
+        std::vector<TileSwap> swaps;
+        for (auto mode : { TileSwap::Mode::FLOOR, TileSwap::Mode::WALL_NE, TileSwap::Mode::WALL_NW })
+        {
+            swaps.emplace_back(random_op(), random_op(), mode);
+        }
+        std::vector<Door> doors;
+        for (const auto& size : Door::SIZES)
+        {
+            doors.emplace_back(static_cast<uint8_t>(rng() % 64), static_cast<uint8_t>(rng() % 64), size.first);
+        }
+        for (auto layer : layers)
+        {
+            Tilemap3D drawn = *map;
+            for (const auto& swap : swaps)
+            {
+                swap.DrawSwap(drawn, layer);
+            }
+            for (const auto& door : doors)
+            {
+                door.DrawDoor(drawn, layer);
+            }
+            const Tilemap3DOverlay preview(*map, layer, swaps, doors);
+            bool same = true;
+            for (int y = 0; y < map->GetHeight(); ++y)
+            {
+                for (int x = 0; x < map->GetWidth(); ++x)
+                {
+                    same = same && preview.GetBlock({ x, y }) == drawn.GetBlock({ x, y }, layer);
+                }
+            }
+            Check(same, m.first + ": the overlay differs from the previews drawn onto the map");
+
+            // Toggling the previews only redraws the cells they cover
+            std::vector<IsoPoint2D> cells;
+            for (const auto& cell : preview.GetOverlaidCells())
+            {
+                cells.push_back({ cell.first % map->GetWidth(), cell.first / map->GetWidth() });
+            }
+            ImageBuffer buf(map->GetPixelWidth(), map->GetPixelHeight());
+            buf.Insert3DMapLayer(0, 0, 0, layer, map, room.tileset, room.blockset);
+            buf.GetRGB(room.palettes);
+            for (int i = 0; i < 10; ++i)
+            {
+                const bool shown = i % 2 == 0;
+                auto start = std::chrono::steady_clock::now();
+                const Tilemap3DOverlay view(*map, layer, shown ? swaps : std::vector<TileSwap>(), shown ? doors : std::vector<Door>());
+                buf.Redraw3DMapCells(0, view, room.tileset, room.blockset, cells);
+                const auto& rgb = buf.GetRGB(room.palettes);
+                overlay_ms += ElapsedMs(start);
+                start = std::chrono::steady_clock::now();
+                auto copy = std::make_shared<Tilemap3D>(*map);
+                if (shown)
+                {
+                    for (const auto& swap : swaps)
+                    {
+                        swap.DrawSwap(*copy, layer);
+                    }
+                    for (const auto& door : doors)
+                    {
+                        door.DrawDoor(*copy, layer);
+                    }
+                }
+                ImageBuffer full(map->GetPixelWidth(), map->GetPixelHeight());
+                full.Insert3DMapLayer(0, 0, 0, layer, copy, room.tileset, room.blockset);
+                const auto& full_rgb = full.GetRGB(room.palettes);
+                copy_ms += ElapsedMs(start);
+                Check(rgb == full_rgb, m.first + ": toggling the previews differs from drawing them onto a copy");
+                ++toggles;
+            }
+        }
+    }
+    std::printf("  %zu toggles: %.2f ms through an overlay, %.2f ms copying the map\n", toggles, overlay_ms, copy_ms);
+}
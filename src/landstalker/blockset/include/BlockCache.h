@@ -0,0 +1,41 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <landstalker/blockset/include/Block.h>
+#include <landstalker/tileset/include/Tileset.h>
+
+// Every block of a blockset composed into 16x16 indexed pixels, with a matching plane of
+// tile priorities. Pixels hold colour indices without palette bits, so the same cache
+// serves any palette; zero is transparent.
+class BlockCache
+{
+public:
+    static const std::size_t BLOCK_WIDTH = MapBlock::GetBlockWidth() * 8;
+    static const std::size_t BLOCK_HEIGHT = MapBlock::GetBlockHeight() * 8;
+    static const std::size_t BLOCK_BYTES = BLOCK_WIDTH * BLOCK_HEIGHT;
+
+    BlockCache(std::shared_ptr<const TileFlipCache> tiles, const Blockset& blocks);
+
+    // Returns a cache shared by all callers drawing this blockset with this tileset. A new
+    // one is built whenever the tileset has been modified or the blocks differ.
+    static std::shared_ptr<const BlockCache> Get(const Tileset& tileset, const Blockset& blocks);
+
+    std::size_t GetBlockCount() const { return m_blocks.size(); }
+    // False if the block refers to tiles outside of the tileset
+    bool IsComposed(std::size_t block) const { return m_composed[block]; }
+    const uint8_t* GetPixels(std::size_t block) const { return m_pixels.data() + block * BLOCK_BYTES; }
+    const uint8_t* GetPriority(std::size_t block) const { return m_priority.data() + block * BLOCK_BYTES; }
+    bool Matches(const TileFlipCache* tiles, const Blockset& blocks) const;
+private:
+    std::shared_ptr<const TileFlipCache> m_tiles;
+    Blockset m_blocks;
+    std::vector<bool> m_composed;
+    std::vector<uint8_t> m_pixels;
+    std::vector<uint8_t> m_priority;
+};
+
+#endif // BLOCK_CACHE_H
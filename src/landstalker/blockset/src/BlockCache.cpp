@@ -0,0 +1,94 @@
+#include <landstalker/blockset/include/BlockCache.h>
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <cstring>
+
+#include <landstalker/misc/include/TaskPool.h>
+
+namespace
+{
+    // A room's layers, and the rooms either side of it, tend to reuse a handful of blocksets
+    const std::size_t MAX_SHARED_CACHES = 8;
+
+    std::mutex shared_caches_mutex;
+    std::list<std::shared_ptr<const BlockCache>> shared_caches;
+}
+
+BlockCache::BlockCache(std::shared_ptr<const TileFlipCache> tiles, const Blockset& blocks)
+    : m_tiles(std::move(tiles)),
+      m_blocks(blocks),
+      m_composed(blocks.size(), false),
+      m_pixels(blocks.size() * BLOCK_BYTES, 0),
+      m_priority(blocks.size() * BLOCK_BYTES, 0)
+{
+    std::vector<char> composed(m_blocks.size(), 0);
+    TaskPool::ParallelForRange(m_blocks.size(), [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t b = begin; b < end; ++b)
+            {
+                const MapBlock& block = m_blocks[b];
+                bool in_range = true;
+                for (std::size_t t = 0; t < MapBlock::GetBlockSize(); ++t)
+                {
+                    in_range = in_range && block.GetTile(t).GetIndex() < m_tiles->GetTileCount();
+                }
+                if (!in_range)
+                {
+                    continue;
+                }
+                for (std::size_t t = 0; t < MapBlock::GetBlockSize(); ++t)
+                {
+                    const Tile& tile = block.GetTile(t);
+                    const uint8_t* src = m_tiles->Get(tile);
+                    const uint8_t priority = tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_PRIORITY) ? 1 : 0;
+                    const std::size_t x = (t % MapBlock::GetBlockWidth()) * 8;
+                    const std::size_t y = (t / MapBlock::GetBlockWidth()) * 8;
+                    for (std::size_t row = 0; row < 8; ++row)
+                    {
+                        const std::size_t offset = b * BLOCK_BYTES + (y + row) * BLOCK_WIDTH + x;
+                        std::memcpy(&m_pixels[offset], src + row * 8, 8);
+                        std::memset(&m_priority[offset], priority, 8);
+                    }
+                }
+                composed[b] = 1;
+            }
+        }, 64);
+    std::copy(composed.cbegin(), composed.cend(), m_composed.begin());
+}
+
+std::shared_ptr<const BlockCache> BlockCache::Get(const Tileset& tileset, const Blockset& blocks)
+{
+    auto tiles = tileset.GetFlipCache();
+    if (tiles == nullptr)
+    {
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(shared_caches_mutex);
+        auto it = std::find_if(shared_caches.begin(), shared_caches.end(), [&](const auto& c)
+            {
+                return c->Matches(tiles.get(), blocks);
+            });
+        if (it != shared_caches.end())
+        {
+            shared_caches.splice(shared_caches.begin(), shared_caches, it);
+            return shared_caches.front();
+        }
+    }
+    // Composed outside of the lock, so two threads may occasionally build the same cache
+    auto cache = std::make_shared<const BlockCache>(tiles, blocks);
+    std::lock_guard<std::mutex> lock(shared_caches_mutex);
+    shared_caches.push_front(cache);
+    if (shared_caches.size() > MAX_SHARED_CACHES)
+    {
+        shared_caches.pop_back();
+    }
+    return cache;
+}
+
+bool BlockCache::Matches(const TileFlipCache* tiles, const Blockset& blocks) const
+{
+    return m_tiles.get() == tiles && m_blocks == blocks;
+}
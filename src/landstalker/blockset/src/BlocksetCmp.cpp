@@ -12,8 +12,8 @@
 #include <sstream>
 #include <cassert>
 #include <stdexcept>
-#include <landstalker/misc/include/BitBarrel.h>
-#include <landstalker/misc/include/BitBarrelWriter.h>
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/misc/include/BitWriter.h>
 #include <landstalker/blockset/include/Block.h>
 #include <landstalker/tileset/include/TileAttributes.h>
 
@@ -73,24 +73,26 @@ static unsigned int ilog2(unsigned int in)
 /* Gets compressed variable-width number. Number is in the form 2^Exp + Man */
 /* Exp is the number of leading zeroes. The following bits make up the
  * mantissa. The same number of bits make up the exponent and mantissa */
-static uint16_t getCompNumber(BitBarrel& bb)
+static uint16_t getCompNumber(BitReader& bb)
 {
     int16_t exponent = 0, mantissa = 0;
-    while(bb.getNextBit() == false)
+    exponent = static_cast<int16_t>(bb.CountLeadingZeros());
+    if (exponent >= 16)
     {
-        exponent++;
+        throw std::runtime_error("Bad compressed number in blockset");
     }
+    bb.Consume(exponent + 1);
     if(!exponent) return 0;
     
     uint16_t val = 1 << exponent;
-    mantissa = static_cast<int16_t>(bb.readBits(exponent));
+    mantissa = static_cast<int16_t>(bb.ReadBits(exponent));
     val += mantissa;
     --val;
 
     return val;
 }
 
-static void writeCompNumber(BitBarrelWriter& bb, uint16_t val)
+static void writeCompNumber(BitWriter& bb, uint16_t val)
 {
     uint16_t exp = static_cast<uint16_t>(ilog2(val) - 1);
     uint16_t i = exp;
@@ -109,22 +111,22 @@ static void writeCompNumber(BitBarrelWriter& bb, uint16_t val)
     }
 }
 
-static uint16_t decodeTile(TileQueue<uint16_t, 16>& tq, BitBarrel& bb)
+static uint16_t decodeTile(TileQueue<uint16_t, 16>& tq, BitReader& bb)
 {
-    if(bb.getNextBit())
+    if(bb.ReadBit())
     {
-        uint8_t idx = static_cast<uint8_t>(bb.readBits(4));
+        uint8_t idx = static_cast<uint8_t>(bb.ReadBits(4));
         if(idx) tq.moveToFront(idx);
     }
     else
     {
-        uint16_t val = static_cast<uint16_t>(bb.readBits(11));
+        uint16_t val = static_cast<uint16_t>(bb.ReadBits(11));
         tq.push(val);
     }
     return tq.front();
 }
 
-static void decompressTiles(std::vector<Tile>& tiles, BitBarrel& bb)
+static void decompressTiles(std::vector<Tile>& tiles, BitReader& bb)
 {
     TileQueue<uint16_t, 16> tq;
     std::vector<Tile>::iterator it;
@@ -132,7 +134,7 @@ static void decompressTiles(std::vector<Tile>& tiles, BitBarrel& bb)
     {
         uint16_t tile = decodeTile(tq, bb);
         it->SetIndex(tile);
-        if(!bb.getNextBit())
+        if(!bb.ReadBit())
         {
             (it + 1)->SetIndex(decodeTile(tq, bb));
         }
@@ -150,7 +152,7 @@ static void decompressTiles(std::vector<Tile>& tiles, BitBarrel& bb)
     }
 }
 
-static void maskTiles(std::vector<Tile>& tiles, const TileAttributes::Attribute& attr, BitBarrel& bb)
+static void maskTiles(std::vector<Tile>& tiles, const TileAttributes::Attribute& attr, BitReader& bb)
 {
     uint16_t count = 0;
     std::vector<Tile>::iterator it = tiles.begin();
@@ -185,7 +187,7 @@ static void maskTiles(std::vector<Tile>& tiles, const TileAttributes::Attribute&
 
 uint16_t BlocksetCmp::Decode(const uint8_t* src, size_t length, Blockset& blocks)
 {
-    BitBarrel bb(src);
+    BitReader bb(src, length);
     TileQueue<uint16_t, 16> tq;
     std::vector<Tile> new_tiles;
     
@@ -194,7 +196,7 @@ uint16_t BlocksetCmp::Decode(const uint8_t* src, size_t length, Blockset& blocks
         throw std::runtime_error("Unexpected end of input data");
     }
 
-    const uint16_t TOTAL = static_cast<uint16_t>(bb.readBits(16));
+    const uint16_t TOTAL = static_cast<uint16_t>(bb.ReadBits(16));
     
     new_tiles.resize(TOTAL * 4);   
     blocks.reserve(blocks.size() + TOTAL);
@@ -213,11 +215,15 @@ uint16_t BlocksetCmp::Decode(const uint8_t* src, size_t length, Blockset& blocks
         blocks.push_back(MapBlock(it, it+4));
     }
 
-    bb.advanceNextByte();
-    return static_cast<uint16_t>(bb.getBytePosition());;
+    bb.AlignToByte();
+    if (bb.IsOverrun())
+    {
+        throw std::runtime_error("Unexpected end of input data");
+    }
+    return static_cast<uint16_t>(bb.GetBytePosition());
 }
 
-static void SetMask(const Blockset& blocks, const TileAttributes::Attribute& attr, BitBarrelWriter& cbs)
+static void SetMask(const Blockset& blocks, const TileAttributes::Attribute& attr, BitWriter& cbs)
 {
     bool attr_set = false;
     uint16_t count = 0;
@@ -240,7 +246,7 @@ static void SetMask(const Blockset& blocks, const TileAttributes::Attribute& att
     writeCompNumber(cbs, ++count);
 }
 
-static void EncodeTile(TileQueue<uint16_t, 16>& tq, uint16_t tileval, BitBarrelWriter& cbs)
+static void EncodeTile(TileQueue<uint16_t, 16>& tq, uint16_t tileval, BitWriter& cbs)
 {
     int tq_idx = tq.find(tileval);
     if (tq_idx == -1)
@@ -256,7 +262,7 @@ static void EncodeTile(TileQueue<uint16_t, 16>& tq, uint16_t tileval, BitBarrelW
     }
 }
 
-static void CompressTiles(const Blockset& blocks, BitBarrelWriter& cbs)
+static void CompressTiles(const Blockset& blocks, BitWriter& cbs)
 {
     TileQueue<uint16_t, 16> tq;
     for (const auto& block : blocks)
@@ -289,9 +295,9 @@ static void CompressTiles(const Blockset& blocks, BitBarrelWriter& cbs)
 
 uint16_t BlocksetCmp::Encode(const Blockset& blocks, uint8_t* dst, size_t bufsize)
 {
-    BitBarrelWriter cbs;
+    BitWriter cbs;
     // STEP 1: Write out total blocks
-    cbs.Write<uint16_t>(static_cast<uint16_t>(blocks.size()));
+    cbs.WriteBits(static_cast<uint16_t>(blocks.size()), 16);
     // STEP 2: Calculate mask for PRIORITY
     SetMask(blocks, TileAttributes::Attribute::ATTR_PRIORITY, cbs);
     // STEP 3: Calculate mask for VFLIP
@@ -303,7 +309,8 @@ uint16_t BlocksetCmp::Encode(const Blockset& blocks, uint8_t* dst, size_t bufsiz
     // Done!
     if (cbs.GetByteCount() <= bufsize)
     {
-        std::copy(cbs.Begin(), cbs.End(), dst);
+        const auto bytes = cbs.GetBytes();
+        std::copy(bytes.begin(), bytes.end(), dst);
     }
     else
     {
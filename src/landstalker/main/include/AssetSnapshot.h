@@ -0,0 +1,91 @@
+#ifndef _ASSET_SNAPSHOT_H_
+#define _ASSET_SNAPSHOT_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <landstalker/misc/include/MappedFile.h>
+#include <wjakob/filesystem/path.h>
+
+// An on-disk cache of already-decoded assets, so that they need not be
+// decompressed again the next time the same ROM or disassembly is opened.
+//
+// The file holds a header, an index of fixed-size records sorted by key hash,
+// and the record payloads. It is memory mapped and searched in place; only the
+// index bounds are checked on opening. Each record also carries a hash of the
+// bytes it was decoded from, so a stale record is never used.
+class AssetSnapshot
+{
+public:
+	struct Record
+	{
+		const uint8_t* data;
+		std::size_t size;
+		uint64_t source_hash;
+		// Number of source bytes the decoder consumed
+		uint32_t source_length;
+	};
+
+	// Collects records from any number of threads and writes them out in key order
+	class Builder
+	{
+	public:
+		void Add(const std::string& key, std::vector<uint8_t> data, uint64_t source_hash, uint32_t source_length);
+		std::size_t GetRecordCount() const;
+		void Write(const filesystem::path& filename, uint64_t file_hash) const;
+	private:
+		struct Item
+		{
+			std::string key;
+			std::vector<uint8_t> data;
+			uint64_t source_hash;
+			uint32_t source_length;
+		};
+		mutable std::mutex m_mutex;
+		std::vector<Item> m_items;
+	};
+
+	// Returns nullptr if the file does not exist, is damaged, or was made from a different source
+	static std::shared_ptr<const AssetSnapshot> Open(const filesystem::path& filename, uint64_t file_hash);
+	static filesystem::path GetFilename(const filesystem::path& dir, uint64_t file_hash);
+	// Deletes all but the most recently written snapshots in dir
+	static void Prune(const filesystem::path& dir, std::size_t keep);
+
+	bool Find(const std::string& key, Record& record) const;
+	std::size_t GetRecordCount() const;
+
+private:
+	struct FileHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t byte_order;
+		uint32_t record_count;
+		uint64_t file_hash;
+	};
+
+	struct IndexRecord
+	{
+		uint64_t key_hash;
+		uint64_t source_hash;
+		uint32_t key_offset;
+		uint32_t key_length;
+		uint32_t data_offset;
+		uint32_t data_size;
+		uint32_t source_length;
+		uint32_t reserved;
+	};
+
+	explicit AssetSnapshot(std::unique_ptr<MappedFile> file);
+
+	static const uint32_t VERSION = 1;
+	static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	std::unique_ptr<MappedFile> m_file;
+	const IndexRecord* m_index;
+	std::size_t m_record_count;
+};
+
+#endif // _ASSET_SNAPSHOT_H_
@@ -1,12 +1,20 @@
 #ifndef _DATA_MANAGER_H_
 #define _DATA_MANAGER_H_
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 #include <landstalker/main/include/Rom.h>
 #include <landstalker/main/include/AsmFile.h>
+#include <landstalker/main/include/AssetSnapshot.h>
 #include <wjakob/filesystem/path.h>
 
 using ByteVector = std::vector<uint8_t>;
@@ -17,8 +25,21 @@ using PendingWrites = std::vector<std::pair<std::string, ConstByteVectorPtr>>;
 class DataManager
 {
 public:
+	// Anything that can contribute records to an asset snapshot
+	class SnapshotSource
+	{
+	public:
+		virtual ~SnapshotSource() {}
+		virtual void AddToSnapshot(AssetSnapshot::Builder& builder) = 0;
+		// Decodes and serialises ahead of ROM injection, so that preparing the writes finds the bytes memoised
+		virtual void PrepareBytes() {}
+		// Checks, without decoding, that the source is long enough to decode. Returns false,
+		// with the reason in error, if it is not.
+		virtual bool Validate(std::string& /*error*/) { return true; }
+	};
+
 	template<class T>
-	class Entry
+	class Entry : public SnapshotSource
 	{
 	public:
 		Entry(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename);
@@ -26,6 +47,14 @@ public:
 
 		virtual bool Serialise(const std::shared_ptr<T> in, ByteVectorPtr out) = 0;
 		virtual bool Deserialise(const ByteVectorPtr in, std::shared_ptr<T>& out) = 0;
+		// Uncompressed form of the data for the asset snapshot. Types without one are not cached.
+		virtual bool SerialiseSnapshot(const std::shared_ptr<T> /*in*/, ByteVector& /*out*/) { return false; }
+		virtual bool DeserialiseSnapshot(const uint8_t* /*in*/, std::size_t /*size*/, std::shared_ptr<T>& /*out*/) { return false; }
+		virtual void AddToSnapshot(AssetSnapshot::Builder& builder);
+		virtual void PrepareBytes();
+		virtual bool Validate(std::string& error);
+		// Header and length checks on the undecoded bytes, for types that have them
+		virtual bool CheckSource(const ByteVector& /*in*/, std::string& /*error*/) const { return true; }
 
 		virtual void Initialise();
 		virtual void Commit();
@@ -41,6 +70,9 @@ public:
 		std::shared_ptr<const T> GetOrigData() const;
 		std::shared_ptr<const ByteVector> GetBytes();
 		std::shared_ptr<const ByteVector> GetOrigBytes() const;
+		// The data that GetBytes() was produced from. It is never modified, so can be held and
+		// compared by identity.
+		std::shared_ptr<const T> GetSerialisedData();
 		std::string GetName() const;
 		void SetName(const std::string& val);
 		filesystem::path GetFilename() const;
@@ -51,7 +83,29 @@ public:
 		uint32_t GetOrigDataLength() const;
 		uint32_t GetOrigEndAddress() const;
 		void SetStartAddress(uint32_t addr);
+		// Why the data could not be decoded, if it was loaded and failed to. The entry then holds
+		// default-constructed data.
+		std::string GetLoadError() const;
+		// Bumped whenever write access to the data is handed out or the data is replaced
+		uint64_t GetGeneration() const { return m_generation; }
 	private:
+		void EnsureLoaded() const;
+		void Load();
+		bool LoadFromSnapshot();
+		std::string GetSnapshotKey() const;
+		uint64_t GetMemoTag() const;
+
+		// Data is decoded from m_raw_data on first use. Until write access is first handed out,
+		// m_data, m_orig_data and m_saved_data all share the one decoded object.
+		std::atomic<bool> m_loaded;
+		std::mutex m_load_mutex;
+		// Only written before m_loaded is set. The raw bytes are kept, so that saving leaves an
+		// undecodable asset as it was.
+		std::string m_load_error;
+		// Hash of m_raw_data as it was before decoding trimmed it, and its length after. The raw
+		// data is replaced when changes are committed, but these still describe m_orig_data.
+		uint64_t m_source_hash;
+		uint32_t m_source_length;
 		std::shared_ptr<T> m_data;
 		std::shared_ptr<T> m_orig_data;
 		std::shared_ptr<T> m_saved_data;
@@ -59,12 +113,73 @@ public:
 		std::string m_name;
 		filesystem::path m_filename;
 		ByteVectorPtr m_raw_data;
-		ByteVectorPtr m_cached_raw_data;
 		DataManager* m_owner;
+
+		// Write access is handed out through handles that share m_writer. Holders of read-only
+		// handles cannot modify the data, so only a live writer can change it behind the entry's back.
+		std::weak_ptr<std::shared_ptr<T>> m_writer;
+
+		// Change checks and serialisation are memoised against the generation, which every write
+		// access moves on. A result is only tagged while no writer is live, as a writer can still
+		// modify the data after the generation was read. Untagged results fall back to a comparison.
+		// Serialised bytes are also tied to the compression settings they were produced with.
+		uint64_t m_generation;
+		mutable uint64_t m_changed_generation;
+		mutable bool m_changed;
+		mutable uint64_t m_saved_changed_generation;
+		mutable bool m_saved_changed;
+		uint64_t m_cached_generation;
+		uint32_t m_cached_settings;
+		std::shared_ptr<const T> m_cached_source;
+		ByteVectorPtr m_cached_raw_data;
+	};
+
+	// Everything that a group of pending writes is prepared from. A refresh reuses the writes
+	// from the previous refresh for any group whose inputs are all unchanged.
+	class SectionInputs
+	{
+	public:
+		// Entries are compared by their serialised bytes, which GetBytes() only recomputes after an edit
+		template<class E>
+		SectionInputs& AddEntry(const std::shared_ptr<E>& entry);
+		template<class K, class E>
+		SectionInputs& AddEntries(const std::map<K, std::shared_ptr<E>>& entries);
+		template<class E>
+		SectionInputs& AddEntries(const std::vector<std::shared_ptr<E>>& entries);
+		// For writes that depend on more of the entry than its serialised bytes. The data is
+		// shared rather than copied, and only compared by value if it is not the same object.
+		template<class E>
+		SectionInputs& AddEntryData(const std::shared_ptr<E>& entry);
+		// Copied, and compared by value
+		template<class T>
+		SectionInputs& AddValue(const T& value);
+
+		bool operator==(const SectionInputs& rhs) const;
+	private:
+		struct Value
+		{
+			std::shared_ptr<const void> value;
+			bool (*equal)(const void*, const void*);
+		};
+		template<class T>
+		static bool ValueEquals(const void* lhs, const void* rhs);
+		template<class T>
+		static bool DataEquals(const void* lhs, const void* rhs);
+
+		std::vector<ConstByteVectorPtr> m_bytes;
+		std::vector<Value> m_values;
 	};
 
-	DataManager(const filesystem::path& asm_file) : m_asm_filename(asm_file), m_base_path(asm_file.parent_path()) {}
-	DataManager(const Rom&) {}
+	struct SectionTiming
+	{
+		std::string name;
+		double milliseconds;
+		bool reused;
+	};
+
+	DataManager(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot = nullptr)
+		: m_asm_filename(asm_file), m_base_path(asm_file.parent_path()), m_snapshot(snapshot) {}
+	DataManager(const Rom&, std::shared_ptr<const AssetSnapshot> snapshot = nullptr) : m_snapshot(snapshot) {}
 
 	virtual ~DataManager() {}
 
@@ -76,54 +191,268 @@ public:
 	virtual bool Save(const filesystem::path& dir);
 	virtual bool Save();
 	virtual void RefreshPendingWrites(const Rom& rom);
+	// Commits the changes once the pending writes have been applied to the ROM by some other means
+	virtual void CompleteRomInjection();
+	// Writes are applied in order, so a later write to the same location takes precedence
+	static void ApplyPendingWrites(Rom& rom, const PendingWrites& writes);
+	// Applies the writes, leaving the ROM untouched and returning false if any of them fails
+	static bool StageRomInjection(Rom& rom, const PendingWrites& writes);
+	// Serialises every changed entry in parallel, ahead of RefreshPendingWrites()
+	void PrepareEntryBytes();
+	// How long each section took to prepare during the last refresh
+	const std::vector<SectionTiming>& GetSectionTimings() const { return m_section_timings; }
+	// Identifies the compression levels that entries are currently serialised with
+	static uint32_t GetCompressionSettings();
 
 	filesystem::path GetBasePath() const { return m_base_path; }
 	filesystem::path GetAsmFilename() const { return m_asm_filename; }
+
+	// Decoded entries are looked up in the snapshot before being decompressed
+	std::shared_ptr<const AssetSnapshot> GetSnapshot() const { return m_snapshot; }
+	void RegisterSnapshotSource(std::weak_ptr<SnapshotSource> source);
+	// Adds every registered source that is still alive. Nothing is decoded for it: loaded entries
+	// add their data, and the others keep any record that still matches them in the snapshot
+	// they were opened with.
+	virtual void AddToSnapshot(AssetSnapshot::Builder& builder);
+	// Checks that every registered entry is long enough to decode, without decoding any of them.
+	// Returns a description of each entry that is not.
+	std::vector<std::string> ValidateEntries();
+	// Entries that failed to decode when first loaded, since this was last called
+	virtual std::vector<std::string> TakeLoadErrors();
 protected:
 	virtual void CommitAllChanges();
 	
 	virtual bool GetFilenameFromAsm(AsmFile& file, const std::string& label, filesystem::path& path);
+	// Runs prepare, which appends to m_pending_writes, unless inputs match those it was last run
+	// with. In that case the writes it made then are appended instead.
+	bool PrepareSection(const std::string& name, SectionInputs inputs, const std::function<bool()>& prepare);
 
 	mutable PendingWrites m_pending_writes;
 private:
 	filesystem::path m_asm_filename;
 	filesystem::path m_base_path;
+	std::shared_ptr<const AssetSnapshot> m_snapshot;
+	std::vector<std::weak_ptr<SnapshotSource>> m_snapshot_sources;
+
+	std::vector<std::shared_ptr<SnapshotSource>> GetSnapshotSources() const;
+	void AddLoadError(const std::string& error);
+
+	std::mutex m_load_errors_mutex;
+	std::vector<std::string> m_load_errors;
+
+	struct PreparedSection
+	{
+		SectionInputs inputs;
+		PendingWrites writes;
+	};
+	// Prepared writes are only reused for ROMs with the same layout
+	std::map<std::string, PreparedSection> m_prepared_sections;
+	RomOffsets::Region m_prepared_region = RomOffsets::Region::COUNT;
+	std::size_t m_prepared_rom_size = 0;
+	std::vector<SectionTiming> m_section_timings;
 };
 
 template<class T>
 inline DataManager::Entry<T>::Entry(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename)
-	: m_data(std::make_shared<T>()),
-	  m_orig_data(std::make_shared<T>()),
+	: m_loaded(false),
+	  m_source_hash(0),
+	  m_source_length(0),
+	  m_data(nullptr),
+	  m_orig_data(nullptr),
 	  m_saved_data(nullptr),
 	  m_begin_address(0),
 	  m_name(name),
 	  m_filename(filename),
 	  m_raw_data(std::make_shared<ByteVector>(b)),
-	  m_cached_raw_data(std::make_shared<ByteVector>()),
-	  m_owner(owner)
+	  m_owner(owner),
+	  m_generation(1),
+	  m_changed_generation(0),
+	  m_changed(false),
+	  m_saved_changed_generation(0),
+	  m_saved_changed(false),
+	  m_cached_generation(0),
+	  m_cached_settings(0),
+	  m_cached_source(nullptr),
+	  m_cached_raw_data(std::make_shared<ByteVector>())
 {
 }
 
 template<class T>
 inline DataManager::Entry<T>::Entry(DataManager* owner, const std::string& name, const filesystem::path& filename)
-  : m_data(std::make_shared<T>()),
+  : m_loaded(true),
+	m_source_hash(0),
+	m_source_length(0),
+	m_data(std::make_shared<T>()),
 	m_orig_data(std::make_shared<T>()),
 	m_saved_data(std::make_shared<T>()),
 	m_begin_address(0),
 	m_name(name),
 	m_filename(filename),
 	m_raw_data(std::make_shared<ByteVector>()),
-	m_cached_raw_data(std::make_shared<ByteVector>()),
-	m_owner(owner)
+	m_owner(owner),
+	m_generation(1),
+	m_changed_generation(0),
+	m_changed(false),
+	m_saved_changed_generation(0),
+	m_saved_changed(false),
+	m_cached_generation(0),
+	m_cached_settings(0),
+	m_cached_source(nullptr),
+	m_cached_raw_data(std::make_shared<ByteVector>())
 {
 }
 
 template<class T>
 inline void DataManager::Entry<T>::Initialise()
 {
-	Deserialise(m_raw_data, m_orig_data);
-	m_data = std::make_shared<T>(*m_orig_data);
-	m_saved_data = std::make_shared<T>(*m_orig_data);
+	// Decoding is deferred until the data is first needed
+	std::lock_guard<std::mutex> lock(m_load_mutex);
+	m_loaded = false;
+	m_load_error.clear();
+	m_data = nullptr;
+	m_orig_data = nullptr;
+	m_saved_data = nullptr;
+	m_cached_source = nullptr;
+	++m_generation;
+}
+
+template<class T>
+inline void DataManager::Entry<T>::EnsureLoaded() const
+{
+	if (!m_loaded.load(std::memory_order_acquire))
+	{
+		const_cast<Entry*>(this)->Load();
+	}
+}
+
+template<class T>
+inline void DataManager::Entry<T>::Load()
+{
+	std::lock_guard<std::mutex> lock(m_load_mutex);
+	if (!m_loaded.load(std::memory_order_relaxed))
+	{
+		if (m_raw_data.use_count() > 1)
+		{
+			// Handed out before the entry was last initialised, so must not be trimmed under its holder
+			m_raw_data = std::make_shared<ByteVector>(*m_raw_data);
+		}
+		m_source_hash = Fnv1a(m_raw_data->data(), m_raw_data->size());
+		if (!LoadFromSnapshot())
+		{
+			// Callers may be anywhere, including paint handlers, so a failure is recorded rather than thrown
+			try
+			{
+				if (!Deserialise(m_raw_data, m_orig_data) || m_orig_data == nullptr)
+				{
+					throw std::runtime_error("No data decoded");
+				}
+			}
+			catch (const std::exception& e)
+			{
+				m_load_error = e.what();
+				m_orig_data = std::make_shared<T>();
+				if (m_owner != nullptr)
+				{
+					m_owner->AddLoadError(m_name + ": " + m_load_error);
+				}
+			}
+		}
+		m_source_length = m_raw_data->size();
+		m_data = m_orig_data;
+		m_saved_data = m_orig_data;
+		++m_generation;
+		m_loaded.store(true, std::memory_order_release);
+	}
+}
+
+template<class T>
+inline bool DataManager::Entry<T>::LoadFromSnapshot()
+{
+	auto snapshot = (m_owner != nullptr) ? m_owner->GetSnapshot() : nullptr;
+	AssetSnapshot::Record record;
+	if (snapshot == nullptr || !snapshot->Find(GetSnapshotKey(), record) ||
+		record.source_hash != m_source_hash || record.source_length > m_raw_data->size())
+	{
+		return false;
+	}
+	try
+	{
+		if (!DeserialiseSnapshot(record.data, record.size, m_orig_data))
+		{
+			return false;
+		}
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+	m_raw_data->resize(record.source_length);
+	return true;
+}
+
+template<class T>
+inline std::string DataManager::Entry<T>::GetSnapshotKey() const
+{
+	return std::string(typeid(T).name()) + ':' + m_name;
+}
+
+template<class T>
+inline void DataManager::Entry<T>::AddToSnapshot(AssetSnapshot::Builder& builder)
+{
+	std::shared_ptr<T> data;
+	uint64_t source_hash = 0;
+	uint32_t source_length = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_load_mutex);
+		if (m_raw_data->empty() || !m_load_error.empty())
+		{
+			return;
+		}
+		if (!m_loaded)
+		{
+			auto snapshot = (m_owner != nullptr) ? m_owner->GetSnapshot() : nullptr;
+			AssetSnapshot::Record record;
+			if (snapshot != nullptr && snapshot->Find(GetSnapshotKey(), record) && record.source_length <= m_raw_data->size() &&
+				record.source_hash == Fnv1a(m_raw_data->data(), m_raw_data->size()))
+			{
+				builder.Add(GetSnapshotKey(), ByteVector(record.data, record.data + record.size), record.source_hash, record.source_length);
+			}
+			return;
+		}
+		data = m_orig_data;
+		source_hash = m_source_hash;
+		source_length = m_source_length;
+	}
+	try
+	{
+		ByteVector bytes;
+		if (SerialiseSnapshot(data, bytes))
+		{
+			builder.Add(GetSnapshotKey(), std::move(bytes), source_hash, source_length);
+		}
+	}
+	catch (const std::exception&)
+	{
+		// Left out of the snapshot, and decoded normally when needed
+	}
+}
+
+template<class T>
+inline void DataManager::Entry<T>::PrepareBytes()
+{
+	GetBytes();
+}
+
+template<class T>
+inline bool DataManager::Entry<T>::Validate(std::string& error)
+{
+	std::lock_guard<std::mutex> lock(m_load_mutex);
+	if (m_loaded || CheckSource(*m_raw_data, error))
+	{
+		return true;
+	}
+	error = m_name + ": " + error;
+	return false;
 }
 
 template<class T>
@@ -131,66 +460,142 @@ inline void DataManager::Entry<T>::Commit()
 {
 	if (HasDataChanged())
 	{
-		Serialise(m_data, m_cached_raw_data);
-		*m_saved_data = *m_data;
-		*m_raw_data = *m_cached_raw_data;
+		auto bytes = GetBytes();
+		if (m_saved_data == m_orig_data)
+		{
+			m_saved_data = std::make_shared<T>(*m_data);
+		}
+		else
+		{
+			*m_saved_data = *m_data;
+		}
+		// Replaced rather than overwritten, as prepared sections may still hold the old bytes to
+		// compare against
+		m_raw_data = std::make_shared<ByteVector>(*bytes);
+		m_saved_changed = false;
+		m_saved_changed_generation = GetMemoTag();
 	}
 }
 
 template<class T>
 inline void DataManager::Entry<T>::AbandonChanges()
 {
+	if (!m_loaded || m_data == m_saved_data)
+	{
+		return;
+	}
 	*m_data = *m_saved_data;
-	m_cached_raw_data->clear();
+	++m_generation;
+	m_saved_changed = false;
+	m_saved_changed_generation = GetMemoTag();
 }
 
 template<class T>
 inline bool DataManager::Entry<T>::HasDataChanged() const
 {
-	return *m_orig_data != *m_data;
+	if (!m_loaded || m_data == m_orig_data)
+	{
+		return false;
+	}
+	if (m_changed_generation != m_generation)
+	{
+		m_changed = *m_orig_data != *m_data;
+		m_changed_generation = GetMemoTag();
+	}
+	return m_changed;
 }
 
 template<class T>
 inline bool DataManager::Entry<T>::HasSavedDataChanged() const
 {
-	return m_saved_data != nullptr && *m_saved_data != *m_data;
+	if (!m_loaded || m_data == m_saved_data)
+	{
+		return false;
+	}
+	if (m_saved_changed_generation != m_generation)
+	{
+		m_saved_changed = m_saved_data != nullptr && *m_saved_data != *m_data;
+		m_saved_changed_generation = GetMemoTag();
+	}
+	return m_saved_changed;
 }
 
 template<class T>
 inline std::shared_ptr<T> DataManager::Entry<T>::GetData()
 {
-	return m_data;
+	EnsureLoaded();
+	// The caller may modify the data, so it can no longer share the original
+	if (m_data == m_orig_data)
+	{
+		m_data = std::make_shared<T>(*m_orig_data);
+	}
+	++m_generation;
+	auto writer = m_writer.lock();
+	if (writer == nullptr || *writer != m_data)
+	{
+		writer = std::make_shared<std::shared_ptr<T>>(m_data);
+		m_writer = writer;
+	}
+	// Shares ownership with the writer, while pointing at the data itself
+	return std::shared_ptr<T>(writer, m_data.get());
 }
 
 template<class T>
 inline std::shared_ptr<const T> DataManager::Entry<T>::GetData() const
 {
-	return GetData();
+	EnsureLoaded();
+	return m_data;
 }
 
 template<class T>
 inline std::shared_ptr<const T> DataManager::Entry<T>::GetOrigData() const
 {
+	EnsureLoaded();
 	return m_orig_data;
 }
 
 template<class T>
 inline std::shared_ptr<const ByteVector> DataManager::Entry<T>::GetBytes()
 {
-	if (HasDataChanged())
+	// Sources may be read with padding after them, which only decoding trims off. Untrimmed
+	// bytes could overflow the section they are written to.
+	EnsureLoaded();
+	if (!HasDataChanged())
 	{
-		Serialise(m_data, m_cached_raw_data);
-		return m_cached_raw_data;
+		return m_raw_data;
 	}
-	return m_raw_data;
+	const uint32_t settings = GetCompressionSettings();
+	if (m_cached_generation != m_generation || m_cached_settings != settings)
+	{
+		// Comparing against the data that was last serialised is far cheaper than compressing it again
+		if (m_cached_source == nullptr || m_cached_settings != settings || *m_cached_source != *m_data)
+		{
+			auto bytes = std::make_shared<ByteVector>();
+			Serialise(m_data, bytes);
+			m_cached_raw_data = bytes;
+			m_cached_source = std::make_shared<const T>(*m_data);
+			m_cached_settings = settings;
+		}
+		m_cached_generation = GetMemoTag();
+	}
+	return m_cached_raw_data;
 }
 
 template<class T>
 inline std::shared_ptr<const ByteVector> DataManager::Entry<T>::GetOrigBytes() const
 {
+	EnsureLoaded();
 	return m_raw_data;
 }
 
+template<class T>
+inline std::shared_ptr<const T> DataManager::Entry<T>::GetSerialisedData()
+{
+	GetBytes();
+	// m_orig_data is only ever replaced, and the cached source is a private copy
+	return HasDataChanged() ? m_cached_source : m_orig_data;
+}
+
 template<class T>
 inline std::string DataManager::Entry<T>::GetName() const
 {
@@ -226,8 +631,7 @@ inline uint32_t DataManager::Entry<T>::GetDataLength()
 {
 	if (HasDataChanged())
 	{
-		Serialise(m_data, m_cached_raw_data);
-		return m_cached_raw_data->size();
+		return GetBytes()->size();
 	}
 	return GetOrigDataLength();
 }
@@ -241,6 +645,7 @@ inline uint32_t DataManager::Entry<T>::GetEndAddress()
 template<class T>
 inline uint32_t DataManager::Entry<T>::GetOrigDataLength() const
 {
+	EnsureLoaded();
 	return m_raw_data->size();
 }
 
@@ -256,6 +661,19 @@ inline void DataManager::Entry<T>::SetStartAddress(uint32_t addr)
 	m_begin_address = addr;
 }
 
+template<class T>
+inline std::string DataManager::Entry<T>::GetLoadError() const
+{
+	return m_loaded.load(std::memory_order_acquire) ? m_load_error : std::string();
+}
+
+template<class T>
+inline uint64_t DataManager::Entry<T>::GetMemoTag() const
+{
+	// Generation zero is never current
+	return m_writer.expired() ? m_generation : 0;
+}
+
 template<class T>
 inline bool DataManager::Entry<T>::Save(const filesystem::path& dir)
 {
@@ -266,4 +684,61 @@ inline bool DataManager::Entry<T>::Save(const filesystem::path& dir)
 	return true;
 }
 
+template<class E>
+inline DataManager::SectionInputs& DataManager::SectionInputs::AddEntry(const std::shared_ptr<E>& entry)
+{
+	m_bytes.push_back(entry != nullptr ? entry->GetBytes() : nullptr);
+	return *this;
+}
+
+template<class K, class E>
+inline DataManager::SectionInputs& DataManager::SectionInputs::AddEntries(const std::map<K, std::shared_ptr<E>>& entries)
+{
+	AddValue(entries);
+	for (const auto& e : entries)
+	{
+		AddEntry(e.second);
+	}
+	return *this;
+}
+
+template<class E>
+inline DataManager::SectionInputs& DataManager::SectionInputs::AddEntries(const std::vector<std::shared_ptr<E>>& entries)
+{
+	AddValue(entries);
+	for (const auto& e : entries)
+	{
+		AddEntry(e);
+	}
+	return *this;
+}
+
+template<class E>
+inline DataManager::SectionInputs& DataManager::SectionInputs::AddEntryData(const std::shared_ptr<E>& entry)
+{
+	using T = typename std::decay<decltype(*entry->GetSerialisedData())>::type;
+	AddEntry(entry);
+	m_values.push_back({ entry->GetSerialisedData(), &DataEquals<T> });
+	return *this;
+}
+
+template<class T>
+inline DataManager::SectionInputs& DataManager::SectionInputs::AddValue(const T& value)
+{
+	m_values.push_back({ std::make_shared<const T>(value), &ValueEquals<T> });
+	return *this;
+}
+
+template<class T>
+inline bool DataManager::SectionInputs::ValueEquals(const void* lhs, const void* rhs)
+{
+	return *static_cast<const T*>(lhs) == *static_cast<const T*>(rhs);
+}
+
+template<class T>
+inline bool DataManager::SectionInputs::DataEquals(const void* lhs, const void* rhs)
+{
+	return lhs == rhs || (lhs != nullptr && rhs != nullptr && ValueEquals<T>(lhs, rhs));
+}
+
 #endif // _DATA_MANAGER_H_
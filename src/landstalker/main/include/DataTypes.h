@@ -28,6 +28,8 @@ public:
 
 	virtual bool Serialise(const std::shared_ptr<Tileset> in, ByteVectorPtr out);
 	virtual bool Deserialise(const ByteVectorPtr in, std::shared_ptr<Tileset>& out);
+	virtual bool SerialiseSnapshot(const std::shared_ptr<Tileset> in, ByteVector& out);
+	virtual bool DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<Tileset>& out);
 
 	const std::string& GetPointerName() const { return m_ptrname; }
 	void SetPointerName(const std::string& name) { m_ptrname = name; }
@@ -94,6 +96,7 @@ public:
 
 	virtual bool Serialise(const std::shared_ptr<Palette> in, ByteVectorPtr out);
 	virtual bool Deserialise(const ByteVectorPtr in, std::shared_ptr<Palette>& out);
+	virtual bool CheckSource(const ByteVector& in, std::string& error) const;
 
 	int GetIndex() const { return m_index; }
 	void SetIndex(int val) { m_index = val; }
@@ -113,6 +116,9 @@ public:
 
 	virtual bool Serialise(const std::shared_ptr<Blockset> in, ByteVectorPtr out);
 	virtual bool Deserialise(const ByteVectorPtr in, std::shared_ptr<Blockset>& out);
+	virtual bool CheckSource(const ByteVector& in, std::string& error) const;
+	virtual bool SerialiseSnapshot(const std::shared_ptr<Blockset> in, ByteVector& out);
+	virtual bool DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<Blockset>& out);
 
 	std::pair<uint8_t, uint8_t> GetIndex() const { return { pri, sec }; }
 	void SetIndex(std::pair<uint8_t, uint8_t> idx) { pri = idx.first; sec = idx.second; }
@@ -135,6 +141,9 @@ public:
 
 	virtual bool Serialise(const std::shared_ptr<Tilemap3D> in, ByteVectorPtr out);
 	virtual bool Deserialise(const ByteVectorPtr in, std::shared_ptr<Tilemap3D>& out);
+	virtual bool CheckSource(const ByteVector& in, std::string& error) const;
+	virtual bool SerialiseSnapshot(const std::shared_ptr<Tilemap3D> in, ByteVector& out);
+	virtual bool DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<Tilemap3D>& out);
 };
 
 class Tilemap2DEntry : public DataManager::Entry<Tilemap2D>, public PalettePreferences
@@ -184,6 +193,8 @@ public:
 
 	virtual bool Serialise(const std::shared_ptr<SpriteFrame> in, ByteVectorPtr out);
 	virtual bool Deserialise(const ByteVectorPtr in, std::shared_ptr<SpriteFrame>& out);
+	virtual bool SerialiseSnapshot(const std::shared_ptr<SpriteFrame> in, ByteVector& out);
+	virtual bool DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<SpriteFrame>& out);
 
 	uint8_t GetSprite() const { return m_sprite; }
 	void SetSprite(uint8_t val) { m_sprite = val; }
@@ -4,6 +4,7 @@
 #include <vector>
 #include <memory>
 #include <list>
+#include <mutex>
 
 #include <landstalker/main/include/DataManager.h>
 #include <landstalker/main/include/RoomData.h>
@@ -26,8 +27,13 @@ public:
     virtual PendingWrites GetPendingWrites() const;
     virtual bool WillFitInRom(const Rom& rom) const;
     virtual bool HasBeenModified() const;
+    // Returns false, leaving the ROM as it was, if the last refresh failed or a write does not fit
     virtual bool InjectIntoRom(Rom& rom);
     virtual void RefreshPendingWrites(const Rom& rom);
+    // Breakdown of the last RefreshPendingWrites(), with the critical path marked, followed by how
+    // long InjectIntoRom() then took
+    std::string GetInjectionTimings() const;
+    virtual std::vector<std::string> TakeLoadErrors();
 
     std::shared_ptr<RoomData> GetRoomData() const { return m_rd; }
     std::shared_ptr<GraphicsData> GetGraphicsData() const { return m_gd; }
@@ -44,9 +50,20 @@ public:
     std::shared_ptr<AnimatedTilesetEntry> GetAnimatedTileset(const std::string& name) const;
     std::shared_ptr<Tilemap2DEntry> GetTilemap(const std::string& name) const;
 
+    // Decoded assets are cached here between sessions. An empty path disables the cache.
+    static void SetSnapshotDirectory(const filesystem::path& dir);
+    static filesystem::path GetSnapshotDirectory();
+    // Caches whatever this session decoded, for the next session to start from. Called when the
+    // game data is closed. The cache only saves time, so a failure to write it is logged and ignored.
+    void WriteSnapshot();
+
 private:
+    // Throws, listing every entry too short to decode
+    void CheckEntries();
     void CacheData();
     void SetDefaults();
+    static uint64_t HashAsmTree(const filesystem::path& asm_file);
+    static std::shared_ptr<const AssetSnapshot> OpenSnapshot(uint64_t hash);
 
     std::shared_ptr<RoomData> m_rd;
     std::shared_ptr<GraphicsData> m_gd;
@@ -59,6 +76,16 @@ private:
     std::map<std::string, std::shared_ptr<TilesetEntry>> m_tilesets;
     std::map<std::string, std::shared_ptr<AnimatedTilesetEntry>> m_anim_tilesets;
     std::map<std::string, std::shared_ptr<Tilemap2DEntry>> m_tilemaps;
+
+    std::string m_injection_timings;
+    std::string m_apply_timings;
+    // Set while the pending writes are being refreshed, and left set if that fails
+    bool m_refresh_failed;
+    uint64_t m_snapshot_hash;
+
+    static const std::size_t MAX_SNAPSHOTS = 8;
+    static filesystem::path s_snapshot_dir;
+    static std::mutex s_snapshot_mutex;
 };
 
 #endif // _GAME_DATA_H_
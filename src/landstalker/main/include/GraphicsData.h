@@ -10,8 +10,8 @@
 class GraphicsData : public DataManager
 {
 public:
-    GraphicsData(const filesystem::path& asm_file);
-    GraphicsData(const Rom& rom);
+    GraphicsData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
+    GraphicsData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
 
     virtual ~GraphicsData() {}
 
@@ -2,6 +2,7 @@
 #define IMAGE_BUFFER_H
 
 #include <vector>
+#include <array>
 #include <memory>
 #include <optional>
 #include <wx/image.h>
@@ -11,15 +12,26 @@
 #include <landstalker/tileset/include/Tileset.h>
 #include <landstalker/palettes/include/Palette.h>
 #include <landstalker/blockset/include/Block.h>
+#include <landstalker/blockset/include/BlockCache.h>
 #include <landstalker/sprites/include/SpriteFrame.h>
 #include <landstalker/2d_maps/include/Tilemap2DRLE.h>
 #include <landstalker/3d_maps/include/Tilemap3DCmp.h>
 #include <landstalker/3d_maps/include/TileSwaps.h>
 #include <landstalker/3d_maps/include/Doors.h>
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
 
 class ImageBuffer
 {
 public:
+	// Speed and size trade-offs for PNG output. DEFAULT leaves libpng's own settings alone.
+	enum class PngCompression
+	{
+		STORE,
+		FAST,
+		DEFAULT,
+		MAX
+	};
+
 	ImageBuffer();
 	ImageBuffer(std::size_t width, std::size_t height);
 	void Clear();
@@ -34,9 +46,21 @@ public:
 	void Insert3DMapLayer(int x, int y, uint8_t palette_index, Tilemap3D::Layer layer,
 		const std::shared_ptr<const Tilemap3D> map, const std::shared_ptr<const Tileset> tileset,
 		const std::shared_ptr<const std::vector<MapBlock>> blockset, bool offset = true,
-		std::optional<std::vector<TileSwap>> swaps = std::nullopt, std::optional<std::vector<Door>> doors = std::nullopt);
-	bool WritePNG(const std::string& filename, const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha = true);
+		const std::optional<std::vector<TileSwap>>& swaps = std::nullopt, const std::optional<std::vector<Door>>& doors = std::nullopt);
+	void Insert3DMapLayer(int x, int y, uint8_t palette_index, const Tilemap3DOverlay& map, const std::shared_ptr<const Tileset> tileset,
+		const std::shared_ptr<const std::vector<MapBlock>> blockset, bool offset = true);
+	// Clears and redraws only the given cells of a layer already drawn with Insert3DMapLayer at (0, 0)
+	void Redraw3DMapCells(uint8_t palette_index, const Tilemap3DOverlay& map, const std::shared_ptr<const Tileset> tileset,
+		const std::shared_ptr<const std::vector<MapBlock>> blockset, const std::vector<IsoPoint2D>& cells, bool offset = true);
+	// Returns false, rather than throwing, if the PNG cannot be encoded or written
+	bool WritePNG(const std::string& filename, const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha = true,
+		PngCompression compression = PngCompression::DEFAULT) const;
+	// The same indexed PNG that WritePNG would write, held in memory. Throws std::runtime_error
+	// if libpng fails.
+	std::vector<uint8_t> EncodePNG(const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha = true,
+		PngCompression compression = PngCompression::DEFAULT) const;
 	void InsertBlock(std::size_t x, std::size_t y, uint8_t palette_index, const MapBlock& block, const Tileset& tileset);
+	// Only rows drawn to since the last call with the same palettes and opacity are expanded again
 	const std::vector<uint8_t>& GetRGB(const std::vector<std::shared_ptr<Palette>>& pals) const;
 	const std::vector<uint8_t>& GetAlpha(const std::vector<std::shared_ptr<Palette>>& pals, uint8_t low_pri_max_opacity = 0xFF, uint8_t high_pri_max_opacity = 0xFF) const;
 	std::shared_ptr<wxBitmap> MakeBitmap(const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha = false, uint8_t low_pri_max_opacity = 0xFF, uint8_t high_pri_max_opacity = 0xFF) const;
@@ -44,13 +68,49 @@ public:
 	std::size_t GetHeight() const;
 	std::size_t GetWidth() const;
 private:
+	// What m_rgb or an alpha channel were last expanded from, and which rows have been drawn to since
+	struct ExpandedRows
+	{
+		std::vector<std::weak_ptr<Palette>> pals;
+		std::vector<uint64_t> palette_versions;
+		uint8_t low_pri_max_opacity = 0;
+		uint8_t high_pri_max_opacity = 0;
+		std::size_t dirty_begin = 0;
+		std::size_t dirty_end = 0;
+		bool valid = false;
+	};
+	// Layers drawn from one buffer at different opacities each keep their own alpha channel
+	struct AlphaChannel
+	{
+		ExpandedRows rows;
+		std::vector<uint8_t> alpha;
+	};
+
+	void Draw3DMapCell(const IsoPoint2D& cell, uint8_t palette_index, const Tilemap3DOverlay& map,
+		const Tileset& tileset, const Blockset& blockset, bool offset, const TileFlipCache* cache, const BlockCache* blocks);
+	void ClearRect(int x, int y, int width, int height);
+	void MarkDirty(std::size_t first_row, std::size_t last_row);
+	AlphaChannel& GetAlphaChannel(uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const;
+	std::pair<std::size_t, std::size_t> TakeDirtyRows(ExpandedRows& rows, const std::vector<std::shared_ptr<Palette>>& pals,
+		uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const;
+	void ExpandRows(std::size_t first_row, std::size_t last_row, const std::vector<std::shared_ptr<Palette>>& pals,
+		bool rgb, uint8_t* alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const;
+	void InsertTile(int x, int y, uint8_t palette_index, const Tile& tile, const Tileset& tileset, const TileFlipCache* cache, bool use_alpha = true);
+	void InsertBlock(std::size_t x, std::size_t y, uint8_t palette_index, const MapBlock& block, const Tileset& tileset, const TileFlipCache* cache);
+	void BlitTile(std::size_t offset, const uint8_t* src, uint8_t pal_bits, uint8_t priority, bool use_alpha);
+	void BlitBlock(std::size_t offset, const uint8_t* src, const uint8_t* src_pri, uint8_t pal_bits);
+	// Fills both m_rgb and an alpha channel in one pass over the pixels
+	AlphaChannel& GetRGBA(const std::vector<std::shared_ptr<Palette>>& pals, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const;
+
 	std::size_t m_width;
 	std::size_t m_height;
 	std::vector<uint8_t> m_pixels;
 	std::vector<uint8_t> m_priority;
 	mutable std::vector<uint8_t> m_rgb;
 	mutable std::vector<uint8_t> m_rgba;
-	mutable std::vector<uint8_t> m_alpha;
+	mutable ExpandedRows m_rgb_rows;
+	mutable std::array<AlphaChannel, 2> m_alpha;
+	mutable std::size_t m_last_alpha = 0;
 	mutable wxImage m_img;
 };
 
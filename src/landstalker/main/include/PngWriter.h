@@ -0,0 +1,33 @@
+#ifndef _PNG_WRITER_H_
+#define _PNG_WRITER_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <landstalker/main/include/ImageBuffer.h>
+#include <landstalker/misc/include/TaskPool.h>
+
+// Encodes and writes PNGs on a task pool, so that exporting many images overlaps their
+// encoding. Each image is handed over when it is queued, and held until it has been written.
+class PngWriter
+{
+public:
+    explicit PngWriter(ImageBuffer::PngCompression compression = ImageBuffer::PngCompression::DEFAULT, TaskPool& pool = TaskPool::Global());
+    // Waits for any writes still in progress
+    ~PngWriter();
+    PngWriter(const PngWriter&) = delete;
+    PngWriter& operator=(const PngWriter&) = delete;
+
+    void Write(const std::string& filename, ImageBuffer image, std::vector<std::shared_ptr<Palette>> pals, bool use_alpha = true);
+    // Waits for every queued write, and returns the files that could not be written
+    std::vector<std::string> Wait();
+private:
+    ImageBuffer::PngCompression m_compression;
+    TaskPool::TaskGroup m_group;
+    std::mutex m_mutex;
+    std::vector<std::string> m_failed;
+};
+
+#endif // _PNG_WRITER_H_
@@ -10,8 +10,11 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <array>
+#include <memory>
 
 #include <landstalker/misc/include/Utils.h>
+#include <landstalker/misc/include/MappedFile.h>
 #include <landstalker/main/include/RomOffsets.h>
 
 class Rom
@@ -74,41 +77,89 @@ public:
 
 	uint32_t get_address(const std::string& name) const;
 	RomOffsets::Section get_section(const std::string& name) const;
-	const uint8_t* data(uint32_t address = 0) const;
 	std::size_t size(uint32_t address = 0) const;
 	void resize(std::size_t amt);
 	std::string get_description() const;
 	RomOffsets::Region get_region() const;
-	const std::vector<uint8_t>& get_vec() const;
 
 	static bool section_exists(const std::string& name);
 	static bool address_exists(const std::string& name);
 
 	uint16_t read_checksum();
 	uint16_t calc_checksum();
+	// Hash of the whole image, as Fnv1a() would give for a copy of it
+	uint64_t calc_hash() const;
 
 private:
+	// The ROM image is a read-only base image, usually read from the ROM file, plus
+	// an overlay of pages that have been written to. Copies of a Rom share both the
+	// base image and the overlay pages, and a shared page is duplicated before it is
+	// modified, so copying a Rom is cheap and only changed pages take up memory.
+	static constexpr unsigned OVERLAY_PAGE_BITS = 12;
+	static constexpr std::size_t OVERLAY_PAGE_SIZE = 1 << OVERLAY_PAGE_BITS;
+	static constexpr std::size_t OVERLAY_PAGE_MASK = OVERLAY_PAGE_SIZE - 1;
+	typedef std::array<uint8_t, OVERLAY_PAGE_SIZE> Page;
+
+	void SetBaseImage(std::shared_ptr<const MappedFile> image);
+	const uint8_t* GetReadPointer(uint32_t offset, std::size_t length, uint8_t* scratch) const;
+	void ReadBytes(uint32_t offset, std::size_t length, uint8_t* dest) const;
+	void WriteByte(uint32_t offset, uint8_t value);
+	Page& GetWritablePage(std::size_t page);
+	static const Page& GetZeroPage();
+
 	void ValidateRomChecksum();
 	void FixRomChecksum();
 
 	std::string m_filename;
 	bool m_initialised;
-	std::vector<uint8_t> m_rom;
+	std::shared_ptr<const MappedFile> m_image;
+	std::vector<std::shared_ptr<Page>> m_pages;
+	// Where each page is read from: the base image, the overlay page or a page of zeros
+	std::vector<const uint8_t*> m_page_data;
+	std::size_t m_size;
 	RomOffsets::Region m_region;
 };
 
+// Returns a pointer to length bytes at offset. Reads that lie within a single page are
+// served in place; anything else is assembled in scratch.
+inline const uint8_t* Rom::GetReadPointer(uint32_t offset, std::size_t length, uint8_t* scratch) const
+{
+	if (offset + length <= m_size && ((offset ^ (offset + length - 1)) >> OVERLAY_PAGE_BITS) == 0)
+	{
+		return m_page_data[offset >> OVERLAY_PAGE_BITS] + (offset & OVERLAY_PAGE_MASK);
+	}
+	ReadBytes(offset, length, scratch);
+	return scratch;
+}
+
+inline void Rom::WriteByte(uint32_t offset, uint8_t value)
+{
+	if (offset >= m_size)
+	{
+		throw std::runtime_error("Attempt to write past end of ROM.");
+	}
+	const std::size_t page = offset >> OVERLAY_PAGE_BITS;
+	auto& overlay = m_pages[page];
+	if (overlay && overlay.use_count() == 1)
+	{
+		(*overlay)[offset & OVERLAY_PAGE_MASK] = value;
+	}
+	else
+	{
+		GetWritablePage(page)[offset & OVERLAY_PAGE_MASK] = value;
+	}
+}
+
 template< class T >
 inline T Rom::read(uint32_t offset) const
 {
 	T retval = 0;
-	if (m_initialised == false)
-	{
-		throw std::runtime_error("Attempt to read from uninitialised ROM.");
-	}
+	uint8_t scratch[sizeof(T)];
+	const uint8_t* bytes = GetReadPointer(offset, sizeof(T), scratch);
 	for (uint32_t i = 0; i < sizeof(T); ++i)
 	{
 		retval <<= (8 % (8 * sizeof(T)));
-		retval |= m_rom[offset + i];
+		retval |= bytes[i];
 	}
 	return retval;
 }
@@ -116,11 +167,8 @@ inline T Rom::read(uint32_t offset) const
 template<>
 inline bool Rom::read<bool>(uint32_t offset) const
 {
-	if (m_initialised == false)
-	{
-		throw std::runtime_error("Attempt to read from uninitialised ROM.");
-	}
-	return (m_rom[offset] > 0);
+	uint8_t scratch;
+	return (*GetReadPointer(offset, 1, &scratch) > 0);
 }
 
 template<class T>
@@ -159,6 +207,17 @@ inline std::vector<T> Rom::read_array(uint32_t offset, uint32_t count) const
 	return ret;
 }
 
+template<>
+inline std::vector<uint8_t> Rom::read_array(uint32_t offset, uint32_t count) const
+{
+	std::vector<uint8_t> ret(count);
+	if (count > 0)
+	{
+		ReadBytes(offset, count, ret.data());
+	}
+	return ret;
+}
+
 template<>
 inline std::vector<bool> Rom::read_array(uint32_t offset, uint32_t count) const
 {
@@ -212,7 +271,7 @@ inline void Rom::write(const T& data, uint32_t offset)
 	}
 	for (uint32_t i = 0; i < sizeof(T); ++i)
 	{
-		m_rom[offset++] = (data >> ((sizeof(T) - i - 1) * 8)) & 0xFF;
+		WriteByte(offset++, static_cast<uint8_t>((data >> ((sizeof(T) - i - 1) * 8)) & 0xFF));
 	}
 }
 
@@ -26,8 +26,8 @@ public:
         LANTERN
     };
 
-    RoomData(const filesystem::path& asm_file);
-    RoomData(const Rom& rom);
+    RoomData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
+    RoomData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
 
     virtual ~RoomData() {}
 
@@ -0,0 +1,73 @@
+#ifndef _ROOM_RENDERER_H_
+#define _ROOM_RENDERER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <landstalker/main/include/GameData.h>
+#include <landstalker/main/include/ImageBuffer.h>
+
+// Draws rooms as the room viewer shows them by default - the BG and FG map layers with the
+// room's entities on top - without needing a window, a display or an event loop.
+class RoomRenderer
+{
+public:
+    struct Result
+    {
+        uint16_t room;
+        std::string name;
+        filesystem::path path;
+        double render_ms;
+        double write_ms;
+        bool success;
+        std::string error;
+    };
+
+    explicit RoomRenderer(std::shared_ptr<const GameData> gd);
+
+    // Resizes buf to fit the room, draws it, and returns the palettes it should be displayed with
+    std::vector<std::shared_ptr<Palette>> Render(uint16_t room, ImageBuffer& buf) const;
+    // Writes every room in the room list to dir as an indexed PNG named after the room. Rooms are
+    // drawn and encoded in parallel; results are returned in room order.
+    std::vector<Result> RenderAll(const filesystem::path& dir, ImageBuffer::PngCompression compression = ImageBuffer::PngCompression::DEFAULT) const;
+
+    // The palettes used for a room: the room palette, the two sprite palettes that its entities
+    // select, the player palette and the HUD palette. Entities that ask for conflicting sprite
+    // palettes are reported in errors.
+    static std::vector<std::shared_ptr<Palette>> PrepareEntityPalettes(const GameData& gd, uint16_t room,
+        const std::vector<Entity>& entities, std::vector<std::string>& errors);
+    // Whether lhs should be drawn before rhs, so that entities nearer the camera end up on top
+    static bool DrawsBefore(const SpriteData& sd, const Entity& lhs, const Entity& rhs);
+private:
+    struct Sprite
+    {
+        std::shared_ptr<const SpriteFrameEntry> frame;
+        int x;
+        int y;
+        int z;
+        uint8_t palette;
+        bool hflip;
+    };
+
+    // Everything needed to draw one room. Gathering it touches shared lookup tables, so is done
+    // on one thread; drawing only reads the entries, which decode themselves safely on first use.
+    struct Job
+    {
+        uint16_t room;
+        std::string name;
+        std::shared_ptr<const Tilemap3DEntry> map;
+        std::shared_ptr<const TilesetEntry> tileset;
+        std::vector<std::shared_ptr<const BlocksetEntry>> blocksets;
+        std::vector<std::shared_ptr<Palette>> palettes;
+        std::vector<Sprite> sprites;
+    };
+
+    Job Prepare(uint16_t room) const;
+    static void Draw(const Job& job, ImageBuffer& buf);
+
+    std::shared_ptr<const GameData> m_gd;
+};
+
+#endif // _ROOM_RENDERER_H_
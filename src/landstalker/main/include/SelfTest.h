@@ -0,0 +1,88 @@
+#ifndef _SELF_TEST_H_
+#define _SELF_TEST_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <landstalker/blockset/include/Block.h>
+#include <landstalker/3d_maps/include/Tilemap3DCmp.h>
+#include <landstalker/palettes/include/Palette.h>
+#include <landstalker/tileset/include/Tileset.h>
+#include <landstalker/main/include/GameData.h>
+#include <landstalker/text/include/HuffmanTree.h>
+#include <landstalker/text/include/LSString.h>
+
+// Round-trip and regression checks for the compression codecs and the renderer. Every check runs
+// over generated data; when game data is given, the codec checks also run over every matching
+// asset in it. Each group of checks is defined next to the code it exercises, and they all draw
+// their inputs from the fixtures here.
+class SelfTest
+{
+public:
+    explicit SelfTest(std::shared_ptr<const GameData> gd = nullptr);
+
+    // Runs every group of checks, printing a line for each group and for each failure.
+    // Returns the number of checks that failed.
+    int Run();
+
+    // The greedy LZ77 encoder with one byte of lookahead, as it was before its match search was
+    // indexed. The current greedy encoder has to match it byte for byte.
+    static std::vector<uint8_t> ReferenceLz77Encode(const std::vector<uint8_t>& in);
+private:
+    void Lz77();
+    void Lz77Optimal();
+    void Lz77Decoder();
+    void CodecTracing();
+    void BitStreams();
+    void Tilemap3DMaps();
+    void HuffmanDecoding();
+    void HuffmanEncoding();
+    void RoomLayers();
+    void RoomRedraw();
+    void PreviewOverlays();
+    void PngPresets();
+    void TmxRoundTrip();
+    void EntryMemo();
+    void EntryInjection();
+    void Snapshots();
+
+    // Strings to Huffman-encode, in the character set of a region
+    struct StringCorpus
+    {
+        std::string name;
+        std::vector<LSString::StringType> strings;
+        RomOffsets::Region region;
+    };
+
+    // What a room is drawn with: every block of the blockset is made of tiles in the tileset, and
+    // the palette gives every colour index a distinct colour
+    struct RoomFixture
+    {
+        std::shared_ptr<Tileset> tileset;
+        std::shared_ptr<Blockset> blockset;
+        std::vector<std::shared_ptr<Palette>> palettes;
+    };
+
+    void Check(bool condition, const std::string& description);
+    static double ElapsedMs(std::chrono::steady_clock::time_point since);
+
+    // Deterministic test inputs, so that failures can be reproduced
+    static std::vector<std::vector<uint8_t>> GenerateBuffers();
+    static std::vector<std::pair<std::string, Blockset>> GenerateBlocksets();
+    static std::vector<std::pair<std::string, Tilemap3D>> GenerateMaps();
+    // The generated maps, compressed as they are stored in the game data
+    static std::vector<std::pair<std::string, std::vector<uint8_t>>> GenerateEncodedMaps();
+    static RoomFixture GenerateRoom();
+    static std::vector<std::pair<std::string, HuffmanTree::CharFrequencies>> GenerateHuffmanFrequencies();
+    static std::vector<LSString::StringType> GenerateStrings();
+    std::vector<StringCorpus> GetStringCorpora() const;
+
+    std::shared_ptr<const GameData> m_gd;
+    int m_checks;
+    int m_failures;
+};
+
+#endif // _SELF_TEST_H_
@@ -88,8 +88,8 @@ public:
 		std::array<uint8_t, 5> Pack() const;
 	};
 
-	SpriteData(const filesystem::path& asm_file);
-	SpriteData(const Rom& rom);
+	SpriteData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
+	SpriteData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
 
 	virtual ~SpriteData();
 
@@ -25,8 +25,8 @@ public:
         SYSTEM
     };
 
-    StringData(const filesystem::path& asm_file);
-    StringData(const Rom& rom);
+    StringData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
+    StringData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot = nullptr);
 
     virtual ~StringData() {}
 
@@ -35,6 +35,9 @@ public:
 
     virtual bool HasBeenModified() const;
     virtual void RefreshPendingWrites(const Rom& rom);
+    virtual void AddToSnapshot(AssetSnapshot::Builder& builder);
+
+    RomOffsets::Region GetRegion() const;
 
     std::map<std::string, std::shared_ptr<TilesetEntry>> GetAllTilesets() const;
     std::vector<std::shared_ptr<TilesetEntry>> GetFonts() const;
@@ -126,6 +129,8 @@ private:
     void SetDefaultFilenames();
     bool CreateDirectoryStructure(const filesystem::path& dir);
     void InitCache();
+    uint64_t GetStringsSnapshotHash(const std::vector<ByteVector>& compressed, const ByteVector& offsets, const ByteVector& tables) const;
+    bool LoadStringsFromSnapshot();
     bool DecompressStrings();
     bool CompressStrings();
     bool DecodeStrings(const std::vector<uint8_t>& bytes, std::vector<LSString::StringType>& strings);
@@ -253,6 +258,8 @@ private:
 
     RomOffsets::Region m_region;
     bool m_has_region_check;
+    uint64_t m_strings_generation;
+    uint64_t m_compressed_generation;
 };
 
 #endif // _STRING_DATA_H_
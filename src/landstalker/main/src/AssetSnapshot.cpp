@@ -0,0 +1,197 @@
+#include <landstalker/main/include/AssetSnapshot.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <landstalker/misc/include/Utils.h>
+
+namespace
+{
+	const char MAGIC[4] = { 'L', 'S', 'A', 'S' };
+	const std::size_t PAYLOAD_ALIGNMENT = 8;
+
+	std::size_t Align(std::size_t offset)
+	{
+		return (offset + PAYLOAD_ALIGNMENT - 1) & ~(PAYLOAD_ALIGNMENT - 1);
+	}
+
+	uint64_t HashKey(const std::string& key)
+	{
+		return Fnv1a(reinterpret_cast<const uint8_t*>(key.data()), key.size());
+	}
+}
+
+void AssetSnapshot::Builder::Add(const std::string& key, std::vector<uint8_t> data, uint64_t source_hash, uint32_t source_length)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_items.push_back({ key, std::move(data), source_hash, source_length });
+}
+
+std::size_t AssetSnapshot::Builder::GetRecordCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_items.size();
+}
+
+void AssetSnapshot::Builder::Write(const filesystem::path& filename, uint64_t file_hash) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<std::pair<uint64_t, const Item*>> order;
+	order.reserve(m_items.size());
+	for (const auto& item : m_items)
+	{
+		order.emplace_back(HashKey(item.key), &item);
+	}
+	// Sorting on the key as well keeps the file identical whatever order the records were added in
+	std::sort(order.begin(), order.end(), [](const auto& lhs, const auto& rhs)
+		{
+			return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.second->key < rhs.second->key;
+		});
+
+	FileHeader header;
+	std::copy(std::begin(MAGIC), std::end(MAGIC), header.magic);
+	header.version = VERSION;
+	header.byte_order = BYTE_ORDER_MARK;
+	header.record_count = static_cast<uint32_t>(order.size());
+	header.file_hash = file_hash;
+
+	std::vector<IndexRecord> index(order.size());
+	std::size_t offset = sizeof(FileHeader) + sizeof(IndexRecord) * order.size();
+	for (std::size_t i = 0; i < order.size(); ++i)
+	{
+		const Item& item = *order[i].second;
+		index[i].key_hash = order[i].first;
+		index[i].source_hash = item.source_hash;
+		index[i].key_offset = static_cast<uint32_t>(offset);
+		index[i].key_length = static_cast<uint32_t>(item.key.size());
+		offset = Align(offset + item.key.size());
+		index[i].data_offset = static_cast<uint32_t>(offset);
+		index[i].data_size = static_cast<uint32_t>(item.data.size());
+		index[i].source_length = item.source_length;
+		index[i].reserved = 0;
+		offset = Align(offset + item.data.size());
+	}
+
+	std::vector<uint8_t> bytes(offset, 0);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	if (!index.empty())
+	{
+		std::memcpy(bytes.data() + sizeof(header), index.data(), sizeof(IndexRecord) * index.size());
+	}
+	for (std::size_t i = 0; i < order.size(); ++i)
+	{
+		const Item& item = *order[i].second;
+		std::copy(item.key.begin(), item.key.end(), bytes.begin() + index[i].key_offset);
+		std::copy(item.data.begin(), item.data.end(), bytes.begin() + index[i].data_offset);
+	}
+
+	CreateDirectoryTree(filename);
+	// Another instance of the editor may have the previous snapshot mapped
+	const std::string tmp_filename = filename.str() + ".tmp";
+	WriteBytes(bytes, tmp_filename);
+	std::filesystem::rename(tmp_filename, filename.str());
+}
+
+AssetSnapshot::AssetSnapshot(std::unique_ptr<MappedFile> file)
+	: m_file(std::move(file)),
+	  m_index(reinterpret_cast<const IndexRecord*>(m_file->data() + sizeof(FileHeader))),
+	  m_record_count(reinterpret_cast<const FileHeader*>(m_file->data())->record_count)
+{
+}
+
+std::shared_ptr<const AssetSnapshot> AssetSnapshot::Open(const filesystem::path& filename, uint64_t file_hash)
+{
+	if (!filename.is_file())
+	{
+		return nullptr;
+	}
+	std::unique_ptr<MappedFile> file;
+	try
+	{
+		file = std::make_unique<MappedFile>(filename.str());
+	}
+	catch (const std::exception&)
+	{
+		return nullptr;
+	}
+	const std::size_t size = file->size();
+	if (size < sizeof(FileHeader))
+	{
+		return nullptr;
+	}
+	FileHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+	if (!std::equal(std::begin(MAGIC), std::end(MAGIC), header.magic) || header.version != VERSION ||
+		header.byte_order != BYTE_ORDER_MARK || header.file_hash != file_hash ||
+		(size - sizeof(FileHeader)) / sizeof(IndexRecord) < header.record_count)
+	{
+		return nullptr;
+	}
+	const auto* index = reinterpret_cast<const IndexRecord*>(file->data() + sizeof(FileHeader));
+	for (std::size_t i = 0; i < header.record_count; ++i)
+	{
+		if (static_cast<std::size_t>(index[i].key_offset) + index[i].key_length > size ||
+			static_cast<std::size_t>(index[i].data_offset) + index[i].data_size > size)
+		{
+			return nullptr;
+		}
+	}
+	return std::shared_ptr<const AssetSnapshot>(new AssetSnapshot(std::move(file)));
+}
+
+filesystem::path AssetSnapshot::GetFilename(const filesystem::path& dir, uint64_t file_hash)
+{
+	std::ostringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << file_hash << ".lssnap";
+	return dir / ss.str();
+}
+
+void AssetSnapshot::Prune(const filesystem::path& dir, std::size_t keep)
+{
+	std::error_code ec;
+	std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+	for (const auto& f : std::filesystem::directory_iterator(dir.str(), ec))
+	{
+		if (f.is_regular_file(ec) && f.path().extension() == ".lssnap")
+		{
+			files.emplace_back(f.last_write_time(ec), f.path());
+		}
+	}
+	if (files.size() <= keep)
+	{
+		return;
+	}
+	std::sort(files.begin(), files.end(), [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+	for (std::size_t i = keep; i < files.size(); ++i)
+	{
+		std::filesystem::remove(files[i].second, ec);
+	}
+}
+
+bool AssetSnapshot::Find(const std::string& key, Record& record) const
+{
+	const uint64_t key_hash = HashKey(key);
+	const IndexRecord* end = m_index + m_record_count;
+	auto it = std::lower_bound(m_index, end, key_hash, [](const IndexRecord& r, uint64_t h) { return r.key_hash < h; });
+	for (; it != end && it->key_hash == key_hash; ++it)
+	{
+		const char* k = reinterpret_cast<const char*>(m_file->data() + it->key_offset);
+		if (key.size() == it->key_length && std::equal(key.begin(), key.end(), k))
+		{
+			record.data = m_file->data() + it->data_offset;
+			record.size = it->data_size;
+			record.source_hash = it->source_hash;
+			record.source_length = it->source_length;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::size_t AssetSnapshot::GetRecordCount() const
+{
+	return m_record_count;
+}
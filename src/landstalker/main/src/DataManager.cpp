@@ -1,4 +1,10 @@
 #include <landstalker/main/include/DataManager.h>
+#include <landstalker/misc/include/TaskPool.h>
+#include <landstalker/misc/include/LZ77.h>
+#include <landstalker/misc/include/Utils.h>
+#include <landstalker/3d_maps/include/Tilemap3DCmp.h>
+
+#include <chrono>
 
 PendingWrites DataManager::GetPendingWrites() const
 {
@@ -40,7 +46,41 @@ bool DataManager::HasBeenModified() const
 
 bool DataManager::InjectIntoRom(Rom& rom)
 {
-	for (const auto& w : m_pending_writes)
+	if (!StageRomInjection(rom, m_pending_writes))
+	{
+		return false;
+	}
+	CompleteRomInjection();
+	return true;
+}
+
+bool DataManager::StageRomInjection(Rom& rom, const PendingWrites& writes)
+{
+	// A write that fails part way through would leave the ROM half updated, so the writes go into
+	// a copy that only replaces the ROM once all of them have succeeded
+	Rom staged(rom);
+	try
+	{
+		ApplyPendingWrites(staged, writes);
+	}
+	catch (const std::exception& e)
+	{
+		Debug(std::string("Unable to inject into ROM: ") + e.what());
+		return false;
+	}
+	rom = staged;
+	return true;
+}
+
+void DataManager::CompleteRomInjection()
+{
+	CommitAllChanges();
+	m_pending_writes.clear();
+}
+
+void DataManager::ApplyPendingWrites(Rom& rom, const PendingWrites& writes)
+{
+	for (const auto& w : writes)
 	{
 		uint32_t addr;
 		if (rom.section_exists(w.first))
@@ -56,11 +96,7 @@ bool DataManager::InjectIntoRom(Rom& rom)
 			throw std::runtime_error("Section \"" + w.first + "\" does not exist!");
 		}
 		rom.write_array(*w.second, addr);
-		Debug(StrPrintf("ROM WRITE @ 0x%06X - %06d bytes (finish 0x%06X)", addr, w.second->size(), addr + w.second->size()));
 	}
-	CommitAllChanges();
-	m_pending_writes.clear();
-	return true;
 }
 
 bool DataManager::AbandomRomInjection()
@@ -88,9 +124,140 @@ bool DataManager::Save()
 	return Save(m_base_path);
 }
 
-void DataManager::RefreshPendingWrites(const Rom& /*rom*/)
+void DataManager::RefreshPendingWrites(const Rom& rom)
 {
 	m_pending_writes.clear();
+	m_section_timings.clear();
+	if (rom.get_region() != m_prepared_region || rom.size() != m_prepared_rom_size)
+	{
+		m_prepared_sections.clear();
+		m_prepared_region = rom.get_region();
+		m_prepared_rom_size = rom.size();
+	}
+}
+
+uint32_t DataManager::GetCompressionSettings()
+{
+	return static_cast<uint32_t>(LZ77::GetDefaultLevel()) | (static_cast<uint32_t>(Tilemap3D::GetDefaultLevel()) << 8);
+}
+
+bool DataManager::PrepareSection(const std::string& name, SectionInputs inputs, const std::function<bool()>& prepare)
+{
+	const auto start = std::chrono::steady_clock::now();
+	auto elapsed = [&]()
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+	auto it = m_prepared_sections.find(name);
+	if (it != m_prepared_sections.end())
+	{
+		if (it->second.inputs == inputs)
+		{
+			m_pending_writes.insert(m_pending_writes.end(), it->second.writes.cbegin(), it->second.writes.cend());
+			m_section_timings.push_back({ name, elapsed(), true });
+			return true;
+		}
+		m_prepared_sections.erase(it);
+	}
+	const std::size_t first = m_pending_writes.size();
+	if (!prepare())
+	{
+		return false;
+	}
+	PendingWrites writes(m_pending_writes.cbegin() + first, m_pending_writes.cend());
+	m_prepared_sections.insert({ name, { std::move(inputs), std::move(writes) } });
+	m_section_timings.push_back({ name, elapsed(), false });
+	return true;
+}
+
+bool DataManager::SectionInputs::operator==(const SectionInputs& rhs) const
+{
+	if (m_bytes.size() != rhs.m_bytes.size() || m_values.size() != rhs.m_values.size())
+	{
+		return false;
+	}
+	for (std::size_t i = 0; i < m_bytes.size(); ++i)
+	{
+		const auto& lhs_bytes = m_bytes[i];
+		const auto& rhs_bytes = rhs.m_bytes[i];
+		if (lhs_bytes != rhs_bytes && (lhs_bytes == nullptr || rhs_bytes == nullptr || *lhs_bytes != *rhs_bytes))
+		{
+			return false;
+		}
+	}
+	for (std::size_t i = 0; i < m_values.size(); ++i)
+	{
+		if (m_values[i].equal != rhs.m_values[i].equal || !m_values[i].equal(m_values[i].value.get(), rhs.m_values[i].value.get()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void DataManager::RegisterSnapshotSource(std::weak_ptr<SnapshotSource> source)
+{
+	m_snapshot_sources.push_back(std::move(source));
+}
+
+std::vector<std::shared_ptr<DataManager::SnapshotSource>> DataManager::GetSnapshotSources() const
+{
+	std::vector<std::shared_ptr<SnapshotSource>> sources;
+	for (const auto& s : m_snapshot_sources)
+	{
+		if (auto source = s.lock())
+		{
+			sources.push_back(source);
+		}
+	}
+	return sources;
+}
+
+void DataManager::AddToSnapshot(AssetSnapshot::Builder& builder)
+{
+	auto sources = GetSnapshotSources();
+	TaskPool::ParallelFor(sources.size(), [&](std::size_t i)
+		{
+			sources[i]->AddToSnapshot(builder);
+		});
+}
+
+std::vector<std::string> DataManager::ValidateEntries()
+{
+	std::vector<std::string> errors;
+	for (const auto& source : GetSnapshotSources())
+	{
+		std::string error;
+		if (!source->Validate(error))
+		{
+			errors.push_back(error);
+		}
+	}
+	return errors;
+}
+
+std::vector<std::string> DataManager::TakeLoadErrors()
+{
+	std::vector<std::string> errors;
+	std::lock_guard<std::mutex> lock(m_load_errors_mutex);
+	errors.swap(m_load_errors);
+	return errors;
+}
+
+void DataManager::AddLoadError(const std::string& error)
+{
+	std::lock_guard<std::mutex> lock(m_load_errors_mutex);
+	m_load_errors.push_back(error);
+}
+
+void DataManager::PrepareEntryBytes()
+{
+	// Each entry only touches its own state, so they can be serialised in any order
+	auto sources = GetSnapshotSources();
+	TaskPool::ParallelFor(sources.size(), [&](std::size_t i)
+		{
+			sources[i]->PrepareBytes();
+		});
 }
 
 void DataManager::CommitAllChanges()
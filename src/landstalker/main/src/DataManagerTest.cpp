@@ -0,0 +1,271 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <utility>
+
+#include <landstalker/main/include/RomLabels.h>
+
+namespace
+{
+    // Copies its entries one after another into a section, as GraphicsData copies the inventory
+    // graphics into theirs
+    class SectionManager : public DataManager
+    {
+    public:
+        SectionManager()
+            : DataManager(filesystem::path("selftest.asm"))
+        {
+        }
+
+        virtual void RefreshPendingWrites(const Rom& rom)
+        {
+            DataManager::RefreshPendingWrites(rom);
+            PrepareSection(RomLabels::Graphics::INV_SECTION, SectionInputs().AddEntries(entries), [&]()
+                {
+                    auto bytes = std::make_shared<ByteVector>();
+                    for (const auto& e : entries)
+                    {
+                        const auto entry_bytes = e->GetBytes();
+                        bytes->insert(bytes->end(), entry_bytes->cbegin(), entry_bytes->cend());
+                    }
+                    m_pending_writes.push_back({ RomLabels::Graphics::INV_SECTION, bytes });
+                    return true;
+                });
+        }
+
+        std::vector<std::shared_ptr<Tilemap3DEntry>> entries;
+    protected:
+        virtual void CommitAllChanges()
+        {
+            for (const auto& e : entries)
+            {
+                e->Commit();
+            }
+        }
+    };
+
+    ByteVector ReadSection(const Rom& rom, const std::string& name, std::size_t size)
+    {
+        return rom.read_array<uint8_t>(rom.get_section(name).begin, static_cast<uint32_t>(size));
+    }
+}
+
+void SelfTest::EntryMemo()
+{
+    // Drawing reads a room's map on every redraw. Reads through the const overload must leave the
+    // entry's memoised change check valid, whereas taking write access discards it.
+    const int REDRAWS = 20;
+    DataManager dm(filesystem::path("selftest.asm"));
+    std::vector<std::shared_ptr<Tilemap3DEntry>> entries;
+    for (const auto& m : GenerateEncodedMaps())
+    {
+        entries.push_back(Tilemap3DEntry::Create(&dm, m.second, m.first, m.first + ".cmp"));
+        // Loaded up front, as loading moves the generation on
+        entries.back()->GetOrigBytes();
+    }
+    const std::vector<std::pair<std::string, bool>> modes = { {"const", true}, {"non-const", false} };
+    for (const auto& mode : modes)
+    {
+        std::size_t reads = 0;
+        std::size_t hits = 0;
+        double read_ms = 0.0;
+        double check_ms = 0.0;
+        for (int i = 0; i < REDRAWS; ++i)
+        {
+            for (const auto& e : entries)
+            {
+                const uint64_t generation = e->GetGeneration();
+                auto start = std::chrono::steady_clock::now();
+                if (mode.second)
+                {
+                    std::as_const(*e).GetData()->GetBlock({ 0, 0 });
+                }
+                else
+                {
+                    e->GetData()->GetBlock({ 0, 0 });
+                }
+                read_ms += ElapsedMs(start);
+                ++reads;
+                hits += e->GetGeneration() == generation ? 1 : 0;
+                start = std::chrono::steady_clock::now();
+                const bool changed = e->HasDataChanged();
+                const auto bytes = e->GetBytes();
+                check_ms += ElapsedMs(start);
+                Check(!changed && bytes == e->GetOrigBytes(), e->GetName() + ": reading the map changed its bytes (" + mode.first + ")");
+            }
+        }
+        Check(!mode.second || hits == reads, "a const read discarded the memoised change check");
+        std::printf("  %-9s %zu reads: %zu memo hits, %.2f ms reading, %.2f ms checking for changes\n", mode.first.c_str(),
+            reads, hits, read_ms, check_ms);
+    }
+
+    // Editors keep hold of the data they were given write access to. An edit made through such a
+    // handle after a change check must still be seen, whereas read-only holders change nothing.
+    const auto& entry = entries.back();
+    const auto reader = std::as_const(*entry).GetData();
+    auto writer = entry->GetData();
+    const Tilemap3D unedited(*writer);
+    Check(!entry->HasDataChanged() && entry->GetBytes() == entry->GetOrigBytes(), "taking write access changed the map");
+    writer->SetBlock(writer->GetBlock({ 0, 0 }) ^ 1, 0);
+    Check(entry->HasDataChanged() && *entry->GetBytes() != *entry->GetOrigBytes(), "an edit through a held writer was missed");
+    *writer = unedited;
+    writer = nullptr;
+    Check(!entry->HasDataChanged() && *reader == unedited, "undoing an edit through a held writer was missed");
+
+    // Sections that depend on an entry's data share it with the entry, rather than copying it
+    auto make_inputs = [&](bool copy)
+    {
+        DataManager::SectionInputs inputs;
+        for (const auto& e : entries)
+        {
+            if (copy)
+            {
+                inputs.AddEntry(e).AddValue(*std::as_const(*e).GetData());
+            }
+            else
+            {
+                inputs.AddEntryData(e);
+            }
+        }
+        return inputs;
+    };
+    std::vector<double> section_ms;
+    for (bool copy : { false, true })
+    {
+        const auto prepared = make_inputs(copy);
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < REDRAWS; ++i)
+        {
+            Check(make_inputs(copy) == prepared, std::string("unchanged section inputs differ when ") + (copy ? "copied" : "shared"));
+        }
+        section_ms.push_back(ElapsedMs(start));
+    }
+    const auto prepared = make_inputs(false);
+    {
+        auto map = entries.front()->GetData();
+        map->SetBlock(map->GetBlock({ 0, 0 }) ^ 1, 0);
+    }
+    Check(!(make_inputs(false) == prepared), "section inputs did not change with an entry's data");
+    std::printf("  %d refreshes of %zu entries' section inputs: %.2f ms shared, %.2f ms copied\n", REDRAWS, entries.size(),
+        section_ms[0], section_ms[1]);
+}
+
+void SelfTest::Snapshots()
+{
+    // The first session decodes every map from its compressed bytes and leaves them in a snapshot,
+    // from which the second session loads them. Neither session decodes anything for the snapshot.
+    const uint64_t FILE_HASH = 0x5E1F7E57;
+    const filesystem::path filename((std::filesystem::temp_directory_path() / "landstalker-selftest.snapshot").string());
+    const auto maps = GenerateMaps();
+    const auto sources = GenerateEncodedMaps();
+    std::vector<double> load_ms;
+    std::shared_ptr<const AssetSnapshot> snapshot;
+    for (const char* session : { "cold", "warm" })
+    {
+        DataManager dm(filesystem::path("selftest.asm"), snapshot);
+        std::vector<std::shared_ptr<Tilemap3DEntry>> entries;
+        for (const auto& source : sources)
+        {
+            entries.push_back(Tilemap3DEntry::Create(&dm, source.second, source.first, source.first + ".cmp"));
+        }
+        AssetSnapshot::Builder unloaded;
+        dm.AddToSnapshot(unloaded);
+        Check(unloaded.GetRecordCount() == (snapshot != nullptr ? entries.size() : 0),
+            std::string(session) + ": unloaded entries were not carried over as they were");
+
+        const auto start = std::chrono::steady_clock::now();
+        for (const auto& e : entries)
+        {
+            std::as_const(*e).GetData();
+        }
+        load_ms.push_back(ElapsedMs(start));
+        for (std::size_t i = 0; i < entries.size(); ++i)
+        {
+            Check(*std::as_const(*entries[i]).GetData() == maps[i].second && *entries[i]->GetBytes() == sources[i].second,
+                maps[i].first + " did not load the same from the " + session + " session");
+        }
+
+        AssetSnapshot::Builder loaded;
+        dm.AddToSnapshot(loaded);
+        Check(loaded.GetRecordCount() == entries.size(), std::string(session) + ": loaded entries were left out of the snapshot");
+        loaded.Write(filename, FILE_HASH);
+        snapshot = AssetSnapshot::Open(filename, FILE_HASH);
+        Check(snapshot != nullptr && snapshot->GetRecordCount() == entries.size(), std::string(session) + ": the snapshot did not open");
+    }
+    snapshot = nullptr;
+    std::error_code ec;
+    std::filesystem::remove(filename.str(), ec);
+
+    // ROMs are hashed where their pages lie, including pages that have been written to
+    std::mt19937 rng(37);
+    std::vector<uint8_t> image(3 * 4096 + 100);
+    std::generate(image.begin(), image.end(), [&]() { return static_cast<uint8_t>(rng()); });
+    Rom rom(image);
+    rom.write<uint8_t>(0xA5, 4096 + 7);
+    const auto copy = rom.read_array<uint8_t>(0, static_cast<uint32_t>(rom.size()));
+    Check(rom.calc_hash() == Fnv1a(copy.data(), copy.size()), "the ROM hash differs from the hash of a copy");
+
+    std::printf("  %zu maps: %.2f ms decoding, %.2f ms from the snapshot\n", maps.size(), load_ms[0], load_ms[1]);
+}
+
+void SelfTest::EntryInjection()
+{
+    // An entry read with padding after it, as entries are read when their size is not known, has
+    // to inject the same bytes whether or not it was ever opened
+    auto sources = GenerateEncodedMaps();
+    std::sort(sources.begin(), sources.end(), [](const auto& lhs, const auto& rhs) { return lhs.second.size() < rhs.second.size(); });
+    const auto& source = sources.front();
+    ByteVector padded(source.second);
+    padded.resize(padded.size() + 65536, 0xFF);
+    for (bool opened : { false, true })
+    {
+        const std::string name = source.first + (opened ? " (opened)" : " (unopened)");
+        Rom rom(std::vector<uint8_t>(0x10000, 0));
+        SectionManager sm;
+        sm.entries.push_back(Tilemap3DEntry::Create(&sm, padded, source.first, source.first + ".cmp"));
+        if (opened)
+        {
+            std::as_const(*sm.entries.front()).GetData();
+        }
+        sm.RefreshPendingWrites(rom);
+        Check(sm.WillFitInRom(rom) && *sm.entries.front()->GetBytes() == source.second, name + ": padding was injected");
+        Check(sm.InjectIntoRom(rom), name + ": the injection failed");
+        Check(ReadSection(rom, RomLabels::Graphics::INV_SECTION, source.second.size()) == source.second,
+            name + ": the injected bytes differ from the source");
+    }
+
+    // An edit that is saved between two refreshes must still be injected by the second
+    Rom rom(std::vector<uint8_t>(0x10000, 0));
+    SectionManager sm;
+    sm.entries.push_back(Tilemap3DEntry::Create(&sm, source.second, source.first, source.first + ".cmp"));
+    sm.RefreshPendingWrites(rom);
+    {
+        auto map = sm.entries.front()->GetData();
+        map->SetBlock(map->GetBlock({ 0, 0 }) ^ 1, 0);
+    }
+    const ByteVector edited(*sm.entries.front()->GetBytes());
+    sm.Save(filesystem::path());
+    sm.RefreshPendingWrites(rom);
+    Check(sm.GetSectionTimings().size() == 1 && !sm.GetSectionTimings().front().reused, "the section was reused after an edit was saved");
+    Check(sm.InjectIntoRom(rom), "the injection of a saved edit failed");
+    Check(edited != source.second && ReadSection(rom, RomLabels::Graphics::INV_SECTION, edited.size()) == edited,
+        "an edit saved between refreshes was not injected");
+
+    // A write that runs off the end of the ROM fails the injection, without writing the part that
+    // did fit or committing the change
+    const uint32_t section_start = rom.get_section(RomLabels::Graphics::INV_SECTION).begin;
+    Rom small_rom(std::vector<uint8_t>(section_start + edited.size() / 2, 0));
+    {
+        auto map = sm.entries.front()->GetData();
+        map->SetBlock(map->GetBlock({ 0, 0 }) ^ 1, 0);
+    }
+    sm.RefreshPendingWrites(small_rom);
+    Check(!sm.InjectIntoRom(small_rom), "an injection past the end of the ROM succeeded");
+    Check(small_rom.read_array<uint8_t>(section_start, static_cast<uint32_t>(small_rom.size() - section_start)) ==
+        std::vector<uint8_t>(small_rom.size() - section_start, 0), "a failed injection wrote to the ROM");
+    Check(sm.entries.front()->HasSavedDataChanged(), "a failed injection committed the change");
+}
@@ -1,9 +1,18 @@
 #include <landstalker/main/include/DataTypes.h>
 
+static void Register(DataManager* owner, const std::shared_ptr<DataManager::SnapshotSource>& entry)
+{
+	if (owner != nullptr)
+	{
+		owner->RegisterSnapshotSource(entry);
+	}
+}
+
 std::shared_ptr<TilesetEntry> TilesetEntry::Create(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename, bool compressed, std::size_t width, std::size_t height, uint8_t bit_depth, Tileset::BlockType blocktype)
 {
 	auto o = std::make_shared<TilesetEntry>(owner, b, name, filename, compressed, width, height, bit_depth, blocktype);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -21,10 +30,31 @@ bool TilesetEntry::Deserialise(const ByteVectorPtr in, std::shared_ptr<Tileset>&
 	return true;
 }
 
+bool TilesetEntry::SerialiseSnapshot(const std::shared_ptr<Tileset> in, ByteVector& out)
+{
+	out = in->GetBits(false);
+	out.insert(out.begin(), in->GetCompressed() ? 1 : 0);
+	return true;
+}
+
+bool TilesetEntry::DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<Tileset>& out)
+{
+	if (size < 1)
+	{
+		return false;
+	}
+	out = std::make_shared<Tileset>();
+	out->SetParams(m_width, m_height, m_bit_depth, m_blocktype);
+	out->SetBits(ByteVector(in + 1, in + size), false);
+	out->SetCompressed(in[0] != 0);
+	return true;
+}
+
 std::shared_ptr<PaletteEntry> PaletteEntry::Create(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename, Palette::Type type)
 {
 	auto o = std::make_shared<PaletteEntry>(owner, b, name, filename, type);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -40,10 +70,27 @@ bool PaletteEntry::Deserialise(const ByteVectorPtr in, std::shared_ptr<Palette>&
 	return true;
 }
 
+bool PaletteEntry::CheckSource(const ByteVector& in, std::string& error) const
+{
+	std::size_t required = Palette::GetSizeBytes(m_type);
+	if (Palette::IsVarWidth(m_type))
+	{
+		// Prefixed with its colour count
+		required = (in.size() < 2) ? 2 : 2 + ((in[0] << 8) | in[1]) * 2;
+	}
+	if (in.size() < required)
+	{
+		error = StrPrintf("Palette is %d bytes, expected %d", static_cast<int>(in.size()), static_cast<int>(required));
+		return false;
+	}
+	return true;
+}
+
 std::shared_ptr<BlocksetEntry> BlocksetEntry::Create(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename)
 {
 	auto o = std::make_shared<BlocksetEntry>(owner, b, name, filename);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -63,10 +110,55 @@ bool BlocksetEntry::Deserialise(const ByteVectorPtr in, std::shared_ptr<Blockset
 	return true;
 }
 
+bool BlocksetEntry::CheckSource(const ByteVector& in, std::string& error) const
+{
+	if (in.size() < 2)
+	{
+		error = "Blockset has no header";
+		return false;
+	}
+	return true;
+}
+
+bool BlocksetEntry::SerialiseSnapshot(const std::shared_ptr<Blockset> in, ByteVector& out)
+{
+	out.clear();
+	out.reserve(in->size() * MapBlock::GetBlockSize() * 2);
+	for (const auto& block : *in)
+	{
+		for (std::size_t i = 0; i < MapBlock::GetBlockSize(); ++i)
+		{
+			const uint16_t value = block.GetTile(i).GetTileValue();
+			out.push_back(value >> 8);
+			out.push_back(value & 0xFF);
+		}
+	}
+	return true;
+}
+
+bool BlocksetEntry::DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<Blockset>& out)
+{
+	if (size % (MapBlock::GetBlockSize() * 2) != 0)
+	{
+		return false;
+	}
+	out = std::make_shared<Blockset>(size / (MapBlock::GetBlockSize() * 2));
+	for (auto& block : *out)
+	{
+		for (std::size_t i = 0; i < MapBlock::GetBlockSize(); ++i)
+		{
+			block.SetTile(i, Tile((in[0] << 8) | in[1]));
+			in += 2;
+		}
+	}
+	return true;
+}
+
 std::shared_ptr<Tilemap3DEntry> Tilemap3DEntry::Create(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename)
 {
 	auto o = std::make_shared<Tilemap3DEntry>(owner, b, name, filename);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -81,15 +173,38 @@ bool Tilemap3DEntry::Serialise(const std::shared_ptr<Tilemap3D> in, ByteVectorPt
 bool Tilemap3DEntry::Deserialise(const ByteVectorPtr in, std::shared_ptr<Tilemap3D>& out)
 {
 	out = std::make_shared<Tilemap3D>();
-	uint16_t len = out->Decode(&in->at(0));
+	uint16_t len = out->Decode(in->data(), in->size());
 	in->resize(len);
 	return true;
 }
 
+bool Tilemap3DEntry::CheckSource(const ByteVector& in, std::string& error) const
+{
+	if (in.size() < 4)
+	{
+		error = "Map has no header";
+		return false;
+	}
+	return true;
+}
+
+bool Tilemap3DEntry::SerialiseSnapshot(const std::shared_ptr<Tilemap3D> in, ByteVector& out)
+{
+	out = in->EncodeUncompressed();
+	return true;
+}
+
+bool Tilemap3DEntry::DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<Tilemap3D>& out)
+{
+	out = std::make_shared<Tilemap3D>();
+	return out->DecodeUncompressed(in, size);
+}
+
 std::shared_ptr<AnimatedTilesetEntry> AnimatedTilesetEntry::Create(DataManager* owner, const ByteVector& b, const std::string& name, const filesystem::path& filename, uint16_t base, uint16_t length, uint8_t speed, uint8_t frames, uint8_t base_tileset)
 {
 	auto o = std::make_shared<AnimatedTilesetEntry>(owner, b, name, filename, base, length, speed, frames, base_tileset);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -115,6 +230,7 @@ std::shared_ptr<Tilemap2DEntry> Tilemap2DEntry::Create(DataManager* owner, const
 {
 	auto o = std::make_shared<Tilemap2DEntry>(owner, b, name, filename, compression, tile_base, width, height);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -136,6 +252,7 @@ std::shared_ptr<SpriteFrameEntry> SpriteFrameEntry::Create(DataManager* owner, c
 {
 	auto o = std::make_shared<SpriteFrameEntry>(owner, b, name, filename);
 	o->Initialise();
+	Register(owner, o);
 	return o;
 }
 
@@ -156,3 +273,22 @@ bool SpriteFrameEntry::Deserialise(const ByteVectorPtr in, std::shared_ptr<Sprit
 	in->resize(out->SetBits(*in));
 	return true;
 }
+
+bool SpriteFrameEntry::SerialiseSnapshot(const std::shared_ptr<SpriteFrame> in, ByteVector& out)
+{
+	out = in->GetBits(false);
+	out.insert(out.begin(), in->GetCompressed() ? 1 : 0);
+	return true;
+}
+
+bool SpriteFrameEntry::DeserialiseSnapshot(const uint8_t* in, std::size_t size, std::shared_ptr<SpriteFrame>& out)
+{
+	if (size < 1)
+	{
+		return false;
+	}
+	out = std::make_shared<SpriteFrame>();
+	out->SetBits(ByteVector(in + 1, in + size));
+	out->SetCompressed(in[0] != 0);
+	return true;
+}
@@ -1,39 +1,148 @@
 #include <landstalker/main/include/GameData.h>
 
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
 
 #include <landstalker/main/include/RomLabels.h>
+#include <landstalker/misc/include/TaskGraph.h>
+#include <landstalker/misc/include/TaskPool.h>
+
+filesystem::path GameData::s_snapshot_dir;
+std::mutex GameData::s_snapshot_mutex;
 
 GameData::GameData(const filesystem::path& asm_file)
 	: DataManager(asm_file),
-	  m_rd(std::make_shared<RoomData>(asm_file)),
-	  m_gd(std::make_shared<GraphicsData>(asm_file)),
-	  m_sd(std::make_shared<StringData>(asm_file)),
-	  m_spd(std::make_shared<SpriteData>(asm_file))
+	  m_refresh_failed(false),
+	  m_snapshot_hash(HashAsmTree(asm_file))
 {
+	auto snapshot = OpenSnapshot(m_snapshot_hash);
+	// The managers load independently of each other; they are only linked up by CacheData()
+	TaskPool::TaskGroup tasks;
+	tasks.Run([&]() { m_rd = std::make_shared<RoomData>(asm_file, snapshot); });
+	tasks.Run([&]() { m_gd = std::make_shared<GraphicsData>(asm_file, snapshot); });
+	tasks.Run([&]() { m_sd = std::make_shared<StringData>(asm_file, snapshot); });
+	tasks.Run([&]() { m_spd = std::make_shared<SpriteData>(asm_file, snapshot); });
+	tasks.Wait();
 	m_data.push_back(m_rd);
 	m_data.push_back(m_gd);
 	m_data.push_back(m_sd);
 	m_data.push_back(m_spd);
+	CheckEntries();
 	CacheData();
 	SetDefaults();
 }
 
 GameData::GameData(const Rom& rom)
 	: DataManager(rom),
-	  m_rd(std::make_shared<RoomData>(rom)),
-	  m_gd(std::make_shared<GraphicsData>(rom)),
-	  m_sd(std::make_shared<StringData>(rom)),
-	  m_spd(std::make_shared<SpriteData>(rom))
+	  m_refresh_failed(false),
+	  m_snapshot_hash(rom.calc_hash())
 {
+	auto snapshot = OpenSnapshot(m_snapshot_hash);
+	TaskPool::TaskGroup tasks;
+	tasks.Run([&]() { m_rd = std::make_shared<RoomData>(rom, snapshot); });
+	tasks.Run([&]() { m_gd = std::make_shared<GraphicsData>(rom, snapshot); });
+	tasks.Run([&]() { m_sd = std::make_shared<StringData>(rom, snapshot); });
+	tasks.Run([&]() { m_spd = std::make_shared<SpriteData>(rom, snapshot); });
+	tasks.Wait();
 	m_data.push_back(m_rd);
 	m_data.push_back(m_gd);
 	m_data.push_back(m_sd);
 	m_data.push_back(m_spd);
+	CheckEntries();
 	CacheData();
 	SetDefaults();
 }
 
+void GameData::SetSnapshotDirectory(const filesystem::path& dir)
+{
+	std::lock_guard<std::mutex> lock(s_snapshot_mutex);
+	s_snapshot_dir = dir;
+}
+
+filesystem::path GameData::GetSnapshotDirectory()
+{
+	std::lock_guard<std::mutex> lock(s_snapshot_mutex);
+	return s_snapshot_dir;
+}
+
+uint64_t GameData::HashAsmTree(const filesystem::path& asm_file)
+{
+	// Every record is checked against the bytes it was decoded from, so the name, size and
+	// modification time of each file are enough to tell whether the snapshot is worth opening.
+	std::vector<std::string> files;
+	const std::filesystem::path root(asm_file.parent_path().str());
+	std::error_code ec;
+	for (auto it = std::filesystem::recursive_directory_iterator(root, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+	{
+		if (it->path().filename().string().rfind(".", 0) == 0)
+		{
+			if (it->is_directory())
+			{
+				it.disable_recursion_pending();
+			}
+			continue;
+		}
+		if (it->is_regular_file())
+		{
+			std::ostringstream ss;
+			ss << it->path().lexically_relative(root).generic_string() << '|' << it->file_size(ec) << '|'
+			   << it->last_write_time(ec).time_since_epoch().count();
+			files.push_back(ss.str());
+		}
+	}
+	std::sort(files.begin(), files.end());
+	const std::string name = asm_file.str();
+	uint64_t hash = Fnv1a(reinterpret_cast<const uint8_t*>(name.data()), name.size());
+	for (const auto& f : files)
+	{
+		hash = Fnv1a(reinterpret_cast<const uint8_t*>(f.data()), f.size() + 1, hash);
+	}
+	return hash;
+}
+
+std::shared_ptr<const AssetSnapshot> GameData::OpenSnapshot(uint64_t hash)
+{
+	const auto dir = GetSnapshotDirectory();
+	if (dir.empty())
+	{
+		return nullptr;
+	}
+	return AssetSnapshot::Open(AssetSnapshot::GetFilename(dir, hash), hash);
+}
+
+void GameData::WriteSnapshot()
+{
+	const auto dir = GetSnapshotDirectory();
+	if (dir.empty())
+	{
+		return;
+	}
+	try
+	{
+		AssetSnapshot::Builder builder;
+		for (const auto& d : m_data)
+		{
+			d->AddToSnapshot(builder);
+		}
+		// Every record in the snapshot is carried over, so only a larger count means that this session decoded something new
+		const auto snapshot = m_rd->GetSnapshot();
+		if (builder.GetRecordCount() == 0 || (snapshot != nullptr && builder.GetRecordCount() <= snapshot->GetRecordCount()))
+		{
+			return;
+		}
+		builder.Write(AssetSnapshot::GetFilename(dir, m_snapshot_hash), m_snapshot_hash);
+		AssetSnapshot::Prune(dir, MAX_SNAPSHOTS);
+	}
+	catch (const std::exception& e)
+	{
+		// The snapshot only saves time, so failing to write one is not an error
+		Debug(std::string("Unable to write asset snapshot: ") + e.what());
+	}
+}
+
 bool GameData::Save(const filesystem::path& dir)
 {
 	auto success = std::all_of(m_data.begin(), m_data.end(), [&](auto& d)
@@ -80,18 +189,70 @@ bool GameData::HasBeenModified() const
 
 bool GameData::InjectIntoRom(Rom& rom)
 {
-	return std::all_of(m_data.begin(), m_data.end(), [&](auto& d)
-		{
-			return d->InjectIntoRom(rom);
-		});
+	// Every manager's writes go into the ROM in one pass, in the same order as they were prepared.
+	// Writes left over from a refresh that failed part way through are not injected.
+	if (m_refresh_failed)
+	{
+		m_apply_timings = "ROM injection failed: the pending writes were not prepared\n";
+		return false;
+	}
+	const auto start = std::chrono::steady_clock::now();
+	if (!DataManager::StageRomInjection(rom, GetPendingWrites()))
+	{
+		m_apply_timings = "ROM injection failed: a write did not fit in the ROM\n";
+		return false;
+	}
+	const auto applied = std::chrono::steady_clock::now();
+	for (auto& d : m_data)
+	{
+		d->CompleteRomInjection();
+	}
+	const auto committed = std::chrono::steady_clock::now();
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1)
+	   << "ROM writes applied in " << std::chrono::duration<double, std::milli>(applied - start).count() << " ms, "
+	   << "changes committed in " << std::chrono::duration<double, std::milli>(committed - applied).count() << " ms" << std::endl;
+	m_apply_timings = ss.str();
+	return true;
 }
 
 void GameData::RefreshPendingWrites(const Rom& rom)
 {
-	std::for_each(m_data.begin(), m_data.end(), [&](auto& d)
+	// Serialising the changed entries is where most of the time goes, and each entry is independent
+	// of the others. A manager's sections are then prepared in order, as later sections take their
+	// addresses from where earlier ones placed their data. The managers only read the ROM, so each
+	// runs alongside the others.
+	const std::pair<std::string, std::shared_ptr<DataManager>> managers[] = {
+		{ "RoomData", m_rd }, { "GraphicsData", m_gd }, { "StringData", m_sd }, { "SpriteData", m_spd }
+	};
+	TaskGraph graph;
+	for (const auto& m : managers)
+	{
+		auto d = m.second;
+		auto serialise = graph.Add(m.first + " serialise", [d]() { d->PrepareEntryBytes(); });
+		graph.Add(m.first + " prepare", [d, &rom]() { d->RefreshPendingWrites(rom); }, { serialise });
+	}
+	m_refresh_failed = true;
+	graph.Run();
+	m_refresh_failed = false;
+
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision(1) << graph.FormatTimings();
+	for (const auto& m : managers)
+	{
+		for (const auto& t : m.second->GetSectionTimings())
 		{
-			d->RefreshPendingWrites(rom);
-		});
+			ss << "  " << std::left << std::setw(32) << (m.first + ":" + t.name) << std::right
+			   << " took " << std::setw(8) << t.milliseconds << " ms" << (t.reused ? " (reused)" : "") << std::endl;
+		}
+	}
+	m_injection_timings = ss.str();
+	m_apply_timings.clear();
+}
+
+std::string GameData::GetInjectionTimings() const
+{
+	return m_injection_timings + m_apply_timings;
 }
 
 const std::map<std::string, std::shared_ptr<PaletteEntry>>& GameData::GetAllPalettes() const
@@ -138,6 +299,33 @@ std::shared_ptr<Tilemap2DEntry> GameData::GetTilemap(const std::string& name) co
 	return m_tilemaps.at(name);
 }
 
+std::vector<std::string> GameData::TakeLoadErrors()
+{
+	auto errors = DataManager::TakeLoadErrors();
+	for (const auto& d : m_data)
+	{
+		auto e = d->TakeLoadErrors();
+		errors.insert(errors.end(), e.cbegin(), e.cend());
+	}
+	return errors;
+}
+
+void GameData::CheckEntries()
+{
+	std::string message;
+	for (const auto& d : m_data)
+	{
+		for (const auto& error : d->ValidateEntries())
+		{
+			message += "\n" + error;
+		}
+	}
+	if (!message.empty())
+	{
+		throw std::runtime_error("Unable to decode:" + message);
+	}
+}
+
 void GameData::CacheData()
 {
 	auto room_pals = m_rd->GetAllPalettes();
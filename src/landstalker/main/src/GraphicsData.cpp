@@ -6,8 +6,8 @@
 #include <landstalker/main/include/AsmUtils.h>
 #include <landstalker/main/include/RomLabels.h>
 
-GraphicsData::GraphicsData(const filesystem::path& asm_file)
-	: DataManager(asm_file)
+GraphicsData::GraphicsData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot)
+	: DataManager(asm_file, snapshot)
 {
 	if (!LoadAsmFilenames())
 	{
@@ -70,8 +70,8 @@ GraphicsData::GraphicsData(const filesystem::path& asm_file)
 	ResetTilesetDefaultPalettes();
 }
 
-GraphicsData::GraphicsData(const Rom& rom)
-	: DataManager(rom)
+GraphicsData::GraphicsData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot)
+	: DataManager(rom, snapshot)
 {
 	SetDefaultFilenames();
 	if (!RomLoadInventoryGraphics(rom))
@@ -369,55 +369,68 @@ bool GraphicsData::HasBeenModified() const
 void GraphicsData::RefreshPendingWrites(const Rom& rom)
 {
 	DataManager::RefreshPendingWrites(rom);
-	if (!RomPrepareInjectInvGraphics(rom))
+	if (!PrepareSection("inv_graphics", SectionInputs().AddEntries(m_fonts_internal).AddEntries(m_ui_gfx_internal).AddEntries(m_palettes_internal),
+		[&]() { return RomPrepareInjectInvGraphics(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare inventory graphics for ROM injection"));
 	}
-	if (!RomPrepareInjectPalettes(rom))
+	if (!PrepareSection("palettes", SectionInputs().AddEntries(m_palettes_internal),
+		[&]() { return RomPrepareInjectPalettes(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare palettes for ROM injection"));
 	}
-	if (!RomPrepareInjectTextGraphics(rom))
+	if (!PrepareSection("text_graphics", SectionInputs().AddEntries(m_ui_gfx_internal),
+		[&]() { return RomPrepareInjectTextGraphics(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare text graphics for ROM injection"));
 	}
-	if (!RomPrepareInjectSwordFx(rom))
+	if (!PrepareSection("sword_fx", SectionInputs().AddEntries(m_ui_tilemaps_internal).AddEntries(m_sword_fx_internal),
+		[&]() { return RomPrepareInjectSwordFx(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare sword effects for ROM injection"));
 	}
-	if (!RomPrepareInjectStatusFx(rom))
+	if (!PrepareSection("status_fx", SectionInputs().AddEntries(m_status_fx_frames).AddValue(m_status_fx),
+		[&]() { return RomPrepareInjectStatusFx(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare status effects for ROM injection"));
 	}
-	if (!RomPrepareInjectHudData(rom))
+	if (!PrepareSection("hud_data", SectionInputs().AddEntries(m_ui_tilemaps_internal).AddEntries(m_ui_gfx_internal),
+		[&]() { return RomPrepareInjectHudData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare HUD data for ROM injection"));
 	}
-	if (!RomPrepareInjectEndCreditData(rom))
+	if (!PrepareSection("end_credit_data", SectionInputs().AddEntry(m_end_credits_map).AddEntry(m_end_credits_tileset).AddEntry(m_end_credits_palette).AddEntries(m_fonts_internal),
+		[&]() { return RomPrepareInjectEndCreditData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare end credit data for ROM injection"));
 	}
-	if (!RomPrepareInjectIslandMapData(rom))
+	if (!PrepareSection("island_map_data", SectionInputs().AddEntries(m_island_map_tilemaps).AddEntries(m_island_map_tiles_internal).AddEntries(m_island_map_pals_internal),
+		[&]() { return RomPrepareInjectIslandMapData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare island map data for ROM injection"));
 	}
-	if (!RomPrepareInjectLithographData(rom))
+	if (!PrepareSection("lithograph_data", SectionInputs().AddEntry(m_lithograph_map).AddEntry(m_lithograph_tileset).AddEntry(m_lithograph_palette),
+		[&]() { return RomPrepareInjectLithographData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare lithograph data for ROM injection"));
 	}
-	if (!RomPrepareInjectTitleScreenData(rom))
+	if (!PrepareSection("title_screen_data", SectionInputs().AddEntries(m_title_tilemaps_internal).AddEntries(m_title_tiles_internal).AddEntries(m_title_pals_internal),
+		[&]() { return RomPrepareInjectTitleScreenData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare title screen data for ROM injection"));
 	}
-	if (!RomPrepareInjectSegaLogoData(rom))
+	if (!PrepareSection("sega_logo_data", SectionInputs().AddEntry(m_sega_logo_tileset).AddEntry(m_sega_logo_palette),
+		[&]() { return RomPrepareInjectSegaLogoData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare Sega logo data for ROM injection"));
 	}
-	if (!RomPrepareInjectClimaxLogoData(rom))
+	if (!PrepareSection("climax_logo_data", SectionInputs().AddEntry(m_climax_logo_map).AddEntry(m_climax_logo_tileset).AddEntry(m_climax_logo_palette),
+		[&]() { return RomPrepareInjectClimaxLogoData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare Climax logo data for ROM injection"));
 	}
-	if (!RomPrepareInjectGameLoadScreenData(rom))
+	if (!PrepareSection("game_load_screen_data", SectionInputs().AddEntry(m_load_game_map).AddEntries(m_load_game_tiles_internal).AddEntries(m_load_game_pals_internal),
+		[&]() { return RomPrepareInjectGameLoadScreenData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare load game screen data for ROM injection"));
 	}
@@ -1,9 +1,17 @@
 #include <landstalker/main/include/ImageBuffer.h>
 
+#include <algorithm>
 #include <cassert>
 #include <png.h>
+#include <zlib.h>
 #include <numeric>
-#include <emmintrin.h>
+#include <tuple>
+#include <cstdlib>
+#include <cstring>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #include <landstalker/misc/include/Utils.h>
 
 #if defined(_MSC_VER)
@@ -16,6 +24,299 @@
 #endif
 #endif
 
+namespace
+{
+#if defined(_MSC_VER)
+#define TARGET_(x)
+#else
+#define TARGET_(x) __attribute__ ((target(x)))
+#endif
+
+    // Colours of up to 16 palettes, indexed by pixel value. Packed RGBA for gathers, and
+    // split into one 16 byte table per channel and palette for byte shuffles.
+    struct PaletteLut
+    {
+        std::vector<std::weak_ptr<Palette>> pals;
+        std::vector<uint64_t> versions;
+        std::size_t groups = 0;
+        ALIGNED_(32) uint32_t rgba[256];
+        ALIGNED_(16) uint8_t planes[4][16][16];
+    };
+
+    // Caches hold their palettes weakly so that they do not keep them alive. A palette that has
+    // since been destroyed never matches, even if another is later created at the same address.
+    bool SamePalettes(const std::vector<std::weak_ptr<Palette>>& cached, const std::vector<uint64_t>& versions,
+        const std::vector<std::shared_ptr<Palette>>& pals)
+    {
+        if (cached.size() != pals.size())
+        {
+            return false;
+        }
+        for (std::size_t i = 0; i < pals.size(); ++i)
+        {
+            if (cached[i].lock() != pals[i] || (pals[i] && versions[i] != pals[i]->GetVersion()))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void StorePalettes(std::vector<std::weak_ptr<Palette>>& cached, std::vector<uint64_t>& versions,
+        const std::vector<std::shared_ptr<Palette>>& pals)
+    {
+        cached.assign(pals.cbegin(), pals.cend());
+        versions.resize(pals.size());
+        std::transform(pals.cbegin(), pals.cend(), versions.begin(), [](const auto& p) { return p ? p->GetVersion() : 0; });
+    }
+
+    // Rebuilt only when the palettes passed in, or their colours, have changed
+    const PaletteLut& GetPaletteLut(const std::vector<std::shared_ptr<Palette>>& pals)
+    {
+        thread_local PaletteLut lut;
+        if (lut.groups != 0 && SamePalettes(lut.pals, lut.versions, pals))
+        {
+            return lut;
+        }
+        StorePalettes(lut.pals, lut.versions, pals);
+        lut.groups = std::min<std::size_t>(pals.size(), 16);
+        memset(lut.rgba, 0, sizeof(lut.rgba));
+        memset(lut.planes, 0, sizeof(lut.planes));
+        for (std::size_t g = 0; g < lut.groups; ++g)
+        {
+            for (uint8_t i = 0; i < 16; ++i)
+            {
+                const auto& p = pals[g];
+                if (!p->ColourInRange(i))
+                {
+                    continue;
+                }
+                const uint8_t c[4] = { p->getR(i), p->getG(i), p->getB(i), p->getA(i) };
+                lut.rgba[g * 16 + i] = c[0] | (c[1] << 8) | (c[2] << 16) | (static_cast<uint32_t>(c[3]) << 24);
+                for (int ch = 0; ch < 4; ++ch)
+                {
+                    lut.planes[ch][g][i] = c[ch];
+                }
+            }
+        }
+        return lut;
+    }
+
+    // Expands indexed pixels to packed RGB and/or alpha in a single pass. Either output may be null.
+    struct Expansion
+    {
+        const uint8_t* pixels;
+        const uint8_t* priority;
+        std::size_t count;
+        uint8_t* rgb;
+        uint8_t* alpha;
+        uint8_t low_pri_max_opacity;
+        uint8_t high_pri_max_opacity;
+    };
+
+    template <bool RGB, bool ALPHA>
+    void ExpandScalar(const Expansion& e, const PaletteLut& lut, std::size_t first)
+    {
+        const uint8_t max_opacity[2] = { e.low_pri_max_opacity, e.high_pri_max_opacity };
+        for (std::size_t i = first; i < e.count; ++i)
+        {
+            const uint32_t c = lut.rgba[e.pixels[i]];
+            if (RGB)
+            {
+                e.rgb[i * 3] = c & 0xFF;
+                e.rgb[i * 3 + 1] = (c >> 8) & 0xFF;
+                e.rgb[i * 3 + 2] = (c >> 16) & 0xFF;
+            }
+            if (ALPHA)
+            {
+                e.alpha[i] = std::min<uint8_t>(max_opacity[e.priority[i] != 0], c >> 24);
+            }
+        }
+    }
+
+    void ExpandScalar(const Expansion& e, const PaletteLut& lut, std::size_t first)
+    {
+        if (e.rgb != nullptr && e.alpha != nullptr)
+        {
+            ExpandScalar<true, true>(e, lut, first);
+        }
+        else if (e.rgb != nullptr)
+        {
+            ExpandScalar<true, false>(e, lut, first);
+        }
+        else if (e.alpha != nullptr)
+        {
+            ExpandScalar<false, true>(e, lut, first);
+        }
+    }
+
+    // Maximum opacity of 16 pixels, selected by their priority
+    inline __m128i MaxOpacity(const Expansion& e, std::size_t i)
+    {
+        const __m128i low_pri = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(e.priority + i)), _mm_setzero_si128());
+        return _mm_or_si128(_mm_and_si128(low_pri, _mm_set1_epi8(static_cast<char>(e.low_pri_max_opacity))),
+            _mm_andnot_si128(low_pri, _mm_set1_epi8(static_cast<char>(e.high_pri_max_opacity))));
+    }
+
+    struct InterleaveMasks
+    {
+        uint8_t m[3][3][16];
+    };
+
+    // For each 16 byte block of RGB output, which R, G and B bytes land where
+    constexpr InterleaveMasks MakeInterleaveMasks()
+    {
+        InterleaveMasks masks{};
+        for (int block = 0; block < 3; ++block)
+        {
+            for (int ch = 0; ch < 3; ++ch)
+            {
+                for (int j = 0; j < 16; ++j)
+                {
+                    const int pos = block * 16 + j;
+                    masks.m[block][ch][j] = (pos % 3 == ch) ? static_cast<uint8_t>(pos / 3) : 0x80;
+                }
+            }
+        }
+        return masks;
+    }
+
+    ALIGNED_(16) constexpr InterleaveMasks INTERLEAVE_MASKS = MakeInterleaveMasks();
+
+    // 16 pixels at a time: the low nibble of each pixel indexes a 16 byte table per channel, and
+    // the high nibble selects which palette's table the result is taken from.
+    TARGET_("ssse3") void ExpandSsse3(const Expansion& e, const PaletteLut& lut)
+    {
+        const __m128i nibble = _mm_set1_epi8(0x0F);
+        std::size_t i = 0;
+        for (; i + 16 <= e.count; i += 16)
+        {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(e.pixels + i));
+            const __m128i lo = _mm_and_si128(px, nibble);
+            const __m128i hi = _mm_and_si128(_mm_srli_epi16(px, 4), nibble);
+            __m128i ch[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+            for (std::size_t g = 0; g < lut.groups; ++g)
+            {
+                const __m128i in_group = _mm_cmpeq_epi8(hi, _mm_set1_epi8(static_cast<char>(g)));
+                for (int c = 0; c < 4; ++c)
+                {
+                    const __m128i table = _mm_load_si128(reinterpret_cast<const __m128i*>(lut.planes[c][g]));
+                    ch[c] = _mm_or_si128(ch[c], _mm_and_si128(in_group, _mm_shuffle_epi8(table, lo)));
+                }
+            }
+            if (e.rgb != nullptr)
+            {
+                for (int block = 0; block < 3; ++block)
+                {
+                    __m128i out = _mm_setzero_si128();
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        const __m128i mask = _mm_load_si128(reinterpret_cast<const __m128i*>(INTERLEAVE_MASKS.m[block][c]));
+                        out = _mm_or_si128(out, _mm_shuffle_epi8(ch[c], mask));
+                    }
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(e.rgb + i * 3 + block * 16), out);
+                }
+            }
+            if (e.alpha != nullptr)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(e.alpha + i), _mm_min_epu8(ch[3], MaxOpacity(e, i)));
+            }
+        }
+        ExpandScalar(e, lut, i);
+    }
+
+    // 16 pixels at a time, gathering packed RGBA. Each 128 bit lane is shuffled to 12 bytes of RGB
+    // followed by 4 bytes of alpha; the RGB stores overlap so that the alpha bytes are overwritten.
+    TARGET_("avx2") void ExpandAvx2(const Expansion& e, const PaletteLut& lut)
+    {
+        const __m256i split = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15,
+                                               0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, 3, 7, 11, 15);
+        const int* table = reinterpret_cast<const int*>(lut.rgba);
+        std::size_t i = 0;
+        // The last RGB store writes 4 bytes past this block's output
+        for (; i + 18 <= e.count; i += 16)
+        {
+            const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(e.pixels + i));
+            const __m256i c0 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(px), 4), split);
+            const __m256i c1 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(px, 8)), 4), split);
+            if (e.rgb != nullptr)
+            {
+                uint8_t* out = e.rgb + i * 3;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(c0));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12), _mm256_extracti128_si256(c0, 1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 24), _mm256_castsi256_si128(c1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 36), _mm256_extracti128_si256(c1, 1));
+            }
+            if (e.alpha != nullptr)
+            {
+                const __m128i a = _mm_setr_epi32(_mm256_extract_epi32(c0, 3), _mm256_extract_epi32(c0, 7),
+                                                 _mm256_extract_epi32(c1, 3), _mm256_extract_epi32(c1, 7));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(e.alpha + i), _mm_min_epu8(a, MaxOpacity(e, i)));
+            }
+        }
+        ExpandScalar(e, lut, i);
+    }
+
+    enum class ExpansionKernel
+    {
+        SCALAR,
+        SSSE3,
+        AVX2
+    };
+
+    // The best kernel the CPU supports, optionally capped through LS_SIMD (none, ssse3 or avx2)
+    ExpansionKernel DetectExpansionKernel()
+    {
+        bool ssse3 = false;
+        bool avx2 = false;
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        ssse3 = (info[2] & (1 << 9)) != 0;
+        const bool os_avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x06) == 0x06;
+        __cpuidex(info, 7, 0);
+        avx2 = os_avx && (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        ssse3 = __builtin_cpu_supports("ssse3");
+        avx2 = __builtin_cpu_supports("avx2");
+#endif
+        ExpansionKernel kernel = avx2 ? ExpansionKernel::AVX2 : ssse3 ? ExpansionKernel::SSSE3 : ExpansionKernel::SCALAR;
+        const char* env = std::getenv("LS_SIMD");
+        if (env != nullptr)
+        {
+            const std::string cap(env);
+            if (cap == "none")
+            {
+                kernel = ExpansionKernel::SCALAR;
+            }
+            else if (cap == "ssse3" && kernel == ExpansionKernel::AVX2)
+            {
+                kernel = ExpansionKernel::SSSE3;
+            }
+        }
+        return kernel;
+    }
+
+    void Expand(const Expansion& e, const std::vector<std::shared_ptr<Palette>>& pals)
+    {
+        static const ExpansionKernel kernel = DetectExpansionKernel();
+        const PaletteLut& lut = GetPaletteLut(pals);
+        switch (kernel)
+        {
+        case ExpansionKernel::AVX2:
+            ExpandAvx2(e, lut);
+            break;
+        case ExpansionKernel::SSSE3:
+            ExpandSsse3(e, lut);
+            break;
+        default:
+            ExpandScalar(e, lut, 0);
+            break;
+        }
+    }
+}
+
 ImageBuffer::ImageBuffer()
     : m_width(0), m_height(0)
 {}
@@ -36,6 +337,7 @@ void ImageBuffer::Clear(uint8_t colour)
 {
     std::fill(m_pixels.begin(), m_pixels.end(), colour);
     std::fill(m_priority.begin(), m_priority.end(), colour);
+    MarkDirty(0, m_height);
 }
 
 void ImageBuffer::Resize(std::size_t width, std::size_t height)
@@ -45,15 +347,33 @@ void ImageBuffer::Resize(std::size_t width, std::size_t height)
     m_pixels.clear();
     m_pixels.assign(m_width * m_height, 0);
     m_priority.assign(width * height, 0);
+    m_rgb_rows.valid = false;
+    for (auto& channel : m_alpha)
+    {
+        channel.rows.valid = false;
+    }
 }
 
 void ImageBuffer::PutPixel(std::size_t x, std::size_t y, uint8_t colour)
 {
     m_pixels[x + m_width * y] = colour;
+    MarkDirty(y, y + 1);
 }
 
 void ImageBuffer::InsertTile(int x, int y, uint8_t palette_index, const Tile& tile, const Tileset& tileset, bool use_alpha)
 {
+    InsertTile(x, y, palette_index, tile, tileset, tileset.GetFlipCache().get(), use_alpha);
+}
+
+void ImageBuffer::InsertTile(int x, int y, uint8_t palette_index, const Tile& tile, const Tileset& tileset, const TileFlipCache* cache, bool use_alpha)
+{
+    if (cache != nullptr && tile.GetIndex() < cache->GetTileCount() &&
+        x >= 0 && y >= 0 && x + 8 <= static_cast<int>(m_width) && y + 8 <= static_cast<int>(m_height))
+    {
+        const uint8_t priority = tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_PRIORITY) ? 1 : 0;
+        BlitTile(y * m_width + x, cache->Get(tile), palette_index << 4, priority, use_alpha);
+        return;
+    }
 	int max_x = x + 7;
 	int max_y = y + 7;
     std::vector<uint8_t> cmap = tileset.GetColourIndicies();
@@ -70,31 +390,85 @@ void ImageBuffer::InsertTile(int x, int y, uint8_t palette_index, const Tile& ti
     }
     else
     {
-	    auto tile_bits = tileset.GetTile(tile);
+	    const auto tile_bits = tileset.GetTileView(tile);
 	    const uint8_t pal_bits = palette_index << 4;
-        std::size_t begin_offset = y * m_width + x;
-        auto row_it = m_pixels.begin() + begin_offset;
-        auto dest_it = row_it;
-        auto pri_row_it = m_priority.begin() + begin_offset;
-        auto pri_dest_it = row_it;
         uint8_t priority = tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_PRIORITY);
-        for (std::size_t i = 0; i < tile_bits.size(); ++i)
+        // Pixels are read from the tileset in place, with the flips applied as they are read
+        for (std::size_t row = 0; row < tile_bits.GetHeight(); ++row)
         {
-            if (i % tileset.GetTileWidth() == 0)
-            {
-                dest_it = row_it + m_width * (i / tileset.GetTileWidth());
-                pri_dest_it = pri_row_it + m_width * (i / tileset.GetTileWidth());
-				y++;
-				x -= tileset.GetTileWidth();
-            }
-            if (!use_alpha || (cmap[tile_bits[i]] != 0))
+            const std::size_t row_offset = (y + row) * m_width + x;
+            auto dest_it = m_pixels.begin() + row_offset;
+            auto pri_dest_it = m_priority.begin() + row_offset;
+            for (std::size_t col = 0; col < tile_bits.GetWidth(); ++col)
             {
-                *dest_it = cmap[tile_bits[i]] | pal_bits;
-                *pri_dest_it = priority;
+                const uint8_t p = cmap[tile_bits.At(col, row)];
+                if (!use_alpha || (p != 0))
+                {
+                    *dest_it = p | pal_bits;
+                    *pri_dest_it = priority;
+                }
+                dest_it++;
+                pri_dest_it++;
             }
-            dest_it++;
-            pri_dest_it++;
         }
+        MarkDirty(y, y + tile_bits.GetHeight());
+    }
+}
+
+void ImageBuffer::BlitTile(std::size_t offset, const uint8_t* src, uint8_t pal_bits, uint8_t priority, bool use_alpha)
+{
+    // Each 8 pixel row is written as one 64-bit store. Transparent pixels keep the destination
+    // by blending against a mask of the non-zero source pixels.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pal = _mm_set1_epi8(static_cast<char>(pal_bits));
+    const __m128i pri = _mm_set1_epi8(static_cast<char>(priority));
+    MarkDirty(offset / m_width, offset / m_width + 8);
+    uint8_t* dest = m_pixels.data() + offset;
+    uint8_t* pri_dest = m_priority.data() + offset;
+    for (std::size_t row = 0; row < 8; ++row)
+    {
+        const __m128i pixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+        __m128i out = _mm_or_si128(pixels, pal);
+        __m128i out_pri = pri;
+        if (use_alpha)
+        {
+            const __m128i transparent = _mm_cmpeq_epi8(pixels, zero);
+            const __m128i old = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(dest));
+            const __m128i old_pri = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pri_dest));
+            out = _mm_or_si128(_mm_and_si128(transparent, old), _mm_andnot_si128(transparent, out));
+            out_pri = _mm_or_si128(_mm_and_si128(transparent, old_pri), _mm_andnot_si128(transparent, out_pri));
+        }
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dest), out);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(pri_dest), out_pri);
+        src += 8;
+        dest += m_width;
+        pri_dest += m_width;
+    }
+}
+
+void ImageBuffer::BlitBlock(std::size_t offset, const uint8_t* src, const uint8_t* src_pri, uint8_t pal_bits)
+{
+    // As BlitTile, but a whole 16 pixel row of a composed block per store
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i pal = _mm_set1_epi8(static_cast<char>(pal_bits));
+    MarkDirty(offset / m_width, offset / m_width + BlockCache::BLOCK_HEIGHT);
+    uint8_t* dest = m_pixels.data() + offset;
+    uint8_t* pri_dest = m_priority.data() + offset;
+    for (std::size_t row = 0; row < BlockCache::BLOCK_HEIGHT; ++row)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i pri = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_pri));
+        const __m128i transparent = _mm_cmpeq_epi8(pixels, zero);
+        const __m128i old = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest));
+        const __m128i old_pri = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pri_dest));
+        const __m128i out = _mm_or_si128(_mm_and_si128(transparent, old), _mm_andnot_si128(transparent, _mm_or_si128(pixels, pal)));
+        const __m128i out_pri = _mm_or_si128(_mm_and_si128(transparent, old_pri), _mm_andnot_si128(transparent, pri));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), out);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pri_dest), out_pri);
+        src += BlockCache::BLOCK_WIDTH;
+        src_pri += BlockCache::BLOCK_WIDTH;
+        dest += m_width;
+        pri_dest += m_width;
     }
 }
 
@@ -129,6 +503,7 @@ void ImageBuffer::ClearTile(int x, int y, const Tileset& ts)
             *dest_it++ = 0;
             *pri_dest_it++ = false;
         }
+        MarkDirty(begin_offset / m_width, begin_offset / m_width + ts.GetTileHeight());
     }
 }
 
@@ -176,67 +551,185 @@ void ImageBuffer::InsertSprite(int x, int y, uint8_t palette_index, const Sprite
 
 void ImageBuffer::InsertMap(int x, int y, uint8_t palette_index, const Tilemap2D& map, const Tileset& tileset)
 {
+    const auto cache = tileset.GetFlipCache();
     for (std::size_t yy = 0; yy < map.GetHeight(); ++yy)
     {
         for (std::size_t xx = 0; xx < map.GetWidth(); ++xx)
         {
             const int xpos = x + xx * tileset.GetTileWidth();
             const int ypos = y + yy * tileset.GetTileHeight();
-            InsertTile(xpos, ypos, palette_index, map.GetTile(xx, yy), tileset);
+            InsertTile(xpos, ypos, palette_index, map.GetTile(xx, yy), tileset, cache.get());
         }
     }
 }
 
 void ImageBuffer::Insert3DMapLayer(int x, int y, uint8_t palette_index, Tilemap3D::Layer layer, const std::shared_ptr<const Tilemap3D> map,
     const std::shared_ptr<const Tileset> tileset, const std::shared_ptr<const std::vector<MapBlock>> blockset, bool offset,
-    std::optional<std::vector<TileSwap>> swaps, std::optional<std::vector<Door>> doors)
+    const std::optional<std::vector<TileSwap>>& swaps, const std::optional<std::vector<Door>>& doors)
 {
-    Point2D tilepos = {0, 0};
-    Tilemap3D disp_map = *map;
-    if (swaps)
-    {
-        for (const auto& swap : *swaps)
+    static const std::vector<TileSwap> no_swaps;
+    static const std::vector<Door> no_doors;
+    const Tilemap3DOverlay overlay(*map, layer, swaps ? *swaps : no_swaps, doors ? *doors : no_doors);
+    Insert3DMapLayer(x, y, palette_index, overlay, tileset, blockset, offset);
+}
+
+void ImageBuffer::Insert3DMapLayer(int x, int y, uint8_t palette_index, const Tilemap3DOverlay& map,
+    const std::shared_ptr<const Tileset> tileset, const std::shared_ptr<const std::vector<MapBlock>> blockset, bool offset)
+{
+    const auto cache = tileset->GetFlipCache();
+    const auto blocks = BlockCache::Get(*tileset, *blockset);
+    for (int yy = 0; yy < map.GetHeight(); ++yy)
+        for (int xx = 0; xx < map.GetWidth(); ++xx)
         {
-            swap.DrawSwap(disp_map, layer);
+            Draw3DMapCell({ xx + x, yy + y }, palette_index, map, *tileset, *blockset, offset, cache.get(), blocks.get());
         }
+}
+
+void ImageBuffer::Redraw3DMapCells(uint8_t palette_index, const Tilemap3DOverlay& map, const std::shared_ptr<const Tileset> tileset,
+    const std::shared_ptr<const std::vector<MapBlock>> blockset, const std::vector<IsoPoint2D>& cells, bool offset)
+{
+    if (cells.empty())
+    {
+        return;
     }
-    if (doors)
+    const auto cache = tileset->GetFlipCache();
+    const auto blocks = BlockCache::Get(*tileset, *blockset);
+    // The blocks of a layer never overlap, so each cell's square can be cleared and drawn again on its own
+    for (const auto& cell : cells)
     {
-        for (const auto& door : *doors)
+        if (map.GetMap().IsIsoPointValid(cell))
         {
-            door.DrawDoor(disp_map, layer);
+            const auto loc = map.GetMap().IsoToPixel(cell, map.GetLayer(), offset);
+            ClearRect(loc.x, loc.y, BlockCache::BLOCK_WIDTH, BlockCache::BLOCK_HEIGHT);
+            Draw3DMapCell(cell, palette_index, map, *tileset, *blockset, offset, cache.get(), blocks.get());
         }
     }
-    for (int yy = 0; yy < disp_map.GetHeight(); ++yy)
-        for (int xx = 0; xx < disp_map.GetWidth(); ++xx)
+}
+
+void ImageBuffer::Draw3DMapCell(const IsoPoint2D& cell, uint8_t palette_index, const Tilemap3DOverlay& map,
+    const Tileset& tileset, const Blockset& blockset, bool offset, const TileFlipCache* cache, const BlockCache* blocks)
+{
+    auto tile = map.GetBlock(cell);
+    auto loc(map.GetMap().IsoToPixel(cell, map.GetLayer(), offset));
+    if (tile >= blockset.size())
+    {
+        std::ostringstream ss;
+        ss << "Attempt to index out of range block " << std::hex << tile << " - maximum is " << (blockset.size() - 1);
+        Debug(ss.str());
+        tile = 0;
+    }
+    if (blocks != nullptr && blocks->IsComposed(tile) && loc.x >= 0 && loc.y >= 0 &&
+        loc.x + static_cast<int>(BlockCache::BLOCK_WIDTH) <= static_cast<int>(m_width) &&
+        loc.y + static_cast<int>(BlockCache::BLOCK_HEIGHT) <= static_cast<int>(m_height))
+    {
+        BlitBlock(loc.y * m_width + loc.x, blocks->GetPixels(tile), blocks->GetPriority(tile), palette_index << 4);
+    }
+    else
+    {
+        InsertBlock(loc.x, loc.y, palette_index, blockset.at(tile), tileset, cache);
+    }
+}
+
+void ImageBuffer::ClearRect(int x, int y, int width, int height)
+{
+    const int left = std::max(x, 0);
+    const int top = std::max(y, 0);
+    const int right = std::min(x + width, static_cast<int>(m_width));
+    const int bottom = std::min(y + height, static_cast<int>(m_height));
+    if (left >= right || top >= bottom)
+    {
+        return;
+    }
+    for (int row = top; row < bottom; ++row)
+    {
+        std::fill_n(m_pixels.begin() + row * m_width + left, right - left, 0);
+        std::fill_n(m_priority.begin() + row * m_width + left, right - left, 0);
+    }
+    MarkDirty(top, bottom);
+}
+
+namespace
+{
+    void AppendPngData(png_structp png, png_bytep data, png_size_t length)
+    {
+        auto* out = static_cast<std::vector<uint8_t>*>(png_get_io_ptr(png));
+        out->insert(out->end(), data, data + length);
+    }
+
+    void SetPngCompression(png_structp png, ImageBuffer::PngCompression compression)
+    {
+        // Row filters make indexed images larger, so they are always left off
+        switch (compression)
         {
-            tilepos = { xx + x, yy + y };
-            auto tile = disp_map.GetBlock(tilepos, layer);
-            auto loc(disp_map.IsoToPixel(tilepos, layer, offset));
-            if (tile >= blockset->size())
-            {
-                std::ostringstream ss;
-                ss << "Attempt to index out of range block " << std::hex << tile << " - maximum is " << (blockset->size() - 1);
-                Debug(ss.str());
-                tile = 0;
-            }
-            InsertBlock(loc.x, loc.y, palette_index, blockset->at(tile), *tileset);
-            tilepos.x++;
-            if (tilepos.x == static_cast<int>(GetWidth()))
-            {
-                tilepos.x = 0;
-                tilepos.y++;
-            }
+        case ImageBuffer::PngCompression::STORE:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+            png_set_compression_level(png, Z_NO_COMPRESSION);
+            break;
+        case ImageBuffer::PngCompression::FAST:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+            png_set_compression_level(png, Z_BEST_SPEED);
+            break;
+        case ImageBuffer::PngCompression::MAX:
+            png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+            png_set_compression_level(png, Z_BEST_COMPRESSION);
+            break;
+        case ImageBuffer::PngCompression::DEFAULT:
+        default:
+            // libpng's own choices
+            break;
         }
+    }
+}
+
+bool ImageBuffer::WritePNG(const std::string& filename, const std::vector<std::shared_ptr<Palette>>& palettes, bool use_alpha, PngCompression compression) const
+{
+    std::vector<uint8_t> png;
+    try
+    {
+        png = EncodePNG(palettes, use_alpha, compression);
+    }
+    catch (const std::exception& e)
+    {
+        Debug(std::string("Unable to write PNG: ") + e.what());
+        return false;
+    }
+    FILE* fp = fopen(filename.c_str(), "wb");
+    if (fp == NULL)
+    {
+        Debug("Unable to open PNG!");
+        return false;
+    }
+    const bool written = fwrite(png.data(), 1, png.size(), fp) == png.size();
+    return fclose(fp) == 0 && written;
 }
 
-bool ImageBuffer::WritePNG(const std::string& filename, const std::vector<std::shared_ptr<Palette>>& palettes, bool use_alpha)
+std::vector<uint8_t> ImageBuffer::EncodePNG(const std::vector<std::shared_ptr<Palette>>& palettes, bool use_alpha, PngCompression compression) const
 {
-    volatile bool retval = false;
+    std::vector<uint8_t> out;
+    out.reserve((compression == PngCompression::STORE ? m_pixels.size() + m_height : m_pixels.size() / 8) + 1024);
+    std::vector<png_const_bytep> rows(m_height);
+    for (std::size_t y = 0; y < m_height; ++y)
+    {
+        rows[y] = m_pixels.data() + y * m_width;
+    }
 
     png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    if (png == NULL)
+    {
+        throw std::runtime_error("Unable to create PNG write struct");
+    }
     png_infop info = png_create_info_struct(png);
-    if (setjmp(png_jmpbuf(png))) throw std::runtime_error("Unable to set libpng longjmp");
+    if (info == NULL)
+    {
+        png_destroy_write_struct(&png, NULL);
+        throw std::runtime_error("Unable to create PNG info struct");
+    }
+    if (setjmp(png_jmpbuf(png)))
+    {
+        png_destroy_write_struct(&png, &info);
+        throw std::runtime_error("Unable to encode PNG");
+    }
+    png_set_write_fn(png, &out, AppendPngData, NULL);
 
     png_set_IHDR(
         png,
@@ -248,6 +741,7 @@ bool ImageBuffer::WritePNG(const std::string& filename, const std::vector<std::s
         PNG_COMPRESSION_TYPE_BASE,
         PNG_FILTER_TYPE_BASE
     );
+    SetPngCompression(png, compression);
 
     png_color png_palette[256];
     memset(png_palette, 0, sizeof(png_palette));
@@ -272,42 +766,27 @@ bool ImageBuffer::WritePNG(const std::string& filename, const std::vector<std::s
         png_set_tRNS(png, info, png_alpha, 256, NULL);
     };
 
-    FILE* fp = fopen(filename.c_str(), "wb");
-
-    if (fp != NULL)
-    {
-        png_init_io(png, fp);
-        png_write_info(png, info);
-
-        const uint8_t* row = m_pixels.data();
-        for (std::size_t y = 0; y < m_height; ++y)
-        {
-            png_write_row(png, row);
-            row += m_width;
-        }
-
-        png_write_end(png, info);
-        fclose(fp);
-        retval = true;
-    }
-    else
-    {
-        Debug("Unable to open PNG!");
-    }
-
+    png_write_info(png, info);
+    png_write_rows(png, const_cast<png_bytepp>(rows.data()), static_cast<png_uint_32>(m_height));
+    png_write_end(png, info);
     png_destroy_write_struct(&png, &info);
 
-    return retval;
+    return out;
 }
 
 void ImageBuffer::InsertBlock(std::size_t x, std::size_t y, uint8_t palette_index, const MapBlock& block, const Tileset& tileset)
+{
+    InsertBlock(x, y, palette_index, block, tileset, tileset.GetFlipCache().get());
+}
+
+void ImageBuffer::InsertBlock(std::size_t x, std::size_t y, uint8_t palette_index, const MapBlock& block, const Tileset& tileset, const TileFlipCache* cache)
 {
     if ((y + 7) * m_width + x + 7 < m_pixels.size())
     {
-        InsertTile(x, y, palette_index, block.GetTile(0), tileset);
-        InsertTile(x + 8, y, palette_index, block.GetTile(1), tileset);
-        InsertTile(x, y + 8, palette_index, block.GetTile(2), tileset);
-        InsertTile(x + 8, y + 8, palette_index, block.GetTile(3), tileset);
+        InsertTile(x, y, palette_index, block.GetTile(0), tileset, cache);
+        InsertTile(x + 8, y, palette_index, block.GetTile(1), tileset, cache);
+        InsertTile(x, y + 8, palette_index, block.GetTile(2), tileset, cache);
+        InsertTile(x + 8, y + 8, palette_index, block.GetTile(3), tileset, cache);
     }
     else
     {
@@ -319,73 +798,124 @@ void ImageBuffer::InsertBlock(std::size_t x, std::size_t y, uint8_t palette_inde
 const std::vector<uint8_t>& ImageBuffer::GetRGB(const std::vector<std::shared_ptr<Palette>>& pals) const
 {
     m_rgb.resize(m_width * m_height * 3);
-    auto it = m_rgb.begin();
-    std::unique_ptr<uint8_t[]> pal_lookup(new uint8_t[pals.size() * 16 * 4]);
-    int idx = 0;
-    for (const auto& p : pals)
+    const auto rows = TakeDirtyRows(m_rgb_rows, pals, 0xFF, 0xFF);
+    ExpandRows(rows.first, rows.second, pals, true, nullptr, 0xFF, 0xFF);
+    return m_rgb;
+}
+
+const std::vector<uint8_t>& ImageBuffer::GetAlpha(const std::vector<std::shared_ptr<Palette>>& pals, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+{
+    auto& channel = GetAlphaChannel(low_pri_max_opacity, high_pri_max_opacity);
+    channel.alpha.resize(m_width * m_height);
+    const auto rows = TakeDirtyRows(channel.rows, pals, low_pri_max_opacity, high_pri_max_opacity);
+    ExpandRows(rows.first, rows.second, pals, false, channel.alpha.data(), low_pri_max_opacity, high_pri_max_opacity);
+    return channel.alpha;
+}
+
+ImageBuffer::AlphaChannel& ImageBuffer::GetRGBA(const std::vector<std::shared_ptr<Palette>>& pals, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+{
+    auto& channel = GetAlphaChannel(low_pri_max_opacity, high_pri_max_opacity);
+    m_rgb.resize(m_width * m_height * 3);
+    channel.alpha.resize(m_width * m_height);
+    const auto rgb_rows = TakeDirtyRows(m_rgb_rows, pals, 0xFF, 0xFF);
+    const auto alpha_rows = TakeDirtyRows(channel.rows, pals, low_pri_max_opacity, high_pri_max_opacity);
+    // Re-expanding clean RGB rows alongside dirty alpha rows (or vice versa) rewrites the same values,
+    // so the union of both ranges is done in one pass
+    std::size_t first = std::min(rgb_rows.first, alpha_rows.first);
+    std::size_t last = std::max(rgb_rows.second, alpha_rows.second);
+    if (rgb_rows.first == rgb_rows.second)
     {
-        for (int i = 0; i < 16; ++i)
-        {
-            pal_lookup[idx++] = p->getR(i);
-            pal_lookup[idx++] = p->getG(i);
-            pal_lookup[idx++] = p->getB(i);
-            pal_lookup[idx++] = 0;
-        }
+        std::tie(first, last) = alpha_rows;
     }
-    for (const auto& pixel : m_pixels)
+    else if (alpha_rows.first == alpha_rows.second)
     {
-        *it++ = pal_lookup[(pixel << 2)];
-        *it++ = pal_lookup[(pixel << 2) + 1];
-        *it++ = pal_lookup[(pixel << 2) + 2];
+        std::tie(first, last) = rgb_rows;
     }
-    return m_rgb;
+    ExpandRows(first, last, pals, true, channel.alpha.data(), low_pri_max_opacity, high_pri_max_opacity);
+    return channel;
 }
 
-const std::vector<uint8_t>& ImageBuffer::GetAlpha(const std::vector<std::shared_ptr<Palette>>& pals, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+void ImageBuffer::MarkDirty(std::size_t first_row, std::size_t last_row)
 {
-    m_alpha.resize(m_width * m_height);
-    auto pri = m_priority.cbegin();
-    auto it = m_alpha.begin();
-    std::unique_ptr<uint8_t[]> pal_lookup(new uint8_t[pals.size() * 16]);
-    int pi = 0;
-    for (const auto& p : pals)
+    last_row = std::min(last_row, m_height);
+    for (auto* rows : { &m_rgb_rows, &m_alpha[0].rows, &m_alpha[1].rows })
     {
-        for (int i = 0; i < 16; ++i)
+        if (rows->dirty_begin >= rows->dirty_end)
+        {
+            rows->dirty_begin = first_row;
+            rows->dirty_end = last_row;
+        }
+        else
         {
-            pal_lookup[pi++] = p->getA(i);
+            rows->dirty_begin = std::min(rows->dirty_begin, first_row);
+            rows->dirty_end = std::max(rows->dirty_end, last_row);
         }
     }
-    for (const auto& pixel : m_pixels)
+}
+
+ImageBuffer::AlphaChannel& ImageBuffer::GetAlphaChannel(uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+{
+    for (std::size_t i = 0; i < m_alpha.size(); ++i)
     {
-        uint8_t alpha = pal_lookup[pixel];
-        uint8_t max_opacity = *pri++ ? high_pri_max_opacity : low_pri_max_opacity;
-        *it++ = std::min<uint8_t>(max_opacity, alpha);
+        const auto& rows = m_alpha[i].rows;
+        if (rows.valid && rows.low_pri_max_opacity == low_pri_max_opacity && rows.high_pri_max_opacity == high_pri_max_opacity)
+        {
+            m_last_alpha = i;
+            return m_alpha[i];
+        }
     }
-    return m_alpha;
+    // Otherwise replace whichever channel was used least recently
+    m_last_alpha = (m_last_alpha + 1) % m_alpha.size();
+    m_alpha[m_last_alpha].rows.valid = false;
+    return m_alpha[m_last_alpha];
 }
 
-std::shared_ptr<wxBitmap> ImageBuffer::MakeBitmap(const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+std::pair<std::size_t, std::size_t> ImageBuffer::TakeDirtyRows(ExpandedRows& rows, const std::vector<std::shared_ptr<Palette>>& pals,
+    uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
 {
-    GetRGB(pals);
-    wxImage* img = new wxImage(m_width, m_height, m_rgb.data(), true);
-    if (use_alpha)
+    std::pair<std::size_t, std::size_t> dirty(rows.dirty_begin, std::max(rows.dirty_begin, rows.dirty_end));
+    if (!rows.valid || !SamePalettes(rows.pals, rows.palette_versions, pals) ||
+        rows.low_pri_max_opacity != low_pri_max_opacity || rows.high_pri_max_opacity != high_pri_max_opacity)
+    {
+        rows.valid = true;
+        StorePalettes(rows.pals, rows.palette_versions, pals);
+        rows.low_pri_max_opacity = low_pri_max_opacity;
+        rows.high_pri_max_opacity = high_pri_max_opacity;
+        dirty = { 0, m_height };
+    }
+    rows.dirty_begin = 0;
+    rows.dirty_end = 0;
+    return dirty;
+}
+
+void ImageBuffer::ExpandRows(std::size_t first_row, std::size_t last_row, const std::vector<std::shared_ptr<Palette>>& pals,
+    bool rgb, uint8_t* alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+{
+    if (first_row >= last_row)
     {
-        GetAlpha(pals, low_pri_max_opacity, high_pri_max_opacity);
-        img->SetAlpha(m_alpha.data(), true);
+        return;
     }
-    auto ret = std::make_shared<wxBitmap>(*img);
-    return ret;
+    const std::size_t first = first_row * m_width;
+    Expand({ m_pixels.data() + first, m_priority.data() + first, (last_row - first_row) * m_width,
+             rgb ? m_rgb.data() + first * 3 : nullptr, alpha ? alpha + first : nullptr,
+             low_pri_max_opacity, high_pri_max_opacity }, pals);
+}
+
+std::shared_ptr<wxBitmap> ImageBuffer::MakeBitmap(const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
+{
+    return std::make_shared<wxBitmap>(MakeImage(pals, use_alpha, low_pri_max_opacity, high_pri_max_opacity));
 }
 
 wxImage ImageBuffer::MakeImage(const std::vector<std::shared_ptr<Palette>>& pals, bool use_alpha, uint8_t low_pri_max_opacity, uint8_t high_pri_max_opacity) const
 {
-    GetRGB(pals);
-    wxImage img(m_width, m_height, m_rgb.data(), true);
-    if (use_alpha)
+    if (!use_alpha)
     {
-        GetAlpha(pals, low_pri_max_opacity, high_pri_max_opacity);
-        img.SetAlpha(m_alpha.data(), true);
+        GetRGB(pals);
+        return wxImage(m_width, m_height, m_rgb.data(), true);
     }
+    auto& channel = GetRGBA(pals, low_pri_max_opacity, high_pri_max_opacity);
+    wxImage img(m_width, m_height, m_rgb.data(), true);
+    img.SetAlpha(channel.alpha.data(), true);
     return img;
 }
 
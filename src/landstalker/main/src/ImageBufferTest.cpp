@@ -0,0 +1,282 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <utility>
+#include <png.h>
+
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
+#include <landstalker/main/include/ImageBuffer.h>
+
+namespace
+{
+    // Draws a map layer one block at a time through the per-tile path, as Insert3DMapLayer did
+    // before blocks were composed
+    void DrawLayerByTile(ImageBuffer& buf, const Tilemap3D& map, Tilemap3D::Layer layer, const Tileset& tileset, const Blockset& blockset)
+    {
+        for (int y = 0; y < map.GetHeight(); ++y)
+        {
+            for (int x = 0; x < map.GetWidth(); ++x)
+            {
+                const auto loc = map.IsoToPixel({ x, y }, layer, true);
+                const auto block = map.GetBlock({ x, y }, layer);
+                buf.InsertBlock(loc.x, loc.y, 0, blockset.at(block < blockset.size() ? block : 0), tileset);
+            }
+        }
+    }
+
+    struct PngSource
+    {
+        const std::vector<uint8_t>& data;
+        std::size_t pos;
+    };
+
+    void ReadPngData(png_structp png, png_bytep out, png_size_t count)
+    {
+        auto* src = static_cast<PngSource*>(png_get_io_ptr(png));
+        if (src->pos + count > src->data.size())
+        {
+            png_error(png, "Read past the end of the PNG");
+        }
+        std::copy_n(src->data.begin() + src->pos, count, out);
+        src->pos += count;
+    }
+
+    // Decodes an 8-bit indexed PNG back into an ImageBuffer, without applying its palette
+    bool DecodeIndexedPng(const std::vector<uint8_t>& png_data, ImageBuffer& buf)
+    {
+        png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+        png_infop info = png_create_info_struct(png);
+        PngSource src{ png_data, 0 };
+        std::vector<uint8_t> pixels;
+        std::vector<png_bytep> rows;
+        if (setjmp(png_jmpbuf(png)))
+        {
+            png_destroy_read_struct(&png, &info, NULL);
+            return false;
+        }
+        png_set_read_fn(png, &src, ReadPngData);
+        png_read_info(png, info);
+        const std::size_t width = png_get_image_width(png, info);
+        const std::size_t height = png_get_image_height(png, info);
+        if (png_get_color_type(png, info) != PNG_COLOR_TYPE_PALETTE || png_get_bit_depth(png, info) != 8)
+        {
+            png_destroy_read_struct(&png, &info, NULL);
+            return false;
+        }
+        pixels.resize(width * height);
+        rows.resize(height);
+        for (std::size_t y = 0; y < height; ++y)
+        {
+            rows[y] = pixels.data() + y * width;
+        }
+        png_read_image(png, rows.data());
+        png_read_end(png, NULL);
+        png_destroy_read_struct(&png, &info, NULL);
+        buf.Resize(width, height);
+        for (std::size_t i = 0; i < pixels.size(); ++i)
+        {
+            buf.PutPixel(i % width, i / width, pixels[i]);
+        }
+        return true;
+    }
+}
+
+void SelfTest::RoomLayers()
+{
+    // Layers assembled from composed blocks must match the blocks drawn tile by tile
+    const auto room = GenerateRoom();
+    std::vector<std::shared_ptr<const Tilemap3D>> maps;
+    for (const auto& m : GenerateMaps())
+    {
+        const auto map = std::make_shared<const Tilemap3D>(m.second);
+        ImageBuffer composed(map->GetPixelWidth(), map->GetPixelHeight());
+        ImageBuffer reference(map->GetPixelWidth(), map->GetPixelHeight());
+        for (auto layer : { Tilemap3D::Layer::BG, Tilemap3D::Layer::FG })
+        {
+            composed.Insert3DMapLayer(0, 0, 0, layer, map, room.tileset, room.blockset);
+            DrawLayerByTile(reference, *map, layer, *room.tileset, *room.blockset);
+        }
+        Check(composed.GetRGB(room.palettes) == reference.GetRGB(room.palettes) &&
+            composed.GetAlpha(room.palettes, 0x80, 0xFF) == reference.GetAlpha(room.palettes, 0x80, 0xFF),
+            m.first + ": composed blocks drew differently");
+        maps.push_back(map);
+    }
+
+    // Reading pixels leaves the flip cache alone, whereas setting them drops it, and drawing then
+    // picks up the change
+    const auto cache = room.tileset->GetFlipCache();
+    const auto read = std::as_const(*room.tileset).GetTilePixels(1);
+    std::vector<uint8_t> pixels(read.begin(), read.end());
+    Check(room.tileset->GetFlipCache() == cache, "reading pixels dropped the flip cache");
+    std::transform(pixels.begin(), pixels.end(), pixels.begin(), [](uint8_t p) { return static_cast<uint8_t>((p + 1) % 16); });
+    room.tileset->SetTilePixels(1, ConstTilePixels(pixels.data(), pixels.size()));
+    Check(room.tileset->GetFlipCache() != cache, "setting a tile's pixels kept the flip cache");
+    if (!maps.empty())
+    {
+        const auto& map = maps.front();
+        ImageBuffer composed(map->GetPixelWidth(), map->GetPixelHeight());
+        ImageBuffer reference(map->GetPixelWidth(), map->GetPixelHeight());
+        composed.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, room.tileset, room.blockset);
+        DrawLayerByTile(reference, *map, Tilemap3D::Layer::BG, *room.tileset, *room.blockset);
+        Check(composed.GetRGB(room.palettes) == reference.GetRGB(room.palettes), "a modified tile was drawn from the old flip cache");
+    }
+
+    // Throughput once the blocks have been composed
+    double composed_ms = 0.0;
+    double tile_ms = 0.0;
+    std::size_t cells = 0;
+    for (const auto& map : maps)
+    {
+        ImageBuffer buf(map->GetPixelWidth(), map->GetPixelHeight());
+        for (int pass = 0; pass < 10; ++pass)
+        {
+            auto start = std::chrono::steady_clock::now();
+            buf.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, room.tileset, room.blockset);
+            composed_ms += ElapsedMs(start);
+            start = std::chrono::steady_clock::now();
+            DrawLayerByTile(buf, *map, Tilemap3D::Layer::BG, *room.tileset, *room.blockset);
+            tile_ms += ElapsedMs(start);
+            cells += map->GetWidth() * map->GetHeight();
+        }
+    }
+    std::printf("  %zu cells: %.2f ms from composed blocks, %.2f ms tile by tile\n", cells, composed_ms, tile_ms);
+}
+
+void SelfTest::RoomRedraw()
+{
+    // Redrawing only the edited cells of a layer must give the same image as drawing the layer again
+    const auto room = GenerateRoom();
+    const Tilemap3D::Layer layers[] = { Tilemap3D::Layer::BG, Tilemap3D::Layer::FG };
+    std::mt19937 rng(29);
+    double cells_ms = 0.0;
+    double full_ms = 0.0;
+    std::size_t edits = 0;
+    for (const auto& m : GenerateMaps())
+    {
+        const auto map = std::make_shared<Tilemap3D>(m.second);
+        auto render = [&](Tilemap3D::Layer layer)
+        {
+            ImageBuffer buf(map->GetPixelWidth(), map->GetPixelHeight());
+            buf.Insert3DMapLayer(0, 0, 0, layer, map, room.tileset, room.blockset);
+            return buf;
+        };
+        std::vector<ImageBuffer> bufs;
+        for (auto layer : layers)
+        {
+            bufs.push_back(render(layer));
+            bufs.back().GetRGB(room.palettes);
+            bufs.back().GetAlpha(room.palettes, 0x80, 0xFF);
+        }
+        for (int i = 0; i < 20; ++i)
+        {
+            auto& buf = bufs[i % 2];
+            const auto layer = layers[i % 2];
+            const IsoPoint2D cell{ static_cast<int>(rng() % map->GetWidth()), static_cast<int>(rng() % map->GetHeight()) };
+            map->SetBlock({ static_cast<uint16_t>(rng() % room.blockset->size()), cell }, layer);
+            auto start = std::chrono::steady_clock::now();
+            buf.Redraw3DMapCells(0, Tilemap3DOverlay(*map, layer), room.tileset, room.blockset, { cell });
+            const auto& rgb = buf.GetRGB(room.palettes);
+            cells_ms += ElapsedMs(start);
+            start = std::chrono::steady_clock::now();
+            const auto full = render(layer);
+            const auto& full_rgb = full.GetRGB(room.palettes);
+            full_ms += ElapsedMs(start);
+            Check(rgb == full_rgb && buf.GetAlpha(room.palettes, 0x80, 0xFF) == full.GetAlpha(room.palettes, 0x80, 0xFF),
+                m.first + ": redrawing cell (" + std::to_string(cell.x) + ", " + std::to_string(cell.y) + ") differs from a full render");
+            ++edits;
+        }
+        // A colour change has to expand every row again, not just the dirty ones
+        const auto colour = room.palettes[0]->GetNthUnlockedColour(1).GetGenesis();
+        room.palettes[0]->SetNthUnlockedGenesisColour(1, colour ^ 0x0EEE);
+        Check(bufs[0].GetRGB(room.palettes) == render(layers[0]).GetRGB(room.palettes), m.first + ": a palette change was not expanded");
+    }
+
+    // A merged palette shares its sources' colours, so an edit made through either has to be
+    // expanded for buffers drawn with the other
+    const auto map = std::make_shared<Tilemap3D>(GenerateMaps().front().second);
+    ImageBuffer merged_buf(map->GetPixelWidth(), map->GetPixelHeight());
+    merged_buf.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, room.tileset, room.blockset);
+    ImageBuffer source_buf = merged_buf;
+    const std::vector<std::shared_ptr<Palette>> sources = { std::make_shared<Palette>(*room.palettes[0]) };
+    const std::vector<std::shared_ptr<Palette>> merged = { std::make_shared<Palette>(sources) };
+    auto expected = [&](const std::shared_ptr<Palette>& pal)
+    {
+        ImageBuffer buf = merged_buf;
+        return buf.GetRGB({ std::make_shared<Palette>(*pal) });
+    };
+    merged_buf.GetRGB(merged);
+    source_buf.GetRGB(sources);
+    sources[0]->SetNthUnlockedGenesisColour(1, sources[0]->GetNthUnlockedColour(1).GetGenesis() ^ 0x0EEE);
+    Check(merged_buf.GetRGB(merged) == expected(merged[0]), "editing a palette was not expanded for a merged palette sharing its colours");
+    source_buf.GetRGB(sources);
+    merged[0]->SetNthUnlockedGenesisColour(2, merged[0]->GetNthUnlockedColour(2).GetGenesis() ^ 0x0EEE);
+    Check(source_buf.GetRGB(sources) == expected(sources[0]), "editing a merged palette was not expanded for its source");
+
+    // The expansion caches must not keep a palette alive once its owner has dropped it
+    std::weak_ptr<Palette> dropped;
+    {
+        const std::vector<std::shared_ptr<Palette>> pals = { std::make_shared<Palette>(*room.palettes[0]) };
+        dropped = pals[0];
+        source_buf.GetRGB(pals);
+        source_buf.GetAlpha(pals);
+    }
+    Check(dropped.expired(), "expanding a buffer kept its palette alive");
+    std::printf("  %zu edits: %.2f ms redrawing the cells, %.2f ms redrawing the layers\n", edits, cells_ms, full_ms);
+}
+
+void SelfTest::PngPresets()
+{
+    // Every preset must decode back to the same indices
+    const auto room = GenerateRoom();
+    const std::vector<std::pair<std::string, ImageBuffer::PngCompression>> presets = {
+        {"store", ImageBuffer::PngCompression::STORE}, {"fast", ImageBuffer::PngCompression::FAST},
+        {"default", ImageBuffer::PngCompression::DEFAULT}, {"max", ImageBuffer::PngCompression::MAX} };
+    std::vector<double> ms(presets.size());
+    std::vector<std::size_t> bytes(presets.size());
+    std::size_t pixels = 0;
+    for (const auto& m : GenerateMaps())
+    {
+        const auto map = std::make_shared<const Tilemap3D>(m.second);
+        ImageBuffer buf(map->GetPixelWidth(), map->GetPixelHeight());
+        for (auto layer : { Tilemap3D::Layer::BG, Tilemap3D::Layer::FG })
+        {
+            buf.Insert3DMapLayer(0, 0, 0, layer, map, room.tileset, room.blockset);
+        }
+        pixels += buf.GetWidth() * buf.GetHeight();
+        for (std::size_t i = 0; i < presets.size(); ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const auto png = buf.EncodePNG(room.palettes, true, presets[i].second);
+            ms[i] += ElapsedMs(start);
+            bytes[i] += png.size();
+            ImageBuffer decoded;
+            Check(DecodeIndexedPng(png, decoded) && decoded.GetWidth() == buf.GetWidth() && decoded.GetHeight() == buf.GetHeight() &&
+                decoded.GetRGB(room.palettes) == buf.GetRGB(room.palettes), m.first + ": the " + presets[i].first + " PNG does not decode to the same pixels");
+        }
+    }
+    for (std::size_t i = 0; i < presets.size(); ++i)
+    {
+        std::printf("  %-7s %zu pixels: %.2f ms, %zu bytes\n", presets[i].first.c_str(), pixels, ms[i], bytes[i]);
+    }
+
+    // libpng rejects an empty image, which WritePNG must report rather than throw
+    const auto filename = std::filesystem::temp_directory_path() / "landstalker-selftest.png";
+    bool written = true;
+    try
+    {
+        written = ImageBuffer().WritePNG(filename.string(), room.palettes);
+    }
+    catch (const std::exception&)
+    {
+        Check(false, "writing an empty image threw");
+    }
+    Check(!written, "an empty image was written");
+    Check(!ImageBuffer(8, 8).WritePNG((filename / "missing" / "room.png").string(), room.palettes),
+        "a PNG was written to a directory that does not exist");
+    std::error_code ec;
+    std::filesystem::remove(filename, ec);
+}
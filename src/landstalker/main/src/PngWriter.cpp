@@ -0,0 +1,44 @@
+#include <landstalker/main/include/PngWriter.h>
+
+#include <algorithm>
+
+PngWriter::PngWriter(ImageBuffer::PngCompression compression, TaskPool& pool)
+    : m_compression(compression),
+      m_group(pool)
+{
+}
+
+PngWriter::~PngWriter()
+{
+    try
+    {
+        Wait();
+    }
+    catch (...)
+    {
+    }
+}
+
+void PngWriter::Write(const std::string& filename, ImageBuffer image, std::vector<std::shared_ptr<Palette>> pals, bool use_alpha)
+{
+    auto job = std::make_shared<std::pair<ImageBuffer, std::vector<std::shared_ptr<Palette>>>>(std::move(image), std::move(pals));
+    m_group.Run([this, filename, job, use_alpha]()
+        {
+            if (!job->first.WritePNG(filename, job->second, use_alpha, m_compression))
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_failed.push_back(filename);
+            }
+        });
+}
+
+std::vector<std::string> PngWriter::Wait()
+{
+    m_group.Wait();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> failed;
+    failed.swap(m_failed);
+    // Writes finish in any order, so report them in a stable one
+    std::sort(failed.begin(), failed.end());
+    return failed;
+}
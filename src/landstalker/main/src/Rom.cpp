@@ -1,8 +1,17 @@
 #include <landstalker/main/include/Rom.h>
 
+#include <algorithm>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 Rom::Rom(const std::string filename)
 	: m_filename(filename),
 	  m_initialised(false),
+	  m_size(0),
 	  m_region(RomOffsets::Region::US)
 {
 	load_from_file(filename);
@@ -10,65 +19,162 @@ Rom::Rom(const std::string filename)
 
 Rom::Rom(const std::vector<uint8_t>& arr)
 	: m_initialised(true),
-	  m_rom(arr),
+	  m_size(0),
 	  m_region(RomOffsets::Region::US)
 {
+	SetBaseImage(std::make_shared<MappedFile>(arr));
 }
 
 Rom::Rom(const Rom& rhs)
 	: m_filename(rhs.m_filename),
 	  m_initialised(rhs.m_initialised),
-	  m_rom(rhs.m_rom),
+	  m_image(rhs.m_image),
+	  m_pages(rhs.m_pages),
+	  m_page_data(rhs.m_page_data),
+	  m_size(rhs.m_size),
 	  m_region(rhs.m_region)
 {}
 
 Rom::Rom()
 	: m_initialised(false),
+	m_size(0),
 	m_region(RomOffsets::Region::US)
 {}
 
 void Rom::load_from_file(std::string filename)
 {
 	m_filename = filename;
-	std::ifstream infile;
-	infile.open(filename, std::ios::in | std::ios::binary | std::ios::ate);
-
-	if (!infile.is_open())
+	std::shared_ptr<const MappedFile> image;
+	try
+	{
+		// Copied rather than mapped, as the assembler or an emulator may rewrite the file while it is open
+		image = std::make_shared<MappedFile>(filename, MappedFile::Access::COPY);
+	}
+	catch (const std::exception&)
 	{
 		std::ostringstream ss;
 		ss << "Unable to open ROM file \"" << filename << "\".";
 		throw std::runtime_error(ss.str());
 	}
 
-	infile.seekg(0, std::ios::end);
-	std::size_t size = static_cast<std::size_t>(infile.tellg());
-	infile.seekg(0, std::ios::beg);
-
-	if (size < RomOffsets::EXPECTED_SIZE)
+	if (image->size() < RomOffsets::EXPECTED_SIZE)
 	{
 		std::ostringstream ss;
-		ss << "ROM file " << filename << ": Bad ROM size! Expected " << std::dec << RomOffsets::EXPECTED_SIZE << " bytes, read " << size << " bytes.";
+		ss << "ROM file " << filename << ": Bad ROM size! Expected " << std::dec << RomOffsets::EXPECTED_SIZE << " bytes, read " << image->size() << " bytes.";
 		throw std::runtime_error(ss.str());
 	}
 
-	m_rom.assign(size, 0);
-	infile.read(reinterpret_cast<char*>(m_rom.data()), size);
-	infile.close();
-
+	SetBaseImage(image);
 	m_initialised = true;
 	ValidateRomChecksum();
 }
 
 Rom& Rom::operator=(const Rom& rhs)
 {
-	m_rom = rhs.m_rom;
+	m_filename = rhs.m_filename;
+	m_initialised = rhs.m_initialised;
+	m_image = rhs.m_image;
+	m_pages = rhs.m_pages;
+	m_page_data = rhs.m_page_data;
+	m_size = rhs.m_size;
+	m_region = rhs.m_region;
 	return *this;
 }
 
 void Rom::writeFile(const std::string& filename)
 {
 	FixRomChecksum();
-	WriteBytes(m_rom, filename);
+	std::vector<uint8_t> bytes = read_array<uint8_t>(0, static_cast<uint32_t>(m_size));
+	// Write to a temporary file and move it into place, so that a failed write leaves the
+	// original intact. A symlink is written through rather than replaced by a regular file.
+	std::filesystem::path target(filename);
+	std::error_code ec;
+	const bool replacing = std::filesystem::exists(target, ec);
+	if (replacing)
+	{
+		target = std::filesystem::canonical(target);
+	}
+	const std::filesystem::path tmp_filename = target.string() + ".tmp";
+	try
+	{
+		WriteBytes(bytes, tmp_filename.string());
+		if (replacing)
+		{
+			std::filesystem::permissions(tmp_filename, std::filesystem::status(target).permissions());
+#ifndef _WIN32
+			struct stat st;
+			// Keeping the owner needs privileges we may not have, so a failure is only logged
+			if (stat(target.c_str(), &st) == 0 && chown(tmp_filename.c_str(), st.st_uid, st.st_gid) != 0)
+			{
+				Debug("Unable to keep the owner of \"" + target.string() + "\"");
+			}
+#endif
+		}
+		std::filesystem::rename(tmp_filename, target);
+	}
+	catch (...)
+	{
+		std::filesystem::remove(tmp_filename, ec);
+		throw;
+	}
+	// The file now holds every modified page, so it becomes the new base image and the overlay is dropped
+	SetBaseImage(std::make_shared<MappedFile>(std::move(bytes)));
+}
+
+void Rom::SetBaseImage(std::shared_ptr<const MappedFile> image)
+{
+	m_image = std::move(image);
+	m_size = m_image->size();
+	m_pages.assign((m_size + OVERLAY_PAGE_SIZE - 1) >> OVERLAY_PAGE_BITS, nullptr);
+	m_page_data.resize(m_pages.size());
+	for (std::size_t i = 0; i < m_page_data.size(); ++i)
+	{
+		m_page_data[i] = m_image->data() + (i << OVERLAY_PAGE_BITS);
+	}
+}
+
+void Rom::ReadBytes(uint32_t offset, std::size_t length, uint8_t* dest) const
+{
+	if (m_initialised == false)
+	{
+		throw std::runtime_error("Attempt to read from uninitialised ROM.");
+	}
+	if (offset + length > m_size)
+	{
+		throw std::runtime_error("Attempt to read past end of ROM.");
+	}
+	while (length > 0)
+	{
+		const std::size_t count = std::min(length, OVERLAY_PAGE_SIZE - (offset & OVERLAY_PAGE_MASK));
+		std::copy_n(m_page_data[offset >> OVERLAY_PAGE_BITS] + (offset & OVERLAY_PAGE_MASK), count, dest);
+		offset += static_cast<uint32_t>(count);
+		dest += count;
+		length -= count;
+	}
+}
+
+Rom::Page& Rom::GetWritablePage(std::size_t page)
+{
+	auto& overlay = m_pages[page];
+	if (overlay == nullptr)
+	{
+		// Bytes past the end of the ROM are left as zero, in case it is later enlarged
+		overlay = std::make_shared<Page>();
+		std::copy_n(m_page_data[page], std::min(OVERLAY_PAGE_SIZE, m_size - (page << OVERLAY_PAGE_BITS)), overlay->data());
+	}
+	else if (overlay.use_count() > 1)
+	{
+		// Shared with a copy of this ROM
+		overlay = std::make_shared<Page>(*overlay);
+	}
+	m_page_data[page] = overlay->data();
+	return *overlay;
+}
+
+const Rom::Page& Rom::GetZeroPage()
+{
+	static const Page zero_page = {};
+	return zero_page;
 }
 
 std::string Rom::read_string(const std::string& name) const
@@ -138,19 +244,24 @@ RomOffsets::Section Rom::get_section(const std::string& name) const
 	return addr->second;
 }
 
-const uint8_t* Rom::data(uint32_t address) const
-{
-	return m_rom.data() + address;
-}
-
 std::size_t Rom::size(uint32_t address) const
 {
-	return m_rom.size() - address;
+	return m_size - address;
 }
 
 void Rom::resize(std::size_t amt)
 {
-	m_rom.resize(amt);
+	if ((amt < m_size && (amt & OVERLAY_PAGE_MASK) != 0) || (amt > m_size && (m_size & OVERLAY_PAGE_MASK) != 0))
+	{
+		// The page containing the new (or old) end of the ROM must be zero beyond the smaller of the
+		// two sizes, which is only true of an overlay page.
+		const std::size_t boundary = std::min(amt, m_size);
+		Page& last = GetWritablePage(boundary >> OVERLAY_PAGE_BITS);
+		std::fill(last.begin() + (boundary & OVERLAY_PAGE_MASK), last.end(), 0);
+	}
+	m_size = amt;
+	m_pages.resize((m_size + OVERLAY_PAGE_SIZE - 1) >> OVERLAY_PAGE_BITS);
+	m_page_data.resize(m_pages.size(), GetZeroPage().data());
 }
 
 std::string Rom::get_description() const
@@ -163,11 +274,6 @@ RomOffsets::Region Rom::get_region() const
 	return m_region;
 }
 
-const std::vector<uint8_t>& Rom::get_vec() const
-{
-	return m_rom;
-}
-
 bool Rom::section_exists(const std::string& name)
 {
 	return RomOffsets::SECTION.find(name) != RomOffsets::SECTION.cend();
@@ -188,6 +294,17 @@ uint16_t Rom::calc_checksum()
 	return calculated_checksum;
 }
 
+uint64_t Rom::calc_hash() const
+{
+	// The hash runs over the bytes in order, so hashing the pages where they lie gives the hash of the whole image
+	uint64_t hash = Fnv1a(nullptr, 0);
+	for (std::size_t offset = 0; offset < m_size; offset += OVERLAY_PAGE_SIZE)
+	{
+		hash = Fnv1a(m_page_data[offset >> OVERLAY_PAGE_BITS], std::min(OVERLAY_PAGE_SIZE, m_size - offset), hash);
+	}
+	return hash;
+}
+
 uint16_t Rom::read_checksum()
 {
 	return read<uint16_t>(RomOffsets::CHECKSUM_ADDRESS);
@@ -3,6 +3,7 @@
 #include <set>
 #include <cassert>
 #include <algorithm>
+#include <utility>
 
 #include <landstalker/misc/include/Utils.h>
 #include <landstalker/main/include/AsmUtils.h>
@@ -126,8 +127,8 @@ ByteVector EncodeFromSet(const std::set<uint16_t>& data, bool terminate = true)
     return ret;
 }
 
-RoomData::RoomData(const filesystem::path& asm_file)
-    : DataManager(asm_file)
+RoomData::RoomData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot)
+    : DataManager(asm_file, snapshot)
 {
     if (!LoadAsmFilenames())
     {
@@ -189,8 +190,8 @@ RoomData::RoomData(const filesystem::path& asm_file)
     ResetTilesetDefaultPalettes();
 }
 
-RoomData::RoomData(const Rom& rom)
-    : DataManager(rom)
+RoomData::RoomData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot)
+    : DataManager(rom, snapshot)
 {
     SetDefaultFilenames();
     if (!RomLoadRoomData(rom))
@@ -443,43 +444,68 @@ bool RoomData::HasBeenModified() const
 void RoomData::RefreshPendingWrites(const Rom& rom)
 {
     DataManager::RefreshPendingWrites(rom);
-    if (!RomPrepareInjectMiscWarp(rom))
+    if (!PrepareSection("misc_warps", SectionInputs().AddValue(m_warps),
+        [&]() { return RomPrepareInjectMiscWarp(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare misc warps for ROM injection"));
     }
-    if (!RomPrepareInjectRoomData(rom))
+    std::vector<Room> rooms;
+    rooms.reserve(m_roomlist.size());
+    for (const auto& room : m_roomlist)
+    {
+        rooms.push_back(*room);
+    }
+    if (!PrepareSection("room_data", SectionInputs().AddValue(rooms).AddEntries(m_maps).AddEntries(m_room_pals).AddValue(m_warps),
+        [&]() { return RomPrepareInjectRoomData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare room data for ROM injection"));
     }
-    if (!RomPrepareInjectMiscPaletteData(rom))
+    if (!PrepareSection("misc_palettes", SectionInputs().AddEntry(m_labrynth_lit_palette).AddEntries(m_lava_palette).AddEntries(m_warp_palette),
+        [&]() { return RomPrepareInjectMiscPaletteData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare misc palette data for ROM injection"));
     }
-    if (!RomPrepareInjectBlocksetData(rom))
+    if (!PrepareSection("blocksets", SectionInputs().AddEntries(m_blocksets),
+        [&]() { return RomPrepareInjectBlocksetData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare blockset data for ROM injection"));
     }
-    if (!RomPrepareInjectAnimatedTilesetData(rom))
+    SectionInputs anim_inputs;
+    anim_inputs.AddValue(m_animated_ts);
+    for (const auto& ts : m_animated_ts)
+    {
+        anim_inputs.AddEntryData(ts.second);
+    }
+    if (!PrepareSection("animated_tilesets", std::move(anim_inputs),
+        [&]() { return RomPrepareInjectAnimatedTilesetData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare animated tileset data for ROM injection"));
     }
-    if (!RomPrepareInjectTilesetData(rom))
+    if (!PrepareSection("tilesets", SectionInputs().AddEntries(m_tilesets_by_name).AddEntries(m_animated_ts_by_name)
+        .AddEntry(m_intro_font).AddValue(m_tilesets).AddValue(m_animated_ts.size()),
+        [&]() { return RomPrepareInjectTilesetData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare tileset data for ROM injection"));
     }
-    if (!RomPrepareInjectChestData(rom))
+    if (!PrepareSection("chests", SectionInputs().AddValue(m_chests).AddValue(GetRoomCount()),
+        [&]() { return RomPrepareInjectChestData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare chest data for ROM injection"));
     }
-    if (!RomPrepareInjectDoorData(rom))
+    if (!PrepareSection("doors", SectionInputs().AddValue(m_doors).AddValue(GetRoomCount()),
+        [&]() { return RomPrepareInjectDoorData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare door data for ROM injection"));
     }
-    if (!RomPrepareInjectGfxSwapData(rom))
+    if (!PrepareSection("gfx_swaps", SectionInputs().AddValue(m_gfxswaps).AddValue(m_gfxswap_flags)
+        .AddValue(m_gfxswap_locked_door_flags).AddValue(m_gfxswap_big_tree_flags),
+        [&]() { return RomPrepareInjectGfxSwapData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare tile swap data for ROM injection"));
     }
-    if (!RomPrepareInjectMiscData(rom))
+    if (!PrepareSection("misc", SectionInputs().AddValue(m_shop_list).AddValue(m_lifestock_sold_flags)
+        .AddValue(m_big_tree_list).AddValue(m_lantern_flag_list),
+        [&]() { return RomPrepareInjectMiscData(rom); }))
     {
         throw std::runtime_error(std::string("Unable to prepare miscellaneous room data for ROM injection"));
     }
@@ -2585,7 +2611,7 @@ bool RoomData::RomPrepareInjectAnimatedTilesetData(const Rom& rom)
     ByteVectorPtr bytes = std::make_shared<ByteVector>();
     for (const auto& ts : m_animated_ts)
     {
-        bytes->push_back(ts.second->GetData()->GetBaseTileset());
+        bytes->push_back(std::as_const(*ts.second).GetData()->GetBaseTileset());
     }
     bytes->push_back(0xFF);
 
@@ -2597,12 +2623,13 @@ bool RoomData::RomPrepareInjectAnimatedTilesetData(const Rom& rom)
     int i = 1;
     for (const auto& ts : m_animated_ts)
     {
-        bytes->push_back(ts.second->GetData()->GetBaseBytes() >> 8);
-        bytes->push_back(ts.second->GetData()->GetBaseBytes() & 0xFF);
-        bytes->push_back(ts.second->GetData()->GetFrameSizeBytes() >> 8);
-        bytes->push_back(ts.second->GetData()->GetFrameSizeBytes() & 0xFF);
-        bytes->push_back(ts.second->GetData()->GetAnimationSpeed());
-        bytes->push_back(ts.second->GetData()->GetAnimationFrames());
+        const auto data = std::as_const(*ts.second).GetData();
+        bytes->push_back(data->GetBaseBytes() >> 8);
+        bytes->push_back(data->GetBaseBytes() & 0xFF);
+        bytes->push_back(data->GetFrameSizeBytes() >> 8);
+        bytes->push_back(data->GetFrameSizeBytes() & 0xFF);
+        bytes->push_back(data->GetAnimationSpeed());
+        bytes->push_back(data->GetAnimationFrames());
         auto ptr = Split<uint8_t, uint32_t>(tilesets_begin + (i * sizeof(uint32_t)));
         bytes->insert(bytes->end(), ptr.cbegin(), ptr.cend());
         i++;
@@ -0,0 +1,249 @@
+#include <landstalker/main/include/RoomRenderer.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <numeric>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include <landstalker/misc/include/TaskPool.h>
+#include <landstalker/misc/include/Utils.h>
+
+namespace
+{
+    double ElapsedMs(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+}
+
+RoomRenderer::RoomRenderer(std::shared_ptr<const GameData> gd)
+    : m_gd(std::move(gd))
+{
+}
+
+std::vector<std::shared_ptr<Palette>> RoomRenderer::Render(uint16_t room, ImageBuffer& buf) const
+{
+    const Job job = Prepare(room);
+    Draw(job, buf);
+    return job.palettes;
+}
+
+std::vector<RoomRenderer::Result> RoomRenderer::RenderAll(const filesystem::path& dir, ImageBuffer::PngCompression compression) const
+{
+    const auto& rooms = m_gd->GetRoomData()->GetRoomlist();
+    std::vector<Job> jobs;
+    std::vector<Result> results(rooms.size());
+    jobs.reserve(rooms.size());
+    for (std::size_t i = 0; i < rooms.size(); ++i)
+    {
+        results[i] = { rooms[i]->index, rooms[i]->name, dir / (rooms[i]->name + ".png"), 0.0, 0.0, false, "" };
+        jobs.push_back(Prepare(rooms[i]->index));
+    }
+    if (!dir.is_directory() && !filesystem::create_directories(dir))
+    {
+        throw std::runtime_error("Unable to create directory \"" + dir.str() + "\"");
+    }
+
+    // Each tileset's flip cache is built once up front, rather than by whichever rooms reach it first
+    std::set<std::shared_ptr<const TilesetEntry>> tileset_set;
+    for (const auto& job : jobs)
+    {
+        tileset_set.insert(job.tileset);
+    }
+    const std::vector<std::shared_ptr<const TilesetEntry>> tilesets(tileset_set.cbegin(), tileset_set.cend());
+    TaskPool::ParallelFor(tilesets.size(), [&](std::size_t i)
+        {
+            tilesets[i]->GetData()->GetFlipCache();
+        });
+
+    // Rooms sharing a tileset and blocksets are handed out together, so that each thread
+    // mostly finds the blocks it needs already composed in the shared block cache
+    std::vector<std::size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs)
+        {
+            return std::tie(jobs[lhs].tileset, jobs[lhs].blocksets) < std::tie(jobs[rhs].tileset, jobs[rhs].blocksets);
+        });
+
+    TaskPool::ParallelFor(order.size(), [&](std::size_t i)
+        {
+            const Job& job = jobs[order[i]];
+            Result& result = results[order[i]];
+            try
+            {
+                auto start = std::chrono::steady_clock::now();
+                ImageBuffer buf;
+                Draw(job, buf);
+                result.render_ms = ElapsedMs(start);
+                start = std::chrono::steady_clock::now();
+                result.success = buf.WritePNG(result.path.str(), job.palettes, true, compression);
+                result.write_ms = ElapsedMs(start);
+                if (!result.success)
+                {
+                    result.error = "Unable to write \"" + result.path.str() + "\"";
+                }
+            }
+            catch (const std::exception& e)
+            {
+                result.success = false;
+                result.error = e.what();
+            }
+        });
+    return results;
+}
+
+std::vector<std::shared_ptr<Palette>> RoomRenderer::PrepareEntityPalettes(const GameData& gd, uint16_t room,
+    const std::vector<Entity>& entities, std::vector<std::string>& errors)
+{
+    auto sd = gd.GetSpriteData();
+    // The palettes are only read, so they are copied out through the const overloads rather than
+    // taking write access, which would discard the entries' memoised bytes
+    auto palette = std::vector<std::shared_ptr<Palette>>{
+        std::make_shared<Palette>(*std::as_const(*gd.GetRoomData()->GetPaletteForRoom(room)).GetData()) };
+    palette.emplace_back();
+    palette.emplace_back(std::make_shared<Palette>(*std::as_const(*gd.GetGraphicsData()->GetPlayerPalette()).GetData()));
+    palette.emplace_back(std::make_shared<Palette>(*std::as_const(*gd.GetGraphicsData()->GetHudPalette()).GetData()));
+    std::array<int, 3> sprite_palette_alloc = { -1, -1, -1 };
+    for (const auto& entity : entities)
+    {
+        auto s_pal = sd->GetEntityPaletteIdxs(entity.GetType());
+        const uint8_t pal_slot = entity.GetPalette();
+        if (pal_slot == 1 || pal_slot == 3)
+        {
+            const int lo = s_pal.first;
+            const int hi = s_pal.second;
+            if (lo != -1)
+            {
+                if (sprite_palette_alloc[pal_slot - 1] == -1)
+                {
+                    sprite_palette_alloc[pal_slot - 1] = lo;
+                }
+                else if (sprite_palette_alloc[pal_slot - 1] != lo)
+                {
+                    errors.push_back(StrPrintf("Possible Palette Clash - Slot%d Lo orig %02X, req %02X.",
+                        pal_slot, sprite_palette_alloc[pal_slot - 1], lo));
+                }
+            }
+            if (hi != -1) // Hi Palette
+            {
+                if (pal_slot == 3)
+                {
+                    errors.push_back(StrPrintf("Possible Palette Clash - Slot%d Hi specified, req %02X.",
+                            pal_slot, hi));
+                }
+                else
+                {
+                    if (sprite_palette_alloc[pal_slot] == -1)
+                    {
+                        sprite_palette_alloc[pal_slot] = hi;
+                    }
+                    else if (sprite_palette_alloc[pal_slot] != hi)
+                    {
+                        errors.push_back(StrPrintf("Possible Palette Clash - Slot%d Hi orig %02X, req %02X.",
+                            pal_slot, sprite_palette_alloc[pal_slot], hi));
+                    }
+                }
+            }
+        }
+    }
+    palette[3] = std::make_shared<Palette>(std::vector<std::shared_ptr<Palette>>{ palette[3], sd->GetSpritePalette(sprite_palette_alloc[2], -1) });
+    palette[1] = sd->GetSpritePalette(sprite_palette_alloc[0], sprite_palette_alloc[1]);
+    return palette;
+}
+
+bool RoomRenderer::DrawsBefore(const SpriteData& sd, const Entity& lhs, const Entity& rhs)
+{
+    // Draw objects furthest away from camera first
+    auto hitbox_lhs = sd.GetEntityHitbox(lhs.GetType());
+    auto hitbox_rhs = sd.GetEntityHitbox(rhs.GetType());
+    int dist_lhs = lhs.GetX() + lhs.GetY() + hitbox_lhs.first;
+    int dist_rhs = rhs.GetX() + rhs.GetY() + hitbox_rhs.first;
+    if (dist_lhs != dist_rhs)
+    {
+        return dist_lhs < dist_rhs;
+    }
+    // Next draw left-most objects
+    int left_lhs = lhs.GetY() - hitbox_lhs.first;
+    int left_rhs = rhs.GetY() - hitbox_rhs.first;
+    if (left_lhs != left_rhs)
+    {
+        return left_lhs < left_rhs;
+    }
+    // Finally, sort by height
+    int height_lhs = lhs.GetZ() + hitbox_lhs.second;
+    int height_rhs = rhs.GetZ() + hitbox_rhs.second;
+    return height_lhs < height_rhs;
+}
+
+RoomRenderer::Job RoomRenderer::Prepare(uint16_t room) const
+{
+    auto rd = m_gd->GetRoomData();
+    auto sd = m_gd->GetSpriteData();
+    Job job;
+    job.room = room;
+    job.name = rd->GetRoom(room)->name;
+    job.map = rd->GetMapForRoom(room);
+    job.tileset = rd->GetTilesetForRoom(room);
+    for (const auto& b : rd->GetBlocksetsForRoom(room))
+    {
+        job.blocksets.push_back(b);
+    }
+    auto entities = sd->GetRoomEntities(room);
+    std::vector<std::string> errors;
+    job.palettes = PrepareEntityPalettes(*m_gd, room, entities, errors);
+    std::stable_sort(entities.begin(), entities.end(), [&](const Entity& lhs, const Entity& rhs)
+        {
+            return DrawsBefore(*sd, lhs, rhs);
+        });
+    for (const auto& entity : entities)
+    {
+        Sprite s;
+        if (sd->HasFrontAndBack(entity.GetType()))
+        {
+            const int anim = (entity.GetOrientation() == Orientation::SW || entity.GetOrientation() == Orientation::SE) ? 1 : 0;
+            s.frame = sd->GetSpriteFrame(sd->GetSpriteFromEntity(entity.GetType()), anim, 0);
+        }
+        else
+        {
+            s.frame = sd->GetDefaultEntityFrame(entity.GetType());
+        }
+        s.x = entity.GetX() + 0x080;
+        s.y = entity.GetY() - 0x080;
+        s.z = entity.GetZ();
+        if (sd->GetEntityHitbox(entity.GetType()).first >= 0x0C)
+        {
+            s.x += 0x80;
+            s.y += 0x80;
+        }
+        s.palette = entity.GetPalette();
+        s.hflip = (entity.GetOrientation() == Orientation::NW || entity.GetOrientation() == Orientation::SE);
+        if (s.frame != nullptr)
+        {
+            job.sprites.push_back(s);
+        }
+    }
+    return job;
+}
+
+void RoomRenderer::Draw(const Job& job, ImageBuffer& buf)
+{
+    auto map = job.map->GetData();
+    auto tileset = job.tileset->GetData();
+    auto blockset = std::make_shared<Blockset>();
+    for (const auto& b : job.blocksets)
+    {
+        auto blocks = b->GetData();
+        blockset->insert(blockset->end(), blocks->cbegin(), blocks->cend());
+    }
+    buf.Resize(map->GetPixelWidth(), map->GetPixelHeight());
+    buf.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, tileset, blockset);
+    buf.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset);
+    for (const auto& s : job.sprites)
+    {
+        auto xy = map->EntityPositionToPixel(s.x, s.y, s.z);
+        buf.InsertSprite(xy.x, xy.y, s.palette, *s.frame->GetData(), s.hflip);
+    }
+}
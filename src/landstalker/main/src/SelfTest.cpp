@@ -0,0 +1,308 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include <random>
+#include <utility>
+
+#include <landstalker/text/include/Charset.h>
+
+SelfTest::SelfTest(std::shared_ptr<const GameData> gd)
+    : m_gd(std::move(gd)),
+      m_checks(0),
+      m_failures(0)
+{
+}
+
+int SelfTest::Run()
+{
+    const std::vector<std::pair<std::string, void (SelfTest::*)()>> groups = {
+        {"lz77", &SelfTest::Lz77}, {"lz77-opt", &SelfTest::Lz77Optimal}, {"lz77-dec", &SelfTest::Lz77Decoder},
+        {"trace", &SelfTest::CodecTracing},
+        {"bits", &SelfTest::BitStreams}, {"map3d", &SelfTest::Tilemap3DMaps},
+        {"huff-dec", &SelfTest::HuffmanDecoding}, {"huff-enc", &SelfTest::HuffmanEncoding},
+        {"layers", &SelfTest::RoomLayers},
+        {"redraw", &SelfTest::RoomRedraw},
+        {"overlay", &SelfTest::PreviewOverlays},
+        {"png", &SelfTest::PngPresets},
+        {"tmx", &SelfTest::TmxRoundTrip},
+        {"memo", &SelfTest::EntryMemo},
+        {"inject", &SelfTest::EntryInjection},
+        {"snapshot", &SelfTest::Snapshots} };
+    int failures = 0;
+    for (const auto& group : groups)
+    {
+        m_checks = 0;
+        m_failures = 0;
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            (this->*group.second)();
+        }
+        catch (const std::exception& e)
+        {
+            Check(false, std::string("threw an exception: ") + e.what());
+        }
+        std::printf("%-10s %6d checks, %4d failed, %8.1f ms\n", group.first.c_str(), m_checks, m_failures, ElapsedMs(start));
+        failures += m_failures;
+    }
+    return failures;
+}
+
+double SelfTest::ElapsedMs(std::chrono::steady_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+void SelfTest::Check(bool condition, const std::string& description)
+{
+    ++m_checks;
+    if (!condition)
+    {
+        ++m_failures;
+        std::printf("  FAILED: %s\n", description.c_str());
+    }
+}
+
+std::vector<std::pair<std::string, Blockset>> SelfTest::GenerateBlocksets()
+{
+    std::mt19937 rng(7);
+    std::vector<std::pair<std::string, Blockset>> blocksets;
+    for (int i = 0; i < 16; ++i)
+    {
+        Blockset blockset(rng() % 256);
+        uint16_t index = static_cast<uint16_t>(rng() % 0x400);
+        for (auto& block : blockset)
+        {
+            for (std::size_t t = 0; t < MapBlock::GetBlockSize(); ++t)
+            {
+                // Mostly runs of consecutive tiles with shared attributes, as drawn by the tools
+                index = (rng() % 4 == 0) ? static_cast<uint16_t>(rng() % 0x800) : static_cast<uint16_t>((index + 1) % 0x800);
+                const uint16_t attributes = (rng() % 4 == 0) ? static_cast<uint16_t>(rng() & 0xF800) : 0;
+                block.SetTile(t, Tile(static_cast<uint16_t>(attributes | index)));
+            }
+        }
+        blocksets.push_back({ "Blockset " + std::to_string(i), std::move(blockset) });
+    }
+    return blocksets;
+}
+
+SelfTest::RoomFixture SelfTest::GenerateRoom()
+{
+    RoomFixture room;
+    std::mt19937 rng(19);
+    room.tileset = std::make_shared<Tileset>();
+    room.tileset->Resize(0x100);
+    std::vector<uint8_t> pixels(room.tileset->GetTileWidth() * room.tileset->GetTileHeight());
+    for (std::size_t i = 0; i < room.tileset->GetTileCount(); ++i)
+    {
+        // Mostly opaque, with runs of transparency as in real tiles
+        for (auto& p : pixels)
+        {
+            p = rng() % 4 == 0 ? 0 : static_cast<uint8_t>(rng() % 16);
+        }
+        room.tileset->SetTilePixels(static_cast<int>(i), ConstTilePixels(pixels.data(), pixels.size()));
+    }
+
+    rng.seed(23);
+    // Enough blocks for every block index the generated maps use
+    room.blockset = std::make_shared<Blockset>(0x400);
+    for (auto& block : *room.blockset)
+    {
+        for (std::size_t t = 0; t < MapBlock::GetBlockSize(); ++t)
+        {
+            // Random flips and priority
+            const uint16_t attributes = static_cast<uint16_t>(rng() & 0x9800);
+            block.SetTile(t, Tile(static_cast<uint16_t>(attributes | (rng() % room.tileset->GetTileCount()))));
+        }
+    }
+
+    // A distinct colour for every index, so that any difference in the pixels shows in the RGB
+    std::vector<Palette::Colour> colours;
+    for (int i = 0; i < Palette::GetSize(Palette::Type::FULL); ++i)
+    {
+        colours.emplace_back(static_cast<uint16_t>(((i & 7) << 1) | (((i >> 3) & 7) << 5) | (((i >> 6) & 7) << 9)), i % 16 == 0);
+    }
+    room.palettes.push_back(std::make_shared<Palette>("test", colours, Palette::Type::FULL));
+    return room;
+}
+
+std::vector<std::pair<std::string, Tilemap3D>> SelfTest::GenerateMaps()
+{
+    std::mt19937 rng(11);
+    std::vector<std::pair<std::string, Tilemap3D>> maps;
+    for (int i = 0; i < 60; ++i)
+    {
+        Tilemap3D map;
+        map.ResizeHeightmap(static_cast<uint8_t>(1 + rng() % 32), static_cast<uint8_t>(1 + rng() % 32));
+        map.Resize(static_cast<uint8_t>(1 + rng() % 48), static_cast<uint8_t>(1 + rng() % 48));
+        map.SetLeft(static_cast<uint8_t>(rng() % 64));
+        map.SetTop(static_cast<uint8_t>(rng() % 64));
+        // Random blocks, mostly empty space with a few blocks, and rows that repeat as in a room
+        std::vector<uint16_t> blocks(8);
+        std::generate(blocks.begin(), blocks.end(), [&]() { return static_cast<uint16_t>(rng() % 0x400); });
+        for (uint16_t j = 0; j < map.GetSize(); ++j)
+        {
+            for (auto layer : { Tilemap3D::Layer::FG, Tilemap3D::Layer::BG })
+            {
+                uint16_t block = 0;
+                switch (i % 3)
+                {
+                case 0:
+                    block = static_cast<uint16_t>(rng() % 0x400);
+                    break;
+                case 1:
+                    block = rng() % 4 == 0 ? blocks[rng() % blocks.size()] : 0;
+                    break;
+                default:
+                    block = blocks[(j % map.GetWidth()) % blocks.size()];
+                    break;
+                }
+                map.SetBlock(block, j, layer);
+            }
+        }
+        for (int y = 0; y < map.GetHeightmapHeight(); ++y)
+        {
+            for (int x = 0; x < map.GetHeightmapWidth(); ++x)
+            {
+                map.SetHeightmapCell({ x, y }, rng() % 3 == 0 ? static_cast<uint16_t>(rng()) : 0x4000);
+            }
+        }
+        maps.push_back({ "Map " + std::to_string(i), std::move(map) });
+    }
+    return maps;
+}
+
+std::vector<std::pair<std::string, std::vector<uint8_t>>> SelfTest::GenerateEncodedMaps()
+{
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> encoded;
+    for (auto& m : GenerateMaps())
+    {
+        std::vector<uint8_t> bytes(65536);
+        bytes.resize(m.second.Encode(bytes.data(), bytes.size(), Tilemap3D::Level::FAST));
+        encoded.push_back({ m.first, std::move(bytes) });
+    }
+    return encoded;
+}
+
+std::vector<std::pair<std::string, HuffmanTree::CharFrequencies>> SelfTest::GenerateHuffmanFrequencies()
+{
+    std::mt19937 rng(17);
+    std::vector<std::pair<std::string, HuffmanTree::CharFrequencies>> frequencies;
+    // 0xFF marks a branch, so is never a character
+    HuffmanTree::CharFrequencies every;
+    for (unsigned c = 0; c < 0xFF; ++c)
+    {
+        every[static_cast<uint8_t>(c)] = 1;
+    }
+    frequencies.push_back({ "One character", { { 0x55, 10 } } });
+    frequencies.push_back({ "Two characters", { { 0x00, 1 }, { 0xFE, 1000 } } });
+    frequencies.push_back({ "Every character", every });
+    // Fibonacci weights give the deepest tree for the number of characters, with codes longer than
+    // can be encoded
+    HuffmanTree::CharFrequencies fibonacci;
+    std::size_t a = 1;
+    std::size_t b = 1;
+    for (uint8_t c = 0; c < 48; ++c)
+    {
+        fibonacci[c] = a;
+        b += std::exchange(a, b);
+    }
+    frequencies.push_back({ "Fibonacci weights", fibonacci });
+    for (int i = 0; i < 60; ++i)
+    {
+        HuffmanTree::CharFrequencies random;
+        const std::size_t count = 1 + rng() % 0xFF;
+        while (random.size() < count)
+        {
+            random[static_cast<uint8_t>(rng() % 0xFF)] = 1 + rng() % 1000;
+        }
+        frequencies.push_back({ "Random weights " + std::to_string(i), std::move(random) });
+    }
+    return frequencies;
+}
+
+std::vector<LSString::StringType> SelfTest::GenerateStrings()
+{
+    std::mt19937 rng(19);
+    const LSString::StringType common = L"etaoinshrdlucmfwypvbgkqjxz";
+    const LSString::StringType other = L"ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789.,?!'-";
+    std::vector<LSString::StringType> strings = { L"" };
+    for (int i = 0; i < 200; ++i)
+    {
+        LSString::StringType s;
+        const std::size_t words = rng() % 20;
+        for (std::size_t w = 0; w < words; ++w)
+        {
+            // Earlier letters are more likely, as in text
+            const std::size_t len = 1 + rng() % 8;
+            for (std::size_t c = 0; c < len; ++c)
+            {
+                s += rng() % 8 == 0 ? other[rng() % other.size()] : common[std::min(rng() % common.size(), rng() % common.size())];
+            }
+            s += L' ';
+        }
+        strings.push_back(s);
+    }
+    return strings;
+}
+
+std::vector<SelfTest::StringCorpus> SelfTest::GetStringCorpora() const
+{
+    std::vector<StringCorpus> corpora = { { "Generated string", GenerateStrings(), RomOffsets::Region::US } };
+    if (m_gd != nullptr)
+    {
+        const auto sd = m_gd->GetStringData();
+        StringCorpus main = { "Main string", {}, sd->GetRegion() };
+        for (std::size_t i = 0; i < sd->GetMainStringCount(); ++i)
+        {
+            main.strings.push_back(sd->GetOrigMainString(i));
+        }
+        corpora.push_back(std::move(main));
+    }
+    return corpora;
+}
+
+std::vector<std::vector<uint8_t>> SelfTest::GenerateBuffers()
+{
+    std::mt19937 rng(1);
+    auto random_bytes = [&](std::size_t size, unsigned values)
+    {
+        std::vector<uint8_t> buf(size);
+        std::generate(buf.begin(), buf.end(), [&]() { return static_cast<uint8_t>(rng() % values); });
+        return buf;
+    };
+    auto repeat = [](const std::vector<uint8_t>& pattern, std::size_t size)
+    {
+        std::vector<uint8_t> buf(size);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            buf[i] = pattern[i % pattern.size()];
+        }
+        return buf;
+    };
+
+    std::vector<std::vector<uint8_t>> buffers;
+    // Every size around the minimum and maximum match lengths
+    for (std::size_t size = 0; size <= 24; ++size)
+    {
+        buffers.push_back(random_bytes(size, 4));
+    }
+    buffers.push_back(std::vector<uint8_t>(4096, 0));
+    buffers.push_back(random_bytes(5000, 256));
+    buffers.push_back(random_bytes(20000, 4));
+    // Repeats just within and just beyond the largest offset that can be encoded
+    buffers.push_back(repeat(random_bytes(4095, 256), 10000));
+    buffers.push_back(repeat(random_bytes(4100, 256), 10000));
+    // Tiles picked from a small set, as in a typical tileset
+    const auto tiles = random_bytes(16 * 32, 16);
+    std::vector<uint8_t> tileset;
+    for (int i = 0; i < 256; ++i)
+    {
+        const std::size_t tile = rng() % 16;
+        tileset.insert(tileset.end(), tiles.begin() + tile * 32, tiles.begin() + tile * 32 + 32);
+    }
+    buffers.push_back(std::move(tileset));
+    return buffers;
+}
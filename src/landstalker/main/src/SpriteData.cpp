@@ -241,8 +241,8 @@ void SetFlagsForRoom(uint16_t room, const std::vector<T>& src, std::vector<T>& d
 	}
 }
 
-SpriteData::SpriteData(const filesystem::path& asm_file)
-	: DataManager(asm_file)
+SpriteData::SpriteData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot)
+	: DataManager(asm_file, snapshot)
 {
 	if (!LoadAsmFilenames())
 	{
@@ -267,8 +267,8 @@ SpriteData::SpriteData(const filesystem::path& asm_file)
 	InitCache();
 }
 
-SpriteData::SpriteData(const Rom& rom)
-	: DataManager(rom)
+SpriteData::SpriteData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot)
+	: DataManager(rom, snapshot)
 {
 	SetDefaultFilenames();
 	if (!RomLoadSpriteFrames(rom))
@@ -440,15 +440,22 @@ bool SpriteData::HasBeenModified() const
 void SpriteData::RefreshPendingWrites(const Rom& rom)
 {
 	DataManager::RefreshPendingWrites(rom);
-	if (!RomPrepareInjectSpriteFrames(rom))
+	if (!PrepareSection("sprite_frames", SectionInputs().AddEntries(m_frames).AddValue(m_animations).AddValue(m_animation_frames).AddValue(m_sprite_volume),
+		[&]() { return RomPrepareInjectSpriteFrames(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare sprite frame data for ROM injection"));
 	}
-	if (!RomPrepareInjectSpritePalettes(rom))
+	if (!PrepareSection("sprite_palettes", SectionInputs().AddEntries(m_projectile1_palettes).AddEntries(m_projectile2_palettes)
+			.AddValue(SerialisePaletteLUT()).AddEntries(m_lo_palettes).AddEntries(m_hi_palettes),
+		[&]() { return RomPrepareInjectSpritePalettes(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare sprite palette data for ROM injection"));
 	}
-	if (!RomPrepareInjectSpriteData(rom))
+	if (!PrepareSection("sprite_data", SectionInputs().AddValue(m_room_entities).AddValue(m_item_properties).AddValue(m_sprite_animation_flags)
+			.AddValue(m_sprite_behaviour_offsets).AddValue(m_sprite_behaviours).AddValue(m_sprite_visibility_flags)
+			.AddValue(m_one_time_event_flags).AddValue(m_room_clear_flags).AddValue(m_locked_door_flags).AddValue(m_permanent_switch_flags)
+			.AddValue(m_sacred_tree_flags).AddValue(m_sprite_to_entity_lookup).AddValue(m_sprite_dimensions).AddValue(m_enemy_stats),
+		[&]() { return RomPrepareInjectSpriteData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare sprite data for ROM injection"));
 	}
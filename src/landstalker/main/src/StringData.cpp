@@ -5,9 +5,10 @@
 #include <landstalker/main/include/AsmUtils.h>
 #include <landstalker/main/include/RomLabels.h>
 #include <landstalker/misc/include/Literals.h>
+#include <landstalker/misc/include/TaskPool.h>
 
-StringData::StringData(const filesystem::path& asm_file)
-	: DataManager(asm_file), m_has_region_check(false)
+StringData::StringData(const filesystem::path& asm_file, std::shared_ptr<const AssetSnapshot> snapshot)
+	: DataManager(asm_file, snapshot), m_has_region_check(false), m_strings_generation(0), m_compressed_generation(0)
 {
 	if (!LoadAsmFilenames())
 	{
@@ -57,10 +58,12 @@ StringData::StringData(const filesystem::path& asm_file)
 	InitCache();
 }
 
-StringData::StringData(const Rom& rom)
-	: DataManager(rom),
+StringData::StringData(const Rom& rom, std::shared_ptr<const AssetSnapshot> snapshot)
+	: DataManager(rom, snapshot),
 	  m_region(rom.get_region()),
-	  m_has_region_check(m_region != RomOffsets::Region::JP && m_region != RomOffsets::Region::US_BETA)
+	  m_has_region_check(m_region != RomOffsets::Region::JP && m_region != RomOffsets::Region::US_BETA),
+	  m_strings_generation(0),
+	  m_compressed_generation(0)
 {
 	SetDefaultFilenames();
 	if (m_has_region_check)
@@ -266,36 +269,45 @@ void StringData::RefreshPendingWrites(const Rom& rom)
 	CompressStrings();
 	if (m_has_region_check)
 	{
-		if (!RomPrepareInjectSystemText(rom))
+		if (!PrepareSection("system_text", SectionInputs().AddEntries(m_fonts_by_name).AddValue(m_system_strings),
+			[&]() { return RomPrepareInjectSystemText(rom); }))
 		{
 			throw std::runtime_error(std::string("Unable to prepare system text data for ROM injection"));
 		}
 	}
-	if (!RomPrepareInjectCompressedStringData(rom))
+	if (!PrepareSection("compressed_string_data", SectionInputs().AddEntries(m_fonts_internal).AddValue(m_compressed_strings),
+		[&]() { return RomPrepareInjectCompressedStringData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare compressed strings for ROM injection"));
 	}
-	if (!RomPrepareInjectHuffmanData(rom))
+	if (!PrepareSection("huffman_data", SectionInputs().AddEntries(m_ui_tilemaps_internal).AddValue(m_huffman_offsets).AddValue(m_huffman_tables),
+		[&]() { return RomPrepareInjectHuffmanData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare Huffman data for ROM injection"));
 	}
-	if (!RomPrepareInjectStringTables(rom))
+	if (!PrepareSection("string_tables", SectionInputs().AddValue(m_save_game_locations).AddValue(m_island_map_locations).AddValue(m_character_names)
+			.AddValue(m_special_character_names).AddValue(m_default_character_name).AddValue(m_item_names).AddValue(m_menu_strings),
+		[&]() { return RomPrepareInjectStringTables(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare string tables for ROM injection"));
 	}
-	if (!RomPrepareInjectIntroStrings(rom))
+	if (!PrepareSection("intro_strings", SectionInputs().AddValue(m_intro_strings).AddValue(m_room_visit_flags),
+		[&]() { return RomPrepareInjectIntroStrings(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare intro strings for ROM injection"));
 	}
-	if (!RomPrepareInjectEndCreditStrings(rom))
+	if (!PrepareSection("end_credit_strings", SectionInputs().AddValue(m_ending_strings),
+		[&]() { return RomPrepareInjectEndCreditStrings(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare end credit strings for ROM injection"));
 	}
-	if (!RomPrepareInjectTalkSfx(rom))
+	if (!PrepareSection("talk_sfx", SectionInputs().AddValue(m_char_talk_sfx).AddValue(m_sprite_talk_sfx),
+		[&]() { return RomPrepareInjectTalkSfx(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare talk sound effects for ROM injection"));
 	}
-	if (!RomPrepareInjectScriptData(rom))
+	if (!PrepareSection("script_data", SectionInputs().AddValue(m_room_dialogue_table),
+		[&]() { return RomPrepareInjectScriptData(rom); }))
 	{
 		throw std::runtime_error(std::string("Unable to prepare script data for ROM injection"));
 	}
@@ -331,6 +343,11 @@ std::vector<std::shared_ptr<Tilemap2DEntry>> StringData::GetTextboxMaps() const
 	return result;
 }
 
+RomOffsets::Region StringData::GetRegion() const
+{
+	return m_region;
+}
+
 std::size_t StringData::GetMainStringCount() const
 {
 	return m_decompressed_strings.size();
@@ -352,12 +369,14 @@ void StringData::SetMainString(std::size_t index, const LSString::StringType& va
 {
 	assert(index < m_decompressed_strings.size());
 	m_decompressed_strings[index] = value;
+	++m_strings_generation;
 }
 
 void StringData::InsertMainString(std::size_t index, const LSString::StringType& value)
 {
 	assert(index <= m_decompressed_strings.size());
 	m_decompressed_strings.insert(m_decompressed_strings.begin() + index, value);
+	++m_strings_generation;
 }
 
 bool StringData::HasMainStringChanged(std::size_t index) const
@@ -881,6 +900,7 @@ void StringData::SetCharacterTalkSound(uint8_t character_id, uint8_t sound)
 
 void StringData::CommitAllChanges()
 {
+	CompressStrings();
 	auto pair_commit = [](const auto& e) {return e.second->Commit(); };
 	std::for_each(m_fonts_by_name.begin(), m_fonts_by_name.end(), pair_commit);
 	std::for_each(m_ui_tilemaps.begin(), m_ui_tilemaps.end(), pair_commit);
@@ -1064,23 +1084,129 @@ void StringData::InitCache()
 
 bool StringData::DecompressStrings()
 {
+	if (LoadStringsFromSnapshot())
+	{
+		return true;
+	}
 	auto huff_trees = std::make_shared<HuffmanTrees>(m_huffman_offsets.data(), m_huffman_offsets.size(), m_huffman_tables.data(), m_huffman_tables.size(), m_huffman_offsets.size() / 2);
 	const auto& charset = Charset::GetDefaultCharset(m_region);
 	auto eos_marker = Charset::GetEOSChar(m_region);
 	const auto& diacritic_map = Charset::GetDiacriticMap(m_region);
-	auto decoder = HuffmanString(huff_trees, charset, eos_marker, diacritic_map);
-	m_decompressed_strings.clear();
-	for (const auto& s : m_compressed_strings)
+	m_decompressed_strings.assign(m_compressed_strings.size(), LSString::StringType());
+	TaskPool::ParallelForRange(m_compressed_strings.size(), [&](std::size_t begin, std::size_t end)
+		{
+			auto decoder = HuffmanString(huff_trees, charset, eos_marker, diacritic_map);
+			for (std::size_t i = begin; i < end; ++i)
+			{
+				decoder.Decode(m_compressed_strings[i].data(), m_compressed_strings[i][0]);
+				m_decompressed_strings[i] = decoder.Str();
+			}
+		}, 64);
+	return true;
+}
+
+void StringData::AddToSnapshot(AssetSnapshot::Builder& builder)
+{
+	DataManager::AddToSnapshot(builder);
+	// The strings are stored as they were last loaded or saved, as 32-bit characters
+	ByteVector bytes;
+	auto put32 = [&bytes](uint32_t v)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			bytes.push_back(static_cast<uint8_t>(v >> (i * 8)));
+		}
+	};
+	put32(static_cast<uint32_t>(m_decompressed_strings_orig.size()));
+	for (const auto& str : m_decompressed_strings_orig)
+	{
+		put32(static_cast<uint32_t>(str.size()));
+		for (auto c : str)
+		{
+			put32(static_cast<uint32_t>(c));
+		}
+	}
+	const auto hash = GetStringsSnapshotHash(m_compressed_strings_orig, m_huffman_offsets_orig, m_huffman_tables_orig);
+	builder.Add("StringData:strings", std::move(bytes), hash, 0);
+}
+
+uint64_t StringData::GetStringsSnapshotHash(const std::vector<ByteVector>& compressed, const ByteVector& offsets, const ByteVector& tables) const
+{
+	const uint32_t header[3] = { static_cast<uint32_t>(m_region), static_cast<uint32_t>(offsets.size()), static_cast<uint32_t>(tables.size()) };
+	uint64_t hash = Fnv1a(reinterpret_cast<const uint8_t*>(header), sizeof(header));
+	hash = Fnv1a(offsets.data(), offsets.size(), hash);
+	hash = Fnv1a(tables.data(), tables.size(), hash);
+	for (const auto& str : compressed)
+	{
+		const uint32_t size = static_cast<uint32_t>(str.size());
+		hash = Fnv1a(reinterpret_cast<const uint8_t*>(&size), sizeof(size), hash);
+		hash = Fnv1a(str.data(), str.size(), hash);
+	}
+	return hash;
+}
+
+bool StringData::LoadStringsFromSnapshot()
+{
+	AssetSnapshot::Record record;
+	if (GetSnapshot() == nullptr || !GetSnapshot()->Find("StringData:strings", record) ||
+		record.source_hash != GetStringsSnapshotHash(m_compressed_strings, m_huffman_offsets, m_huffman_tables))
+	{
+		return false;
+	}
+	const uint8_t* p = record.data;
+	const uint8_t* const end = record.data + record.size;
+	bool ok = true;
+	auto get32 = [&]()
+	{
+		uint32_t v = 0;
+		if (end - p < 4)
+		{
+			ok = false;
+			return v;
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			v |= static_cast<uint32_t>(*p++) << (i * 8);
+		}
+		return v;
+	};
+	if (get32() != m_compressed_strings.size())
 	{
-		decoder.Decode(s.data(), s[0]);
-		m_decompressed_strings.push_back(decoder.Str());
+		return false;
+	}
+	std::vector<LSString::StringType> strings(m_compressed_strings.size());
+	for (auto& str : strings)
+	{
+		const uint32_t length = get32();
+		if (!ok || length > static_cast<std::size_t>(end - p) / 4)
+		{
+			return false;
+		}
+		str.resize(length);
+		for (auto& c : str)
+		{
+			c = static_cast<LSString::StringType::value_type>(get32());
+		}
 	}
+	m_decompressed_strings = std::move(strings);
 	return true;
 }
 
 bool StringData::CompressStrings()
 {
-	if (m_decompressed_strings_orig != m_decompressed_strings)
+	// Rebuilding the Huffman trees is expensive, so only do it after an edit
+	if (m_compressed_generation == m_strings_generation)
+	{
+		return true;
+	}
+	m_compressed_generation = m_strings_generation;
+	if (m_decompressed_strings_orig == m_decompressed_strings)
+	{
+		m_compressed_strings = m_compressed_strings_orig;
+		m_huffman_offsets = m_huffman_offsets_orig;
+		m_huffman_tables = m_huffman_tables_orig;
+	}
+	else
 	{
 		auto huff_trees = std::make_shared<HuffmanTrees>();
 		const auto& charset = Charset::GetDefaultCharset(m_region);
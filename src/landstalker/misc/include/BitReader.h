@@ -0,0 +1,122 @@
+#ifndef BITREADER_H
+#define BITREADER_H
+
+#include <cstdint>
+#include <cstdlib>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Reads a big-endian bitstream, most significant bit first. Bits are buffered
+// in a 64-bit word that is refilled a word at a time, so reading a field of up
+// to 32 bits costs a shift rather than a loop. Reading past the end of the
+// input yields zero bits and sets the overrun flag.
+class BitReader
+{
+public:
+    BitReader(const uint8_t* buf, std::size_t size);
+
+    // Returns the next numBits (0-32) bits without consuming them
+    uint32_t Peek(unsigned numBits)
+    {
+        Refill();
+        return numBits == 0 ? 0 : static_cast<uint32_t>(m_bits >> (64 - numBits));
+    }
+
+    // Skips the next numBits (0-32) bits
+    void Consume(unsigned numBits)
+    {
+        if (numBits > m_count)
+        {
+            Refill();
+            if (numBits > m_count)
+            {
+                m_overrun_bits += numBits - m_count;
+                m_bits = 0;
+                m_count = 0;
+                return;
+            }
+        }
+        m_bits <<= numBits;
+        m_count -= numBits;
+    }
+
+    uint32_t ReadBits(unsigned numBits)
+    {
+        uint32_t retval = Peek(numBits);
+        Consume(numBits);
+        return retval;
+    }
+
+    bool ReadBit()
+    {
+        return ReadBits(1) != 0;
+    }
+
+    // Number of zero bits before the next set bit, without consuming anything.
+    // Only the next 32 bits are examined: if they are all zero, returns 32.
+    unsigned CountLeadingZeros()
+    {
+        Refill();
+        return Clz32(static_cast<uint32_t>(m_bits >> 32));
+    }
+
+    void AlignToByte();
+    std::size_t GetBitPosition() const;
+    // Number of whole bytes consumed so far
+    std::size_t GetBytePosition() const;
+    bool IsOverrun() const;
+
+private:
+    void Refill()
+    {
+        if (m_count <= 56)
+        {
+            if (m_next + 8 <= m_size)
+            {
+                // Load a whole word and keep as many complete bytes as fit. Bits
+                // beyond m_count are either zero or the same data reloaded next time.
+                const uint8_t* p = m_buf + m_next;
+                uint64_t word = (static_cast<uint64_t>(p[0]) << 56) | (static_cast<uint64_t>(p[1]) << 48) |
+                                (static_cast<uint64_t>(p[2]) << 40) | (static_cast<uint64_t>(p[3]) << 32) |
+                                (static_cast<uint64_t>(p[4]) << 24) | (static_cast<uint64_t>(p[5]) << 16) |
+                                (static_cast<uint64_t>(p[6]) << 8)  |  static_cast<uint64_t>(p[7]);
+                m_bits |= word >> m_count;
+                const unsigned bytes = (63 - m_count) >> 3;
+                m_next += bytes;
+                m_count += bytes * 8;
+            }
+            else
+            {
+                RefillTail();
+            }
+        }
+    }
+
+    void RefillTail();
+
+    static unsigned Clz32(uint32_t value)
+    {
+        if (value == 0)
+        {
+            return 32;
+        }
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanReverse(&idx, value);
+        return 31 - idx;
+#else
+        return __builtin_clz(value);
+#endif
+    }
+
+    const uint8_t* m_buf;
+    std::size_t m_size;
+    std::size_t m_next;
+    uint64_t m_bits;
+    unsigned m_count;
+    std::size_t m_overrun_bits;
+};
+
+#endif // BITREADER_H
@@ -0,0 +1,53 @@
+#ifndef BITWRITER_H
+#define BITWRITER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+// Writes a big-endian bitstream, most significant bit first. Bits are gathered
+// in a 64-bit accumulator and flushed to the output buffer 32 bits at a time.
+class BitWriter
+{
+public:
+    BitWriter();
+
+    // Writes the low numBits (0-32) bits of value
+    void WriteBits(uint32_t value, unsigned numBits)
+    {
+        if (numBits == 0)
+        {
+            return;
+        }
+        m_acc = (m_acc << numBits) | (value & (0xFFFFFFFFU >> (32 - numBits)));
+        m_count += numBits;
+        if (m_count >= 32)
+        {
+            m_count -= 32;
+            const uint32_t word = static_cast<uint32_t>(m_acc >> m_count);
+            m_buffer.push_back(static_cast<uint8_t>(word >> 24));
+            m_buffer.push_back(static_cast<uint8_t>(word >> 16));
+            m_buffer.push_back(static_cast<uint8_t>(word >> 8));
+            m_buffer.push_back(static_cast<uint8_t>(word));
+        }
+    }
+
+    void WriteBit(bool value)
+    {
+        WriteBits(value ? 1 : 0, 1);
+    }
+
+    // Pads with zero bits up to the next byte boundary
+    void AlignToByte();
+    std::size_t GetBitCount() const;
+    std::size_t GetByteCount() const;
+    // The bytes written so far, with any partial final byte zero-padded
+    std::vector<uint8_t> GetBytes() const;
+
+private:
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_acc;
+    unsigned m_count;
+};
+
+#endif // BITWRITER_H
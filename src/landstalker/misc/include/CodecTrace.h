@@ -0,0 +1,83 @@
+#ifndef CODEC_TRACE_H
+#define CODEC_TRACE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Records the individual operations performed by the compression codecs into a
+// fixed-size ring buffer. Tracing is disabled by default and costs a single flag
+// test per operation while off. It can be switched on per codec at runtime,
+// either through Enable() or by listing codec names in the LS_CODEC_TRACE
+// environment variable (e.g. LS_CODEC_TRACE=lz77,tilemap3d). Events traced
+// through the environment variable are dumped to stderr when the program exits.
+class CodecTrace
+{
+public:
+    enum class Codec : uint8_t
+    {
+        LZ77,
+        TILEMAP3D,
+        SPRITE_FRAME,
+        COUNT
+    };
+
+    enum class Op : uint8_t
+    {
+        LITERAL,          // arg1: value
+        RUN,              // arg1: back offset, arg2: length
+        END,
+        OFFSET_DICT,      // arg1: offset, arg2: frequency
+        TILE_DICT,        // arg1: dictionary index, arg2: tile value
+        LOAD_TILE,
+        INCREMENT_TILE,   // arg1: dictionary index, arg2: tile value
+        PLACE_REL_TILE,   // arg1: tile value
+        PLACE_TILE,       // arg1: tile value
+        ZERO_FILL,        // arg1: word count
+        RAW_COPY,         // arg1: word count
+        COMPRESSED_BLOCK  // arg1: compressed length, arg2: decompressed length
+    };
+
+    struct Event
+    {
+        Codec codec;
+        Op op;
+        uint32_t position;
+        uint32_t arg1;
+        uint32_t arg2;
+    };
+
+    static void Enable(Codec codec, bool enabled = true);
+    static bool IsEnabled(Codec codec)
+    {
+        return (s_enabled.load(std::memory_order_relaxed) & (1U << static_cast<unsigned>(codec))) != 0;
+    }
+
+    static void Record(Codec codec, Op op, std::size_t position, uint32_t arg1 = 0, uint32_t arg2 = 0)
+    {
+        if (IsEnabled(codec))
+        {
+            Push({ codec, op, static_cast<uint32_t>(position), arg1, arg2 });
+        }
+    }
+
+    static void SetCapacity(std::size_t capacity);
+    static void Clear();
+    // Returns the buffered events, oldest first
+    static std::vector<Event> GetEvents();
+    static void Dump(std::ostream& os);
+
+    static const char* GetCodecName(Codec codec);
+    static const char* GetOpName(Op op);
+private:
+    CodecTrace();
+
+    static void Push(const Event& evt);
+
+    static std::atomic<uint32_t> s_enabled;
+};
+
+#endif // CODEC_TRACE_H
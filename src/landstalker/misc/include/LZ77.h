@@ -1,6 +1,7 @@
 #ifndef LZ77_H
 #define LZ77_H
 
+#include <atomic>
 #include <cstdlib>
 #include <cstdint>
 #include <vector>
@@ -8,10 +9,36 @@
 class LZ77
 {
 public:
-    static std::size_t Decode(const uint8_t* inbuf, std::size_t bufsize, uint8_t* outbuf, std::size_t& elen);
+    enum class Level
+    {
+        GREEDY,  // Longest match with one byte of lookahead, as the original data was compressed
+        OPTIMAL  // Minimum-size parse, slower to encode
+    };
+
+    enum class DecodeResult
+    {
+        OK,
+        MISSING_END_MARKER,  // Input ended between two commands, without an end marker
+        TRUNCATED_INPUT,     // Input ended part way through a command
+        OUTPUT_OVERFLOW,     // Decompressed data would not fit in the output buffer
+        INVALID_OFFSET       // Back-reference points before the start of the output
+    };
+
+    // Decompresses at most outcap bytes into outbuf. On return, elen holds the number of
+    // compressed bytes consumed and dlen the number of bytes written, even on failure. Data
+    // that ends without an end marker decodes as MISSING_END_MARKER, which callers that have
+    // always accepted such data treat the same as OK.
+    static DecodeResult Decode(const uint8_t* inbuf, std::size_t bufsize, uint8_t* outbuf, std::size_t outcap, std::size_t& elen, std::size_t& dlen);
     static std::size_t Encode(const uint8_t* inbuf, std::size_t bufsize, uint8_t* outbuf);
+    static std::size_t Encode(const uint8_t* inbuf, std::size_t bufsize, uint8_t* outbuf, Level level);
+
+    static void SetDefaultLevel(Level level);
+    static Level GetDefaultLevel();
 private:
     LZ77();
+
+    // Set from the UI thread while encoders may be running on the task pool
+    static std::atomic<int> s_default_level;
 };
 
 #endif // LZ77_H
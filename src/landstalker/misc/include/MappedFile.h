@@ -0,0 +1,40 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Read-only view of a file's contents. On POSIX systems the file can be memory-mapped
+// privately, so pages are only read from disk when touched and are shared between
+// processes. Elsewhere, or when a copy is asked for, the file is read into memory.
+class MappedFile
+{
+public:
+    enum class Access
+    {
+        MAP,  // Only for files that are replaced rather than rewritten in place while open
+        COPY  // Unaffected by other programs rewriting or truncating the file
+    };
+
+    explicit MappedFile(const std::string& filename, Access access = Access::MAP);
+    // Wraps an in-memory buffer, for images that do not come from a file
+    explicit MappedFile(std::vector<uint8_t> bytes);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const uint8_t* data() const;
+    std::size_t size() const;
+
+private:
+    void ReadFile(const std::string& filename);
+
+    std::vector<uint8_t> m_buffer;
+    const uint8_t* m_data;
+    std::size_t m_size;
+    bool m_mapped;
+};
+
+#endif // MAPPEDFILE_H
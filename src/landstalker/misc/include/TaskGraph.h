@@ -0,0 +1,78 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <landstalker/misc/include/TaskPool.h>
+
+// A set of named tasks with explicit dependencies, run on a TaskPool. Each task
+// is started as soon as everything it depends on has finished, and the start and
+// finish time of every task is recorded so that the critical path through the
+// graph can be reported.
+class TaskGraph
+{
+public:
+    using Task = TaskPool::Task;
+    using Node = std::size_t;
+
+    struct Timing
+    {
+        std::string name;
+        double start_ms;
+        double duration_ms;
+        // On the chain of dependencies that determined when the graph finished
+        bool critical;
+        bool skipped;
+    };
+
+    explicit TaskGraph(TaskPool& pool = TaskPool::Global());
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    // Dependencies must have been added first, so a graph can never contain a cycle
+    Node Add(const std::string& name, Task task, const std::vector<Node>& dependencies = {});
+
+    // Tasks that depend on a failed task are skipped. Once every task has finished or been
+    // skipped, the exception of the earliest-added task that failed is rethrown.
+    void Run();
+
+    // Timings of the last run, in the order the tasks were added
+    std::vector<Timing> GetTimings() const;
+    double GetElapsedMs() const;
+    std::string FormatTimings() const;
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct NodeState
+    {
+        std::string name;
+        Task task;
+        std::vector<Node> dependencies;
+        std::vector<Node> dependents;
+        std::atomic<std::size_t> waiting;
+        std::exception_ptr error;
+        bool skipped;
+        Clock::time_point start;
+        Clock::time_point finish;
+    };
+
+    void Submit(Node node);
+    void Execute(Node node);
+
+    TaskPool& m_pool;
+    TaskPool::TaskGroup* m_group;
+    // Single threaded groups run tasks inline, so a task may submit its dependents from within Submit()
+    std::recursive_mutex m_submit_mutex;
+    std::vector<std::unique_ptr<NodeState>> m_nodes;
+    Clock::time_point m_start;
+    Clock::time_point m_finish;
+};
+
+#endif // TASK_GRAPH_H
@@ -0,0 +1,140 @@
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads, each with its own task queue. Idle workers
+// steal from the front of other queues, and a thread waiting on a TaskGroup
+// runs queued tasks rather than blocking, so groups may be nested freely.
+//
+// All tasks can be forced to run inline on the submitting thread, in
+// submission order, through SetSingleThreaded() or by setting the
+// LS_THREADS environment variable to 1. LS_THREADS=N otherwise sets the number
+// of threads, including the caller, used by the global pool.
+class TaskPool
+{
+public:
+    using Task = std::function<void()>;
+
+    // Tasks submitted through a group are waited on together. Wait() rethrows
+    // the exception of the earliest-submitted task that failed, so a failing
+    // load reports the same error however the tasks were scheduled.
+    class TaskGroup
+    {
+    public:
+        explicit TaskGroup(TaskPool& pool = TaskPool::Global());
+        ~TaskGroup();
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        void Run(Task task);
+        void Wait();
+    private:
+        friend class TaskPool;
+        void Complete(std::size_t index, std::exception_ptr error);
+
+        TaskPool& m_pool;
+        std::size_t m_submitted;
+        std::atomic<std::size_t> m_remaining;
+        std::mutex m_mutex;
+        std::condition_variable m_done;
+        std::size_t m_error_index;
+        std::exception_ptr m_error;
+    };
+
+    // One worker per hardware thread, less the caller
+    static constexpr unsigned AUTO_THREADS = ~0U;
+
+    // threads is the number of workers besides the caller. With none, tasks run inline on the
+    // thread that submits them.
+    explicit TaskPool(unsigned threads = AUTO_THREADS);
+    ~TaskPool();
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    static TaskPool& Global();
+    static void SetSingleThreaded(bool single_threaded);
+    static bool IsSingleThreaded();
+
+    unsigned GetThreadCount() const;
+
+    // Splits [0, count) into contiguous chunks of at least grain indices and
+    // calls fn(begin, end) for each. Results are deterministic as long as each
+    // call only writes to storage owned by its own indices.
+    template<class Fn>
+    static void ParallelForRange(std::size_t count, Fn fn, std::size_t grain = 1)
+    {
+        TaskPool& pool = Global();
+        const std::size_t chunks = std::min(count / std::max<std::size_t>(grain, 1), static_cast<std::size_t>(pool.GetThreadCount() + 1) * 4);
+        if (chunks <= 1 || IsSingleThreaded() || pool.GetThreadCount() == 0)
+        {
+            if (count > 0)
+            {
+                fn(std::size_t(0), count);
+            }
+            return;
+        }
+        TaskGroup group(pool);
+        for (std::size_t c = 0; c < chunks; ++c)
+        {
+            const std::size_t begin = count * c / chunks;
+            const std::size_t end = count * (c + 1) / chunks;
+            group.Run([&fn, begin, end]() { fn(begin, end); });
+        }
+        group.Wait();
+    }
+
+    // Calls fn(i) for every i in [0, count)
+    template<class Fn>
+    static void ParallelFor(std::size_t count, Fn fn, std::size_t grain = 1)
+    {
+        ParallelForRange(count, [&fn](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    fn(i);
+                }
+            }, grain);
+    }
+
+private:
+    struct Job
+    {
+        Task task;
+        TaskGroup* group;
+        std::size_t index;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void Push(Job job);
+    bool TryRunOne();
+    void WorkerLoop(unsigned index);
+    static void Execute(Job& job);
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_next_queue;
+    std::atomic<std::size_t> m_queued;
+    std::mutex m_wake_mutex;
+    std::condition_variable m_wake;
+    bool m_stop;
+
+    static std::atomic<bool> s_single_threaded;
+};
+
+#endif // TASK_POOL_H
@@ -96,6 +96,9 @@ bool CreateDirectoryTree(const filesystem::path& path);
 
 bool StrToInt(const std::string& s, uint32_t& val);
 
+// 64-bit FNV-1a. Pass the previous result as the seed to hash data that is split into pieces.
+uint64_t Fnv1a(const uint8_t* data, std::size_t size, uint64_t seed = 0xCBF29CE484222325ULL);
+
 template<class T, class U>
 std::vector<T> Split(U data)
 {
@@ -0,0 +1,40 @@
+#include <landstalker/misc/include/BitReader.h>
+
+BitReader::BitReader(const uint8_t* buf, std::size_t size)
+    : m_buf(buf),
+      m_size(buf == nullptr ? 0 : size),
+      m_next(0),
+      m_bits(0),
+      m_count(0),
+      m_overrun_bits(0)
+{
+}
+
+void BitReader::RefillTail()
+{
+    while (m_count <= 56 && m_next < m_size)
+    {
+        m_bits |= static_cast<uint64_t>(m_buf[m_next++]) << (56 - m_count);
+        m_count += 8;
+    }
+}
+
+void BitReader::AlignToByte()
+{
+    Consume(static_cast<unsigned>((8 - GetBitPosition() % 8) % 8));
+}
+
+std::size_t BitReader::GetBitPosition() const
+{
+    return m_next * 8 - m_count + m_overrun_bits;
+}
+
+std::size_t BitReader::GetBytePosition() const
+{
+    return GetBitPosition() / 8;
+}
+
+bool BitReader::IsOverrun() const
+{
+    return m_overrun_bits > 0;
+}
@@ -0,0 +1,86 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <random>
+
+#include <landstalker/misc/include/BitBarrel.h>
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/misc/include/BitWriter.h>
+#include <landstalker/blockset/include/BlocksetCmp.h>
+
+void SelfTest::BitStreams()
+{
+    std::mt19937 rng(5);
+    for (int run = 0; run < 200; ++run)
+    {
+        const std::string name = "Bitstream " + std::to_string(run);
+        std::vector<std::pair<uint32_t, unsigned>> fields(rng() % 256);
+        BitWriter writer;
+        std::size_t bits = 0;
+        for (auto& f : fields)
+        {
+            f.second = rng() % 33;
+            f.first = f.second == 0 ? 0 : static_cast<uint32_t>(rng()) >> (32 - f.second);
+            writer.WriteBits(f.first, f.second);
+            bits += f.second;
+        }
+        const auto bytes = writer.GetBytes();
+        Check(writer.GetBitCount() == bits && bytes.size() == (bits + 7) / 8, name + ": wrong length written");
+
+        // The bit-at-a-time reader is the reference for the bit order
+        std::vector<uint8_t> padded(bytes);
+        padded.resize(bytes.size() + 8, 0);
+        BitBarrel barrel(padded.data());
+        BitReader reader(bytes.data(), bytes.size());
+        bool match = true;
+        for (const auto& f : fields)
+        {
+            unsigned width = 0;
+            for (uint32_t v = f.first; v != 0; v >>= 1)
+            {
+                ++width;
+            }
+            const unsigned zeros = reader.CountLeadingZeros();
+            const uint32_t peeked = reader.Peek(f.second);
+            const uint32_t value = reader.ReadBits(f.second);
+            match = match && peeked == value && value == f.first && barrel.readBits(f.second) == f.first &&
+                (f.first == 0 || zeros == f.second - width);
+        }
+        Check(match, name + ": fields read back differently");
+        Check(!reader.IsOverrun() && reader.GetBitPosition() == bits, name + ": wrong position after reading");
+        // Only the zero padding of the final byte remains, and reading past it is reported
+        Check(reader.ReadBits(32) == 0 && reader.IsOverrun(), name + ": reading past the end was not reported");
+    }
+
+    BitWriter writer;
+    writer.WriteBits(5, 3);
+    writer.AlignToByte();
+    writer.WriteBits(0xC3, 8);
+    const auto bytes = writer.GetBytes();
+    BitReader reader(bytes.data(), bytes.size());
+    const uint32_t first = reader.ReadBits(3);
+    reader.AlignToByte();
+    Check(bytes == std::vector<uint8_t>{ 0xA0, 0xC3 } && first == 5 && reader.GetBytePosition() == 1 && reader.ReadBits(8) == 0xC3,
+        "Fields were not aligned to a byte");
+
+    // The codecs ported to the reader and writer
+    auto blocksets = GenerateBlocksets();
+    if (m_gd != nullptr)
+    {
+        for (const auto& b : m_gd->GetRoomData()->GetAllBlocksets())
+        {
+            std::shared_ptr<const BlocksetEntry> entry = b.second;
+            const auto bytes = entry->GetOrigBytes();
+            Blockset blockset;
+            BlocksetCmp::Decode(bytes->data(), bytes->size(), blockset);
+            blocksets.push_back({ b.first, std::move(blockset) });
+        }
+    }
+    for (const auto& b : blocksets)
+    {
+        std::vector<uint8_t> encoded(65536);
+        encoded.resize(BlocksetCmp::Encode(b.second, encoded.data(), encoded.size()));
+        Blockset decoded;
+        const auto len = BlocksetCmp::Decode(encoded.data(), encoded.size(), decoded);
+        Check(len == encoded.size() && decoded == b.second, b.first + " did not survive the blockset round trip");
+    }
+}
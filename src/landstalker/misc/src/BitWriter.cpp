@@ -0,0 +1,35 @@
+#include <landstalker/misc/include/BitWriter.h>
+
+BitWriter::BitWriter()
+    : m_acc(0),
+      m_count(0)
+{
+}
+
+void BitWriter::AlignToByte()
+{
+    WriteBits(0, (8 - m_count % 8) % 8);
+}
+
+std::size_t BitWriter::GetBitCount() const
+{
+    return m_buffer.size() * 8 + m_count;
+}
+
+std::size_t BitWriter::GetByteCount() const
+{
+    return m_buffer.size() + (m_count + 7) / 8;
+}
+
+std::vector<uint8_t> BitWriter::GetBytes() const
+{
+    std::vector<uint8_t> ret;
+    ret.reserve(GetByteCount());
+    ret.assign(m_buffer.begin(), m_buffer.end());
+    const uint64_t tail = m_acc << ((8 - m_count % 8) % 8);
+    for (unsigned bits = (m_count + 7) / 8 * 8; bits > 0; bits -= 8)
+    {
+        ret.push_back(static_cast<uint8_t>(tail >> (bits - 8)));
+    }
+    return ret;
+}
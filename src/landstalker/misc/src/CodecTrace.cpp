@@ -0,0 +1,197 @@
+#include <landstalker/misc/include/CodecTrace.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+namespace
+{
+    const std::size_t DEFAULT_CAPACITY = 65536;
+
+    struct RingBuffer
+    {
+        std::mutex mutex;
+        std::vector<CodecTrace::Event> events;
+        std::size_t capacity = DEFAULT_CAPACITY;
+        std::size_t next = 0;
+    };
+
+    RingBuffer& GetRingBuffer()
+    {
+        static RingBuffer buffer;
+        return buffer;
+    }
+
+    void DumpAtExit()
+    {
+        CodecTrace::Dump(std::cerr);
+    }
+
+    uint32_t ReadEnvironment()
+    {
+        uint32_t enabled = 0;
+        const char* env = std::getenv("LS_CODEC_TRACE");
+        if (env != nullptr)
+        {
+            std::istringstream ss(env);
+            std::string name;
+            while (std::getline(ss, name, ','))
+            {
+                std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+                for (unsigned i = 0; i < static_cast<unsigned>(CodecTrace::Codec::COUNT); ++i)
+                {
+                    if (name == "ALL" || name == CodecTrace::GetCodecName(static_cast<CodecTrace::Codec>(i)))
+                    {
+                        enabled |= 1U << i;
+                    }
+                }
+            }
+        }
+        if (enabled != 0)
+        {
+            // The buffer is created first so that it is destroyed after the dump has run
+            GetRingBuffer();
+            std::atexit(DumpAtExit);
+        }
+        return enabled;
+    }
+}
+
+std::atomic<uint32_t> CodecTrace::s_enabled(ReadEnvironment());
+
+void CodecTrace::Enable(Codec codec, bool enabled)
+{
+    const uint32_t mask = 1U << static_cast<unsigned>(codec);
+    if (enabled)
+    {
+        s_enabled.fetch_or(mask);
+    }
+    else
+    {
+        s_enabled.fetch_and(~mask);
+    }
+}
+
+void CodecTrace::SetCapacity(std::size_t capacity)
+{
+    auto& rb = GetRingBuffer();
+    std::lock_guard<std::mutex> lock(rb.mutex);
+    rb.capacity = std::max<std::size_t>(capacity, 1);
+    rb.events.clear();
+    rb.next = 0;
+}
+
+void CodecTrace::Clear()
+{
+    auto& rb = GetRingBuffer();
+    std::lock_guard<std::mutex> lock(rb.mutex);
+    rb.events.clear();
+    rb.next = 0;
+}
+
+std::vector<CodecTrace::Event> CodecTrace::GetEvents()
+{
+    auto& rb = GetRingBuffer();
+    std::lock_guard<std::mutex> lock(rb.mutex);
+    std::vector<Event> ret;
+    ret.reserve(rb.events.size());
+    ret.insert(ret.end(), rb.events.begin() + rb.next, rb.events.end());
+    ret.insert(ret.end(), rb.events.begin(), rb.events.begin() + rb.next);
+    return ret;
+}
+
+void CodecTrace::Dump(std::ostream& os)
+{
+    for (const auto& evt : GetEvents())
+    {
+        os << GetCodecName(evt.codec) << " @" << evt.position << " " << GetOpName(evt.op);
+        switch (evt.op)
+        {
+        case Op::LITERAL:
+        case Op::PLACE_REL_TILE:
+        case Op::PLACE_TILE:
+        case Op::ZERO_FILL:
+        case Op::RAW_COPY:
+            os << " " << evt.arg1;
+            break;
+        case Op::RUN:
+        case Op::OFFSET_DICT:
+        case Op::TILE_DICT:
+        case Op::INCREMENT_TILE:
+        case Op::COMPRESSED_BLOCK:
+            os << " " << evt.arg1 << "," << evt.arg2;
+            break;
+        default:
+            break;
+        }
+        os << "\n";
+    }
+    os.flush();
+}
+
+const char* CodecTrace::GetCodecName(Codec codec)
+{
+    switch (codec)
+    {
+    case Codec::LZ77:
+        return "LZ77";
+    case Codec::TILEMAP3D:
+        return "TILEMAP3D";
+    case Codec::SPRITE_FRAME:
+        return "SPRITE_FRAME";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+const char* CodecTrace::GetOpName(Op op)
+{
+    switch (op)
+    {
+    case Op::LITERAL:
+        return "LITERAL";
+    case Op::RUN:
+        return "RUN";
+    case Op::END:
+        return "END";
+    case Op::OFFSET_DICT:
+        return "OFFSET_DICT";
+    case Op::TILE_DICT:
+        return "TILE_DICT";
+    case Op::LOAD_TILE:
+        return "LOAD_TILE";
+    case Op::INCREMENT_TILE:
+        return "INCREMENT_TILE";
+    case Op::PLACE_REL_TILE:
+        return "PLACE_REL_TILE";
+    case Op::PLACE_TILE:
+        return "PLACE_TILE";
+    case Op::ZERO_FILL:
+        return "ZERO_FILL";
+    case Op::RAW_COPY:
+        return "RAW_COPY";
+    case Op::COMPRESSED_BLOCK:
+        return "COMPRESSED_BLOCK";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+void CodecTrace::Push(const Event& evt)
+{
+    auto& rb = GetRingBuffer();
+    std::lock_guard<std::mutex> lock(rb.mutex);
+    if (rb.events.size() < rb.capacity)
+    {
+        rb.events.push_back(evt);
+        rb.next = rb.events.size() % rb.capacity;
+    }
+    else
+    {
+        rb.events[rb.next] = evt;
+        rb.next = (rb.next + 1) % rb.capacity;
+    }
+}
@@ -0,0 +1,71 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <sstream>
+
+#include <landstalker/misc/include/CodecTrace.h>
+#include <landstalker/misc/include/LZ77.h>
+
+namespace
+{
+    bool SameEvents(const std::vector<CodecTrace::Event>& lhs, const std::vector<CodecTrace::Event>& rhs)
+    {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const auto& l, const auto& r)
+            {
+                return l.codec == r.codec && l.op == r.op && l.position == r.position && l.arg1 == r.arg1 && l.arg2 == r.arg2;
+            });
+    }
+}
+
+void SelfTest::CodecTracing()
+{
+    // Three literals and a run that repeats them, both ways through the codec
+    const std::vector<uint8_t> in = { 'A', 'B', 'C', 'A', 'B', 'C', 'A', 'B', 'C', 'A', 'B', 'C' };
+    const std::vector<CodecTrace::Event> expected = {
+        { CodecTrace::Codec::LZ77, CodecTrace::Op::LITERAL, 0, 'A', 0 },
+        { CodecTrace::Codec::LZ77, CodecTrace::Op::LITERAL, 1, 'B', 0 },
+        { CodecTrace::Codec::LZ77, CodecTrace::Op::LITERAL, 2, 'C', 0 },
+        { CodecTrace::Codec::LZ77, CodecTrace::Op::RUN, 3, 3, 9 },
+        { CodecTrace::Codec::LZ77, CodecTrace::Op::END, 12, 0, 0 } };
+    // Tracing may have been switched on through the environment, so is put back as it was
+    const bool lz77_enabled = CodecTrace::IsEnabled(CodecTrace::Codec::LZ77);
+    const bool map_enabled = CodecTrace::IsEnabled(CodecTrace::Codec::TILEMAP3D);
+    std::vector<uint8_t> encoded(in.size() * 2 + 16);
+    std::vector<uint8_t> decoded(in.size());
+    std::size_t elen = 0;
+    std::size_t dlen = 0;
+
+    CodecTrace::Enable(CodecTrace::Codec::LZ77);
+    CodecTrace::Clear();
+    encoded.resize(LZ77::Encode(in.data(), in.size(), encoded.data(), LZ77::Level::GREEDY));
+    Check(SameEvents(CodecTrace::GetEvents(), expected), "encoding did not trace its literals, run and end marker");
+    CodecTrace::Clear();
+    LZ77::Decode(encoded.data(), encoded.size(), decoded.data(), decoded.size(), elen, dlen);
+    Check(SameEvents(CodecTrace::GetEvents(), expected), "decoding did not trace its literals, run and end marker");
+    std::ostringstream ss;
+    CodecTrace::Dump(ss);
+    Check(ss.str().find("LZ77 @3 RUN 3,9\n") != std::string::npos, "the dump does not list the run");
+
+    // Switched off, the codecs record nothing
+    CodecTrace::Enable(CodecTrace::Codec::LZ77, false);
+    CodecTrace::Clear();
+    LZ77::Encode(in.data(), in.size(), encoded.data(), LZ77::Level::GREEDY);
+    LZ77::Decode(encoded.data(), encoded.size(), decoded.data(), decoded.size(), elen, dlen);
+    Check(CodecTrace::GetEvents().empty(), "events were recorded with tracing off");
+
+    // Every map encoding traces its dictionaries
+    auto maps = GenerateMaps();
+    auto& map = maps.front().second;
+    CodecTrace::Enable(CodecTrace::Codec::TILEMAP3D);
+    CodecTrace::Clear();
+    std::vector<uint8_t> map_bytes(65536);
+    map.Encode(map_bytes.data(), map_bytes.size(), Tilemap3D::Level::FAST);
+    const auto events = CodecTrace::GetEvents();
+    Check(std::count_if(events.begin(), events.end(), [](const auto& e) { return e.op == CodecTrace::Op::TILE_DICT; }) == 2 &&
+        std::all_of(events.begin(), events.end(), [](const auto& e) { return e.codec == CodecTrace::Codec::TILEMAP3D; }),
+        "encoding a map did not trace its tile dictionary");
+
+    CodecTrace::Enable(CodecTrace::Codec::LZ77, lz77_enabled);
+    CodecTrace::Enable(CodecTrace::Codec::TILEMAP3D, map_enabled);
+    CodecTrace::Clear();
+}
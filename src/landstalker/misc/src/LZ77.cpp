@@ -4,72 +4,136 @@
 #include <sstream>
 #include <algorithm>
 #include <cassert>
-#include <iostream>
-#include <iomanip>
 
 #include <landstalker/misc/include/BitBarrel.h>
+#include <landstalker/misc/include/CodecTrace.h>
 
-size_t LZ77::Decode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf, size_t& esize)
+static const uint8_t LEN_MAX_LIMIT = 18;
+static const uint8_t LEN_MIN_LIMIT = 3;
+static const uint16_t MAX_OFFSET = 4095;
+
+static inline void copy_run(uint8_t* out, uint16_t offset, uint8_t length)
 {
-    size_t dsize = 0;
-    const uint8_t* inbufptr = inbuf;
-    BitBarrel cmd;
-    int a = 0;
-    
-    while(static_cast<size_t>(inbufptr - inbuf) < bufsize)
-    {
-        if(cmd.empty())
+    const uint8_t* src = out - offset;
+    if (offset >= length)
+    {
+        std::memcpy(out, src, length);
+    }
+    else
+    {
+        // Overlapping runs repeat the last few bytes written, so must go byte by byte
+        for (uint8_t i = 0; i < length; ++i)
         {
-            cmd.newByte(*inbufptr++);
+            out[i] = src[i];
         }
-        if(cmd)
+    }
+}
+
+// Decodes the eight commands following one control byte. When CHECKED is false,
+// the caller guarantees that the input and output can hold the largest
+// possible group, so only the back-reference offsets need validating.
+template <bool CHECKED>
+static inline LZ77::DecodeResult decode_group(uint8_t ctrl, const uint8_t*& in, const uint8_t* in_end,
+                                              uint8_t*& out, const uint8_t* outbuf, const uint8_t* out_end, bool trace, bool& done)
+{
+    for (int bit = 0; bit < 8; ++bit, ctrl <<= 1)
+    {
+        if (ctrl & 0x80)
         {
-            *outbuf++ = *inbufptr++;
-            dsize++;
-            a++;
+            if (CHECKED && in == in_end)
+            {
+                return LZ77::DecodeResult::MISSING_END_MARKER;
+            }
+            if (CHECKED && out == out_end)
+            {
+                return LZ77::DecodeResult::OUTPUT_OVERFLOW;
+            }
+            if (trace)
+            {
+                CodecTrace::Record(CodecTrace::Codec::LZ77, CodecTrace::Op::LITERAL, out - outbuf, *in);
+            }
+            *out++ = *in++;
         }
         else
         {
-            uint16_t offset = (*inbufptr & 0xF0) << 4 | *(inbufptr + 1);
-            uint8_t length = 18 - (*inbufptr & 0x0F);
-            inbufptr += 2;
-#ifndef NDEBUG
-            if (a)
+            if (CHECKED && in == in_end)
+            {
+                return LZ77::DecodeResult::MISSING_END_MARKER;
+            }
+            if (CHECKED && in_end - in < 2)
             {
-                std::cout << "C[" << a << "]; ";
-                for (int z = a; z > 0; --z)
-                    std::cout << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << (int)*(outbuf - z) << std::dec;
-                std::cout << std::endl;
-                a = 0;
+                return LZ77::DecodeResult::TRUNCATED_INPUT;
             }
-#endif
-            if(offset)
+            const uint16_t offset = (in[0] & 0xF0) << 4 | in[1];
+            const uint8_t length = 18 - (in[0] & 0x0F);
+            in += 2;
+            if (offset == 0)
             {
-                dsize += length;
-                for(; length != 0; --length)
+                if (trace)
                 {
-                    *outbuf = *(outbuf - offset);
-                    outbuf++;
+                    CodecTrace::Record(CodecTrace::Codec::LZ77, CodecTrace::Op::END, out - outbuf);
                 }
-#ifndef NDEBUG
-                int l = length;
-                std::cout << "O[" << offset << "," << (int)l << "]; ";
-                for (int z = l; z > 0; --z)
-                    std::cout << std::hex << std::setw(2) << std::setfill('0') << std::uppercase << (int)*(outbuf - offset - z) << std::dec;
-                std::cout << std::endl;
-#endif
+                done = true;
+                return LZ77::DecodeResult::OK;
             }
-            else
+            if (offset > out - outbuf)
             {
-#ifndef NDEBUG
-                std::cout << "END;" << std::endl;
-#endif
-                break;
+                return LZ77::DecodeResult::INVALID_OFFSET;
             }
+            if (CHECKED && out_end - out < length)
+            {
+                return LZ77::DecodeResult::OUTPUT_OVERFLOW;
+            }
+            if (trace)
+            {
+                CodecTrace::Record(CodecTrace::Codec::LZ77, CodecTrace::Op::RUN, out - outbuf, offset, length);
+            }
+            copy_run(out, offset, length);
+            out += length;
         }
     }
-    esize = inbufptr - inbuf;
-    return dsize;
+    return LZ77::DecodeResult::OK;
+}
+
+LZ77::DecodeResult LZ77::Decode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf, size_t outcap, size_t& elen, size_t& dlen)
+{
+    // The most one control byte can cover: eight runs, each two bytes in and up to 18 bytes out.
+    const size_t MAX_GROUP_IN = 8 * 2;
+    const size_t MAX_GROUP_OUT = 8 * LEN_MAX_LIMIT;
+    const uint8_t* in = inbuf;
+    const uint8_t* const in_end = inbuf + bufsize;
+    uint8_t* out = outbuf;
+    const uint8_t* const out_end = outbuf + outcap;
+    DecodeResult result = DecodeResult::MISSING_END_MARKER;
+    const bool trace = CodecTrace::IsEnabled(CodecTrace::Codec::LZ77);
+    bool done = false;
+
+    while (!done && in < in_end)
+    {
+        const uint8_t ctrl = *in++;
+        const bool group_fits = static_cast<size_t>(in_end - in) >= MAX_GROUP_IN && static_cast<size_t>(out_end - out) >= MAX_GROUP_OUT;
+        if (group_fits && ctrl == 0xFF && !trace)
+        {
+            std::memcpy(out, in, 8);
+            in += 8;
+            out += 8;
+            continue;
+        }
+        result = group_fits ? decode_group<false>(ctrl, in, in_end, out, outbuf, out_end, trace, done)
+                            : decode_group<true>(ctrl, in, in_end, out, outbuf, out_end, trace, done);
+        if (result != DecodeResult::OK)
+        {
+            break;
+        }
+    }
+    if (result == DecodeResult::OK && !done)
+    {
+        // Ran out of input at the end of a group, before reaching the end marker
+        result = DecodeResult::MISSING_END_MARKER;
+    }
+    elen = in - inbuf;
+    dlen = out - outbuf;
+    return result;
 }
 
 struct Entry
@@ -82,69 +146,100 @@ struct Entry
     {}
 };
 
-static uint8_t find_best_match(const uint8_t* inbuf, size_t bufsize, size_t curpos, uint16_t& offset)
+// Indexes every position of the input by a hash of the three bytes that start
+// there. Each chain links positions with the same hash, most recent first, so
+// candidates are visited nearest-first and the first longest match found is the
+// same one a full backward scan of the window would pick.
+namespace
 {
-    const uint8_t LEN_MAX_LIMIT = 18;
-    const uint8_t LEN_MIN_LIMIT = 3;
-    const uint16_t MAX_OFFSET = 4095;
-    uint8_t best_len = 0;
-    if((inbuf != NULL) && (bufsize > 3) && (curpos > 0))
-    {
-        const uint16_t END_SEARCH = (curpos > MAX_OFFSET) ? static_cast<uint16_t>(curpos - MAX_OFFSET) : 0;
-        const uint8_t MAX_LEN = static_cast<uint8_t>(std::min(static_cast<size_t>(LEN_MAX_LIMIT), bufsize - curpos));
-        uint8_t len = 0;
-        if(MAX_LEN < LEN_MAX_LIMIT)
-        {
-            len = 1;
-        }
-        if(MAX_LEN >= LEN_MIN_LIMIT)
+class MatchFinder
+{
+public:
+    MatchFinder(const uint8_t* inbuf, size_t bufsize)
+    : m_buf(inbuf),
+      m_size(bufsize),
+      m_head(HASH_SIZE, NO_POS),
+      m_prev(bufsize, NO_POS),
+      m_next_insert(0)
+    {
+    }
+
+    uint8_t FindBestMatch(size_t curpos, uint16_t& offset)
+    {
+        uint8_t best_len = 0;
+        if ((m_buf != nullptr) && (m_size > 3) && (curpos > 0))
         {
-            for(size_t i = curpos; i > END_SEARCH; --i)
+            const uint8_t MAX_LEN = static_cast<uint8_t>(std::min(static_cast<size_t>(LEN_MAX_LIMIT), m_size - curpos));
+            if (MAX_LEN < LEN_MIN_LIMIT)
+            {
+                return 1;
+            }
+            InsertUpTo(curpos);
+            const size_t END_SEARCH = (curpos > MAX_OFFSET) ? curpos - MAX_OFFSET : 0;
+            for (uint32_t pos = m_head[Hash(curpos)]; pos != NO_POS && pos >= END_SEARCH; pos = m_prev[pos])
             {
-                len = 0;
-                while(inbuf[len + i - 1] == inbuf[curpos + len])
+                uint8_t len = 0;
+                while (len < MAX_LEN && m_buf[pos + len] == m_buf[curpos + len])
                 {
                     len++;
-                    if(len == MAX_LEN)
-                    {
-                        break;
-                    }
                 }
-                if(len > best_len)
+                if (len > best_len)
                 {
                     best_len = len;
-                    offset = static_cast<uint16_t>(curpos - i + 1);
-                    if(best_len == MAX_LEN)
+                    offset = static_cast<uint16_t>(curpos - pos);
+                    if (best_len == MAX_LEN)
                     {
                         break;
                     }
                 }
             }
         }
-        else
+        return best_len;
+    }
+
+private:
+    static constexpr uint32_t HASH_BITS = 13;
+    static constexpr uint32_t HASH_SIZE = 1 << HASH_BITS;
+    static constexpr uint32_t NO_POS = 0xFFFFFFFF;
+
+    uint32_t Hash(size_t pos) const
+    {
+        return ((m_buf[pos] << 8) ^ (m_buf[pos + 1] << 4) ^ m_buf[pos + 2]) & (HASH_SIZE - 1);
+    }
+
+    void InsertUpTo(size_t curpos)
+    {
+        // Searches only ever move forwards, so positions are indexed lazily.
+        for (; m_next_insert < curpos; ++m_next_insert)
         {
-            best_len = 1;
+            const uint32_t h = Hash(m_next_insert);
+            m_prev[m_next_insert] = m_head[h];
+            m_head[h] = static_cast<uint32_t>(m_next_insert);
         }
     }
-    return best_len;
+
+    const uint8_t* m_buf;
+    size_t m_size;
+    std::vector<uint32_t> m_head;
+    std::vector<uint32_t> m_prev;
+    size_t m_next_insert;
+};
 }
 
-size_t LZ77::Encode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf)
+static void parse_greedy(const uint8_t* inbuf, size_t bufsize, std::vector<Entry>& entries)
 {
-    size_t esize = 0;
-    std::vector<Entry> entries;
-    BitBarrel bb;
+    MatchFinder finder(inbuf, bufsize);
     size_t i = 0;
     while(i < bufsize)
     {
         uint16_t match_offset = 0;
-        uint8_t match_len = find_best_match(inbuf, bufsize, i, match_offset);
+        uint8_t match_len = finder.FindBestMatch(i, match_offset);
         
         if(match_len >= 3)
         {
             uint16_t tmatch_offset = 0;
             // Do the non-greedy optimisation - look at next offset and see if we find a longer run.
-            uint8_t tmatch_len = find_best_match(inbuf, bufsize, i + 1, tmatch_offset);
+            uint8_t tmatch_len = finder.FindBestMatch(i + 1, tmatch_offset);
             if (tmatch_len > match_len)
             {
                 match_offset = tmatch_offset;
@@ -159,10 +254,87 @@ size_t LZ77::Encode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf)
             entries.push_back(Entry(Entry::T_BYTE, inbuf[i++], 0));
         }
     }
+}
+
+static void parse_optimal(const uint8_t* inbuf, size_t bufsize, std::vector<Entry>& entries)
+{
+    // Each literal costs a flag bit plus a byte, and each run a flag bit plus a
+    // word, regardless of its length or offset.
+    const size_t LITERAL_COST = 9;
+    const size_t RUN_COST = 17;
+    MatchFinder finder(inbuf, bufsize);
+    std::vector<uint8_t> match_len(bufsize);
+    std::vector<uint16_t> match_offset(bufsize);
+    for (size_t i = 0; i < bufsize; ++i)
+    {
+        match_len[i] = finder.FindBestMatch(i, match_offset[i]);
+    }
+    // Every prefix of the longest match at a position is also a match at the
+    // same offset, so working backwards we only need to consider lengths up to
+    // the longest one to find the cheapest way of encoding the rest of the input.
+    std::vector<size_t> cost(bufsize + 1, 0);
+    std::vector<uint8_t> choice(bufsize, 1);
+    for (size_t i = bufsize; i-- > 0;)
+    {
+        cost[i] = LITERAL_COST + cost[i + 1];
+        for (uint8_t len = match_len[i]; len >= LEN_MIN_LIMIT; --len)
+        {
+            if (RUN_COST + cost[i + len] < cost[i])
+            {
+                cost[i] = RUN_COST + cost[i + len];
+                choice[i] = len;
+            }
+        }
+    }
+    for (size_t i = 0; i < bufsize;)
+    {
+        if (choice[i] >= LEN_MIN_LIMIT)
+        {
+            entries.push_back(Entry(Entry::T_RUN, choice[i], match_offset[i]));
+            i += choice[i];
+        }
+        else
+        {
+            entries.push_back(Entry(Entry::T_BYTE, inbuf[i++], 0));
+        }
+    }
+}
+
+std::atomic<int> LZ77::s_default_level{ static_cast<int>(LZ77::Level::GREEDY) };
+
+void LZ77::SetDefaultLevel(Level level)
+{
+    s_default_level.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LZ77::Level LZ77::GetDefaultLevel()
+{
+    return static_cast<Level>(s_default_level.load(std::memory_order_relaxed));
+}
+
+size_t LZ77::Encode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf)
+{
+    return Encode(inbuf, bufsize, outbuf, GetDefaultLevel());
+}
+
+size_t LZ77::Encode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf, Level level)
+{
+    size_t esize = 0;
+    std::vector<Entry> entries;
+    BitBarrel bb;
+    if (level == Level::OPTIMAL)
+    {
+        parse_optimal(inbuf, bufsize, entries);
+    }
+    else
+    {
+        parse_greedy(inbuf, bufsize, entries);
+    }
     entries.push_back(Entry(Entry::T_END,0,0));
     std::vector<Entry>::const_iterator it;
     std::vector<Entry>::const_iterator bstart = entries.begin();
-    int a = 0;
+    const bool trace = CodecTrace::IsEnabled(CodecTrace::Codec::LZ77);
+    size_t pos = 0;
     for(it = bstart; ; ++it)
     {
         if(bb.full() || it == entries.end())
@@ -178,33 +350,30 @@ size_t LZ77::Encode(const uint8_t* inbuf, size_t bufsize, uint8_t* outbuf)
                 switch(bstart->type)
                 {
                     case Entry::T_BYTE:
+                        if (trace)
+                        {
+                            CodecTrace::Record(CodecTrace::Codec::LZ77, CodecTrace::Op::LITERAL, pos, bstart->entry1);
+                        }
                         *outbuf++ = bstart->entry1;
                         esize++;
-                        a++;
+                        pos++;
                         break;
                     case Entry::T_RUN:
-#ifndef NDEBUG
-                        if (a)
+                        if (trace)
                         {
-                            std::cout << "C[" << a << "];" << std::endl;
-                            a = 0;
+                            CodecTrace::Record(CodecTrace::Codec::LZ77, CodecTrace::Op::RUN, pos, bstart->entry2, bstart->entry1);
                         }
-                        std::cout << "O[" << bstart->entry2 << "," << (int)bstart->entry1 << "];" << std::endl;
-#endif
                         assert((bstart->entry2 & 0xFFF) != 0);
                         *outbuf++ = static_cast<uint8_t>((bstart->entry2 & 0xF00) >> 4 | ((18 - bstart->entry1) & 0xF));
                         *outbuf++ = bstart->entry2 & 0xFF;
                         esize+=2;
+                        pos += bstart->entry1;
                         break;
                     default:
-#ifndef NDEBUG
-                        if (a)
+                        if (trace)
                         {
-                            std::cout << "C[" << a << "];" << std::endl;
-                            a = 0;
+                            CodecTrace::Record(CodecTrace::Codec::LZ77, CodecTrace::Op::END, pos);
                         }
-                        std::cout << "END;" << std::endl;
-#endif
                         *outbuf++ = 0x00;
                         *outbuf++ = 0x00;
                         esize+=2;
@@ -0,0 +1,290 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+#include <landstalker/misc/include/LZ77.h>
+#include <landstalker/tileset/include/Tileset.h>
+#include <landstalker/2d_maps/include/Tilemap2DRLE.h>
+
+namespace
+{
+    bool DecodeLz77(const std::vector<uint8_t>& in, std::vector<uint8_t>& out)
+    {
+        std::size_t elen = 0;
+        std::size_t dlen = 0;
+        out.assign(65536, 0);
+        const bool ok = LZ77::Decode(in.data(), in.size(), out.data(), out.size(), elen, dlen) == LZ77::DecodeResult::OK;
+        out.resize(dlen);
+        return ok;
+    }
+
+    // Decodes into a buffer of exactly outcap bytes followed by guard bytes, and reports whether
+    // anything was written past the end of the buffer
+    LZ77::DecodeResult DecodeLz77Guarded(const std::vector<uint8_t>& in, std::size_t outcap, std::vector<uint8_t>& out, bool& overrun)
+    {
+        const std::size_t GUARD_SIZE = 64;
+        const uint8_t GUARD = 0xA5;
+        std::size_t elen = 0;
+        std::size_t dlen = 0;
+        out.assign(outcap + GUARD_SIZE, GUARD);
+        const auto result = LZ77::Decode(in.data(), in.size(), out.data(), outcap, elen, dlen);
+        overrun = dlen > outcap || elen > in.size() ||
+            std::any_of(out.begin() + outcap, out.end(), [&](uint8_t b) { return b != GUARD; });
+        out.resize(std::min(dlen, outcap));
+        return result;
+    }
+
+    std::vector<uint8_t> EncodeLz77(const std::vector<uint8_t>& in, LZ77::Level level)
+    {
+        std::vector<uint8_t> out(in.size() * 2 + 16);
+        out.resize(LZ77::Encode(in.data(), in.size(), out.data(), level));
+        return out;
+    }
+
+    // The longest match for a position as the encoder found it before its match search was indexed,
+    // by scanning the whole window backwards
+    uint8_t ReferenceLz77Match(const std::vector<uint8_t>& in, std::size_t cur, uint16_t& offset)
+    {
+        if (in.size() <= 3 || cur == 0)
+        {
+            return 0;
+        }
+        const std::size_t max_len = std::min<std::size_t>(18, in.size() - cur);
+        if (max_len < 3)
+        {
+            return 1;
+        }
+        const std::size_t end = cur > 4095 ? cur - 4095 : 0;
+        uint8_t best = 0;
+        for (std::size_t pos = cur; pos-- > end;)
+        {
+            std::size_t len = 0;
+            while (len < max_len && in[pos + len] == in[cur + len])
+            {
+                ++len;
+            }
+            if (len > best)
+            {
+                best = static_cast<uint8_t>(len);
+                offset = static_cast<uint16_t>(cur - pos);
+                if (len == max_len)
+                {
+                    break;
+                }
+            }
+        }
+        return best;
+    }
+}
+
+std::vector<uint8_t> SelfTest::ReferenceLz77Encode(const std::vector<uint8_t>& in)
+{
+    struct Command
+    {
+        bool literal;
+        uint8_t value;
+        uint16_t offset;
+    };
+    std::vector<Command> commands;
+    for (std::size_t i = 0; i < in.size();)
+    {
+        uint16_t offset = 0;
+        uint8_t len = ReferenceLz77Match(in, i, offset);
+        if (len >= 3)
+        {
+            uint16_t next_offset = 0;
+            const uint8_t next_len = ReferenceLz77Match(in, i + 1, next_offset);
+            if (next_len > len)
+            {
+                commands.push_back({ true, in[i++], 0 });
+                len = next_len;
+                offset = next_offset;
+            }
+            commands.push_back({ false, len, offset });
+            i += len;
+        }
+        else
+        {
+            commands.push_back({ true, in[i++], 0 });
+        }
+    }
+    // The end marker is a run with a zero offset
+    commands.push_back({ false, 0, 0 });
+
+    std::vector<uint8_t> out;
+    for (std::size_t group = 0; group < commands.size(); group += 8)
+    {
+        uint8_t flags = 0;
+        for (std::size_t i = group; i < group + 8; ++i)
+        {
+            flags = static_cast<uint8_t>((flags << 1) | (i < commands.size() && commands[i].literal ? 1 : 0));
+        }
+        out.push_back(flags);
+        for (std::size_t i = group; i < std::min(group + 8, commands.size()); ++i)
+        {
+            const auto& c = commands[i];
+            if (c.literal)
+            {
+                out.push_back(c.value);
+            }
+            else if (c.value == 0)
+            {
+                out.insert(out.end(), { 0x00, 0x00 });
+            }
+            else
+            {
+                out.push_back(static_cast<uint8_t>(((c.offset & 0xF00) >> 4) | ((18 - c.value) & 0xF)));
+                out.push_back(static_cast<uint8_t>(c.offset & 0xFF));
+            }
+        }
+    }
+    return out;
+}
+
+void SelfTest::Lz77()
+{
+    const auto buffers = GenerateBuffers();
+    for (std::size_t i = 0; i < buffers.size(); ++i)
+    {
+        const auto encoded = EncodeLz77(buffers[i], LZ77::Level::GREEDY);
+        Check(encoded == ReferenceLz77Encode(buffers[i]), "Greedy encoding of buffer " + std::to_string(i) + " differs from the reference encoder");
+        std::vector<uint8_t> decoded;
+        Check(DecodeLz77(encoded, decoded) && decoded == buffers[i], "Buffer " + std::to_string(i) + " did not survive the greedy round trip");
+    }
+    if (m_gd == nullptr)
+    {
+        return;
+    }
+    for (const auto& t : m_gd->GetAllTilesets())
+    {
+        std::shared_ptr<const TilesetEntry> entry = t.second;
+        if (!entry->GetOrigData()->GetCompressed())
+        {
+            continue;
+        }
+        std::vector<uint8_t> original;
+        if (!DecodeLz77(*entry->GetOrigBytes(), original))
+        {
+            Check(false, t.first + ": unable to decode");
+            continue;
+        }
+        std::vector<uint8_t> decoded;
+        Check(DecodeLz77(EncodeLz77(original, LZ77::Level::GREEDY), decoded) && decoded == original,
+            t.first + " did not survive the greedy round trip");
+    }
+}
+
+void SelfTest::Lz77Optimal()
+{
+    std::vector<std::pair<std::string, std::vector<uint8_t>>> inputs;
+    for (auto& buf : GenerateBuffers())
+    {
+        inputs.push_back({ "Buffer " + std::to_string(inputs.size()), std::move(buf) });
+    }
+    if (m_gd != nullptr)
+    {
+        for (const auto& t : m_gd->GetAllTilesets())
+        {
+            std::shared_ptr<const TilesetEntry> entry = t.second;
+            std::vector<uint8_t> decoded;
+            if (entry->GetOrigData()->GetCompressed() && DecodeLz77(*entry->GetOrigBytes(), decoded))
+            {
+                inputs.push_back({ t.first, std::move(decoded) });
+            }
+        }
+    }
+    std::size_t greedy_bytes = 0;
+    std::size_t optimal_bytes = 0;
+    for (const auto& in : inputs)
+    {
+        const auto greedy = EncodeLz77(in.second, LZ77::Level::GREEDY);
+        const auto optimal = EncodeLz77(in.second, LZ77::Level::OPTIMAL);
+        greedy_bytes += greedy.size();
+        optimal_bytes += optimal.size();
+        Check(optimal.size() <= greedy.size(), in.first + ": optimal encoding is larger than the greedy encoding");
+        std::vector<uint8_t> decoded;
+        Check(DecodeLz77(optimal, decoded) && decoded == in.second, in.first + " did not survive the optimal round trip");
+    }
+    std::printf("  %zu bytes greedy, %zu bytes optimal\n", greedy_bytes, optimal_bytes);
+
+    // Encoding without a level uses the default level
+    const auto level = LZ77::GetDefaultLevel();
+    LZ77::SetDefaultLevel(LZ77::Level::OPTIMAL);
+    const auto& buf = inputs.back().second;
+    std::vector<uint8_t> encoded(buf.size() * 2 + 16);
+    encoded.resize(LZ77::Encode(buf.data(), buf.size(), encoded.data()));
+    LZ77::SetDefaultLevel(level);
+    Check(encoded == EncodeLz77(buf, LZ77::Level::OPTIMAL), "Encoding at the default level ignores the level set");
+}
+
+void SelfTest::Lz77Decoder()
+{
+    const auto buffers = GenerateBuffers();
+    for (std::size_t i = 0; i < buffers.size(); ++i)
+    {
+        const std::string name = "Buffer " + std::to_string(i);
+        const auto encoded = EncodeLz77(buffers[i], LZ77::Level::GREEDY);
+        std::vector<uint8_t> decoded;
+        bool overrun = false;
+        std::size_t elen = 0;
+        std::size_t dlen = 0;
+        decoded.resize(buffers[i].size());
+        Check(LZ77::Decode(encoded.data(), encoded.size(), decoded.data(), decoded.size(), elen, dlen) == LZ77::DecodeResult::OK &&
+            elen == encoded.size() && dlen == buffers[i].size() && decoded == buffers[i], name + ": decoding into an exact fit failed");
+        if (!buffers[i].empty())
+        {
+            const auto result = DecodeLz77Guarded(encoded, buffers[i].size() - 1, decoded, overrun);
+            Check(result == LZ77::DecodeResult::OUTPUT_OVERFLOW && !overrun, name + ": a short output buffer was not reported");
+        }
+        // Cutting the input off anywhere must be reported, without writing out of bounds. Input cut
+        // off between two commands decodes everything up to the cut.
+        const std::size_t step = std::max<std::size_t>(1, encoded.size() / 64);
+        for (std::size_t len = 0; len < encoded.size(); len += step)
+        {
+            const std::vector<uint8_t> truncated(encoded.begin(), encoded.begin() + len);
+            const auto result = DecodeLz77Guarded(truncated, buffers[i].size(), decoded, overrun);
+            const bool prefix = std::equal(decoded.begin(), decoded.end(), buffers[i].begin());
+            Check((result == LZ77::DecodeResult::TRUNCATED_INPUT || (result == LZ77::DecodeResult::MISSING_END_MARKER && prefix)) && !overrun,
+                name + ": input truncated to " + std::to_string(len) + " bytes was not reported");
+        }
+        // Without its end marker, the data still decodes in full
+        const std::vector<uint8_t> unterminated(encoded.begin(), encoded.end() - 2);
+        Check(DecodeLz77Guarded(unterminated, buffers[i].size(), decoded, overrun) == LZ77::DecodeResult::MISSING_END_MARKER &&
+            !overrun && decoded == buffers[i], name + ": data without an end marker did not decode");
+    }
+
+    // Tilesets and LZ77 maps have always been read without an end marker, so must still be
+    std::vector<uint8_t> tile_bits(32 * 16);
+    std::mt19937 tile_rng(5);
+    std::generate(tile_bits.begin(), tile_bits.end(), [&]() { return static_cast<uint8_t>(tile_rng() % 3); });
+    Tileset tileset(tile_bits);
+    auto tileset_bits = tileset.GetBits(true);
+    tileset_bits.resize(tileset_bits.size() - 2);
+    Check(Tileset(tileset_bits, true).GetBits() == tile_bits, "A tileset without an end marker was not read");
+    Tilemap2D tilemap(12, 7);
+    tilemap.FillIncrementing(Tile(3));
+    std::vector<uint8_t> tilemap_bits;
+    tilemap.GetBits(tilemap_bits, Tilemap2D::Compression::LZ77);
+    tilemap_bits.resize(tilemap_bits.size() - 2);
+    Check(Tilemap2D(tilemap_bits, Tilemap2D::Compression::LZ77) == tilemap, "A map without an end marker was not read");
+
+    // A run at the start of the output, and a run reaching back before the start
+    std::vector<uint8_t> decoded;
+    bool overrun = false;
+    Check(DecodeLz77Guarded({ 0x00, 0x0F, 0x01 }, 256, decoded, overrun) == LZ77::DecodeResult::INVALID_OFFSET && !overrun,
+        "A run before any output was not reported");
+    Check(DecodeLz77Guarded({ 0x80, 0xAA, 0x0F, 0x02 }, 256, decoded, overrun) == LZ77::DecodeResult::INVALID_OFFSET && !overrun,
+        "A run reaching back before the start of the output was not reported");
+
+    // Whatever the decoder makes of random input, it must stay within its buffers
+    std::mt19937 rng(3);
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::vector<uint8_t> garbage(rng() % 512);
+        std::generate(garbage.begin(), garbage.end(), [&]() { return static_cast<uint8_t>(rng()); });
+        DecodeLz77Guarded(garbage, rng() % 1024, decoded, overrun);
+        Check(!overrun, "Random input " + std::to_string(i) + " was decoded out of bounds");
+    }
+}
@@ -0,0 +1,94 @@
+#include <landstalker/misc/include/MappedFile.h>
+
+#include <fstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filename, Access access)
+    : m_data(nullptr),
+      m_size(0),
+      m_mapped(false)
+{
+    if (access == Access::COPY)
+    {
+        ReadFile(filename);
+        return;
+    }
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Unable to open file \"" + filename + "\".");
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Unable to read size of file \"" + filename + "\".");
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size > 0)
+    {
+        void* addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            m_data = static_cast<const uint8_t*>(addr);
+            m_mapped = true;
+        }
+    }
+    close(fd);
+    if (m_mapped || m_size == 0)
+    {
+        return;
+    }
+#endif
+    ReadFile(filename);
+}
+
+void MappedFile::ReadFile(const std::string& filename)
+{
+    std::ifstream infile(filename, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!infile.is_open())
+    {
+        throw std::runtime_error("Unable to open file \"" + filename + "\".");
+    }
+    m_buffer.resize(static_cast<std::size_t>(infile.tellg()));
+    infile.seekg(0, std::ios::beg);
+    infile.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size());
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+}
+
+MappedFile::MappedFile(std::vector<uint8_t> bytes)
+    : m_buffer(std::move(bytes)),
+      m_data(m_buffer.data()),
+      m_size(m_buffer.size()),
+      m_mapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (m_mapped)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+}
+
+const uint8_t* MappedFile::data() const
+{
+    return m_data;
+}
+
+std::size_t MappedFile::size() const
+{
+    return m_size;
+}
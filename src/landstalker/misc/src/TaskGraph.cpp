@@ -0,0 +1,162 @@
+#include <landstalker/misc/include/TaskGraph.h>
+
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+TaskGraph::TaskGraph(TaskPool& pool)
+    : m_pool(pool),
+      m_group(nullptr)
+{
+}
+
+TaskGraph::Node TaskGraph::Add(const std::string& name, Task task, const std::vector<Node>& dependencies)
+{
+    const Node node = m_nodes.size();
+    for (Node d : dependencies)
+    {
+        if (d >= node)
+        {
+            throw std::runtime_error("Task \"" + name + "\" depends on a task that has not been added");
+        }
+        m_nodes[d]->dependents.push_back(node);
+    }
+    auto state = std::make_unique<NodeState>();
+    state->name = name;
+    state->task = std::move(task);
+    state->dependencies = dependencies;
+    state->waiting = 0;
+    state->skipped = false;
+    m_nodes.push_back(std::move(state));
+    return node;
+}
+
+void TaskGraph::Run()
+{
+    for (auto& n : m_nodes)
+    {
+        n->waiting = n->dependencies.size();
+        n->error = nullptr;
+        n->skipped = false;
+    }
+    m_start = Clock::now();
+    {
+        TaskPool::TaskGroup group(m_pool);
+        m_group = &group;
+        for (Node n = 0; n < m_nodes.size(); ++n)
+        {
+            if (m_nodes[n]->dependencies.empty())
+            {
+                Submit(n);
+            }
+        }
+        group.Wait();
+        m_group = nullptr;
+    }
+    m_finish = Clock::now();
+    for (const auto& n : m_nodes)
+    {
+        if (n->error)
+        {
+            std::rethrow_exception(n->error);
+        }
+    }
+}
+
+void TaskGraph::Submit(Node node)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_submit_mutex);
+    m_group->Run([this, node]() { Execute(node); });
+}
+
+void TaskGraph::Execute(Node node)
+{
+    NodeState& state = *m_nodes[node];
+    for (Node d : state.dependencies)
+    {
+        if (m_nodes[d]->error || m_nodes[d]->skipped)
+        {
+            state.skipped = true;
+        }
+    }
+    state.start = Clock::now();
+    if (!state.skipped)
+    {
+        try
+        {
+            state.task();
+        }
+        catch (...)
+        {
+            state.error = std::current_exception();
+        }
+    }
+    state.finish = Clock::now();
+    for (Node d : state.dependents)
+    {
+        if (--m_nodes[d]->waiting == 0)
+        {
+            Submit(d);
+        }
+    }
+}
+
+std::vector<TaskGraph::Timing> TaskGraph::GetTimings() const
+{
+    auto to_ms = [](Clock::duration d)
+    {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    std::vector<Timing> timings;
+    if (m_nodes.empty())
+    {
+        return timings;
+    }
+    // Walk back from the last task to finish, through whichever dependency held each task up
+    std::vector<Node> held_up_by(m_nodes.size(), m_nodes.size());
+    Node last = 0;
+    for (Node n = 0; n < m_nodes.size(); ++n)
+    {
+        for (Node d : m_nodes[n]->dependencies)
+        {
+            if (held_up_by[n] == m_nodes.size() || m_nodes[d]->finish > m_nodes[held_up_by[n]]->finish)
+            {
+                held_up_by[n] = d;
+            }
+        }
+        if (m_nodes[n]->finish > m_nodes[last]->finish)
+        {
+            last = n;
+        }
+    }
+    std::vector<bool> critical(m_nodes.size(), false);
+    for (Node n = last; n < m_nodes.size(); n = held_up_by[n])
+    {
+        critical[n] = true;
+    }
+    for (Node n = 0; n < m_nodes.size(); ++n)
+    {
+        const auto& state = *m_nodes[n];
+        timings.push_back({ state.name, to_ms(state.start - m_start), to_ms(state.finish - state.start), critical[n], state.skipped });
+    }
+    return timings;
+}
+
+double TaskGraph::GetElapsedMs() const
+{
+    return std::chrono::duration<double, std::milli>(m_finish - m_start).count();
+}
+
+std::string TaskGraph::FormatTimings() const
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1);
+    for (const auto& t : GetTimings())
+    {
+        ss << (t.critical ? "* " : "  ") << std::left << std::setw(32) << t.name << std::right
+           << " start " << std::setw(8) << t.start_ms << " ms, took " << std::setw(8) << t.duration_ms << " ms"
+           << (t.skipped ? " (skipped)" : "") << std::endl;
+    }
+    ss << "  Total " << GetElapsedMs() << " ms, critical path marked *" << std::endl;
+    return ss.str();
+}
@@ -0,0 +1,245 @@
+#include <landstalker/misc/include/TaskPool.h>
+
+#include <chrono>
+#include <limits>
+#include <string>
+
+namespace
+{
+    // The pool and queue that the current thread works for, if any
+    thread_local const TaskPool* t_pool = nullptr;
+    thread_local std::size_t t_queue = 0;
+
+    // Number of threads, including the caller, requested through LS_THREADS. Zero if unset.
+    unsigned ReadThreadCount()
+    {
+        const char* env = std::getenv("LS_THREADS");
+        if (env == nullptr)
+        {
+            return 0;
+        }
+        try
+        {
+            return static_cast<unsigned>(std::stoul(env));
+        }
+        catch (const std::exception&)
+        {
+            return 0;
+        }
+    }
+}
+
+std::atomic<bool> TaskPool::s_single_threaded(ReadThreadCount() == 1);
+
+TaskPool::TaskGroup::TaskGroup(TaskPool& pool)
+    : m_pool(pool),
+      m_submitted(0),
+      m_remaining(0),
+      m_error_index(std::numeric_limits<std::size_t>::max()),
+      m_error(nullptr)
+{
+}
+
+TaskPool::TaskGroup::~TaskGroup()
+{
+    try
+    {
+        Wait();
+    }
+    catch (...)
+    {
+    }
+}
+
+void TaskPool::TaskGroup::Run(Task task)
+{
+    Job job{ std::move(task), this, m_submitted++ };
+    ++m_remaining;
+    if (TaskPool::IsSingleThreaded() || m_pool.GetThreadCount() == 0)
+    {
+        Execute(job);
+    }
+    else
+    {
+        m_pool.Push(std::move(job));
+    }
+}
+
+void TaskPool::TaskGroup::Wait()
+{
+    while (m_remaining.load() > 0)
+    {
+        if (!m_pool.TryRunOne())
+        {
+            // Our remaining tasks are running elsewhere. Check back regularly in case
+            // other work has been queued that we could help with.
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done.wait_for(lock, std::chrono::milliseconds(1), [this]() { return m_remaining.load() == 0; });
+        }
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error)
+    {
+        auto error = m_error;
+        m_error = nullptr;
+        m_error_index = std::numeric_limits<std::size_t>::max();
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskPool::TaskGroup::Complete(std::size_t index, std::exception_ptr error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (error && index < m_error_index)
+    {
+        m_error_index = index;
+        m_error = std::move(error);
+    }
+    // Drop any other exception while the lock is held, as the waiter may be about to rethrow
+    error = nullptr;
+    if (--m_remaining == 0)
+    {
+        m_done.notify_all();
+    }
+}
+
+TaskPool::TaskPool(unsigned threads)
+    : m_next_queue(0),
+      m_queued(0),
+      m_stop(false)
+{
+    if (threads == AUTO_THREADS)
+    {
+        threads = std::max(std::thread::hardware_concurrency(), 1U) - 1;
+    }
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        m_threads.emplace_back(&TaskPool::WorkerLoop, this, i);
+    }
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& t : m_threads)
+    {
+        t.join();
+    }
+}
+
+TaskPool& TaskPool::Global()
+{
+    const unsigned threads = ReadThreadCount();
+    static TaskPool pool(threads == 0 ? AUTO_THREADS : threads - 1);
+    return pool;
+}
+
+void TaskPool::SetSingleThreaded(bool single_threaded)
+{
+    s_single_threaded = single_threaded;
+}
+
+bool TaskPool::IsSingleThreaded()
+{
+    return s_single_threaded.load(std::memory_order_relaxed);
+}
+
+unsigned TaskPool::GetThreadCount() const
+{
+    return static_cast<unsigned>(m_threads.size());
+}
+
+void TaskPool::Push(Job job)
+{
+    // Workers keep the tasks they spawn on their own queue, where they will be picked up
+    // first. Tasks from other threads are spread across all queues.
+    const std::size_t q = (t_pool == this) ? t_queue : m_next_queue++ % m_queues.size();
+    {
+        std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+        m_queues[q]->jobs.push_back(std::move(job));
+        ++m_queued;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_wake_mutex);
+    }
+    m_wake.notify_one();
+}
+
+bool TaskPool::TryRunOne()
+{
+    if (m_queued.load() == 0)
+    {
+        return false;
+    }
+    const std::size_t first = (t_pool == this) ? t_queue : 0;
+    for (std::size_t i = 0; i < m_queues.size(); ++i)
+    {
+        const std::size_t q = (first + i) % m_queues.size();
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(m_queues[q]->mutex);
+            auto& jobs = m_queues[q]->jobs;
+            if (jobs.empty())
+            {
+                continue;
+            }
+            // Newest first from our own queue, oldest first when stealing
+            if (i == 0 && t_pool == this)
+            {
+                job = std::move(jobs.back());
+                jobs.pop_back();
+            }
+            else
+            {
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            --m_queued;
+        }
+        Execute(job);
+        return true;
+    }
+    return false;
+}
+
+void TaskPool::WorkerLoop(unsigned index)
+{
+    t_pool = this;
+    t_queue = index;
+    while (true)
+    {
+        if (!TryRunOne())
+        {
+            std::unique_lock<std::mutex> lock(m_wake_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || m_queued.load() > 0; });
+            if (m_stop && m_queued.load() == 0)
+            {
+                return;
+            }
+        }
+    }
+}
+
+void TaskPool::Execute(Job& job)
+{
+    std::exception_ptr error = nullptr;
+    try
+    {
+        job.task();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+    // Release anything the task captured before the group can be waited out
+    job.task = nullptr;
+    job.group->Complete(job.index, std::move(error));
+}
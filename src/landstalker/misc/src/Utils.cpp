@@ -169,3 +169,13 @@ bool StrToInt(const std::string& s, uint32_t& val)
 	}
 	return false;
 }
+
+uint64_t Fnv1a(const uint8_t* data, std::size_t size, uint64_t seed)
+{
+	uint64_t hash = seed;
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash = (hash ^ data[i]) * 0x100000001B3ULL;
+	}
+	return hash;
+}
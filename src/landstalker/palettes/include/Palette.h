@@ -2,6 +2,7 @@
 #define PALETTE_H
 
 #include <array>
+#include <atomic>
 #include <vector>
 #include <cstdint>
 #include <memory>
@@ -241,13 +242,22 @@ public:
 	static int GetSize(const Type& type);
 	static int GetSizeBytes(const Type& type);
 	static bool IsVarWidth(const Type& type);
+
+	// Changes whenever this palette's colours do, including through a merged palette that
+	// shares them
+	uint64_t GetVersion() const;
 private:
+	void BumpVersion();
 
 	Type m_type;
 	std::string m_name;
 	std::vector<std::shared_ptr<Colour>> m_pal;
 	std::vector<std::string> m_owner;
 	std::vector<bool> m_locked;
+	std::shared_ptr<std::atomic<uint64_t>> m_version = std::make_shared<std::atomic<uint64_t>>(0);
+	// Counters of the palettes whose colours a merged palette shares. Edits made through either
+	// side bump both.
+	std::vector<std::shared_ptr<std::atomic<uint64_t>>> m_shared_versions;
 };
 
 #endif // PALETTE_H
@@ -1,6 +1,7 @@
 #include <landstalker/palettes/include/Palette.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <numeric>
 
@@ -217,6 +218,8 @@ Palette::Palette(const std::vector<std::shared_ptr<Palette>>& pals)
 		Clear();
 		for (const auto& pal : pals)
 		{
+			m_shared_versions.push_back(pal->m_version);
+			m_shared_versions.insert(m_shared_versions.end(), pal->m_shared_versions.cbegin(), pal->m_shared_versions.cend());
 			for (std::size_t i = 0; i < m_pal.size(); ++i)
 			{
 				if (pal->m_locked[i] == false)
@@ -243,6 +246,7 @@ Palette::Palette(const std::vector<std::shared_ptr<Palette>>& pals)
 
 void Palette::Clear()
 {
+	BumpVersion();
 	if (m_pal.size() > 0)
 	{
 		m_pal[0]->FromGenesis(0x0000, true);
@@ -259,6 +263,7 @@ void Palette::Clear()
 
 void Palette::LoadDebugPal()
 {
+	BumpVersion();
 	m_pal[0]->FromGenesis(0x0C0C, true);
 	m_pal[1]->FromGenesis(0x0CCC);
 	m_pal[2]->FromGenesis(0x000E);
@@ -279,6 +284,10 @@ void Palette::LoadDebugPal()
 
 Palette& Palette::operator=(const Palette& rhs)
 {
+	// The colours are copied rather than shared, so the merged counters are folded into this
+	// palette's own before they are dropped. That keeps the version from ever going backwards.
+	m_version->store(GetVersion() + 1);
+	m_shared_versions.clear();
 	m_type = rhs.m_type;
 	m_name = rhs.m_name;
 	m_owner = rhs.m_owner;
@@ -422,6 +431,26 @@ void Palette::SetNthUnlockedGenesisColour(uint8_t n, uint16_t colour)
 void Palette::setGenesisColour(uint8_t index, uint16_t colour)
 {
 	*m_pal[index] = Palette::Colour(colour);
+	BumpVersion();
+}
+
+uint64_t Palette::GetVersion() const
+{
+	uint64_t version = *m_version;
+	for (const auto& v : m_shared_versions)
+	{
+		version += *v;
+	}
+	return version;
+}
+
+void Palette::BumpVersion()
+{
+	++*m_version;
+	for (const auto& v : m_shared_versions)
+	{
+		++*v;
+	}
 }
 
 bool Palette::ColourInRange(uint8_t colour) const
@@ -66,7 +66,8 @@ public:
 
 	std::vector<uint8_t>  GetTile(const Tile& tile) const;
 	std::pair<int, int>   GetTilePosition(const Tile& tile) const;
-	std::vector<uint8_t>& GetTilePixels(int tile_index);
+	ConstTilePixels GetTilePixels(int tile_index) const;
+	void SetTilePixels(int tile_index, ConstTilePixels pixels);
 	std::shared_ptr<const Tileset> GetTileset() const;
 	std::shared_ptr<Tileset> GetTileset();
 
@@ -1,8 +1,10 @@
 #include <landstalker/sprites/include/SpriteFrame.h>
 #include <vector>
 #include <iterator>
+#include <utility>
 #include <landstalker/main/include/Rom.h>
 #include <landstalker/misc/include/LZ77.h>
+#include <landstalker/misc/include/CodecTrace.h>
 #include <landstalker/misc/include/Utils.h>
 
 SpriteFrame::SpriteFrame(const std::vector<uint8_t>& src)
@@ -224,15 +226,6 @@ std::size_t SpriteFrame::SetBits(const std::vector<uint8_t>& src)
 		tile_idx += w * h;
 	} while ((*it++ & 0x80) == 0);
 
-	for (const auto& subs : m_subsprites)
-	{
-		std::ostringstream ss;
-		ss << "Sprite T:" << subs.tile_idx << " X:" << subs.x << " Y:" << subs.y << " W:" << subs.w << " H:" << subs.h;
-		Debug(ss.str().c_str());
-	}
-	std::ostringstream ss;
-	ss << "Total tiles to load: " << tile_idx;
-	Debug(ss.str().c_str());
 	std::vector<uint8_t> sprite_gfx(tile_idx * 32, 0);
 	auto dest_it = sprite_gfx.begin();
 
@@ -248,36 +241,28 @@ std::size_t SpriteFrame::SetBits(const std::vector<uint8_t>& src)
 
 		if ((ctrl & 0x08) > 0)
 		{
-#ifndef NDEBUG
-			ss.str(std::string());
-			ss.clear();
-			ss << "Insert " << count << " zero words." << std::endl;
-			Debug(ss.str().c_str());
-#endif
+			CodecTrace::Record(CodecTrace::Codec::SPRITE_FRAME, CodecTrace::Op::ZERO_FILL, dest_it - sprite_gfx.begin(), count);
 			dest_it += count * 2;
 		}
 		else if ((ctrl & 0x02) > 0)
 		{
 			std::size_t elen = 0;
-			std::size_t dlen = LZ77::Decode(&(*it), src.end() - it, &(*dest_it), elen);
+			std::size_t dlen = 0;
+			// A frame whose compressed data runs to its end has always been accepted without an end marker
+			const auto result = LZ77::Decode(&(*it), src.end() - it, &(*dest_it), sprite_gfx.end() - dest_it, elen, dlen);
+			if (result != LZ77::DecodeResult::OK && result != LZ77::DecodeResult::MISSING_END_MARKER)
+			{
+				throw std::runtime_error("Bad LZ77 compressed sprite frame!");
+			}
+			CodecTrace::Record(CodecTrace::Codec::SPRITE_FRAME, CodecTrace::Op::COMPRESSED_BLOCK, dest_it - sprite_gfx.begin(),
+				static_cast<uint32_t>(elen), static_cast<uint32_t>(dlen));
 			dest_it += dlen;
-#ifndef NDEBUG
-			ss.str(std::string());
-			ss.clear();
-			ss << "Copy " << elen << " compressed bytes, " << dlen << " bytes decompressed.";
-			Debug(ss.str().c_str());
-#endif
 			it += elen;
 			m_compressed = true;
 		}
 		else
 		{
-#ifndef NDEBUG
-			ss.str(std::string());
-			ss.clear();
-			ss << "Copy " << count << " words directly.";
-			Debug(ss.str().c_str());
-#endif
+			CodecTrace::Record(CodecTrace::Codec::SPRITE_FRAME, CodecTrace::Op::RAW_COPY, dest_it - sprite_gfx.begin(), count);
 			std::copy(it, it + count * 2, dest_it);
 			dest_it += count * 2;
 			it += count * 2;
@@ -286,7 +271,6 @@ std::size_t SpriteFrame::SetBits(const std::vector<uint8_t>& src)
 
 	m_sprite_gfx = std::make_shared<Tileset>(sprite_gfx);
 
-	Debug("Done!");
 	return std::distance(src.begin(), it);
 }
 
@@ -420,9 +404,14 @@ std::pair<int, int> SpriteFrame::GetTilePosition(const Tile& tile) const
 	return std::pair<int, int>(x, y);
 }
 
-std::vector<uint8_t>& SpriteFrame::GetTilePixels(int tile_index)
+ConstTilePixels SpriteFrame::GetTilePixels(int tile_index) const
+{
+	return std::as_const(*m_sprite_gfx).GetTilePixels(tile_index);
+}
+
+void SpriteFrame::SetTilePixels(int tile_index, ConstTilePixels pixels)
 {
-	return m_sprite_gfx->GetTilePixels(tile_index);
+	m_sprite_gfx->SetTilePixels(tile_index, pixels);
 }
 
 std::shared_ptr<const Tileset> SpriteFrame::GetTileset() const
@@ -1,13 +1,15 @@
 #ifndef _HUFFMAN_TREE_
 #define _HUFFMAN_TREE_
 
+#include <array>
 #include <unordered_map>
 #include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <string>
-#include <landstalker/misc/include/BitBarrel.h>
-#include <landstalker/misc/include/BitBarrelWriter.h>
+#include <vector>
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/misc/include/BitWriter.h>
 
 class HuffmanTree
 {
@@ -17,25 +19,24 @@ public:
 	HuffmanTree();
 	HuffmanTree(const CharFrequencies& frequencies);
 	HuffmanTree(const uint8_t* tree_data, size_t offset, size_t buffer_size);
+	HuffmanTree(const HuffmanTree&) = delete;
+	HuffmanTree& operator=(const HuffmanTree&) = delete;
 	~HuffmanTree();
 
 	size_t  EncodeTree(std::vector<uint8_t>& tree);
 	size_t  DecodeTree(const uint8_t* tree_data, size_t offset, size_t buffer_size);
 	void    RecalculateTree(const CharFrequencies& frequencies);
-	uint8_t DecodeChar(BitBarrel& bb);
-	bool    EncodeChar(uint8_t chr, BitBarrelWriter& bb);
+	uint8_t DecodeChar(BitReader& bb);
+	bool    EncodeChar(uint8_t chr, BitWriter& bb);
 private:
 
+	// Nodes are allocated from m_nodes, so links between them are plain pointers
+	// that remain valid until the tree is rebuilt.
 	struct Node
 	{
 		Node() : chr(0xFF), weight(0), left(0), right(0), parent(0) {}
 		Node(Node* p) : chr(0xFF), weight(0), left(0), right(0), parent(p) {}
 		Node(uint8_t c, size_t w) : chr(c), weight(w), left(0), right(0), parent(0) {}
-		~Node()
-		{
-			if (left) delete left;
-			if (right) delete right;
-		}
 
 		uint8_t chr;
 		size_t weight;
@@ -44,12 +45,50 @@ private:
 		Node* parent;
 	};
 
-	void EncodeTreePreorder(BitBarrelWriter& bb, std::vector<uint8_t>& chrs, const Node* node);
+	// Code for a character, right-aligned in the low length bits of code. Characters
+	// with codes longer than MAX_CODE_BITS are left invalid and cannot be encoded.
+	struct Code
+	{
+		Code() : code(0), length(0), valid(false) {}
+		Code(uint32_t c, unsigned l) : code(c), length(static_cast<uint8_t>(l)), valid(true) {}
+
+		uint32_t code;
+		uint8_t length;
+		bool valid;
+	};
+
+	// Decoding table entry for a prefix of m_table_bits bits: the node reached and the
+	// number of bits used to reach it. If the node is not a leaf, the code is longer than
+	// the table and decoding continues from that node one bit at a time.
+	struct DecodeEntry
+	{
+		DecodeEntry() : node(nullptr), length(0) {}
+		DecodeEntry(Node* n, unsigned l) : node(n), length(static_cast<uint8_t>(l)) {}
+
+		Node* node;
+		uint8_t length;
+	};
+
+	// A tree with a leaf for every character value has 511 nodes
+	static constexpr size_t MAX_NODES = 511;
+	static constexpr unsigned MAX_CODE_BITS = 32;
+	static constexpr unsigned MAX_TABLE_BITS = 10;
+
+	template <class... Args>
+	Node* NewNode(Args&&... args);
+	void ClearNodes();
+	void EncodeTreePreorder(BitWriter& bb, std::vector<uint8_t>& chrs, const Node* node);
 	void UpdateEncodingTable();
-	void UpdateEncodingTable(Node* node, std::string encoding);
+	void UpdateEncodingTable(Node* node, uint32_t code, unsigned length);
+	void UpdateDecodingTable();
+	void UpdateDecodingTable(Node* node, uint32_t code, unsigned length);
+	static unsigned GetDepth(const Node* node);
 
+	std::vector<Node> m_nodes;
 	Node* m_root;
-	std::unordered_map<uint8_t, std::string> m_encoding;
+	std::array<Code, 256> m_encoding;
+	std::vector<DecodeEntry> m_decoding;
+	unsigned m_table_bits;
 };
 
 #endif // _HUFFMAN_TREE_
@@ -0,0 +1,433 @@
+#include <landstalker/main/include/SelfTest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/misc/include/BitWriter.h>
+#include <landstalker/text/include/Charset.h>
+#include <landstalker/text/include/HuffmanString.h>
+#include <landstalker/text/include/HuffmanTrees.h>
+
+namespace
+{
+    bool ReadBit(const std::vector<uint8_t>& in, std::size_t pos)
+    {
+        return pos / 8 < in.size() && ((in[pos / 8] >> (7 - pos % 8)) & 1) != 0;
+    }
+
+    // A Huffman tree read from its encoded form without HuffmanTree: the shape follows the offset in
+    // preorder, 0 for a branch and 1 for a leaf, and the leaf characters precede it in reverse order
+    class ReferenceHuffmanTree
+    {
+    public:
+        ReferenceHuffmanTree(const std::vector<uint8_t>& data, std::size_t offset)
+            : m_depth(0)
+        {
+            std::size_t pos = offset * 8;
+            std::size_t chr = offset;
+            Parse(data, pos, chr, 0);
+        }
+
+        // Walks the tree a bit at a time from bit position pos
+        uint8_t Decode(const std::vector<uint8_t>& in, std::size_t& pos) const
+        {
+            std::size_t node = 0;
+            while (m_nodes[node].branch)
+            {
+                node = ReadBit(in, pos++) ? m_nodes[node].right : m_nodes[node].left;
+            }
+            return m_nodes[node].chr;
+        }
+
+        unsigned GetDepth() const
+        {
+            return m_depth;
+        }
+
+        // Each character's code, as a string of bits
+        std::map<uint8_t, std::string> GetCodes() const
+        {
+            std::map<uint8_t, std::string> codes;
+            AddCodes(0, "", codes);
+            return codes;
+        }
+    private:
+        struct Node
+        {
+            bool branch;
+            uint8_t chr;
+            std::size_t left;
+            std::size_t right;
+        };
+
+        std::size_t Parse(const std::vector<uint8_t>& data, std::size_t& pos, std::size_t& chr, unsigned depth)
+        {
+            if (m_nodes.size() >= 511 || (pos / 8) >= data.size())
+            {
+                throw std::runtime_error("Reference Huffman tree is corrupt");
+            }
+            m_depth = std::max(m_depth, depth);
+            const std::size_t node = m_nodes.size();
+            m_nodes.push_back({ !ReadBit(data, pos++), 0, 0, 0 });
+            if (m_nodes[node].branch)
+            {
+                const std::size_t left = Parse(data, pos, chr, depth + 1);
+                const std::size_t right = Parse(data, pos, chr, depth + 1);
+                m_nodes[node].left = left;
+                m_nodes[node].right = right;
+            }
+            else if (chr > 0)
+            {
+                m_nodes[node].chr = data[--chr];
+            }
+            else
+            {
+                throw std::runtime_error("Reference Huffman tree is corrupt");
+            }
+            return node;
+        }
+
+        void AddCodes(std::size_t node, const std::string& code, std::map<uint8_t, std::string>& codes) const
+        {
+            if (m_nodes[node].branch)
+            {
+                AddCodes(m_nodes[node].left, code + '0', codes);
+                AddCodes(m_nodes[node].right, code + '1', codes);
+            }
+            else
+            {
+                codes[m_nodes[node].chr] = code;
+            }
+        }
+
+        std::vector<Node> m_nodes;
+        unsigned m_depth;
+    };
+
+    // The tree for each preceding character, from the offset table and the trees it points into
+    std::map<uint8_t, ReferenceHuffmanTree> ReferenceHuffmanTrees(const std::vector<uint8_t>& offsets, const std::vector<uint8_t>& tables)
+    {
+        std::map<uint8_t, ReferenceHuffmanTree> trees;
+        for (std::size_t c = 0; c < offsets.size() / 2; ++c)
+        {
+            const std::size_t offset = offsets[c * 2] << 8 | offsets[c * 2 + 1];
+            if (offset != 0xFFFF)
+            {
+                trees.emplace(static_cast<uint8_t>(c), ReferenceHuffmanTree(tables, offset));
+            }
+        }
+        return trees;
+    }
+
+    std::vector<uint8_t> ReferenceHuffmanDecompress(const std::map<uint8_t, ReferenceHuffmanTree>& trees, const std::vector<uint8_t>& in, uint8_t eos_marker)
+    {
+        std::vector<uint8_t> out;
+        uint8_t last = eos_marker;
+        std::size_t pos = 0;
+        do
+        {
+            const auto tree = trees.find(last);
+            if (tree == trees.end())
+            {
+                break;
+            }
+            last = tree->second.Decode(in, pos);
+            out.push_back(last);
+        } while (last != eos_marker && pos / 8 < in.size());
+        return out;
+    }
+
+    std::vector<uint8_t> PackBits(const std::string& bits)
+    {
+        std::vector<uint8_t> out((bits.size() + 7) / 8);
+        for (std::size_t i = 0; i < bits.size(); ++i)
+        {
+            out[i / 8] |= bits[i] == '1' ? static_cast<uint8_t>(0x80 >> (i % 8)) : 0;
+        }
+        return out;
+    }
+
+    // Encodes with each tree's codes concatenated, or returns nothing if a character has no code
+    std::vector<uint8_t> ReferenceHuffmanCompress(const std::map<uint8_t, ReferenceHuffmanTree>& trees, const std::vector<uint8_t>& in, uint8_t eos_marker)
+    {
+        std::string bits;
+        uint8_t last = eos_marker;
+        for (auto chr : in)
+        {
+            const auto tree = trees.find(last);
+            if (tree == trees.end())
+            {
+                return {};
+            }
+            const auto codes = tree->second.GetCodes();
+            const auto code = codes.find(chr);
+            if (code == codes.end())
+            {
+                return {};
+            }
+            bits += code->second;
+            last = chr;
+        }
+        return PackBits(bits);
+    }
+
+    // The total code length of an optimal code for the weights: merging the two lightest weights adds
+    // one bit to every code under them
+    std::size_t ReferenceHuffmanCost(const HuffmanTree::CharFrequencies& frequencies)
+    {
+        std::multiset<std::size_t> weights;
+        for (const auto& f : frequencies)
+        {
+            weights.insert(f.second);
+        }
+        std::size_t cost = 0;
+        while (weights.size() > 1)
+        {
+            const std::size_t merged = *weights.begin() + *std::next(weights.begin());
+            weights.erase(weights.begin(), std::next(weights.begin(), 2));
+            weights.insert(merged);
+            cost += merged;
+        }
+        return cost;
+    }
+
+    // Strings Huffman-encoded as StringData encodes them: trees built for the whole set, and each
+    // string prefixed with its length
+    struct HuffmanCorpus
+    {
+        std::shared_ptr<HuffmanTrees> trees;
+        std::vector<uint8_t> offsets;
+        std::vector<uint8_t> tables;
+        std::vector<std::vector<uint8_t>> encoded;
+    };
+
+    HuffmanCorpus EncodeHuffmanStrings(const std::vector<LSString::StringType>& strings, RomOffsets::Region region)
+    {
+        HuffmanCorpus corpus;
+        corpus.trees = std::make_shared<HuffmanTrees>();
+        std::vector<std::shared_ptr<LSString>> strs;
+        for (const auto& s : strings)
+        {
+            strs.push_back(std::make_shared<HuffmanString>(s, corpus.trees, Charset::GetDefaultCharset(region),
+                Charset::GetEOSChar(region), Charset::GetDiacriticMap(region)));
+        }
+        corpus.trees->RecalculateTrees(strs);
+        corpus.trees->EncodeTrees(corpus.offsets, corpus.tables);
+        for (const auto& s : strs)
+        {
+            corpus.encoded.emplace_back(256);
+            corpus.encoded.back().resize(s->Encode(corpus.encoded.back().data(), corpus.encoded.back().size()));
+        }
+        return corpus;
+    }
+}
+
+void SelfTest::HuffmanDecoding()
+{
+    // Random input through single trees, including trees with codes longer than the decoding table
+    std::mt19937 rng(13);
+    double table_ms = 0.0;
+    double walk_ms = 0.0;
+    std::size_t chars = 0;
+    for (const auto& f : GenerateHuffmanFrequencies())
+    {
+        HuffmanTree tree(f.second);
+        std::vector<uint8_t> data;
+        const std::size_t offset = tree.EncodeTree(data);
+        const ReferenceHuffmanTree reference(data, offset);
+        HuffmanTree decoded(data.data(), offset, data.size());
+        // Random bits, and runs of zeros and ones to reach the deepest leaves
+        std::vector<uint8_t> in;
+        for (int i = 0; i < 64; ++i)
+        {
+            const unsigned kind = rng() % 3;
+            for (int j = 0; j < 8; ++j)
+            {
+                in.push_back(kind == 0 ? 0x00 : (kind == 1 ? 0xFF : static_cast<uint8_t>(rng())));
+            }
+        }
+        BitReader tree_reader(in.data(), in.size());
+        BitReader decoded_reader(in.data(), in.size());
+        std::size_t pos = 0;
+        bool match = true;
+        for (int i = 0; i < 4096 && pos + reference.GetDepth() <= in.size() * 8; ++i)
+        {
+            const uint8_t chr = reference.Decode(in, pos);
+            match = match && tree.DecodeChar(tree_reader) == chr && decoded.DecodeChar(decoded_reader) == chr &&
+                tree_reader.GetBitPosition() == pos && decoded_reader.GetBitPosition() == pos;
+        }
+        Check(match, f.first + ": table decoding differs from walking the tree");
+
+        // Per-character throughput of the decoding table against walking the tree
+        for (int pass = 0; pass < 20; ++pass)
+        {
+            BitReader reader(in.data(), in.size());
+            auto start = std::chrono::steady_clock::now();
+            std::size_t count = 0;
+            for (int i = 0; i < 4096 && reader.GetBitPosition() + reference.GetDepth() <= in.size() * 8; ++i)
+            {
+                decoded.DecodeChar(reader);
+                ++count;
+            }
+            table_ms += ElapsedMs(start);
+            start = std::chrono::steady_clock::now();
+            pos = 0;
+            for (int i = 0; i < 4096 && pos + reference.GetDepth() <= in.size() * 8; ++i)
+            {
+                reference.Decode(in, pos);
+            }
+            walk_ms += ElapsedMs(start);
+            chars += count;
+        }
+    }
+    std::printf("  %zu chars: %.2f ms with tables, %.2f ms walking the tree\n", chars, table_ms, walk_ms);
+
+    // Whole strings, through trees loaded back from their encoded form
+    for (const auto& corpus : GetStringCorpora())
+    {
+        const auto& charset = Charset::GetDefaultCharset(corpus.region);
+        const auto eos_marker = Charset::GetEOSChar(corpus.region);
+        const auto& diacritic_map = Charset::GetDiacriticMap(corpus.region);
+        const auto encoded = EncodeHuffmanStrings(corpus.strings, corpus.region);
+        const auto reference = ReferenceHuffmanTrees(encoded.offsets, encoded.tables);
+        auto trees = std::make_shared<HuffmanTrees>(encoded.offsets.data(), encoded.offsets.size(),
+            encoded.tables.data(), encoded.tables.size(), encoded.offsets.size() / 2);
+        for (std::size_t i = 0; i < corpus.strings.size(); ++i)
+        {
+            const auto& bytes = encoded.encoded[i];
+            const std::vector<uint8_t> compressed(bytes.begin() + 1, bytes.end());
+            const HuffmanString decoded(bytes.data(), bytes.size(), trees, charset, eos_marker, diacritic_map);
+            Check(trees->DecompressString(compressed, eos_marker) == ReferenceHuffmanDecompress(reference, compressed, eos_marker) &&
+                decoded == HuffmanString(corpus.strings[i], trees, charset, eos_marker, diacritic_map),
+                corpus.name + " " + std::to_string(i) + " decoded differently");
+        }
+    }
+}
+
+void SelfTest::HuffmanEncoding()
+{
+    // A tree rebuilt in place must come out the same as a fresh one
+    HuffmanTree reused;
+    for (const auto& f : GenerateHuffmanFrequencies())
+    {
+        HuffmanTree tree(f.second);
+        std::vector<uint8_t> data;
+        const std::size_t offset = tree.EncodeTree(data);
+        const auto codes = ReferenceHuffmanTree(data, offset).GetCodes();
+        bool match = codes.size() == f.second.size();
+        std::size_t cost = 0;
+        for (unsigned c = 0; c < 0x100; ++c)
+        {
+            const auto code = codes.find(static_cast<uint8_t>(c));
+            BitWriter writer;
+            const bool valid = tree.EncodeChar(static_cast<uint8_t>(c), writer);
+            if (code == codes.end())
+            {
+                match = match && !valid;
+                continue;
+            }
+            cost += code->second.size() * f.second.at(static_cast<uint8_t>(c));
+            // Codes too long for the encoding table cannot be encoded
+            match = match && valid == (code->second.size() <= 32) &&
+                (!valid || (writer.GetBitCount() == code->second.size() && writer.GetBytes() == PackBits(code->second)));
+        }
+        Check(match, f.first + ": character codes differ from the tree");
+        Check(cost == ReferenceHuffmanCost(f.second), f.first + ": tree does not give the shortest encoding");
+
+        std::vector<uint8_t> rebuilt;
+        reused.RecalculateTree(f.second);
+        reused.EncodeTree(rebuilt);
+        Check(rebuilt == data, f.first + ": rebuilding a tree in place changed it");
+        reused.DecodeTree(data.data(), offset, data.size());
+        reused.EncodeTree(rebuilt);
+        Check(rebuilt == data, f.first + ": decoding a tree in place changed it");
+    }
+
+    // A tree that never ends must be reported before it outgrows its nodes
+    const std::vector<uint8_t> zeros(256, 0);
+    bool thrown = false;
+    try
+    {
+        HuffmanTree tree(zeros.data(), 128, zeros.size());
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    Check(thrown, "A corrupt tree was not reported");
+
+    // Whole strings, and the trees written back out after loading them
+    double codes_ms = 0.0;
+    double string_ms = 0.0;
+    std::size_t chars_encoded = 0;
+    for (const auto& corpus : GetStringCorpora())
+    {
+        const auto& charset = Charset::GetDefaultCharset(corpus.region);
+        const auto eos_marker = Charset::GetEOSChar(corpus.region);
+        const auto& diacritic_map = Charset::GetDiacriticMap(corpus.region);
+        const auto encoded = EncodeHuffmanStrings(corpus.strings, corpus.region);
+        const auto reference = ReferenceHuffmanTrees(encoded.offsets, encoded.tables);
+        auto trees = std::make_shared<HuffmanTrees>(encoded.offsets.data(), encoded.offsets.size(),
+            encoded.tables.data(), encoded.tables.size(), encoded.offsets.size() / 2);
+        std::vector<uint8_t> offsets;
+        std::vector<uint8_t> tables;
+        trees->EncodeTrees(offsets, tables);
+        Check(offsets == encoded.offsets && tables == encoded.tables, corpus.name + "s: trees were written back differently");
+        for (std::size_t i = 0; i < corpus.strings.size(); ++i)
+        {
+            const auto& bytes = encoded.encoded[i];
+            const std::vector<uint8_t> compressed(bytes.begin() + 1, bytes.end());
+            const auto chars = ReferenceHuffmanDecompress(reference, compressed, eos_marker);
+            Check(ReferenceHuffmanCompress(reference, chars, eos_marker) == compressed && trees->CompressString(chars, eos_marker) == compressed,
+                corpus.name + " " + std::to_string(i) + " encoded differently");
+            Check(HuffmanString(bytes.data(), bytes.size(), trees, charset, eos_marker, diacritic_map) ==
+                HuffmanString(corpus.strings[i], trees, charset, eos_marker, diacritic_map),
+                corpus.name + " " + std::to_string(i) + " did not survive the round trip");
+        }
+
+        // Encoding throughput of the integer codes against codes held as strings of bits, written
+        // one bit at a time
+        std::map<uint8_t, std::map<uint8_t, std::string>> string_codes;
+        for (const auto& tree : reference)
+        {
+            string_codes[tree.first] = tree.second.GetCodes();
+        }
+        std::vector<std::vector<uint8_t>> strings;
+        for (const auto& bytes : encoded.encoded)
+        {
+            strings.push_back(ReferenceHuffmanDecompress(reference, std::vector<uint8_t>(bytes.begin() + 1, bytes.end()), eos_marker));
+        }
+        for (int pass = 0; pass < 10; ++pass)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (const auto& str : strings)
+            {
+                chars_encoded += str.size();
+                trees->CompressString(str, eos_marker);
+            }
+            codes_ms += ElapsedMs(start);
+            start = std::chrono::steady_clock::now();
+            for (const auto& str : strings)
+            {
+                BitWriter writer;
+                uint8_t last = eos_marker;
+                for (auto chr : str)
+                {
+                    for (char bit : string_codes.at(last).at(chr))
+                    {
+                        writer.WriteBit(bit == '1');
+                    }
+                    last = chr;
+                }
+            }
+            string_ms += ElapsedMs(start);
+        }
+    }
+    std::printf("  %zu chars: %.2f ms with integer codes, %.2f ms with string codes\n", chars_encoded, codes_ms, string_ms);
+}
@@ -2,53 +2,74 @@
 #include <iostream>
 #include <queue>
 #include <algorithm>
+#include <stdexcept>
 
 HuffmanTree::HuffmanTree()
 {
-	m_root = new Node();
+	ClearNodes();
+	UpdateEncodingTable();
+	UpdateDecodingTable();
 }
 
 HuffmanTree::HuffmanTree(const CharFrequencies& frequencies)
 {
-	m_root = new Node();
 	RecalculateTree(frequencies);
 }
 
 HuffmanTree::HuffmanTree(const uint8_t* tree_data, size_t offset, size_t buffer_size)
 {
-	m_root = new Node();
 	DecodeTree(tree_data, offset, buffer_size);
 }
 
 HuffmanTree::~HuffmanTree()
 {
-	if (m_root) delete m_root;
+}
+
+template <class... Args>
+HuffmanTree::Node* HuffmanTree::NewNode(Args&&... args)
+{
+	// Storage is reserved up front, so existing nodes never move
+	if (m_nodes.size() >= MAX_NODES)
+	{
+		throw std::runtime_error("Huffman tree corruption detected.");
+	}
+	m_nodes.emplace_back(std::forward<Args>(args)...);
+	return &m_nodes.back();
+}
+
+void HuffmanTree::ClearNodes()
+{
+	m_nodes.clear();
+	m_nodes.reserve(MAX_NODES);
+	m_root = NewNode();
 }
 
 size_t HuffmanTree::EncodeTree(std::vector<uint8_t>& tree)
 {
 	size_t offset = 0;
-	BitBarrelWriter bb;
+	BitWriter bb;
 	tree.clear();
 	EncodeTreePreorder(bb, tree, m_root);
 	std::reverse(tree.begin(), tree.end());
 	offset = tree.size();
-	tree.insert(tree.end(), bb.Begin(), bb.End());
+	const auto bits = bb.GetBytes();
+	tree.insert(tree.end(), bits.begin(), bits.end());
 	return offset;
 }
 
-size_t HuffmanTree::DecodeTree(const uint8_t* tree_data, size_t offset, size_t /*buffer_size*/)
+size_t HuffmanTree::DecodeTree(const uint8_t* tree_data, size_t offset, size_t buffer_size)
 {
 	tree_data += offset;
-	BitBarrel leaves(tree_data);
+	BitReader leaves(tree_data, buffer_size > offset ? buffer_size - offset : 0);
+	ClearNodes();
 	Node* cur = m_root;
 	while (true)
 	{
-		if (leaves.getNextBit() == false) // node
+		if (leaves.ReadBit() == false) // node
 		{
 			if (cur->left == nullptr)
 			{
-				cur->left = new Node(cur);
+				cur->left = NewNode(cur);
 				cur = cur->left;
 
 			}
@@ -75,29 +96,32 @@ size_t HuffmanTree::DecodeTree(const uint8_t* tree_data, size_t offset, size_t /
 				// Filled the tree
 				break;
 			}
-			cur->right = new Node(cur);
+			cur->right = NewNode(cur);
 			cur = cur->right;
 		}
 	}
 
 	UpdateEncodingTable();
+	UpdateDecodingTable();
 
-	return leaves.getBytePosition();
+	return leaves.GetBytePosition();
 }
 
 void HuffmanTree::RecalculateTree(const CharFrequencies& frequencies)
 {
 	auto node_comparator = [](Node* lhs, Node* rhs) {return lhs->weight > rhs->weight;};
 	std::priority_queue< Node*, std::vector<Node*>, decltype(node_comparator)> nodes(node_comparator);
+	m_nodes.clear();
+	m_nodes.reserve(MAX_NODES);
 	// First, create all empty nodes with the identified chrs and weights
 	for (const auto& fc : frequencies)
 	{
-		nodes.push(new Node(fc.first, fc.second));
+		nodes.push(NewNode(fc.first, fc.second));
 	}
 	// Next, combine lowest weighted elements until we have a complete tree
 	while (nodes.size() > 1)
 	{
-		Node* tmp = new Node();
+		Node* tmp = NewNode();
 		tmp->left = nodes.top();
 		nodes.pop();
 		tmp->right = nodes.top();
@@ -108,17 +132,23 @@ void HuffmanTree::RecalculateTree(const CharFrequencies& frequencies)
 		nodes.push(tmp);
 	}
 	// This tree is now our new root
-	if (m_root != nullptr) delete m_root;
-	m_root = nodes.top();
+	m_root = nodes.empty() ? NewNode() : nodes.top();
 	UpdateEncodingTable();
+	UpdateDecodingTable();
 }
 
-uint8_t HuffmanTree::DecodeChar(BitBarrel& bb)
+uint8_t HuffmanTree::DecodeChar(BitReader& bb)
 {
-	Node* cur = m_root;
+	const DecodeEntry& entry = m_decoding[bb.Peek(m_table_bits)];
+	if (entry.node == nullptr)
+	{
+		throw std::runtime_error("Huffman tree is corrupt.");
+	}
+	bb.Consume(entry.length);
+	Node* cur = entry.node;
 	while (cur->chr == 0xFF)
 	{
-		if (bb.getNextBit() == false)
+		if (bb.ReadBit() == false)
 		{
 			if (cur->left != nullptr)
 			{
@@ -144,23 +174,17 @@ uint8_t HuffmanTree::DecodeChar(BitBarrel& bb)
 	return cur->chr;
 }
 
-bool HuffmanTree::EncodeChar(uint8_t chr, BitBarrelWriter& bb)
+bool HuffmanTree::EncodeChar(uint8_t chr, BitWriter& bb)
 {
-	bool success = false;
-
-	if (m_encoding.find(chr) != m_encoding.end())
+	const Code& code = m_encoding[chr];
+	if (code.valid)
 	{
-		for (auto c : m_encoding[chr])
-		{
-			bb.WriteBits(c == '1', 1);
-		}
-		success = true;
+		bb.WriteBits(code.code, code.length);
 	}
-
-	return success;
+	return code.valid;
 }
 
-void HuffmanTree::EncodeTreePreorder(BitBarrelWriter& bb, std::vector<uint8_t>& chrs, const Node* node)
+void HuffmanTree::EncodeTreePreorder(BitWriter& bb, std::vector<uint8_t>& chrs, const Node* node)
 {
 	if (node == nullptr)
 	{
@@ -187,25 +211,73 @@ void HuffmanTree::EncodeTreePreorder(BitBarrelWriter& bb, std::vector<uint8_t>&
 
 void HuffmanTree::UpdateEncodingTable()
 {
-	m_encoding.clear();
-	UpdateEncodingTable(m_root, "");
+	m_encoding.fill(Code());
+	UpdateEncodingTable(m_root, 0, 0);
 }
 
-void HuffmanTree::UpdateEncodingTable(Node* node, std::string encoding)
+void HuffmanTree::UpdateEncodingTable(Node* node, uint32_t code, unsigned length)
 {
 	if (node->chr != 0xFF)
 	{
-		m_encoding[node->chr] = encoding;
+		m_encoding[node->chr] = Code(code, length);
+	}
+	else if (length < MAX_CODE_BITS)
+	{
+		if (node->left != nullptr)
+		{
+			UpdateEncodingTable(node->left, code << 1, length + 1);
+		}
+		if (node->right != nullptr)
+		{
+			UpdateEncodingTable(node->right, (code << 1) | 1, length + 1);
+		}
+	}
+}
+
+void HuffmanTree::UpdateDecodingTable()
+{
+	m_table_bits = std::min(GetDepth(m_root), MAX_TABLE_BITS);
+	m_decoding.assign(static_cast<size_t>(1) << m_table_bits, DecodeEntry());
+	UpdateDecodingTable(m_root, 0, 0);
+}
+
+void HuffmanTree::UpdateDecodingTable(Node* node, uint32_t code, unsigned length)
+{
+	if (node->chr != 0xFF || length == m_table_bits)
+	{
+		// Every table index that begins with this code resolves to this node
+		const unsigned spare = m_table_bits - length;
+		for (uint32_t i = 0; i < (1U << spare); ++i)
+		{
+			m_decoding[(code << spare) | i] = DecodeEntry(node, length);
+		}
 	}
 	else
 	{
 		if (node->left != nullptr)
 		{
-			UpdateEncodingTable(node->left, encoding + "0");
+			UpdateDecodingTable(node->left, code << 1, length + 1);
+		}
+		if (node->right != nullptr)
+		{
+			UpdateDecodingTable(node->right, (code << 1) | 1, length + 1);
+		}
+	}
+}
+
+unsigned HuffmanTree::GetDepth(const Node* node)
+{
+	unsigned depth = 0;
+	if (node->chr == 0xFF)
+	{
+		if (node->left != nullptr)
+		{
+			depth = std::max(depth, GetDepth(node->left) + 1);
 		}
 		if (node->right != nullptr)
 		{
-			UpdateEncodingTable(node->right, encoding + "1");
+			depth = std::max(depth, GetDepth(node->right) + 1);
 		}
 	}
+	return depth;
 }
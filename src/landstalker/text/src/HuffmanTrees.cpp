@@ -5,8 +5,8 @@
 #include <iostream>
 #include <algorithm>
 
-#include <landstalker/misc/include/BitBarrel.h>
-#include <landstalker/misc/include/BitBarrelWriter.h>
+#include <landstalker/misc/include/BitReader.h>
+#include <landstalker/misc/include/BitWriter.h>
 #include <landstalker/misc/include/Utils.h>
 
 HuffmanTrees::HuffmanTrees()
@@ -69,16 +69,17 @@ void HuffmanTrees::EncodeTrees(std::vector<uint8_t>& huffman_char_offsets, std::
 std::vector<uint8_t> HuffmanTrees::CompressString(const std::vector<uint8_t>& decompressed, uint8_t eos_marker)
 {
 	uint8_t last = eos_marker;
-	BitBarrelWriter compressed;
+	BitWriter compressed;
 	for(auto chr : decompressed)
 	{
-		if (m_trees.find(last) == m_trees.end())
+		auto tree = m_trees.find(last);
+		if (tree == m_trees.end())
 		{
 			std::ostringstream ss;
 			ss << "Unable to compress string: Huffman table does not exist for character 0x" << std::hex << last << ".";
 			throw std::runtime_error(ss.str());
 		}
-		if (m_trees[last]->EncodeChar(chr, compressed) == false)
+		if (tree->second->EncodeChar(chr, compressed) == false)
 		{
 			std::ostringstream ss;
 			ss << "Unable to compress string: No entry in Huffman table 0x" << std::hex
@@ -91,25 +92,26 @@ std::vector<uint8_t> HuffmanTrees::CompressString(const std::vector<uint8_t>& de
 	{
 		throw std::runtime_error("String terminator " + Hex(eos_marker) + " not last character in string.");
 	}
-	return std::vector<uint8_t>(compressed.Begin(), compressed.End());
+	return compressed.GetBytes();
 }
 
 std::vector<uint8_t> HuffmanTrees::DecompressString(const std::vector<uint8_t>& compressed, uint8_t eos_marker)
 {
 	std::vector<uint8_t> decompressed;
 	uint8_t last = eos_marker;
-	BitBarrel bb(compressed.data());
+	BitReader bb(compressed.data(), compressed.size());
 	do
 	{
-		if (m_trees.find(last) == m_trees.end())
+		auto tree = m_trees.find(last);
+		if (tree == m_trees.end())
 		{
 			std::ostringstream ss;
 			ss << "Unable to decompress string: Huffman table does not exist for character " << Hex(last) << ".";
 			throw std::runtime_error(ss.str());
 		}
-		last = m_trees[last]->DecodeChar(bb);
+		last = tree->second->DecodeChar(bb);
 		decompressed.push_back(last);
-	} while (last != eos_marker && bb.getBytePosition() < compressed.size());
+	} while (last != eos_marker && bb.GetBytePosition() < compressed.size());
 	return decompressed;
 }
 
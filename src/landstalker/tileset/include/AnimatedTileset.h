@@ -15,7 +15,8 @@ public:
     bool operator!=(const AnimatedTileset& rhs) const;
 
     std::vector<uint8_t> GetTile(const Tile& tile, uint8_t frame) const;
-    std::vector<uint8_t>& GetTilePixels(int tile_index, uint8_t frame);
+    ConstTilePixels GetTilePixels(int tile_index, uint8_t frame) const;
+    void SetTilePixels(int tile_index, uint8_t frame, ConstTilePixels pixels);
 
     uint16_t GetBaseBytes() const;
     Tile GetStartTile() const;
@@ -8,7 +8,73 @@
 #include <landstalker/palettes/include/Palette.h>
 #include <landstalker/tileset/include/TileAttributes.h>
 #include <landstalker/tileset/include/Tile.h>
-    
+
+// Non-owning view of pixels held by a Tileset, one byte per pixel, row by row. It remains
+// valid until tiles are inserted into or deleted from the tileset.
+template<class T>
+class PixelSpan
+{
+public:
+    PixelSpan(T* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    T* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+    T& operator[](std::size_t i) const { return m_data[i]; }
+private:
+    T* m_data;
+    std::size_t m_size;
+};
+
+using ConstTilePixels = PixelSpan<const uint8_t>;
+
+// A tile as it appears with its flip attributes applied, read from the tileset in place
+class TileView
+{
+public:
+    TileView(ConstTilePixels pixels, std::size_t width, bool hflip, bool vflip)
+        : m_pixels(pixels), m_width(width), m_height(width == 0 ? 0 : pixels.size() / width), m_hflip(hflip), m_vflip(vflip) {}
+
+    std::size_t GetWidth() const { return m_width; }
+    std::size_t GetHeight() const { return m_height; }
+    bool IsHFlipped() const { return m_hflip; }
+    // Row y as displayed, before any horizontal flip. Read it backwards when IsHFlipped().
+    const uint8_t* GetRow(std::size_t y) const { return m_pixels.data() + (m_vflip ? m_height - 1 - y : y) * m_width; }
+    uint8_t At(std::size_t x, std::size_t y) const { return GetRow(y)[m_hflip ? m_width - 1 - x : x]; }
+    std::vector<uint8_t> ToVector() const;
+private:
+    ConstTilePixels m_pixels;
+    std::size_t m_width;
+    std::size_t m_height;
+    bool m_hflip;
+    bool m_vflip;
+};
+
+// Every 8x8 tile of a tileset in each of its four flip orientations, with the colour indicies
+// already applied. Rendering copies whole rows from here rather than mapping pixel by pixel.
+class TileFlipCache
+{
+public:
+    static const std::size_t TILE_BYTES = 64;
+
+    TileFlipCache(std::size_t tile_count) : m_tile_count(tile_count), m_pixels(tile_count * 4 * TILE_BYTES) {}
+
+    std::size_t GetTileCount() const { return m_tile_count; }
+    // The tile index must be in range
+    const uint8_t* Get(const Tile& tile) const
+    {
+        const std::size_t flips = (tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_HFLIP) ? 1 : 0) |
+                                  (tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_VFLIP) ? 2 : 0);
+        return m_pixels.data() + (tile.GetIndex() * 4 + flips) * TILE_BYTES;
+    }
+    uint8_t* GetMutable(std::size_t index, std::size_t flips) { return m_pixels.data() + (index * 4 + flips) * TILE_BYTES; }
+private:
+    std::size_t m_tile_count;
+    std::vector<uint8_t> m_pixels;
+};
+
 class Tileset
 {
 public:
@@ -50,7 +116,13 @@ public:
     void Reset(int size = -1);
     void Resize(int size);
     std::vector<uint8_t> GetTile(const Tile& tile) const;
-    std::vector<uint8_t>& GetTilePixels(int tile_index);
+    TileView GetTileView(const Tile& tile) const;
+    ConstTilePixels GetTilePixels(int tile_index) const;
+    // Replaces every pixel of a tile. Drops the flip cache, which is rebuilt when the tileset is
+    // next drawn.
+    void SetTilePixels(int tile_index, ConstTilePixels pixels);
+    // Built on first use after any change. Only 8x8 tilesets have one; others return nullptr.
+    std::shared_ptr<const TileFlipCache> GetFlipCache() const;
     std::vector<uint8_t> GetTileRGB(const Tile& tile, const Palette& palette) const;
     std::vector<uint8_t> GetTileA(const Tile& tile, const Palette& palette) const;
     std::vector<uint32_t> GetTileRGBA(const Tile& tile, const Palette& palette) const;
@@ -68,6 +140,7 @@ public:
     std::size_t GetTileBitDepth() const;
     BlockType   GetTileBlockType() const;
     bool        GetCompressed() const;
+    void        SetCompressed(bool compressed);
 
     void DeleteTile(int tile_number);
     void InsertTilesBefore(int tile_number, int count = 1);
@@ -78,6 +151,10 @@ public:
 private:
     void TransposeBlock();
     void UntransposeBlock(std::vector<uint8_t>& bits);
+    std::size_t GetTileArea() const;
+    std::size_t ClampTileIndex(std::size_t idx) const;
+    uint8_t* GetWritableTile(int tile_index);
+    void InvalidateFlipCache();
 
     std::size_t m_width;
     std::size_t m_height;
@@ -87,8 +164,11 @@ private:
     bool m_compressed;
     
     BlockType m_blocktype;
-    std::vector<std::vector<uint8_t>> m_tiles;
+    // Every tile's pixels back to back, GetTileArea() bytes per tile
+    std::vector<uint8_t> m_pixels;
     std::vector<uint8_t> m_colour_indicies;
+    // Shared between copies, and only ever replaced as a whole, so it is accessed atomically
+    mutable std::shared_ptr<const TileFlipCache> m_flip_cache;
 };
 
 #endif // TILESET_H
@@ -61,13 +61,20 @@ std::vector<uint8_t> AnimatedTileset::GetTile(const Tile& tile, uint8_t frame) c
 	return Tileset::GetTile(static_cast<uint16_t>(t + f_offset));
 }
 
-std::vector<uint8_t>& AnimatedTileset::GetTilePixels(int tile_index, uint8_t frame)
+ConstTilePixels AnimatedTileset::GetTilePixels(int tile_index, uint8_t frame) const
 {
 	auto t = tile_index - GetStartTile().GetIndex();
 	auto f_offset = frame * GetFrameSizeTiles();
 	return Tileset::GetTilePixels(t + f_offset);
 }
 
+void AnimatedTileset::SetTilePixels(int tile_index, uint8_t frame, ConstTilePixels pixels)
+{
+	auto t = tile_index - GetStartTile().GetIndex();
+	auto f_offset = frame * GetFrameSizeTiles();
+	Tileset::SetTilePixels(t + f_offset, pixels);
+}
+
 uint16_t AnimatedTileset::GetBaseBytes() const
 {
 	return m_base;
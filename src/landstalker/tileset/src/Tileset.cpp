@@ -3,34 +3,14 @@
 #include <sstream>
 #include <numeric>
 #include <iterator>
+#include <utility>
 #include <landstalker/misc/include/Utils.h>
 #include <landstalker/misc/include/LZ77.h>
 #include <landstalker/misc/include/Literals.h>
 
 static const std::size_t MAXIMUM_CAPACITY = 0x400;
-
-template<class T>
-void HFlip(std::vector<T>& elems, int width)
-{
-    int height = elems.size() / width;
-    for (int i = 0; i < height; ++i)
-    {
-        auto source_it = elems.begin() + width * i;
-        std::reverse(source_it, source_it + width);
-    }
-}
-
-template<class T>
-void VFlip(std::vector<T>& elems, int width)
-{
-    int height = elems.size() / width;
-    for (int i = 0; i < height / 2; ++i)
-    {
-        auto source_it = elems.begin() + width * i;
-        auto dest_it = elems.end() - width * (i + 1);
-        std::swap_ranges(source_it, source_it + width, dest_it);
-    }
-}
+// Size of VDP VRAM, the largest a decompressed tileset can usefully be
+static const std::size_t MAXIMUM_DECOMPRESSED_SIZE = 65536;
 
 struct BlockDimensions
 {
@@ -87,7 +67,7 @@ bool Tileset::operator==(const Tileset& rhs) const
     return ((this->m_bit_depth == rhs.m_bit_depth) &&
         (this->m_tileheight == rhs.m_tileheight) &&
         (this->m_tilewidth == rhs.m_tilewidth) &&
-        (this->m_tiles == rhs.m_tiles));
+        (this->m_pixels == rhs.m_pixels));
 }
 
 bool Tileset::operator!=(const Tileset& rhs) const
@@ -97,6 +77,7 @@ bool Tileset::operator!=(const Tileset& rhs) const
 
 uint32_t Tileset::SetBits(const std::vector<uint8_t>& src, bool compressed)
 {
+    InvalidateFlipCache();
     const std::size_t tile_size_bytes = m_width * m_height * m_bit_depth / 8;
     const std::vector<uint8_t>* input = &src;
     m_compressed = compressed;
@@ -105,38 +86,36 @@ uint32_t Tileset::SetBits(const std::vector<uint8_t>& src, bool compressed)
 	std::vector<uint8_t> buffer;
     if (compressed == true)
     {
-		buffer.resize(65536);
+		buffer.resize(MAXIMUM_DECOMPRESSED_SIZE);
         std::size_t elen, dlen;
-        dlen = LZ77::Decode(src.data(), src.size(), buffer.data(), elen);
+        // Tilesets have always been accepted without an end marker
+        const auto result = LZ77::Decode(src.data(), src.size(), buffer.data(), buffer.size(), elen, dlen);
+        if (result != LZ77::DecodeResult::OK && result != LZ77::DecodeResult::MISSING_END_MARKER)
+        {
+            throw std::runtime_error("Bad LZ77 compressed tileset!");
+        }
         buffer.resize(dlen);
         input = &buffer;
         ret = elen;
     }
     const std::size_t num_tiles = (input->size() + (tile_size_bytes - 1)) / tile_size_bytes;
 
-    m_tiles.clear();
-    m_tiles.assign(num_tiles, std::vector<uint8_t>(m_width * m_height));
-    std::size_t tc = 0;
-    for (auto& t : m_tiles)
+    // Unpacked straight into the arena. A partial last tile is padded with zeroes.
+    m_pixels.assign(num_tiles * GetTileArea(), 0);
+    const std::size_t pixels_per_byte = 8 / m_bit_depth;
+    const std::size_t bytes = std::min(input->size(), num_tiles * tile_size_bytes);
+    uint8_t* out = m_pixels.data();
+    for (std::size_t i = 0; i < bytes; ++i)
     {
-        for (std::size_t i = 0; i < tile_size_bytes; ++i)
+        const uint8_t byte = (*input)[i];
+        uint8_t shift = static_cast<uint8_t>(8 - m_bit_depth);
+        uint8_t mask = static_cast<uint8_t>(0xFF << shift);
+        for (std::size_t p = 0; p < pixels_per_byte; ++p)
         {
-            uint8_t byte = 0;
-            if (i + tc < input->size())
-            {
-                byte = input->at(i + tc);
-            }
-            uint8_t shift = static_cast<uint8_t>(8 - m_bit_depth);
-            uint8_t mask = static_cast<uint8_t>(0xFF << shift);
-            const std::size_t pixels_per_byte = 8 / m_bit_depth;
-            for (std::size_t p = 0; p < pixels_per_byte; ++p)
-            {
-                t[i * pixels_per_byte + p] = (byte & mask) >> shift;
-                mask >>= static_cast<uint8_t>(m_bit_depth);
-                shift -= static_cast<uint8_t>(m_bit_depth);
-            }
+            *out++ = (byte & mask) >> shift;
+            mask >>= static_cast<uint8_t>(m_bit_depth);
+            shift -= static_cast<uint8_t>(m_bit_depth);
         }
-        tc += tile_size_bytes;
     }
     TransposeBlock();
     return ret;
@@ -188,76 +167,62 @@ bool Tileset::Open(const std::string& filename, bool compressed, std::size_t wid
 std::vector<uint8_t> Tileset::GetBits(bool compressed)
 {
     std::vector<uint8_t> bits;
-    std::vector<uint8_t> buffer;
-    std::vector<std::vector<uint8_t>> tilebuf;
-    std::vector<uint8_t>* retval = &bits;
-    const std::vector<std::vector<uint8_t>>& tiles = (m_blocktype != BlockType::NORMAL) ? tilebuf : m_tiles;
-
-    bits.reserve(m_width * m_height * m_tiles.size() * m_bit_depth / 8);
-    if (m_blocktype != BlockType::NORMAL)
+    bits.reserve(m_pixels.size() * m_bit_depth / 8);
+    uint8_t byte = 0;
+    uint8_t bit = 0;
+    // Convert to n-bitdepth
+    auto pack = [&](const uint8_t* p, std::size_t count)
     {
-        // Convert back into tiles and reverse transpose
-        for (const auto& t : m_tiles)
+        for (const uint8_t* end = p + count; p != end; ++p)
         {
-            for (int x = 0; x < BLOCK_DIMENSIONS.at(m_blocktype).width; ++x)
-            {
-                for (int y = 0; y < BLOCK_DIMENSIONS.at(m_blocktype).height; ++y)
-                {
-                    tilebuf.insert(tilebuf.end(), std::vector<uint8_t>());
-                    for (std::size_t i = 0; i < m_tileheight; ++i)
-                    {
-                        auto line = t.begin() + i * m_width + x * m_tilewidth + y * m_width * m_tileheight;
-                        tilebuf.back().insert(tilebuf.back().end(), line, line + m_tilewidth);
-                    }
-                }
-            }
-            if (m_blocktype == BlockType::BLOCK4X6)
+            byte <<= m_bit_depth;
+            byte |= *p & (0xFF >> (8 - m_bit_depth));
+            bit += static_cast<uint8_t>(m_bit_depth);
+            if (bit == 8)
             {
-                // Additional processing for block4x6 special case 
-                // Fix tile ordering
-                // Block would be transposed as follows:
-                // 00  06  12  18       00  04  08  12
-                // 01  07  13  19       01  05  09  13
-                // 02  08  14  20  ==>  02  06  10  14
-                // 03  09  15  21       03  07  11  15
-                // 04  10  16  22       16  18  20  22
-                // 05  11  17  23       17  19  21  23
-                auto block_start = tilebuf.end() - BLOCK_DIMENSIONS.at(m_blocktype).Area();
-                auto block_end = tilebuf.end();
-                std::vector<std::vector<uint8_t>> blockbuf(block_start, block_end);
-                std::array<uint8_t, 24> UntransposeLUT{ 0,1,2,3,6,7,8,9,12,13,14,15,18,19,20,21,4,5,10,11,16,17,22,23 };
-                for (std::size_t i = 0; i < blockbuf.size(); ++i)
-                {
-                    block_start[i] = blockbuf[UntransposeLUT[i]];
-                }
+                bit = 0;
+                bits.push_back(byte);
             }
         }
+    };
+    if (m_blocktype == BlockType::NORMAL)
+    {
+        pack(m_pixels.data(), m_pixels.size());
     }
-    for (const auto& t : tiles)
+    else
     {
-        // Convert to n-bitdepth
-        uint8_t byte = 0;
-        uint8_t bit = 0;
-        for (const auto& p : t)
+        // Read each block back out as tiles, reversing the transpose. Blocks would be transposed
+        // column by column, except for block4x6 which is split into two:
+        // 00  06  12  18       00  04  08  12
+        // 01  07  13  19       01  05  09  13
+        // 02  08  14  20  ==>  02  06  10  14
+        // 03  09  15  21       03  07  11  15
+        // 04  10  16  22       16  18  20  22
+        // 05  11  17  23       17  19  21  23
+        const std::array<uint8_t, 24> UntransposeLUT{ 0,1,2,3,6,7,8,9,12,13,14,15,18,19,20,21,4,5,10,11,16,17,22,23 };
+        const auto& DIMS = BLOCK_DIMENSIONS.at(m_blocktype);
+        for (std::size_t b = 0; b < m_pixels.size(); b += GetTileArea())
         {
-            byte <<= m_bit_depth;
-            byte |= p & (0xFF >> (8 - m_bit_depth));
-            bit += static_cast<uint8_t>(m_bit_depth);
-            if (bit == 8)
+            for (int i = 0; i < DIMS.Area(); ++i)
             {
-                bit = 0;
-                bits.push_back(byte);
+                const int k = (m_blocktype == BlockType::BLOCK4X6) ? UntransposeLUT[i] : i;
+                const int x = k / DIMS.height;
+                const int y = k % DIMS.height;
+                for (std::size_t row = 0; row < m_tileheight; ++row)
+                {
+                    pack(m_pixels.data() + b + row * m_width + x * m_tilewidth + y * m_width * m_tileheight, m_tilewidth);
+                }
             }
         }
     }
     if (compressed)
     {
-        buffer.resize(65536);
+        std::vector<uint8_t> buffer(65536);
         auto csize = LZ77::Encode(bits.data(), bits.size(), buffer.data());
         buffer.resize(csize);
-        retval = &buffer;
+        return buffer;
     }
-    return *retval;
+    return bits;
 }
 
 bool Tileset::Save(const std::string& filename, bool compressed)
@@ -276,111 +241,95 @@ bool Tileset::Save(const std::string& filename, bool compressed)
 
 void Tileset::Clear()
 {
-    m_tiles.clear();
+    InvalidateFlipCache();
+    m_pixels.clear();
 }
 
 void Tileset::Reset(int size)
 {
+    InvalidateFlipCache();
     if (size != -1)
     {
-        m_tiles.resize(size);
-    }
-    for (auto& elem : m_tiles)
-    {
-        std::fill(elem.begin(), elem.end(), 0_u8);
+        m_pixels.resize(size * GetTileArea());
     }
+    std::fill(m_pixels.begin(), m_pixels.end(), 0_u8);
 }
 
 void Tileset::Resize(int size)
 {
-    m_tiles.resize(size);
+    InvalidateFlipCache();
+    m_pixels.resize(size * GetTileArea(), 0_u8);
 }
 
 std::vector<uint8_t> Tileset::GetTileRGB(const Tile& tile, const Palette& palette) const
 {
-    auto t = GetTile(tile);
+    const auto t = GetTileView(tile);
     std::vector<uint8_t> ret;
     ret.reserve(m_width * m_height * 3);
-    for (auto p : t)
+    for (std::size_t y = 0; y < t.GetHeight(); ++y)
     {
-        if (m_colour_indicies.empty())
+        for (std::size_t x = 0; x < t.GetWidth(); ++x)
         {
+            const uint8_t p = m_colour_indicies.empty() ? t.At(x, y) : m_colour_indicies[t.At(x, y)];
             ret.push_back(palette.getR(p));
             ret.push_back(palette.getG(p));
             ret.push_back(palette.getB(p));
         }
-        else
-        {
-            ret.push_back(palette.getR(m_colour_indicies[p]));
-            ret.push_back(palette.getG(m_colour_indicies[p]));
-            ret.push_back(palette.getB(m_colour_indicies[p]));
-        }
     }
-
     return ret;
 }
 
 std::vector<uint8_t> Tileset::GetTileA(const Tile& tile, const Palette& palette) const
 {
-    auto t = GetTile(tile);
+    const auto t = GetTileView(tile);
     std::vector<uint8_t> ret;
     ret.reserve(m_width * m_height);
-    for (auto p : t)
+    for (std::size_t y = 0; y < t.GetHeight(); ++y)
     {
-        if (m_colour_indicies.empty())
+        for (std::size_t x = 0; x < t.GetWidth(); ++x)
         {
+            const uint8_t p = m_colour_indicies.empty() ? t.At(x, y) : m_colour_indicies[t.At(x, y)];
             ret.push_back(palette.getA(p));
         }
-        else
-        {
-            ret.push_back(palette.getA(m_colour_indicies[p]));
-        }
     }
     return ret;
 }
 
 std::vector<uint32_t> Tileset::GetTileRGBA(const Tile& tile, const Palette& palette) const
 {
-    auto t = GetTile(tile);
+    const auto t = GetTileView(tile);
     std::vector<uint32_t> ret;
     ret.reserve(m_width * m_height);
-    for (auto p : t)
+    for (std::size_t y = 0; y < t.GetHeight(); ++y)
     {
-        if (m_colour_indicies.empty())
+        for (std::size_t x = 0; x < t.GetWidth(); ++x)
         {
+            const uint8_t p = m_colour_indicies.empty() ? t.At(x, y) : m_colour_indicies[t.At(x, y)];
             ret.push_back(palette.getRGBA(p));
         }
-        else
-        {
-            ret.push_back(palette.getRGBA(m_colour_indicies[p]));
-        }
     }
-
     return ret;
 }
 
 std::vector<uint32_t> Tileset::GetTileBGRA(const Tile& tile, const Palette& palette) const
 {
-    auto t = GetTile(tile);
+    const auto t = GetTileView(tile);
     std::vector<uint32_t> ret;
     ret.reserve(m_width * m_height);
-    for (auto p : t)
+    for (std::size_t y = 0; y < t.GetHeight(); ++y)
     {
-        if (m_colour_indicies.empty())
+        for (std::size_t x = 0; x < t.GetWidth(); ++x)
         {
+            const uint8_t p = m_colour_indicies.empty() ? t.At(x, y) : m_colour_indicies[t.At(x, y)];
             ret.push_back(palette.getBGRA(p));
         }
-        else
-        {
-            ret.push_back(palette.getBGRA(m_colour_indicies[p]));
-        }
     }
-
     return ret;
 }
 
 void Tileset::SetColourIndicies(const std::vector<uint8_t>& colour_indicies)
 {
+    InvalidateFlipCache();
 	if (colour_indicies.size() == 0)
 	{
 		m_colour_indicies.clear();
@@ -432,7 +381,7 @@ std::array<bool, 16> Tileset::GetLockedColours() const
 
 std::size_t Tileset::GetTileCount() const
 {
-    return m_tiles.size();
+    return GetTileArea() == 0 ? 0 : m_pixels.size() / GetTileArea();
 }
 
 std::size_t Tileset::GetTileSizeBytes() const
@@ -442,7 +391,7 @@ std::size_t Tileset::GetTileSizeBytes() const
 
 std::size_t Tileset::GetTilesetUncompressedSizeBytes() const
 {
-	return m_tiles.size() * GetTileSizeBytes();
+	return GetTileCount() * GetTileSizeBytes();
 }
 
 std::size_t Tileset::GetTileWidth() const
@@ -470,23 +419,28 @@ bool Tileset::GetCompressed() const
     return m_compressed;
 }
 
+void Tileset::SetCompressed(bool compressed)
+{
+    m_compressed = compressed;
+}
+
 void Tileset::DeleteTile(int tile_number)
 {
-    if ((tile_number >= 0) && (tile_number < static_cast<int>(m_tiles.size())))
+    InvalidateFlipCache();
+    if ((tile_number >= 0) && (tile_number < static_cast<int>(GetTileCount())))
     {
-        m_tiles.erase(m_tiles.begin() + tile_number);
+        auto it = m_pixels.begin() + tile_number * GetTileArea();
+        m_pixels.erase(it, it + GetTileArea());
     }
 }
 
 void Tileset::InsertTilesBefore(int tile_number, int count)
 {
-    if ((tile_number >= 0) && (tile_number <= static_cast<int>(m_tiles.size())) &&
+    InvalidateFlipCache();
+    if ((tile_number >= 0) && (tile_number <= static_cast<int>(GetTileCount())) &&
         (tile_number + count <= static_cast<int>(MAXIMUM_CAPACITY)))
     {
-        for (int i = 0; i < count; ++i)
-        {
-            m_tiles.insert(m_tiles.begin() + tile_number, std::vector<uint8_t>(m_width * m_height));
-        }
+        m_pixels.insert(m_pixels.begin() + tile_number * GetTileArea(), count * GetTileArea(), 0_u8);
     }
 	else
 	{
@@ -496,27 +450,29 @@ void Tileset::InsertTilesBefore(int tile_number, int count)
 
 void Tileset::DuplicateTile(const Tile& src, const Tile& dst)
 {
-    if ((src.GetIndex() < m_tiles.size()) &&
-        (dst.GetIndex() < m_tiles.size()) &&
+    if ((src.GetIndex() < GetTileCount()) &&
+        (dst.GetIndex() < GetTileCount()) &&
         (src.GetIndex() != dst.GetIndex()))
     {
-        m_tiles[src.GetIndex()] = m_tiles[dst.GetIndex()];
+        SetTilePixels(src.GetIndex(), std::as_const(*this).GetTilePixels(dst.GetIndex()));
     }
 }
 
 void Tileset::SwapTile(const Tile& lhs, const Tile& rhs)
 {
-    if ((lhs.GetIndex() < m_tiles.size()) &&
-        (rhs.GetIndex() < m_tiles.size()) &&
+    if ((lhs.GetIndex() < GetTileCount()) &&
+        (rhs.GetIndex() < GetTileCount()) &&
         (lhs.GetIndex() != rhs.GetIndex()))
     {
-        std::swap(m_tiles[lhs.GetIndex()], m_tiles[rhs.GetIndex()]);
+        uint8_t* a = GetWritableTile(lhs.GetIndex());
+        std::swap_ranges(a, a + GetTileArea(), GetWritableTile(rhs.GetIndex()));
+        InvalidateFlipCache();
     }
 }
 
 void Tileset::SetTile(const Tile& src, const std::vector<uint8_t>& value)
 {
-    if (src.GetIndex() < m_tiles.size())
+    if (src.GetIndex() < GetTileCount())
     {
         if (value.size() == m_height * m_width)
         {
@@ -531,7 +487,7 @@ void Tileset::SetTile(const Tile& src, const std::vector<uint8_t>& value)
             }
             if (ok)
             {
-                m_tiles[src.GetIndex()] = value;
+                SetTilePixels(src.GetIndex(), ConstTilePixels(value.data(), value.size()));
             }
         }
     }
@@ -544,16 +500,17 @@ void Tileset::TransposeBlock()
         return;
     }
     const auto& DIMS = BLOCK_DIMENSIONS.at(m_blocktype);
-    std::vector<uint8_t>::const_iterator src_it;
+    // Each block is rearranged from a copy, and the one copy is reused for every block
+    std::vector<uint8_t> block(GetTileArea());
     if (m_blocktype != BlockType::BLOCK4X6)
     {
-        for (auto& b : m_tiles)
+        for (auto b = m_pixels.begin(); b != m_pixels.end(); b += GetTileArea())
         {
-            std::vector<uint8_t> t = b;
-            src_it = t.begin();
+            std::copy(b, b + GetTileArea(), block.begin());
+            auto src_it = block.cbegin();
             for (int x = 0; x < DIMS.width; ++x)
             {
-                auto dest_it = b.begin();
+                auto dest_it = b;
                 for (std::size_t y = 0; y < m_height; ++y)
                 {
                     std::copy(src_it, src_it + m_tilewidth, dest_it + x * m_tilewidth);
@@ -577,20 +534,15 @@ void Tileset::TransposeBlock()
         //  Here, we store which tiles need to be copied where, and use this lookup table to do
         //  the transform.
         const std::array<int, 24> transpose4x6  { 0,4,8,12,1,5,9,13,2,6,10,14,3,7,11,15,16,18,20,22,17,19,21,23};
+        const std::size_t tile_area = m_tileheight * m_tilewidth;
 
-        for (auto& b : m_tiles)
+        for (auto b = m_pixels.begin(); b != m_pixels.end(); b += GetTileArea())
         {
-            std::vector<std::vector<uint8_t>> tilebuf;
-            src_it = b.begin();
+            std::copy(b, b + GetTileArea(), block.begin());
             for (int i = 0; i < DIMS.Area(); ++i)
             {
-                tilebuf.push_back(std::vector<uint8_t>(src_it, src_it + m_tileheight * m_tilewidth));
-                src_it += m_tileheight * m_tilewidth;
-            }
-            for (std::size_t i = 0; i < tilebuf.size(); ++i)
-            {
-                src_it = tilebuf[transpose4x6[i]].begin();
-                auto dest_it = b.begin() + (i % DIMS.width) * m_tilewidth + (i / DIMS.width) * m_width * m_tileheight;
+                auto src_it = block.cbegin() + transpose4x6[i] * tile_area;
+                auto dest_it = b + (i % DIMS.width) * m_tilewidth + (i / DIMS.width) * m_width * m_tileheight;
                 for (std::size_t y = 0; y < m_tileheight; ++y)
                 {
                     std::copy(src_it, src_it + m_tilewidth, dest_it + y * m_width);
@@ -606,36 +558,132 @@ void Tileset::UntransposeBlock(std::vector<uint8_t>& /*bits*/)
     // const std::array<int, 24> untranspose4x6{ 0,4,8,12,1,5,9,13,2,6,10,14,3,7,11,15,16,20,17,21,18,22,19,23};
 }
 
-std::vector<uint8_t> Tileset::GetTile(const Tile& tile) const
+std::size_t Tileset::GetTileArea() const
+{
+    return m_width * m_height;
+}
+
+std::size_t Tileset::ClampTileIndex(std::size_t idx) const
 {
-    std::size_t idx = tile.GetIndex();
-    if (idx >= m_tiles.size())
+    if (idx >= GetTileCount())
     {
         std::ostringstream ss;
         ss << "Attempt to obtain out-of-range tile " << idx;
         Debug(ss.str());
         idx = 0;
     }
-    std::vector<uint8_t> ret(m_tiles[idx]);
-    if (tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_VFLIP))
+    return idx;
+}
+
+std::vector<uint8_t> Tileset::GetTile(const Tile& tile) const
+{
+    return GetTileView(tile).ToVector();
+}
+
+TileView Tileset::GetTileView(const Tile& tile) const
+{
+    const std::size_t idx = ClampTileIndex(tile.GetIndex());
+    // An empty tileset gives an empty view, rather than reading past the end of the arena
+    const std::size_t size = (idx < GetTileCount()) ? GetTileArea() : 0;
+    return TileView(ConstTilePixels(m_pixels.data() + idx * GetTileArea(), size), m_width,
+        tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_HFLIP),
+        tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_VFLIP));
+}
+
+uint8_t* Tileset::GetWritableTile(int tile_index)
+{
+    if ((tile_index < 0) || (tile_index >= static_cast<int>(GetTileCount())))
     {
-        VFlip(ret, m_width);
+        std::ostringstream ss;
+        ss << "Attempt to obtain out-of-range tile " << tile_index;
+        Debug(ss.str());
+        throw(ss.str());
     }
-    if (tile.Attributes().getAttribute(TileAttributes::Attribute::ATTR_HFLIP))
+    return m_pixels.data() + tile_index * GetTileArea();
+}
+
+ConstTilePixels Tileset::GetTilePixels(int tile_index) const
+{
+    if ((tile_index < 0) || (tile_index >= static_cast<int>(GetTileCount())))
     {
-        HFlip(ret, m_width);
+        std::ostringstream ss;
+        ss << "Attempt to obtain out-of-range tile " << tile_index;
+        Debug(ss.str());
+        throw(ss.str());
     }
-    return ret;
+    return ConstTilePixels(m_pixels.data() + tile_index * GetTileArea(), GetTileArea());
 }
 
-std::vector<uint8_t>& Tileset::GetTilePixels(int tile_index)
+void Tileset::SetTilePixels(int tile_index, ConstTilePixels pixels)
 {
-    if ((tile_index < 0) || (tile_index >= static_cast<int>(m_tiles.size())))
+    uint8_t* dest = GetWritableTile(tile_index);
+    if (pixels.size() != GetTileArea())
     {
         std::ostringstream ss;
-        ss << "Attempt to obtain out-of-range tile " << tile_index;
+        ss << "Attempt to set " << pixels.size() << " pixels of tile " << tile_index << ", which has " << GetTileArea();
         Debug(ss.str());
         throw(ss.str());
     }
-    return m_tiles[tile_index];
+    std::copy(pixels.begin(), pixels.end(), dest);
+    // The cache is shared between copies of the tileset, so it is replaced rather than patched
+    InvalidateFlipCache();
+}
+
+std::shared_ptr<const TileFlipCache> Tileset::GetFlipCache() const
+{
+    if (m_width != 8 || m_height != 8)
+    {
+        return nullptr;
+    }
+    auto cache = std::atomic_load(&m_flip_cache);
+    if (cache == nullptr)
+    {
+        // Concurrent readers may each build one; they are identical, and the last one stored wins
+        std::vector<uint8_t> cmap = m_colour_indicies.empty() ? GetDefaultColourIndicies() : m_colour_indicies;
+        cmap.resize(256, 0);
+        auto built = std::make_shared<TileFlipCache>(GetTileCount());
+        for (std::size_t t = 0; t < GetTileCount(); ++t)
+        {
+            const uint8_t* src = m_pixels.data() + t * GetTileArea();
+            for (std::size_t flips = 0; flips < 4; ++flips)
+            {
+                uint8_t* dst = built->GetMutable(t, flips);
+                for (std::size_t y = 0; y < 8; ++y)
+                {
+                    const uint8_t* row = src + ((flips & 2) ? 7 - y : y) * 8;
+                    for (std::size_t x = 0; x < 8; ++x)
+                    {
+                        *dst++ = cmap[row[(flips & 1) ? 7 - x : x]];
+                    }
+                }
+            }
+        }
+        cache = built;
+        std::atomic_store(&m_flip_cache, cache);
+    }
+    return cache;
+}
+
+void Tileset::InvalidateFlipCache()
+{
+    std::atomic_store(&m_flip_cache, std::shared_ptr<const TileFlipCache>());
+}
+
+std::vector<uint8_t> TileView::ToVector() const
+{
+    std::vector<uint8_t> ret(m_width * m_height);
+    auto it = ret.begin();
+    for (std::size_t y = 0; y < m_height; ++y)
+    {
+        const uint8_t* row = GetRow(y);
+        if (m_hflip)
+        {
+            it = std::reverse_copy(row, row + m_width, it);
+        }
+        else
+        {
+            it = std::copy(row, row + m_width, it);
+        }
+    }
+    return ret;
 }
@@ -0,0 +1,11 @@
+#ifndef _ALLOCATION_COUNT_H_
+#define _ALLOCATION_COUNT_H_
+
+#include <cstddef>
+
+// Number of allocations made through the global operator new so far. Allocations are only
+// counted when built with LS_COUNT_ALLOCATIONS defined (make COUNT_ALLOCATIONS=yes), which
+// replaces the global operator new and delete; otherwise this is always zero.
+std::size_t GetAllocationCount();
+
+#endif // _ALLOCATION_COUNT_H_
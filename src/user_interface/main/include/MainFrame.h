@@ -130,6 +130,7 @@ private:
     ReturnCode SaveToRom(std::string path = std::string());
     void SetMode(const Mode& mode);
     void Refresh();
+    void ShowLoadErrors();
 	ImageList& GetImageList();
     void ProcessSelectedBrowserItem(const wxTreeItemId& item);
     TilesetEditorFrame* GetTilesetEditor();
@@ -0,0 +1,164 @@
+#include <user_interface/main/include/AllocationCount.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef LS_COUNT_ALLOCATIONS
+namespace
+{
+	std::atomic<std::size_t> allocation_count(0);
+
+	void* CountedAllocate(std::size_t size, std::size_t alignment) noexcept
+	{
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		size = std::max<std::size_t>(size, 1);
+		if (alignment <= alignof(std::max_align_t))
+		{
+			return std::malloc(size);
+		}
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void* CountedAllocateOrThrow(std::size_t size, std::size_t alignment)
+	{
+		if (void* p = CountedAllocate(size, alignment))
+		{
+			return p;
+		}
+		throw std::bad_alloc();
+	}
+
+	void CountedFree(void* p, std::size_t alignment) noexcept
+	{
+#ifdef _WIN32
+		if (alignment > alignof(std::max_align_t))
+		{
+			_aligned_free(p);
+			return;
+		}
+#else
+		(void)alignment;
+#endif
+		std::free(p);
+	}
+}
+
+std::size_t GetAllocationCount()
+{
+	return allocation_count.load(std::memory_order_relaxed);
+}
+
+// Every replaceable form is replaced, so that no allocation goes uncounted and no block is
+// freed by a different allocator from the one that made it
+
+void* operator new(std::size_t size)
+{
+	return CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new[](std::size_t size)
+{
+	return CountedAllocateOrThrow(size, 0);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size, 0);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return CountedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return CountedAllocateOrThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+	CountedFree(p, 0);
+}
+
+void operator delete[](void* p) noexcept
+{
+	CountedFree(p, 0);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	CountedFree(p, 0);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	CountedFree(p, 0);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	CountedFree(p, 0);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	CountedFree(p, 0);
+}
+
+void operator delete(void* p, std::align_val_t alignment) noexcept
+{
+	CountedFree(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* p, std::align_val_t alignment) noexcept
+{
+	CountedFree(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	CountedFree(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t alignment) noexcept
+{
+	CountedFree(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	CountedFree(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* p, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	CountedFree(p, static_cast<std::size_t>(alignment));
+}
+#else
+std::size_t GetAllocationCount()
+{
+	return 0;
+}
+#endif
@@ -352,7 +352,7 @@ void MainFrame::InitUI()
 
 void MainFrame::InitConfig()
 {
-    AssemblyBuilderDialog::InitConfig(m_config);
+    PreferencesDialog::InitConfig(m_config);
 }
 
 MainFrame::ReturnCode MainFrame::Save()
@@ -641,6 +641,10 @@ MainFrame::ReturnCode MainFrame::CloseFiles(bool force)
     m_browser->DeleteAllItems();
     m_browser->SetImageList(m_imgs);
     m_properties->GetGrid()->Clear();
+    if (m_g)
+    {
+        m_g->WriteSnapshot();
+    }
     m_g.reset();
     SetMode(Mode::NONE);
     this->SetLabel("Landstalker Editor");
@@ -841,6 +845,25 @@ void MainFrame::Refresh()
         HideAllEditors();
         break;
     }
+    // Entries are decoded on first use, which may not be until the editor is drawn
+    CallAfter(&MainFrame::ShowLoadErrors);
+}
+
+void MainFrame::ShowLoadErrors()
+{
+    if (m_g == nullptr)
+    {
+        return;
+    }
+    std::string message;
+    for (const auto& error : m_g->TakeLoadErrors())
+    {
+        message += "\n" + error;
+    }
+    if (!message.empty())
+    {
+        wxMessageBox("Unable to decode:" + message + "\nEmpty data is shown in its place.", "Error", wxICON_ERROR);
+    }
 }
 
 ImageList& MainFrame::GetImageList()
@@ -4,6 +4,1132 @@
 #include <wx/image.h>
 #include <wx/cmdline.h>
 #include <string>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <filesystem>
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <user_interface/main/include/AllocationCount.h>
+#include <landstalker/main/include/SelfTest.h>
+#include <landstalker/main/include/ImageBuffer.h>
+#include <landstalker/main/include/RoomRenderer.h>
+#include <landstalker/main/include/PngWriter.h>
+#include <landstalker/3d_maps/include/MapToTmx.h>
+#include <landstalker/3d_maps/include/Tilemap3DOverlay.h>
+#include <landstalker/text/include/HuffmanString.h>
+#include <landstalker/text/include/HuffmanTrees.h>
+#include <landstalker/text/include/Charset.h>
+#include <landstalker/misc/include/TaskPool.h>
+#include <landstalker/misc/include/LZ77.h>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+    const std::string BENCHMARK_MAPS_ARG = "--benchmark-maps";
+    const std::string BENCHMARK_DECODE_ARG = "--benchmark-decode";
+    const std::string BENCHMARK_STRINGS_ARG = "--benchmark-strings";
+    const std::string BENCHMARK_REFRESH_ARG = "--benchmark-refresh";
+    const std::string BENCHMARK_OPEN_ARG = "--benchmark-open";
+    const std::string BENCHMARK_TILESETS_ARG = "--benchmark-tilesets";
+    const std::string BENCHMARK_ROOMS_ARG = "--benchmark-rooms";
+    const std::string BENCHMARK_EXPAND_ARG = "--benchmark-expand";
+    const std::string BENCHMARK_REDRAW_ARG = "--benchmark-redraw";
+    const std::string BENCHMARK_PREVIEWS_ARG = "--benchmark-previews";
+    const int DEFAULT_BENCHMARK_PASSES = 10;
+    const std::string SELF_TEST_ARG = "--self-test";
+    const std::string RENDER_ROOMS_ARG = "--render-rooms";
+    const std::string BENCHMARK_PNG_ARG = "--benchmark-png";
+    const std::string BENCHMARK_TMX_ARG = "--benchmark-tmx";
+    const std::string BENCHMARK_LZ77_ARG = "--benchmark-lz77";
+    const std::vector<std::pair<std::string, ImageBuffer::PngCompression>> PNG_COMPRESSION_NAMES = {
+        {"store", ImageBuffer::PngCompression::STORE}, {"fast", ImageBuffer::PngCompression::FAST},
+        {"default", ImageBuffer::PngCompression::DEFAULT}, {"max", ImageBuffer::PngCompression::MAX} };
+
+    double ElapsedMs(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // Peak resident set size of the process in KiB, or -1 where it cannot be read
+    long PeakRssKiB()
+    {
+#ifdef _WIN32
+        return -1;
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return -1;
+        }
+#ifdef __APPLE__
+        return usage.ru_maxrss / 1024;
+#else
+        return usage.ru_maxrss;
+#endif
+#endif
+    }
+
+    // Whether the game data is read from a disassembly rather than a ROM image
+    bool IsAsmInput(const std::string& input)
+    {
+        auto extension = filesystem::path(input).extension();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](const unsigned char i) { return std::tolower(i); });
+        return extension == "asm";
+    }
+
+    std::shared_ptr<GameData> LoadGameData(const std::string& input)
+    {
+        if (IsAsmInput(input))
+        {
+            return std::make_shared<GameData>(input);
+        }
+        return std::make_shared<GameData>(Rom(input));
+    }
+
+    // Encodes every room map at each compression level, and reports the size of each map at every
+    // level, then the total size and the time taken at each, against the size of the maps as they
+    // are stored in the game data
+    int BenchmarkMaps(const std::string& input)
+    {
+        auto gd = LoadGameData(input);
+        std::vector<std::string> names;
+        std::vector<Tilemap3D> maps;
+        std::vector<std::size_t> original_sizes;
+        std::size_t original_bytes = 0;
+        for (const auto& m : gd->GetRoomData()->GetMaps())
+        {
+            std::shared_ptr<const Tilemap3DEntry> entry = m.second;
+            names.push_back(m.first);
+            maps.push_back(*entry->GetOrigData());
+            original_sizes.push_back(entry->GetOrigDataLength());
+            original_bytes += entry->GetOrigDataLength();
+        }
+
+        int failures = 0;
+        const std::vector<std::pair<std::string, Tilemap3D::Level>> levels = {
+            {"fast", Tilemap3D::Level::FAST}, {"maximum", Tilemap3D::Level::MAXIMUM} };
+        std::vector<std::vector<std::size_t>> sizes(levels.size());
+        std::vector<double> level_ms(levels.size());
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            std::vector<uint8_t> buf(65536);
+            const auto start = std::chrono::steady_clock::now();
+            for (auto& map : maps)
+            {
+                const std::size_t size = map.Encode(buf.data(), buf.size(), levels[l].second);
+                Tilemap3D decoded;
+                failures += decoded.Decode(buf.data(), size) == size && decoded == map ? 0 : 1;
+                sizes[l].push_back(size);
+            }
+            level_ms[l] = ElapsedMs(start);
+        }
+
+        std::printf("%-24s %10s %10s %10s %8s\n", "map", "original", "fast", "maximum", "saved");
+        for (std::size_t i = 0; i < maps.size(); ++i)
+        {
+            std::printf("%-24s %10zu %10zu %10zu %+8d\n", names[i].c_str(), original_sizes[i], sizes[0][i], sizes[1][i],
+                static_cast<int>(sizes[0][i]) - static_cast<int>(sizes[1][i]));
+        }
+        std::printf("%-8s %4d maps %10zu bytes\n", "original", static_cast<int>(maps.size()), original_bytes);
+        for (std::size_t l = 0; l < levels.size(); ++l)
+        {
+            std::size_t bytes = 0;
+            for (std::size_t size : sizes[l])
+            {
+                bytes += size;
+            }
+            std::printf("%-8s %4d maps %10zu bytes (%+6.2f%%), %8.1f ms (%6.2f ms per map)\n", levels[l].first.c_str(),
+                static_cast<int>(maps.size()), bytes, (static_cast<double>(bytes) - original_bytes) * 100.0 / std::max<std::size_t>(original_bytes, 1),
+                level_ms[l], level_ms[l] / std::max<std::size_t>(maps.size(), 1));
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Decodes every room map and blockset from the bytes they are stored as, and reports the
+    // throughput of each codec
+    int BenchmarkDecode(const std::string& input, int passes)
+    {
+        auto gd = LoadGameData(input);
+        std::vector<std::pair<std::shared_ptr<const Tilemap3D>, std::shared_ptr<const ByteVector>>> maps;
+        for (const auto& m : gd->GetRoomData()->GetMaps())
+        {
+            std::shared_ptr<const Tilemap3DEntry> entry = m.second;
+            maps.push_back({ entry->GetOrigData(), entry->GetOrigBytes() });
+        }
+        std::vector<std::pair<std::shared_ptr<const Blockset>, std::shared_ptr<const ByteVector>>> blocksets;
+        for (const auto& b : gd->GetRoomData()->GetAllBlocksets())
+        {
+            std::shared_ptr<const BlocksetEntry> entry = b.second;
+            blocksets.push_back({ entry->GetOrigData(), entry->GetOrigBytes() });
+        }
+
+        int failures = 0;
+        auto print_row = [&](const char* name, std::size_t count, std::size_t bytes, double ms)
+        {
+            std::printf("%-9s %4d x %d passes, %10zu bytes, %8.1f ms (%8.0f per second, %7.2f MB/s in)\n", name,
+                static_cast<int>(count), passes, bytes * passes, ms, count * passes * 1000.0 / std::max(ms, 0.001),
+                bytes * passes / 1000.0 / std::max(ms, 0.001));
+        };
+        std::size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (const auto& m : maps)
+            {
+                Tilemap3D map;
+                const std::size_t size = map.Decode(m.second->data(), m.second->size());
+                if (pass == 0)
+                {
+                    failures += map == *m.first ? 0 : 1;
+                    bytes += size;
+                }
+            }
+        }
+        print_row("maps", maps.size(), bytes, ElapsedMs(start));
+        bytes = 0;
+        start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (const auto& b : blocksets)
+            {
+                Blockset blockset;
+                BlocksetCmp::Decode(b.second->data(), b.second->size(), blockset);
+                if (pass == 0)
+                {
+                    failures += blockset == *b.first ? 0 : 1;
+                    bytes += b.second->size();
+                }
+            }
+        }
+        print_row("blocksets", blocksets.size(), bytes, ElapsedMs(start));
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Compresses the main strings as StringData does, then decodes them with trees loaded from the
+    // encoded tables, and reports the throughput of each. Finally times constructing StringData,
+    // which decodes every string when the game data is opened.
+    int BenchmarkStrings(const std::string& input)
+    {
+        const int passes = 20;
+        auto gd = LoadGameData(input);
+        const auto sd = gd->GetStringData();
+        const auto region = sd->GetRegion();
+        const auto& charset = Charset::GetDefaultCharset(region);
+        const auto eos_marker = Charset::GetEOSChar(region);
+        const auto& diacritic_map = Charset::GetDiacriticMap(region);
+
+        auto huff_trees = std::make_shared<HuffmanTrees>();
+        std::vector<std::shared_ptr<LSString>> strs;
+        std::size_t chars = 0;
+        for (std::size_t i = 0; i < sd->GetMainStringCount(); ++i)
+        {
+            strs.push_back(std::make_shared<HuffmanString>(sd->GetOrigMainString(i), huff_trees, charset, eos_marker, diacritic_map));
+            chars += sd->GetOrigMainString(i).size();
+        }
+        std::vector<uint8_t> offsets;
+        std::vector<uint8_t> tables;
+        std::vector<std::vector<uint8_t>> compressed;
+        std::size_t bytes = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            huff_trees->RecalculateTrees(strs);
+            huff_trees->EncodeTrees(offsets, tables);
+            compressed.clear();
+            bytes = 0;
+            for (const auto& s : strs)
+            {
+                compressed.push_back(std::vector<uint8_t>(256));
+                compressed.back().resize(s->Encode(compressed.back().data(), compressed.back().size()));
+                bytes += compressed.back().size();
+            }
+        }
+        double ms = ElapsedMs(start) / passes;
+        std::printf("encode   %5d strings %8zu chars %8zu bytes, %8.2f ms (%6.2f Mchars/s)\n",
+            static_cast<int>(strs.size()), chars, bytes, ms, chars / std::max(ms, 1e-6) / 1000.0);
+
+        auto loaded_trees = std::make_shared<HuffmanTrees>(offsets.data(), offsets.size(), tables.data(), tables.size(), offsets.size() / 2);
+        auto decoder = HuffmanString(loaded_trees, charset, eos_marker, diacritic_map);
+        int failures = 0;
+        start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (std::size_t i = 0; i < compressed.size(); ++i)
+            {
+                decoder.Decode(compressed[i].data(), compressed[i][0]);
+                failures += decoder.Str() == sd->GetOrigMainString(i) ? 0 : 1;
+            }
+        }
+        ms = ElapsedMs(start) / passes;
+        std::printf("decode   %5d strings %8zu chars %8zu bytes, %8.2f ms (%6.2f Mchars/s)\n",
+            static_cast<int>(strs.size()), chars, bytes, ms, chars / std::max(ms, 1e-6) / 1000.0);
+
+        // The ROM is read once up front, so that only the decoding is timed
+        std::unique_ptr<Rom> rom;
+        if (!IsAsmInput(input))
+        {
+            rom = std::make_unique<Rom>(input);
+        }
+        double fastest_ms = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            const auto pass_start = std::chrono::steady_clock::now();
+            const auto loaded = rom ? std::make_shared<StringData>(*rom) : std::make_shared<StringData>(filesystem::path(input));
+            const double pass_ms = ElapsedMs(pass_start);
+            fastest_ms = pass == 0 ? pass_ms : std::min(fastest_ms, pass_ms);
+            failures += loaded->GetMainStringCount() == sd->GetMainStringCount() ? 0 : 1;
+        }
+        ms = ElapsedMs(start) / passes;
+        std::printf("startup  %5d strings, StringData(%s) %8.2f ms mean, %8.2f ms fastest of %d\n",
+            static_cast<int>(sd->GetMainStringCount()), rom ? "const Rom&" : "asm", ms, fastest_ms, passes);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Times GameData::HasBeenModified() and RefreshPendingWrites() on a ROM, first unmodified and
+    // then after a single block of one map has been changed, and prints the injection timings of
+    // the last refresh
+    int BenchmarkRefresh(const std::string& input)
+    {
+        const Rom rom(input);
+        auto start = std::chrono::steady_clock::now();
+        GameData gd(rom);
+        std::printf("Loaded \"%s\" in %.1f ms\n", input.c_str(), ElapsedMs(start));
+
+        const int iterations = 100;
+        auto time_checks = [&](const char* label, bool expected)
+        {
+            bool modified = false;
+            const auto check_start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                modified = gd.HasBeenModified();
+            }
+            std::printf("%-10s HasBeenModified()      %10.3f ms per call\n", label, ElapsedMs(check_start) / iterations);
+            return modified == expected ? 0 : 1;
+        };
+        auto time_refreshes = [&](const char* label)
+        {
+            auto refresh_start = std::chrono::steady_clock::now();
+            gd.RefreshPendingWrites(rom);
+            const double first_ms = ElapsedMs(refresh_start);
+            refresh_start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; ++i)
+            {
+                gd.RefreshPendingWrites(rom);
+            }
+            std::printf("%-10s RefreshPendingWrites() %10.3f ms first, %.3f ms per repeat\n", label, first_ms,
+                ElapsedMs(refresh_start) / iterations);
+        };
+
+        int failures = time_checks("unmodified", false);
+        time_refreshes("unmodified");
+
+        const auto& maps = gd.GetRoomData()->GetMaps();
+        if (maps.empty())
+        {
+            throw std::runtime_error("No maps to modify");
+        }
+        {
+            // Change checks are only memoised while nothing outside the entry holds its data
+            auto map = maps.cbegin()->second->GetData();
+            map->SetBlock(map->GetBlock({ 0, 0 }) ^ 1, 0);
+        }
+        failures += time_checks("modified", true);
+        time_refreshes("modified");
+        std::printf("%s", gd.GetInjectionTimings().c_str());
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Opens the game data on one thread and then on the task pool, then decodes every map, tileset,
+    // tilemap and palette on first use, and reports the time taken and peak resident set size after each.
+    // The last two sessions use an empty snapshot directory, so the second starts warm from the
+    // snapshot that the first leaves behind.
+    int BenchmarkOpen(const std::string& input)
+    {
+        TaskPool::SetSingleThreaded(true);
+        auto start = std::chrono::steady_clock::now();
+        LoadGameData(input);
+        std::printf("%-8s %8.1f ms, peak RSS %8ld KiB, 1 thread\n", "open", ElapsedMs(start), PeakRssKiB());
+
+        TaskPool::SetSingleThreaded(false);
+        start = std::chrono::steady_clock::now();
+        auto gd = LoadGameData(input);
+        std::printf("%-8s %8.1f ms, peak RSS %8ld KiB, %u threads\n", "open", ElapsedMs(start), PeakRssKiB(),
+            TaskPool::Global().GetThreadCount() + 1);
+
+        auto decode = [](const char* label, const GameData& g)
+        {
+            std::size_t entries = 0;
+            auto decode_all = [&](const auto& all)
+            {
+                for (const auto& e : all)
+                {
+                    e.second->GetOrigData();
+                }
+                entries += all.size();
+            };
+            const auto decode_start = std::chrono::steady_clock::now();
+            decode_all(g.GetRoomData()->GetMaps());
+            decode_all(g.GetAllTilesets());
+            decode_all(g.GetAllTilemaps());
+            decode_all(g.GetAllPalettes());
+            std::printf("%-8s %8.1f ms, peak RSS %8ld KiB, %zu entries\n", label, ElapsedMs(decode_start), PeakRssKiB(), entries);
+        };
+        decode("decode", *gd);
+        gd = nullptr;
+
+        const std::filesystem::path snapshot_dir = std::filesystem::temp_directory_path() / "landstalker-benchmark-snapshots";
+        std::error_code ec;
+        std::filesystem::remove_all(snapshot_dir, ec);
+        GameData::SetSnapshotDirectory(snapshot_dir.string());
+        for (const char* session : { "cold", "warm" })
+        {
+            start = std::chrono::steady_clock::now();
+            gd = LoadGameData(input);
+            std::printf("%-8s %8.1f ms, %s open\n", "open", ElapsedMs(start), session);
+            decode("decode", *gd);
+            start = std::chrono::steady_clock::now();
+            gd->WriteSnapshot();
+            gd = nullptr;
+            std::printf("%-8s %8.1f ms, %s close\n", "close", ElapsedMs(start), session);
+        }
+        GameData::SetSnapshotDirectory(filesystem::path());
+        std::filesystem::remove_all(snapshot_dir, ec);
+        return 0;
+    }
+
+    // Decodes, draws and edits every tileset, and reports the time each of those takes, along with
+    // the allocations made when they are counted
+    int BenchmarkTilesets(const std::string& input)
+    {
+        auto gd = LoadGameData(input);
+        struct Phase
+        {
+            const char* name;
+            std::size_t allocations;
+            double ms;
+        };
+        Phase decode{ "decode", 0, 0.0 };
+        Phase draw{ "draw", 0, 0.0 };
+        Phase edit{ "edit", 0, 0.0 };
+        auto measure = [](Phase& phase, const auto& fn)
+        {
+            const std::size_t before = GetAllocationCount();
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            phase.ms += ElapsedMs(start);
+            phase.allocations += GetAllocationCount() - before;
+        };
+
+        std::size_t tiles = 0;
+        for (const auto& t : gd->GetAllTilesets())
+        {
+            std::shared_ptr<const TilesetEntry> entry = t.second;
+            Tileset original(*entry->GetData());
+            const bool compressed = original.GetCompressed();
+            const auto bits = original.GetBits(compressed);
+            Tileset tileset;
+            tileset.SetParams(original.GetTileWidth(), original.GetTileHeight(), original.GetTileBitDepth(), original.GetTileBlockType());
+            measure(decode, [&]() { tileset.SetBits(bits, compressed); });
+
+            const std::size_t max_width = 16U;
+            const int cols = std::min<std::size_t>(tileset.GetTileCount(), max_width);
+            const int rows = std::max<std::size_t>(1UL, (tileset.GetTileCount() + max_width - 1) / max_width);
+            ImageBuffer buf(std::max(cols, 1) * tileset.GetTileWidth(), rows * tileset.GetTileHeight());
+            measure(draw, [&]()
+                {
+                    for (std::size_t i = 0; i < tileset.GetTileCount(); ++i)
+                    {
+                        buf.InsertTile((i % cols) * tileset.GetTileWidth(), (i / cols) * tileset.GetTileHeight(), 0, i, tileset);
+                    }
+                });
+            measure(edit, [&]()
+                {
+                    tileset.InsertTilesBefore(0);
+                    tileset.DeleteTile(0);
+                });
+            tiles += tileset.GetTileCount();
+        }
+
+        std::printf("%d tilesets, %zu tiles\n", static_cast<int>(gd->GetAllTilesets().size()), tiles);
+        for (const auto* phase : { &decode, &draw, &edit })
+        {
+#ifdef LS_COUNT_ALLOCATIONS
+            std::printf("%-6s %10zu allocations (%8.3f per tile) %10.2f ms\n", phase->name, phase->allocations,
+                phase->allocations / static_cast<double>(std::max<std::size_t>(tiles, 1)), phase->ms);
+#else
+            std::printf("%-6s %10.2f ms\n", phase->name, phase->ms);
+#endif
+        }
+#ifndef LS_COUNT_ALLOCATIONS
+        std::printf("Build with COUNT_ALLOCATIONS=yes to count allocations\n");
+#endif
+        return 0;
+    }
+
+    // Draws the background and foreground layers of a room, as the room viewer's PNG export does
+    void DrawRoom(const RoomData& rd, uint16_t roomnum, ImageBuffer& buf)
+    {
+        const auto map = std::as_const(*rd.GetMapForRoom(roomnum)).GetData();
+        const auto tileset = std::as_const(*rd.GetTilesetForRoom(roomnum)).GetData();
+        const auto blockset = rd.GetCombinedBlocksetForRoom(roomnum);
+        buf.Resize(map->GetPixelWidth(), map->GetPixelHeight());
+        buf.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, tileset, blockset);
+        buf.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset);
+    }
+
+    // Draws the background and foreground layers of every room on one thread, without writing any
+    // files, and reports the rooms drawn per second
+    int BenchmarkRooms(const std::string& input, int passes)
+    {
+        auto gd = LoadGameData(input);
+        const auto rd = gd->GetRoomData();
+        ImageBuffer buf;
+
+        // The first pass also decodes the assets and fills the caches, so is reported separately
+        std::vector<uint16_t> rooms;
+        int failures = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& room : rd->GetRoomlist())
+        {
+            try
+            {
+                DrawRoom(*rd, room->index, buf);
+                rooms.push_back(room->index);
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("%03d %-32s FAILED: %s\n", room->index, room->name.c_str(), e.what());
+                ++failures;
+            }
+        }
+        const double first_ms = ElapsedMs(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (const auto room : rooms)
+            {
+                DrawRoom(*rd, room, buf);
+            }
+        }
+        const double pass_ms = ElapsedMs(start) / passes;
+        std::printf("%d rooms: first pass %8.1f ms, then %8.1f ms per pass (%8.1f rooms/s)\n", static_cast<int>(rooms.size()),
+            first_ms, pass_ms, rooms.size() * 1000.0 / std::max(pass_ms, 0.001));
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Expands every room from indexed pixels to RGB, to alpha, and to both at once, and reports the
+    // megapixels expanded per second by each
+    int BenchmarkExpand(const std::string& input, int passes)
+    {
+        auto gd = LoadGameData(input);
+        const auto rd = gd->GetRoomData();
+        ImageBuffer buf;
+        struct Kernel
+        {
+            const char* name;
+            double ms;
+        };
+        Kernel rgb{ "rgb", 0.0 };
+        Kernel alpha{ "alpha", 0.0 };
+        Kernel rgba{ "rgba", 0.0 };
+        double megapixels = 0.0;
+        int failures = 0;
+        for (const auto& room : rd->GetRoomlist())
+        {
+            // Expanded rows are kept until the palettes change, so alternate between two copies
+            std::vector<std::shared_ptr<Palette>> pals[2];
+            try
+            {
+                DrawRoom(*rd, room->index, buf);
+                const auto& pal = *std::as_const(*rd->GetPaletteForRoom(room->index)).GetData();
+                pals[0].push_back(std::make_shared<Palette>(pal));
+                pals[1].push_back(std::make_shared<Palette>(pal));
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("%03d %-32s FAILED: %s\n", room->index, room->name.c_str(), e.what());
+                ++failures;
+                continue;
+            }
+            auto measure = [&](Kernel& kernel, const auto& fn)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                for (int pass = 0; pass < passes; ++pass)
+                {
+                    fn(pals[pass % 2]);
+                }
+                kernel.ms += ElapsedMs(start);
+            };
+            measure(rgb, [&](const auto& p) { buf.GetRGB(p); });
+            measure(alpha, [&](const auto& p) { buf.GetAlpha(p, 0x80, 0xFF); });
+            measure(rgba, [&](const auto& p) { buf.MakeImage(p, true, 0x80, 0xFF); });
+            megapixels += buf.GetWidth() * buf.GetHeight() * passes / 1e6;
+        }
+
+        for (const auto* kernel : { &rgb, &alpha, &rgba })
+        {
+            std::printf("%-5s %10.1f MP in %10.2f ms (%8.1f MP/s)\n", kernel->name, megapixels, kernel->ms,
+                megapixels * 1000.0 / std::max(kernel->ms, 0.001));
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Edits one background cell of every room at a time, and reports the time taken to redraw and
+    // expand just that cell against drawing and expanding the whole room again
+    int BenchmarkRedraw(const std::string& input, int passes)
+    {
+        auto gd = LoadGameData(input);
+        const auto rd = gd->GetRoomData();
+        ImageBuffer buf;
+        ImageBuffer full;
+        double cells_ms = 0.0;
+        double full_ms = 0.0;
+        int edits = 0;
+        int failures = 0;
+        for (const auto& room : rd->GetRoomlist())
+        {
+            std::vector<std::shared_ptr<Palette>> pals;
+            std::shared_ptr<Tilemap3D> map;
+            std::shared_ptr<const Tileset> tileset;
+            std::shared_ptr<const std::vector<MapBlock>> blockset;
+            try
+            {
+                map = std::make_shared<Tilemap3D>(*std::as_const(*rd->GetMapForRoom(room->index)).GetData());
+                tileset = std::as_const(*rd->GetTilesetForRoom(room->index)).GetData();
+                blockset = rd->GetCombinedBlocksetForRoom(room->index);
+                pals.push_back(std::make_shared<Palette>(*std::as_const(*rd->GetPaletteForRoom(room->index)).GetData()));
+                DrawRoom(*rd, room->index, buf);
+                buf.GetRGB(pals);
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("%03d %-32s FAILED: %s\n", room->index, room->name.c_str(), e.what());
+                ++failures;
+                continue;
+            }
+            const int cells = map->GetWidth() * map->GetHeight();
+            for (int pass = 0; pass < passes && cells > 0; ++pass)
+            {
+                const IsoPoint2D cell{ (pass * 7919 % cells) % map->GetWidth(), (pass * 7919 % cells) / map->GetWidth() };
+                const uint16_t block = map->GetBlock(cell, Tilemap3D::Layer::BG);
+                map->SetBlock({ static_cast<uint16_t>((block + 1) % blockset->size()), cell }, Tilemap3D::Layer::BG);
+                auto start = std::chrono::steady_clock::now();
+                buf.Redraw3DMapCells(0, Tilemap3DOverlay(*map, Tilemap3D::Layer::BG), tileset, blockset, { cell });
+                buf.GetRGB(pals);
+                cells_ms += ElapsedMs(start);
+                start = std::chrono::steady_clock::now();
+                full.Resize(map->GetPixelWidth(), map->GetPixelHeight());
+                full.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, tileset, blockset);
+                full.Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset);
+                full.GetRGB(pals);
+                full_ms += ElapsedMs(start);
+                ++edits;
+            }
+            if (buf.GetRGB(pals) != full.GetRGB(pals))
+            {
+                std::printf("%03d %-32s FAILED: redrawn cells differ from a full render\n", room->index, room->name.c_str());
+                ++failures;
+            }
+        }
+        std::printf("%d edits: %8.1f ms redrawing the cells, %8.1f ms redrawing the rooms\n", edits, cells_ms, full_ms);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Toggles the swap and door previews of every room that has any, and reports the time taken to
+    // redraw the cells they cover through an overlay against copying the map and drawing it again
+    int BenchmarkPreviews(const std::string& input, int passes)
+    {
+        auto gd = LoadGameData(input);
+        const auto rd = gd->GetRoomData();
+        double overlay_ms = 0.0;
+        double copy_ms = 0.0;
+        int toggles = 0;
+        int failures = 0;
+        for (const auto& room : rd->GetRoomlist())
+        {
+            const auto swaps = rd->GetTileSwaps(room->index);
+            const auto doors = rd->GetDoors(room->index);
+            if (swaps.empty() && doors.empty())
+            {
+                continue;
+            }
+            std::vector<std::shared_ptr<Palette>> pals;
+            std::shared_ptr<const Tilemap3D> map;
+            std::shared_ptr<const Tileset> tileset;
+            std::shared_ptr<const std::vector<MapBlock>> blockset;
+            try
+            {
+                map = std::as_const(*rd->GetMapForRoom(room->index)).GetData();
+                tileset = std::as_const(*rd->GetTilesetForRoom(room->index)).GetData();
+                blockset = rd->GetCombinedBlocksetForRoom(room->index);
+                pals.push_back(std::make_shared<Palette>(*std::as_const(*rd->GetPaletteForRoom(room->index)).GetData()));
+            }
+            catch (const std::exception& e)
+            {
+                std::printf("%03d %-32s FAILED: %s\n", room->index, room->name.c_str(), e.what());
+                ++failures;
+                continue;
+            }
+            for (auto layer : { Tilemap3D::Layer::BG, Tilemap3D::Layer::FG })
+            {
+                const Tilemap3DOverlay preview(*map, layer, swaps, doors);
+                std::vector<IsoPoint2D> cells;
+                for (const auto& cell : preview.GetOverlaidCells())
+                {
+                    cells.push_back({ cell.first % map->GetWidth(), cell.first / map->GetWidth() });
+                }
+                ImageBuffer buf(map->GetPixelWidth(), map->GetPixelHeight());
+                ImageBuffer full;
+                buf.Insert3DMapLayer(0, 0, 0, layer, map, tileset, blockset);
+                buf.GetRGB(pals);
+                for (int pass = 0; pass < passes * 2; ++pass)
+                {
+                    const bool shown = pass % 2 == 0;
+                    auto start = std::chrono::steady_clock::now();
+                    const Tilemap3DOverlay view(*map, layer, shown ? swaps : std::vector<TileSwap>(), shown ? doors : std::vector<Door>());
+                    buf.Redraw3DMapCells(0, view, tileset, blockset, cells);
+                    buf.GetRGB(pals);
+                    overlay_ms += ElapsedMs(start);
+                    start = std::chrono::steady_clock::now();
+                    auto copy = std::make_shared<Tilemap3D>(*map);
+                    for (const auto& swap : shown ? swaps : std::vector<TileSwap>())
+                    {
+                        swap.DrawSwap(*copy, layer);
+                    }
+                    for (const auto& door : shown ? doors : std::vector<Door>())
+                    {
+                        door.DrawDoor(*copy, layer);
+                    }
+                    full.Resize(map->GetPixelWidth(), map->GetPixelHeight());
+                    full.Insert3DMapLayer(0, 0, 0, layer, copy, tileset, blockset);
+                    full.GetRGB(pals);
+                    copy_ms += ElapsedMs(start);
+                    ++toggles;
+                }
+                if (buf.GetRGB(pals) != full.GetRGB(pals))
+                {
+                    std::printf("%03d %-32s FAILED: toggled previews differ from a full render\n", room->index, room->name.c_str());
+                    ++failures;
+                }
+            }
+        }
+        std::printf("%d toggles: %8.1f ms through an overlay, %8.1f ms copying the map\n", toggles, overlay_ms, copy_ms);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Renders every room in a ROM or disassembly to PNG, reporting the time taken for each
+    int RenderRooms(const std::string& input, const std::string& output_dir, ImageBuffer::PngCompression compression)
+    {
+        auto start = std::chrono::steady_clock::now();
+        auto gd = LoadGameData(input);
+        const double load_ms = ElapsedMs(start);
+        start = std::chrono::steady_clock::now();
+        const auto results = RoomRenderer(gd).RenderAll(output_dir, compression);
+        const double render_ms = ElapsedMs(start);
+
+        int failures = 0;
+        for (const auto& r : results)
+        {
+            if (r.success)
+            {
+                std::printf("%03d %-32s render %7.2f ms, write %7.2f ms\n", r.room, r.name.c_str(), r.render_ms, r.write_ms);
+            }
+            else
+            {
+                std::printf("%03d %-32s FAILED: %s\n", r.room, r.name.c_str(), r.error.c_str());
+                ++failures;
+            }
+        }
+        std::printf("Rendered %d of %d rooms to \"%s\": load %.0f ms, render %.0f ms\n",
+            static_cast<int>(results.size()) - failures, static_cast<int>(results.size()), output_dir.c_str(), load_ms, render_ms);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Exports every tileset and every room at each compression setting, and reports the time
+    // taken and the total size of the files written
+    int BenchmarkPngExport(const std::string& input, const std::string& output_dir)
+    {
+        auto gd = LoadGameData(input);
+        std::vector<std::pair<std::string, ImageBuffer>> tilesets;
+        std::vector<std::vector<std::shared_ptr<Palette>>> tileset_palettes;
+        for (const auto& t : gd->GetAllTilesets())
+        {
+            std::shared_ptr<const TilesetEntry> entry = t.second;
+            auto tileset = entry->GetData();
+            const std::size_t max_width = 16U;
+            const int cols = std::min<std::size_t>(tileset->GetTileCount(), max_width);
+            const int rows = std::max<std::size_t>(1UL, (tileset->GetTileCount() + max_width - 1) / max_width);
+            ImageBuffer buf(cols * tileset->GetTileWidth(), rows * tileset->GetTileHeight());
+            for (std::size_t i = 0; i < tileset->GetTileCount(); ++i)
+            {
+                buf.InsertTile((i % cols) * tileset->GetTileWidth(), (i / cols) * tileset->GetTileHeight(), 0, i, *tileset);
+            }
+            auto palette = gd->GetPalette(entry->GetDefaultPalette());
+            tilesets.push_back({ t.first, std::move(buf) });
+            tileset_palettes.push_back({ palette != nullptr ? palette->GetData() : std::make_shared<Palette>() });
+        }
+
+        int failures = 0;
+        for (const auto& c : PNG_COMPRESSION_NAMES)
+        {
+            const filesystem::path dir = filesystem::path(output_dir) / c.first;
+            const filesystem::path tileset_dir = dir / "tilesets";
+            const filesystem::path room_dir = dir / "rooms";
+            if (!tileset_dir.is_directory() && !filesystem::create_directories(tileset_dir))
+            {
+                throw std::runtime_error("Unable to create directory \"" + tileset_dir.str() + "\"");
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            PngWriter writer(c.second);
+            for (std::size_t i = 0; i < tilesets.size(); ++i)
+            {
+                writer.Write((tileset_dir / (tilesets[i].first + ".png")).str(), tilesets[i].second, tileset_palettes[i]);
+            }
+            failures += static_cast<int>(writer.Wait().size());
+            const double tileset_ms = ElapsedMs(start);
+            std::size_t tileset_bytes = 0;
+            for (const auto& t : tilesets)
+            {
+                const filesystem::path path = tileset_dir / (t.first + ".png");
+                tileset_bytes += path.exists() ? path.file_size() : 0;
+            }
+
+            start = std::chrono::steady_clock::now();
+            const auto results = RoomRenderer(gd).RenderAll(room_dir, c.second);
+            const double room_ms = ElapsedMs(start);
+            std::size_t room_bytes = 0;
+            for (const auto& r : results)
+            {
+                failures += r.success ? 0 : 1;
+                room_bytes += r.success ? r.path.file_size() : 0;
+            }
+
+            std::printf("%-8s %4d tilesets %8.1f ms %10zu bytes, %4d rooms %8.1f ms %10zu bytes\n", c.first.c_str(),
+                static_cast<int>(tilesets.size()), tileset_ms, tileset_bytes, static_cast<int>(results.size()), room_ms, room_bytes);
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Exports every map to TMX with each layer encoding, imports the files back, checks that
+    // the maps survived the round trip, and reports the maps converted per second each way
+    int BenchmarkTmx(const std::string& input, const std::string& output_dir)
+    {
+        auto gd = LoadGameData(input);
+        std::vector<std::string> names;
+        std::vector<std::shared_ptr<const Tilemap3D>> maps;
+        for (const auto& m : gd->GetRoomData()->GetMaps())
+        {
+            names.push_back(m.first);
+            maps.push_back(std::as_const(*m.second).GetData());
+        }
+
+        int failures = 0;
+        const std::vector<std::pair<std::string, MapToTmx::Encoding>> encodings = {
+            {"csv", MapToTmx::Encoding::CSV}, {"zlib", MapToTmx::Encoding::BASE64_ZLIB} };
+        for (const auto& e : encodings)
+        {
+            const filesystem::path dir = filesystem::path(output_dir) / e.first;
+            if (!dir.is_directory() && !filesystem::create_directories(dir))
+            {
+                throw std::runtime_error("Unable to create directory \"" + dir.str() + "\"");
+            }
+            std::vector<MapToTmx::ExportRequest> exports;
+            std::vector<MapToTmx::ImportRequest> imports;
+            for (std::size_t i = 0; i < maps.size(); ++i)
+            {
+                const std::string filename = (dir / (names[i] + ".tmx")).str();
+                exports.push_back({ filename, maps[i], "blockset.png" });
+                // TMX files only hold the block layers, so they are imported over a cleared copy
+                auto copy = std::make_shared<Tilemap3D>(*maps[i]);
+                copy->ClearTilemap();
+                imports.push_back({ filename, copy });
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            failures += static_cast<int>(MapToTmx::ExportAll(exports, e.second).size());
+            const double export_ms = ElapsedMs(start);
+            start = std::chrono::steady_clock::now();
+            failures += static_cast<int>(MapToTmx::ImportAll(imports).size());
+            const double import_ms = ElapsedMs(start);
+
+            std::size_t bytes = 0;
+            for (std::size_t i = 0; i < maps.size(); ++i)
+            {
+                const filesystem::path path(imports[i].filename);
+                bytes += path.exists() ? path.file_size() : 0;
+                if (!(*imports[i].map == *maps[i]))
+                {
+                    std::printf("%s: %s did not survive the round trip\n", e.first.c_str(), names[i].c_str());
+                    ++failures;
+                }
+            }
+            std::printf("%-4s %4d maps, export %8.1f ms (%8.0f maps/s), import %8.1f ms (%8.0f maps/s), %10zu bytes\n",
+                e.first.c_str(), static_cast<int>(maps.size()), export_ms, maps.size() * 1000.0 / std::max(export_ms, 0.001),
+                import_ms, maps.size() * 1000.0 / std::max(import_ms, 0.001), bytes);
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Decodes the LZ77 data of every compressed tileset and 2D map as it is stored in the game
+    // data, then encodes it again with the greedy encoder and with the encoder it replaced, and
+    // reports the throughput of each. Finally encodes every compressed tileset, 2D map and sprite
+    // frame at each level, and reports their size and the time taken against the stored size.
+    int BenchmarkLz77(const std::string& input, int passes)
+    {
+        auto gd = LoadGameData(input);
+        std::vector<std::vector<uint8_t>> streams;
+        std::size_t tileset_count = 0;
+        for (const auto& t : gd->GetAllTilesets())
+        {
+            if (std::as_const(*t.second).GetData()->GetCompressed())
+            {
+                streams.push_back(*t.second->GetBytes());
+                ++tileset_count;
+            }
+        }
+        for (const auto& t : gd->GetAllTilemaps())
+        {
+            if (std::as_const(*t.second).GetData()->GetCompression() == Tilemap2D::Compression::LZ77)
+            {
+                streams.push_back(*t.second->GetBytes());
+            }
+        }
+        std::vector<SpriteFrame> frames;
+        std::size_t frame_bytes = 0;
+        const auto sd = gd->GetSpriteData();
+        for (int i = 0; i < 255; ++i)
+        {
+            if (!sd->IsSprite(i))
+            {
+                continue;
+            }
+            for (const auto& name : sd->GetSpriteFrames(i))
+            {
+                const auto entry = sd->GetSpriteFrame(name);
+                if (std::as_const(*entry).GetData()->GetCompressed())
+                {
+                    frames.push_back(*std::as_const(*entry).GetData());
+                    frame_bytes += entry->GetBytes()->size();
+                }
+            }
+        }
+
+        int failures = 0;
+        std::size_t in_bytes = 0;
+        std::size_t out_bytes = 0;
+        std::vector<std::vector<uint8_t>> decoded(streams.size(), std::vector<uint8_t>(65536));
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            for (std::size_t i = 0; i < streams.size(); ++i)
+            {
+                std::size_t elen = 0;
+                std::size_t dlen = 0;
+                const auto result = LZ77::Decode(streams[i].data(), streams[i].size(), decoded[i].data(), decoded[i].size(), elen, dlen);
+                failures += result == LZ77::DecodeResult::OK || result == LZ77::DecodeResult::MISSING_END_MARKER ? 0 : 1;
+                in_bytes += elen;
+                out_bytes += dlen;
+                if (pass == passes - 1)
+                {
+                    decoded[i].resize(dlen);
+                }
+            }
+        }
+        double ms = ElapsedMs(start);
+        std::printf("decode    %4d streams x %d passes, %10zu bytes in, %10zu bytes out, %8.1f ms (%7.1f MB/s out)\n",
+            static_cast<int>(streams.size()), passes, in_bytes, out_bytes, ms, out_bytes / 1000.0 / std::max(ms, 0.001));
+
+        // Encoding is much slower than decoding, so each encoder makes a single pass
+        const std::size_t raw_bytes = out_bytes / passes;
+        std::vector<std::vector<uint8_t>> reference;
+        start = std::chrono::steady_clock::now();
+        for (const auto& d : decoded)
+        {
+            reference.push_back(SelfTest::ReferenceLz77Encode(d));
+        }
+        ms = ElapsedMs(start);
+        std::printf("reference %4d streams, %10zu bytes in, %8.1f ms (%7.2f MB/s in)\n",
+            static_cast<int>(decoded.size()), raw_bytes, ms, raw_bytes / 1000.0 / std::max(ms, 0.001));
+        std::vector<uint8_t> buf(65536 * 2 + 16);
+        start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < decoded.size(); ++i)
+        {
+            const std::size_t size = LZ77::Encode(decoded[i].data(), decoded[i].size(), buf.data(), LZ77::Level::GREEDY);
+            failures += std::equal(buf.begin(), buf.begin() + size, reference[i].begin(), reference[i].end()) ? 0 : 1;
+        }
+        const double greedy_ms = ElapsedMs(start);
+        std::printf("greedy    %4d streams, %10zu bytes in, %8.1f ms (%7.2f MB/s in, %.1fx the reference)\n",
+            static_cast<int>(decoded.size()), raw_bytes, greedy_ms, raw_bytes / 1000.0 / std::max(greedy_ms, 0.001),
+            ms / std::max(greedy_ms, 0.001));
+
+        struct Kind
+        {
+            const char* name;
+            std::size_t first;
+            std::size_t last;
+        };
+        const Kind kinds[] = { { "tilesets", 0, tileset_count }, { "2d maps", tileset_count, streams.size() } };
+        auto print_row = [](const char* level, const char* kind, std::size_t count, std::size_t bytes, std::size_t stored, double ms)
+        {
+            std::printf("%-8s %-9s %4d assets %10zu bytes (%+6.2f%%), %8.1f ms\n", level, kind, static_cast<int>(count), bytes,
+                (static_cast<double>(bytes) - stored) * 100.0 / std::max<std::size_t>(stored, 1), ms);
+        };
+        const auto default_level = LZ77::GetDefaultLevel();
+        const std::vector<std::pair<std::string, LZ77::Level>> levels = {
+            {"greedy", LZ77::Level::GREEDY}, {"optimal", LZ77::Level::OPTIMAL} };
+        for (const auto& l : levels)
+        {
+            for (const auto& k : kinds)
+            {
+                std::size_t bytes = 0;
+                std::size_t stored = 0;
+                start = std::chrono::steady_clock::now();
+                for (std::size_t i = k.first; i < k.last; ++i)
+                {
+                    bytes += LZ77::Encode(decoded[i].data(), decoded[i].size(), buf.data(), l.second);
+                    stored += streams[i].size();
+                }
+                print_row(l.first.c_str(), k.name, k.last - k.first, bytes, stored, ElapsedMs(start));
+            }
+            // Sprite frames compress their tiles at the default level
+            LZ77::SetDefaultLevel(l.second);
+            std::size_t bytes = 0;
+            start = std::chrono::steady_clock::now();
+            for (auto& frame : frames)
+            {
+                bytes += frame.GetBits(true).size();
+            }
+            print_row(l.first.c_str(), "sprites", frames.size(), bytes, frame_bytes, ElapsedMs(start));
+        }
+        LZ77::SetDefaultLevel(default_level);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Reads a number of benchmark passes given on the command line
+    int ParsePasses(const std::string& arg)
+    {
+        const int passes = std::atoi(arg.c_str());
+        if (passes < 1)
+        {
+            throw std::runtime_error("Invalid number of passes \"" + arg + "\"");
+        }
+        return passes;
+    }
+
+    // Runs the command given on the command line, if there is one. Returns false when the
+    // editor should be started instead.
+    bool RunCommand(const std::vector<std::string>& args, int& exit_code)
+    {
+        try
+        {
+            if (args.size() == 3 && args[1] == BENCHMARK_MAPS_ARG)
+            {
+                exit_code = BenchmarkMaps(args[2]);
+                return true;
+            }
+            if ((args.size() == 3 || args.size() == 4) && args[1] == BENCHMARK_DECODE_ARG)
+            {
+                exit_code = BenchmarkDecode(args[2], args.size() == 4 ? ParsePasses(args[3]) : DEFAULT_BENCHMARK_PASSES);
+                return true;
+            }
+            if (args.size() == 3 && args[1] == BENCHMARK_STRINGS_ARG)
+            {
+                exit_code = BenchmarkStrings(args[2]);
+                return true;
+            }
+            if (args.size() == 3 && args[1] == BENCHMARK_REFRESH_ARG)
+            {
+                exit_code = BenchmarkRefresh(args[2]);
+                return true;
+            }
+            if (args.size() == 3 && args[1] == BENCHMARK_OPEN_ARG)
+            {
+                exit_code = BenchmarkOpen(args[2]);
+                return true;
+            }
+            if (args.size() == 3 && args[1] == BENCHMARK_TILESETS_ARG)
+            {
+                exit_code = BenchmarkTilesets(args[2]);
+                return true;
+            }
+            if ((args.size() == 3 || args.size() == 4) && args[1] == BENCHMARK_ROOMS_ARG)
+            {
+                exit_code = BenchmarkRooms(args[2], args.size() == 4 ? ParsePasses(args[3]) : DEFAULT_BENCHMARK_PASSES);
+                return true;
+            }
+            if ((args.size() == 3 || args.size() == 4) && args[1] == BENCHMARK_EXPAND_ARG)
+            {
+                exit_code = BenchmarkExpand(args[2], args.size() == 4 ? ParsePasses(args[3]) : DEFAULT_BENCHMARK_PASSES);
+                return true;
+            }
+            if ((args.size() == 3 || args.size() == 4) && args[1] == BENCHMARK_REDRAW_ARG)
+            {
+                exit_code = BenchmarkRedraw(args[2], args.size() == 4 ? ParsePasses(args[3]) : DEFAULT_BENCHMARK_PASSES);
+                return true;
+            }
+            if ((args.size() == 3 || args.size() == 4) && args[1] == BENCHMARK_PREVIEWS_ARG)
+            {
+                exit_code = BenchmarkPreviews(args[2], args.size() == 4 ? ParsePasses(args[3]) : DEFAULT_BENCHMARK_PASSES);
+                return true;
+            }
+            if ((args.size() == 4 || args.size() == 5) && args[1] == RENDER_ROOMS_ARG)
+            {
+                auto compression = ImageBuffer::PngCompression::DEFAULT;
+                if (args.size() == 5)
+                {
+                    auto it = std::find_if(PNG_COMPRESSION_NAMES.cbegin(), PNG_COMPRESSION_NAMES.cend(), [&](const auto& c)
+                        {
+                            return c.first == args[4];
+                        });
+                    if (it == PNG_COMPRESSION_NAMES.cend())
+                    {
+                        throw std::runtime_error("Unknown PNG compression \"" + args[4] + "\": expected store, fast, default or max");
+                    }
+                    compression = it->second;
+                }
+                exit_code = RenderRooms(args[2], args[3], compression);
+                return true;
+            }
+            if (args.size() == 4 && args[1] == BENCHMARK_PNG_ARG)
+            {
+                exit_code = BenchmarkPngExport(args[2], args[3]);
+                return true;
+            }
+            if (args.size() == 4 && args[1] == BENCHMARK_TMX_ARG)
+            {
+                exit_code = BenchmarkTmx(args[2], args[3]);
+                return true;
+            }
+            if ((args.size() == 3 || args.size() == 4) && args[1] == BENCHMARK_LZ77_ARG)
+            {
+                exit_code = BenchmarkLz77(args[2], args.size() == 4 ? ParsePasses(args[3]) : DEFAULT_BENCHMARK_PASSES);
+                return true;
+            }
+            if ((args.size() == 2 || args.size() == 3) && args[1] == SELF_TEST_ARG)
+            {
+                exit_code = SelfTest(args.size() == 3 ? LoadGameData(args[2]) : nullptr).Run() == 0 ? 0 : 1;
+                return true;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::fprintf(stderr, "Error: %s\n", e.what());
+            exit_code = 1;
+            return true;
+        }
+        return false;
+    }
+}
 
 // Define the MainApp
 class MainApp : public wxApp
@@ -15,6 +1141,18 @@ public:
     virtual bool OnInit() {
         wxInitAllImageHandlers();
 
+        std::vector<std::string> args;
+        for (int i = 0; i < this->argc; ++i)
+        {
+            args.push_back(this->argv[i].ToStdString());
+        }
+        int exit_code = 0;
+        if (RunCommand(args, exit_code))
+        {
+            // Returning false from OnInit would lose the command's exit code
+            std::exit(exit_code);
+        }
+
         std::string romFile("");
         if (this->argc == 2)
         {
@@ -28,4 +1166,19 @@ public:
 };
 
 DECLARE_APP(MainApp)
+#ifdef __WXMSW__
 IMPLEMENT_APP(MainApp)
+#else
+IMPLEMENT_APP_NO_MAIN(MainApp)
+
+// Commands are handled before wxWidgets is initialised, so that they can run without a display
+int main(int argc, char** argv)
+{
+    int exit_code = 0;
+    if (RunCommand(std::vector<std::string>(argv, argv + argc), exit_code))
+    {
+        return exit_code;
+    }
+    return wxEntry(argc, argv);
+}
+#endif
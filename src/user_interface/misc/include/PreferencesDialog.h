@@ -9,6 +9,9 @@ class PreferencesDialog : public wxDialog
 public:
 	PreferencesDialog(wxWindow* parent, wxConfig* config);
 	virtual ~PreferencesDialog();
+
+	// Applies the stored preferences to the rest of the program
+	static void InitConfig(wxConfig* config);
 private:
 	void Init();
 	void Commit();
@@ -27,6 +30,9 @@ private:
 	wxCheckBox* m_ctrl_run_after_build;
 	wxCheckBox* m_ctrl_build_on_save;
 	wxCheckBox* m_ctrl_clone_in_new_dir;
+	wxCheckBox* m_ctrl_optimal_lz77;
+	wxCheckBox* m_ctrl_optimal_maps;
+	wxCheckBox* m_ctrl_cache_snapshots;
 
 	wxButton* m_ok;
 	wxButton* m_cancel;
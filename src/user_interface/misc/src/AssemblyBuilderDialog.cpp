@@ -508,11 +508,13 @@ bool AssemblyBuilderDialog::DoSaveToRom()
     }
     std::ostringstream message, details;
     Rom output(*m_rom);
-    m_gd->RefreshPendingWrites(output);
-    auto result = m_gd->GetPendingWrites();
+    PendingWrites result;
     bool warning = false;
     try
     {
+        m_gd->RefreshPendingWrites(output);
+        Log(m_gd->GetInjectionTimings(), *wxBLACK);
+        result = m_gd->GetPendingWrites();
         if (!m_gd->WillFitInRom(*m_rom))
         {
             message << "Warning: Data will not fit in ROM without overwriting existing structures!\n";
@@ -565,9 +567,13 @@ bool AssemblyBuilderDialog::DoSaveToRom()
         m_gd->AbandomRomInjection();
         Log("ROM Injection abandoned.\n", *wxRED);
     }
+    else if (!m_gd->InjectIntoRom(output))
+    {
+        Log(m_gd->GetInjectionTimings(), *wxRED);
+        Log("ROM Injection failed, the ROM was not written.\n", *wxRED);
+    }
     else
     {
-        m_gd->InjectIntoRom(output);
         output.writeFile(m_dir.ToStdString());
         Log("ROM Injection complete!\n", *wxGREEN);
         retval = true;
@@ -1,7 +1,11 @@
 #include <user_interface/misc/include/PreferencesDialog.h>
 #include <wx/config.h>
+#include <wx/stdpaths.h>
 #include <user_interface/wxresource/include/wxcrafter.h>
 #include <user_interface/misc/include/AssemblyBuilderDialog.h>
+#include <landstalker/misc/include/LZ77.h>
+#include <landstalker/3d_maps/include/Tilemap3DCmp.h>
+#include <landstalker/main/include/GameData.h>
 
 PreferencesDialog::PreferencesDialog(wxWindow* parent, wxConfig* config)
     : wxDialog(parent, wxID_ANY, "Preferences", wxDefaultPosition, wxSize(600, 500)),
@@ -23,6 +27,9 @@ PreferencesDialog::PreferencesDialog(wxWindow* parent, wxConfig* config)
     m_ctrl_outname = new wxTextCtrl(this, wxID_ANY);
     m_ctrl_run_after_build = new wxCheckBox(this, wxID_ANY, "Run Emulator Following Build");
     m_ctrl_emulator = new wxTextCtrl(this, wxID_ANY);
+    m_ctrl_optimal_lz77 = new wxCheckBox(this, wxID_ANY, "Maximum LZ77 Compression (Slower Saving)");
+    m_ctrl_optimal_maps = new wxCheckBox(this, wxID_ANY, "Maximum Room Map Compression (Slower Saving)");
+    m_ctrl_cache_snapshots = new wxCheckBox(this, wxID_ANY, "Cache Decoded Assets Between Sessions");
 
 
 
@@ -48,6 +55,12 @@ PreferencesDialog::PreferencesDialog(wxWindow* parent, wxConfig* config)
     gsizer->Add(new wxStaticText(this, wxID_ANY, wxEmptyString), 1, wxEXPAND | wxALL | wxALIGN_CENTER_VERTICAL, 5);
     gsizer->Add(new wxStaticText(this, wxID_ANY, "Emulator Command:"), 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
     gsizer->Add(m_ctrl_emulator, 1, wxEXPAND | wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    gsizer->Add(m_ctrl_optimal_lz77, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    gsizer->Add(new wxStaticText(this, wxID_ANY, wxEmptyString), 1, wxEXPAND | wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    gsizer->Add(m_ctrl_optimal_maps, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    gsizer->Add(new wxStaticText(this, wxID_ANY, wxEmptyString), 1, wxEXPAND | wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    gsizer->Add(m_ctrl_cache_snapshots, 0, wxALL | wxALIGN_CENTER_VERTICAL, 5);
+    gsizer->Add(new wxStaticText(this, wxID_ANY, wxEmptyString), 1, wxEXPAND | wxALL | wxALIGN_CENTER_VERTICAL, 5);
 
     wxStdDialogButtonSizer* btnszr = new wxStdDialogButtonSizer();
     m_ok = new wxButton(this, wxID_OK, "OK");
@@ -87,6 +100,9 @@ void PreferencesDialog::Init()
         m_ctrl_outname->SetValue(m_config->Read("/build/outname"));
         m_ctrl_run_after_build->SetValue(m_config->ReadBool("/build/run_after_build", true));
         m_ctrl_emulator->SetValue(m_config->Read("/build/emulator"));
+        m_ctrl_optimal_lz77->SetValue(m_config->ReadBool("/compression/optimal_lz77", false));
+        m_ctrl_optimal_maps->SetValue(m_config->ReadBool("/compression/optimal_maps", false));
+        m_ctrl_cache_snapshots->SetValue(m_config->ReadBool("/cache/snapshots", true));
     }
 }
 
@@ -105,8 +121,29 @@ void PreferencesDialog::Commit()
         m_config->Write("/build/outname", m_ctrl_outname->GetValue());
         m_config->Write("/build/run_after_build", m_ctrl_run_after_build->GetValue());
         m_config->Write("/build/emulator", m_ctrl_emulator->GetValue());
+        m_config->Write("/compression/optimal_lz77", m_ctrl_optimal_lz77->GetValue());
+        m_config->Write("/compression/optimal_maps", m_ctrl_optimal_maps->GetValue());
+        m_config->Write("/cache/snapshots", m_ctrl_cache_snapshots->GetValue());
         m_config->Flush();
-        AssemblyBuilderDialog::InitConfig(m_config);
+        InitConfig(m_config);
+    }
+}
+
+void PreferencesDialog::InitConfig(wxConfig* config)
+{
+    AssemblyBuilderDialog::InitConfig(config);
+    if (config != nullptr)
+    {
+        LZ77::SetDefaultLevel(config->ReadBool("/compression/optimal_lz77", false) ? LZ77::Level::OPTIMAL : LZ77::Level::GREEDY);
+        Tilemap3D::SetDefaultLevel(config->ReadBool("/compression/optimal_maps", false) ? Tilemap3D::Level::MAXIMUM : Tilemap3D::Level::FAST);
+        if (config->ReadBool("/cache/snapshots", true))
+        {
+            GameData::SetSnapshotDirectory((wxStandardPaths::Get().GetUserLocalDataDir() + "/snapshots").ToStdString());
+        }
+        else
+        {
+            GameData::SetSnapshotDirectory(filesystem::path());
+        }
     }
 }
 
@@ -122,6 +122,7 @@ private:
 	};
 	void DrawRoom(uint16_t roomnum);
 	void RefreshRoom(bool redraw_tiles = false);
+	void DrawMapLayers();
 	std::vector<std::shared_ptr<Palette>> PreparePalettes(uint16_t roomnum);
 	std::vector<SpriteQ> PrepareSprites(uint16_t roomnum);
 	void DrawSprites(const std::vector<SpriteQ>& q);
@@ -211,7 +212,19 @@ private:
 	bool m_is_warp_pending;
 	WarpList::Warp m_pending_warp;
 
+	// The blocks last drawn into each map layer's buffer, after swaps and doors were applied
+	struct DrawnMapLayer
+	{
+		std::vector<uint16_t> blocks;
+		std::shared_ptr<const BlockCache> cache;
+		int left = 0;
+		int top = 0;
+		int width = 0;
+		int height = 0;
+	};
+
 	std::map<Layer, std::shared_ptr<ImageBuffer>> m_layer_bufs;
+	std::map<Tilemap3D::Layer, DrawnMapLayer> m_drawn_map_layers;
 	std::map<Layer, std::shared_ptr<wxBitmap>> m_layers;
 	std::map<Layer, uint8_t> m_layer_opacity;
 	std::unique_ptr<wxBitmap> m_bmp;
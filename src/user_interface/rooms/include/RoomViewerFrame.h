@@ -90,6 +90,7 @@ private:
 	void OnImportCsv();
 	void OnImportTmx();
 	void OnImportAllTmx();
+	ImageBuffer DrawBlocksetSheet(uint16_t roomnum) const;
 	void UpdateUI() const;
 
 	void OnKeyDown(wxKeyEvent& evt);
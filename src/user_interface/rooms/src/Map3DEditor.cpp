@@ -1058,7 +1058,8 @@ void Map3DEditor::DrawTiles()
         m_tileset = m_g->GetRoomData()->GetTilesetForRoom(m_roomnum)->GetData();
         m_blockset = m_g->GetRoomData()->GetCombinedBlocksetForRoom(m_roomnum);
         m_layer_buf->Clear();
-        m_layer_buf->Insert3DMapLayer(0, 0, 0, m_layer, m_map_disp, m_tileset, m_blockset, false, m_preview_swaps, m_preview_doors);
+        m_layer_buf->Insert3DMapLayer(0, 0, 0, Tilemap3DOverlay(*m_map_disp, m_layer, m_preview_swaps, m_preview_doors),
+            m_tileset, m_blockset, false);
         if (m_layer == Tilemap3D::Layer::FG)
         {
             m_bg_buf->Clear();
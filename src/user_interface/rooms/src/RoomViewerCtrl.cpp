@@ -3,10 +3,12 @@
 #include <wx/dcbuffer.h>
 #include <wx/graphics.h>
 #include <unordered_map>
+#include <utility>
 
 #include <user_interface/main/include/EditorFrame.h>
 #include <user_interface/rooms/include/EntityPropertiesWindow.h>
 #include <user_interface/rooms/include/WarpPropertyWindow.h>
+#include <landstalker/main/include/RoomRenderer.h>
 
 wxDEFINE_EVENT(EVT_ENTITY_UPDATE, wxCommandEvent);
 wxDEFINE_EVENT(EVT_WARP_UPDATE, wxCommandEvent);
@@ -53,8 +55,10 @@ RoomViewerCtrl::RoomViewerCtrl(wxWindow* parent, RoomViewerFrame* frame)
     m_layer_opacity = { {Layer::BACKGROUND1, 0xFF}, {Layer::BACKGROUND2, 0xFF}, {Layer::BG_SPRITES, 0xFF },
                         {Layer::FOREGROUND, 0xFF}, {Layer::FG_SPRITES, 0xFF}, {Layer::HEIGHTMAP, 0x80} };
     m_layer_bufs = { {Layer::BACKGROUND1, std::make_unique<ImageBuffer>()}, {Layer::BACKGROUND2, std::make_unique<ImageBuffer>()},
-                     {Layer::BG_SPRITES,  std::make_unique<ImageBuffer>()}, {Layer::FOREGROUND,  std::make_unique<ImageBuffer>()},
+                     {Layer::BG_SPRITES,  std::make_unique<ImageBuffer>()}, {Layer::FOREGROUND,  nullptr},
                      {Layer::FG_SPRITES,  std::make_unique<ImageBuffer>()} };
+    // Both are drawn from the FG map layer, so it is only rendered once
+    m_layer_bufs[Layer::FOREGROUND] = m_layer_bufs[Layer::BACKGROUND2];
     m_layers = { {Layer::BACKGROUND1, std::make_unique<wxBitmap>()},              {Layer::BACKGROUND2, std::make_unique<wxBitmap>()},
                  {Layer::BG_SPRITES_WIREFRAME_BG, std::make_unique<wxBitmap>()},  {Layer::BG_SPRITES,  std::make_unique<wxBitmap>()},
                  {Layer::BG_SPRITES_WIREFRAME_FG, std::make_unique<wxBitmap>()},  {Layer::FOREGROUND,  std::make_unique<wxBitmap>()},
@@ -344,9 +348,6 @@ void RoomViewerCtrl::DrawRoom(uint16_t roomnum)
         return;
     }
     auto map = m_g->GetRoomData()->GetMapForRoom(roomnum)->GetData();
-    auto blocksets = m_g->GetRoomData()->GetBlocksetsForRoom(roomnum);
-    auto tileset = m_g->GetRoomData()->GetTilesetForRoom(roomnum)->GetData();
-    auto blockset = m_g->GetRoomData()->GetCombinedBlocksetForRoom(roomnum);
     m_swaps = m_g->GetRoomData()->GetTileSwaps(roomnum);
     m_doors = m_g->GetRoomData()->GetDoors(roomnum);
     m_rpalette = PreparePalettes(roomnum);
@@ -361,27 +362,7 @@ void RoomViewerCtrl::DrawRoom(uint16_t roomnum)
     m_height = map->GetPixelHeight();
     UpdateBuffer();
 
-    if (m_layer_opacity[Layer::BACKGROUND1] > 0)
-    {
-        m_layer_bufs[Layer::BACKGROUND1]->Resize(m_width, m_height);
-        m_layer_bufs[Layer::BACKGROUND1]->Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, tileset, blockset);
-        UpdateLayer(Layer::BACKGROUND1, m_layer_bufs[Layer::BACKGROUND1]->MakeImage(
-            m_rpalette, true, m_layer_opacity[Layer::BACKGROUND1]));
-    }
-    if (m_layer_opacity[Layer::BACKGROUND2] > 0)
-    {
-        m_layer_bufs[Layer::BACKGROUND2]->Resize(m_width, m_height);
-        m_layer_bufs[Layer::BACKGROUND2]->Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset);
-        UpdateLayer(Layer::BACKGROUND2, m_layer_bufs[Layer::BACKGROUND2]->MakeImage(
-            m_rpalette, true, m_layer_opacity[Layer::BACKGROUND2]));
-    }
-    if (m_layer_opacity[Layer::FOREGROUND] > 0)
-    {
-        m_layer_bufs[Layer::FOREGROUND]->Resize(m_width, m_height);
-        m_layer_bufs[Layer::FOREGROUND]->Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset);
-        UpdateLayer(Layer::FOREGROUND, m_layer_bufs[Layer::FOREGROUND]->MakeImage(
-            m_rpalette, true, m_layer_opacity[Layer::FOREGROUND]));
-    }
+    DrawMapLayers();
     if (m_layer_opacity[Layer::HEIGHTMAP] > 0)
     {
         UpdateLayer(Layer::HEIGHTMAP, DrawHeightmapVisualisation(map, m_layer_opacity[Layer::HEIGHTMAP]));
@@ -415,35 +396,7 @@ void RoomViewerCtrl::RefreshRoom(bool redraw_tiles)
     auto q = PrepareSprites(m_roomnum);
     if (redraw_tiles)
     {
-        auto blocksets = m_g->GetRoomData()->GetBlocksetsForRoom(m_roomnum);
-        auto tileset = m_g->GetRoomData()->GetTilesetForRoom(m_roomnum)->GetData();
-        auto blockset = m_g->GetRoomData()->GetCombinedBlocksetForRoom(m_roomnum);
-        auto pswaps = GetPreviewSwaps();
-        auto pdoors = GetPreviewDoors();
-        if (m_layer_opacity[Layer::BACKGROUND1] > 0)
-        {
-            m_layer_bufs[Layer::BACKGROUND1]->Resize(m_width, m_height);
-            m_layer_bufs[Layer::BACKGROUND1]->Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::BG, map, tileset, blockset, true,
-                                                               pswaps, pdoors);
-            UpdateLayer(Layer::BACKGROUND1, m_layer_bufs[Layer::BACKGROUND1]->MakeImage(
-                m_rpalette, true, m_layer_opacity[Layer::BACKGROUND1]));
-        }
-        if (m_layer_opacity[Layer::BACKGROUND2] > 0)
-        {
-            m_layer_bufs[Layer::BACKGROUND2]->Resize(m_width, m_height);
-            m_layer_bufs[Layer::BACKGROUND2]->Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset, true,
-                                                               pswaps, pdoors);
-            UpdateLayer(Layer::BACKGROUND2, m_layer_bufs[Layer::BACKGROUND2]->MakeImage(
-                m_rpalette, true, m_layer_opacity[Layer::BACKGROUND2]));
-        }
-        if (m_layer_opacity[Layer::FOREGROUND] > 0)
-        {
-            m_layer_bufs[Layer::FOREGROUND]->Resize(m_width, m_height);
-            m_layer_bufs[Layer::FOREGROUND]->Insert3DMapLayer(0, 0, 0, Tilemap3D::Layer::FG, map, tileset, blockset, true,
-                                                              pswaps, pdoors);
-            UpdateLayer(Layer::FOREGROUND, m_layer_bufs[Layer::FOREGROUND]->MakeImage(
-                m_rpalette, true, m_layer_opacity[Layer::FOREGROUND]));
-        }
+        DrawMapLayers();
     }
     if (m_layer_opacity[Layer::HEIGHTMAP] > 0)
     {
@@ -462,6 +415,77 @@ void RoomViewerCtrl::RefreshRoom(bool redraw_tiles)
     ForceRedraw();
 }
 
+void RoomViewerCtrl::DrawMapLayers()
+{
+    // Read through the const overloads, so that drawing leaves the entries' memoised bytes valid
+    auto map = std::as_const(*m_g->GetRoomData()->GetMapForRoom(m_roomnum)).GetData();
+    auto tileset = std::as_const(*m_g->GetRoomData()->GetTilesetForRoom(m_roomnum)).GetData();
+    auto blockset = m_g->GetRoomData()->GetCombinedBlocksetForRoom(m_roomnum);
+    auto pswaps = GetPreviewSwaps();
+    auto pdoors = GetPreviewDoors();
+    const auto blocks = BlockCache::Get(*tileset, *blockset);
+    // BACKGROUND2 and FOREGROUND share the buffer holding the FG map layer
+    const std::vector<std::pair<Layer, Tilemap3D::Layer>> map_layers = {
+        {Layer::BACKGROUND1, Tilemap3D::Layer::BG}, {Layer::BACKGROUND2, Tilemap3D::Layer::FG} };
+    for (const auto& ml : map_layers)
+    {
+        auto& drawn = m_drawn_map_layers[ml.second];
+        const bool visible = m_layer_opacity[ml.first] > 0 ||
+            (ml.second == Tilemap3D::Layer::FG && m_layer_opacity[Layer::FOREGROUND] > 0);
+        if (!visible)
+        {
+            drawn = DrawnMapLayer();
+            continue;
+        }
+        auto& buf = m_layer_bufs[ml.first];
+        // The previews are resolved through an overlay, so the room's map is never copied
+        const Tilemap3DOverlay view(*map, ml.second, pswaps, pdoors);
+        // Only the cells whose block has changed are drawn again, unless the tiles, the blocks
+        // or the shape of the map are different to what is already in the buffer
+        if (blocks == nullptr || drawn.cache != blocks || drawn.left != view.GetLeft() || drawn.top != view.GetTop() ||
+            drawn.width != view.GetWidth() || drawn.height != view.GetHeight() ||
+            static_cast<int>(buf->GetWidth()) != m_width || static_cast<int>(buf->GetHeight()) != m_height)
+        {
+            drawn = DrawnMapLayer{ {}, blocks, view.GetLeft(), view.GetTop(), view.GetWidth(), view.GetHeight() };
+            drawn.blocks.reserve(drawn.width * drawn.height);
+            for (int y = 0; y < drawn.height; ++y)
+            {
+                for (int x = 0; x < drawn.width; ++x)
+                {
+                    drawn.blocks.push_back(view.GetBlock({ x, y }));
+                }
+            }
+            buf->Resize(m_width, m_height);
+            buf->Insert3DMapLayer(0, 0, 0, view, tileset, blockset);
+        }
+        else
+        {
+            std::vector<IsoPoint2D> cells;
+            for (int y = 0; y < drawn.height; ++y)
+            {
+                for (int x = 0; x < drawn.width; ++x)
+                {
+                    const uint16_t block = view.GetBlock({ x, y });
+                    uint16_t& prev = drawn.blocks[y * drawn.width + x];
+                    if (block != prev)
+                    {
+                        prev = block;
+                        cells.push_back({ x, y });
+                    }
+                }
+            }
+            buf->Redraw3DMapCells(0, view, tileset, blockset, cells);
+        }
+    }
+    for (auto layer : { Layer::BACKGROUND1, Layer::BACKGROUND2, Layer::FOREGROUND })
+    {
+        if (m_layer_opacity[layer] > 0)
+        {
+            UpdateLayer(layer, m_layer_bufs[layer]->MakeImage(m_rpalette, true, m_layer_opacity[layer]));
+        }
+    }
+}
+
 void RoomViewerCtrl::RedrawAllSprites()
 {
     m_rpalette = PreparePalettes(m_roomnum);
@@ -587,58 +611,9 @@ void RoomViewerCtrl::RefreshStatusbar()
 
 std::vector<std::shared_ptr<Palette>> RoomViewerCtrl::PreparePalettes(uint16_t roomnum)
 {
-    auto palette = std::vector<std::shared_ptr<Palette>>{ m_g->GetRoomData()->GetPaletteForRoom(roomnum)->GetData() };
-    palette.emplace_back();
-    palette.emplace_back(m_g->GetGraphicsData()->GetPlayerPalette()->GetData());
-    palette.emplace_back(m_g->GetGraphicsData()->GetHudPalette()->GetData());
     m_errors.clear();
-    std::array<int, 3> sprite_palette_alloc = { -1, -1, -1 };
     m_layer_bufs[Layer::FG_SPRITES]->Resize(m_width, m_height);
-    for (const auto& entity : m_entities)
-    {
-        auto s_pal = m_g->GetSpriteData()->GetEntityPaletteIdxs(entity.GetType());
-        const uint8_t pal_slot = entity.GetPalette();
-        if (pal_slot == 1 || pal_slot == 3)
-        {
-            const int lo = s_pal.first;
-            const int hi = s_pal.second;
-            if (lo != -1)
-            {
-                if (sprite_palette_alloc[pal_slot - 1] == -1)
-                {
-                    sprite_palette_alloc[pal_slot - 1] = lo;
-                }
-                else if (sprite_palette_alloc[pal_slot - 1] != lo)
-                {
-                    m_errors.push_back(StrPrintf("Possible Palette Clash - Slot%d Lo orig %02X, req %02X.",
-                        pal_slot, sprite_palette_alloc[pal_slot - 1], lo));
-                }
-            }
-            if (hi != -1) // Hi Palette
-            {
-                if (pal_slot == 3)
-                {
-                    m_errors.push_back(StrPrintf("Possible Palette Clash - Slot%d Hi specified, req %02X.",
-                            pal_slot, hi));
-                }
-                else
-                {
-                    if (sprite_palette_alloc[pal_slot] == -1)
-                    {
-                        sprite_palette_alloc[pal_slot] = hi;
-                    }
-                    else if (sprite_palette_alloc[pal_slot] != hi)
-                    {
-                        m_errors.push_back(StrPrintf("Possible Palette Clash - Slot%d Hi orig %02X, req %02X.",
-                            pal_slot, sprite_palette_alloc[pal_slot], hi));
-                    }
-                }
-            }
-        }
-    }
-    palette[3] = std::make_shared<Palette>(std::vector<std::shared_ptr<Palette>>{ palette[3], m_g->GetSpriteData()->GetSpritePalette(sprite_palette_alloc[2], -1) });
-    palette[1] = m_g->GetSpriteData()->GetSpritePalette(sprite_palette_alloc[0], sprite_palette_alloc[1]);
-    return palette;
+    return RoomRenderer::PrepareEntityPalettes(*m_g, roomnum, m_entities, m_errors);
 }
 
 std::vector<RoomViewerCtrl::SpriteQ> RoomViewerCtrl::PrepareSprites(uint16_t roomnum)
@@ -697,26 +672,7 @@ std::vector<RoomViewerCtrl::SpriteQ> RoomViewerCtrl::PrepareSprites(uint16_t roo
             {
                 return rhs.selected;
             }
-            // Draw objects furthest away from camera first
-            auto hitbox_lhs = m_g->GetSpriteData()->GetEntityHitbox(lhs.entity.GetType());
-            auto hitbox_rhs = m_g->GetSpriteData()->GetEntityHitbox(rhs.entity.GetType());
-            int dist_lhs = lhs.entity.GetX() + lhs.entity.GetY() + hitbox_lhs.first;
-            int dist_rhs = rhs.entity.GetX() + rhs.entity.GetY() + hitbox_rhs.first;
-            if (dist_lhs != dist_rhs)
-            {
-                return dist_lhs < dist_rhs;
-            }
-            // Next draw left-most objects
-            int left_lhs = lhs.entity.GetY() - hitbox_lhs.first;
-            int left_rhs = rhs.entity.GetY() - hitbox_rhs.first;
-            if (left_lhs != left_rhs)
-            {
-                return left_lhs < left_rhs;
-            }
-            // Finally, sort by height
-            int height_lhs = lhs.entity.GetZ() + hitbox_lhs.second;
-            int height_rhs = rhs.entity.GetZ() + hitbox_rhs.second;
-            return height_lhs < height_rhs;
+            return RoomRenderer::DrawsBefore(*m_g->GetSpriteData(), lhs.entity, rhs.entity);
         });
     return sprites;
 }
@@ -1,7 +1,10 @@
 #include <user_interface/rooms/include/RoomViewerFrame.h>
 
 #include <fstream>
+#include <map>
+#include <set>
 #include <sstream>
+#include <utility>
 #include <wx/busyinfo.h>
 #include <wx/dir.h>
 #include <user_interface/rooms/include/FlagDialog.h>
@@ -10,6 +13,7 @@
 #include <user_interface/rooms/include/RoomErrorDialog.h>
 #include <user_interface/rooms/include/TileSwapDialog.h>
 #include <landstalker/3d_maps/include/MapToTmx.h>
+#include <landstalker/main/include/PngWriter.h>
 #include <user_interface/rooms/include/RoomViewerCtrl.h>
 
 enum MENU_IDS
@@ -380,11 +384,9 @@ bool RoomViewerFrame::ExportCsv(const std::array<std::string, 3>& paths)
 	return true;
 }
 
-bool RoomViewerFrame::ExportTmx(const std::string& tmx_path, const std::string& bs_path, uint16_t roomnum)
+ImageBuffer RoomViewerFrame::DrawBlocksetSheet(uint16_t roomnum) const
 {
-	auto map = m_g->GetRoomData()->GetMapForRoom(roomnum)->GetData();
 	auto blocksets = m_g->GetRoomData()->GetCombinedBlocksetForRoom(roomnum);
-	auto palette = std::vector<std::shared_ptr<Palette>>{ m_g->GetRoomData()->GetPaletteForRoom(roomnum)->GetData() };
 	auto tileset = m_g->GetRoomData()->GetTilesetForRoom(roomnum)->GetData();
 
 	const int width = 16;
@@ -409,29 +411,51 @@ bool RoomViewerFrame::ExportTmx(const std::string& tmx_path, const std::string&
 			}
 		}
 	}
-	buf.WritePNG(bs_path, { palette }, true);
+	return buf;
+}
+
+bool RoomViewerFrame::ExportTmx(const std::string& tmx_path, const std::string& bs_path, uint16_t roomnum)
+{
+	auto palette = std::vector<std::shared_ptr<Palette>>{ m_g->GetRoomData()->GetPaletteForRoom(roomnum)->GetData() };
+	DrawBlocksetSheet(roomnum).WritePNG(bs_path, { palette }, true);
 	return MapToTmx::ExportToTmx(tmx_path, *m_g->GetRoomData()->GetMapForRoom(roomnum)->GetData(), bs_path);
 }
 
 bool RoomViewerFrame::ExportAllTmx(const std::string& dir)
 {
 	wxBusyInfo wait("Exporting...");
-	wxString curdir = wxGetCwd();
-	wxSetWorkingDirectory(dir);
 	filesystem::path mappath(dir);
 	filesystem::path bspath(mappath / "blocksets");
 	filesystem::create_directories(bspath);
+	// Several rooms can share a map or a blockset sheet, so each file is only written once. As
+	// before, the last room to use a map decides which sheet its TMX refers to.
+	std::map<std::string, MapToTmx::ExportRequest> tmx_requests;
+	std::set<std::string> blocksets;
+	PngWriter png_writer;
 	for (std::size_t i = 0; i < m_g->GetRoomData()->GetRoomCount(); ++i)
 	{
 		auto rd = m_g->GetRoomData()->GetRoom(i);
-		std::string mapfile = rd->map + ".tmx";
+		std::string mapfile = (mappath / (rd->map + ".tmx")).str();
 		std::string blkname = StrPrintf("BT%02d_%01d%01d_p%02d.png", rd->tileset + 1, rd->pri_blockset, rd->sec_blockset + 1, rd->room_palette + 1);
 		std::string blkpath = "blocksets";
 		blkpath += wxFileName::GetPathSeparator() + blkname;
-		ExportTmx(mapfile, blkpath, i);
+		if (blocksets.insert(blkname).second)
+		{
+			auto palette = std::vector<std::shared_ptr<Palette>>{
+				std::make_shared<Palette>(*std::as_const(*m_g->GetRoomData()->GetPaletteForRoom(i)).GetData()) };
+			png_writer.Write((bspath / blkname).str(), DrawBlocksetSheet(i), palette);
+		}
+		// Exporting only reads the maps, so their memoised bytes stay valid
+		tmx_requests[mapfile] = { mapfile, std::as_const(*m_g->GetRoomData()->GetMapForRoom(i)).GetData(), blkpath };
 	}
-	wxSetWorkingDirectory(curdir);
-	return true;
+	std::vector<MapToTmx::ExportRequest> requests;
+	for (const auto& r : tmx_requests)
+	{
+		requests.push_back(r.second);
+	}
+	auto failed = MapToTmx::ExportAll(requests);
+	auto failed_png = png_writer.Wait();
+	return failed.empty() && failed_png.empty();
 }
 
 bool RoomViewerFrame::ExportPng(const std::string& path)
@@ -455,7 +479,7 @@ bool RoomViewerFrame::ImportBin(const std::string& path)
 {
 	auto bytes = ReadBytes(path);
 	auto data = m_g->GetRoomData()->GetMapForRoom(m_roomnum);
-	data->GetData()->Decode(bytes.data());
+	data->GetData()->Decode(bytes.data(), bytes.size());
 	UpdateFrame();
 	return true;
 }
@@ -473,26 +497,25 @@ bool RoomViewerFrame::ImportAllTmx(const std::string& dir)
 	wxBusyInfo wait("Importing...");
 	wxDir d;
 
-	wxString curdir = wxGetCwd();
-	wxSetWorkingDirectory(dir);
+	std::vector<MapToTmx::ImportRequest> requests;
 	if (d.Open(dir))
 	{
 		wxString file;
 		bool cont = d.GetFirst(&file, "*.tmx");
 		while (cont)
 		{
-			wxFileName name(file);
+			wxFileName name(dir, file);
 			auto map = m_g->GetRoomData()->GetMap(name.GetName().ToStdString());
 			if (map)
 			{
-				MapToTmx::ImportFromTmx(file.ToStdString(), *map->GetData());
+				requests.push_back({ name.GetFullPath().ToStdString(), map->GetData() });
 			}
 			cont = d.GetNext(&file);
 		}
 	}
-	wxSetWorkingDirectory(curdir);
+	auto failed = MapToTmx::ImportAll(requests);
 	UpdateFrame();
-	return true;
+	return failed.empty();
 }
 
 bool RoomViewerFrame::ImportCsv(const std::array<std::string, 3>& paths)
@@ -164,7 +164,6 @@ private:
 	std::set<int> m_redraw_list;
 	bool m_redraw_all;
 	mutable std::vector<uint8_t> m_clipboard;
-	mutable std::vector<uint8_t> m_swapbuffer;
 	int m_pendingswap;
 
 	std::unique_ptr<wxBrush> m_alpha_brush;
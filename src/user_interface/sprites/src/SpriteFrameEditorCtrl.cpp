@@ -514,9 +514,7 @@ void SpriteFrameEditorCtrl::SwapCell()
 	}
 	else
 	{
-		m_swapbuffer = m_tiles->GetTilePixels(m_pendingswap);
-		m_tiles->SetTile(m_pendingswap, m_tiles->GetTilePixels(m_selectedtile));
-		m_tiles->SetTile(m_selectedtile, m_swapbuffer);
+		m_tiles->SwapTile(m_pendingswap, m_selectedtile);
 		FireEvent(EVT_SPRITE_FRAME_CHANGE, std::to_string(m_pendingswap));
 		FireEvent(EVT_SPRITE_FRAME_CHANGE, std::to_string(GetSelectedTile().GetIndex()));
 		m_pendingswap = -1;
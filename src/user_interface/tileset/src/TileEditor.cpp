@@ -3,6 +3,7 @@
 #include <wx/dcmemory.h>
 #include <wx/dcbuffer.h>
 #include <algorithm>
+#include <utility>
 
 wxBEGIN_EVENT_TABLE(TileEditor, wxHVScrolledWindow)
 EVT_PAINT(TileEditor::OnPaint)
@@ -70,7 +71,8 @@ void TileEditor::SetGameData(std::shared_ptr<GameData> gd)
 void TileEditor::SetTileset(std::shared_ptr<Tileset> tileset)
 {
 	m_tileset = tileset;
-	m_pixels = m_tileset->GetTilePixels(m_tile.GetIndex());
+	auto pixels = std::as_const(*m_tileset).GetTilePixels(m_tile.GetIndex());
+	m_pixels.assign(pixels.begin(), pixels.end());
 	SetRowColumnCount(m_tileset->GetTileHeight(), m_tileset->GetTileWidth());
 	AutoSize();
 	wxVarHScrollHelper::RefreshAll();
@@ -83,7 +85,8 @@ void TileEditor::SetTile(const Tile& tile)
 	m_tile = tile;
 	if (m_tileset != nullptr)
 	{
-		m_pixels = m_tileset->GetTilePixels(tile.GetIndex());
+		auto pixels = std::as_const(*m_tileset).GetTilePixels(tile.GetIndex());
+		m_pixels.assign(pixels.begin(), pixels.end());
 	}
 	else
 	{
@@ -437,7 +440,7 @@ void TileEditor::MouseDraw(const Point& point)
 		if (!m_pixels.empty() && m_pixels.at(px) != colour)
 		{
 			m_pixels.at(px) = colour;
-			m_tileset->GetTilePixels(m_tile.GetIndex()) = m_pixels;
+			m_tileset->SetTilePixels(m_tile.GetIndex(), ConstTilePixels(m_pixels.data(), m_pixels.size()));
 			refresh = true;
 			FireEvent(EVT_TILE_CHANGE);
 		}
@@ -520,7 +523,7 @@ bool TileEditor::SetColour(const Point& point, int colour)
 		if (m_pixels[pixel] != colour)
 		{
 			m_pixels[pixel] = colour;
-			m_tileset->GetTilePixels(m_tile.GetIndex()) = m_pixels;
+			m_tileset->SetTilePixels(m_tile.GetIndex(), ConstTilePixels(m_pixels.data(), m_pixels.size()));
 			Refresh(true);
 			retval = true;
 		}
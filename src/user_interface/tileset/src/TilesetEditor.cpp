@@ -748,7 +748,7 @@ void TilesetEditor::PasteTile(const Tile& tile)
 {
 	if ((tile.GetIndex() <= m_tileset->GetTileCount()) && !IsClipboardEmpty())
 	{
-		m_tileset->GetTilePixels(tile.GetTileValue()) = m_clipboard;
+		m_tileset->SetTile(tile, m_clipboard);
 		m_redraw_list.insert(tile.GetTileValue());
 		Refresh();
 		FireEvent(EVT_TILESET_CHANGE, std::to_string(tile.GetTileValue()));